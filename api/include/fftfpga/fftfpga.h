@@ -9,6 +9,7 @@
 #define FFTFPGA_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * Single Precision Complex Floating Point Data Structure
@@ -26,6 +27,16 @@ typedef struct {
   double y; /**< imaginary value */
 } double2;
 
+/**
+ * Backend that computed a transform
+ */
+typedef enum {
+  FFTFPGA_BACKEND_FPGA = 0,   /**< FPGA bitstream */
+  FFTFPGA_BACKEND_CPU,        /**< FFTW on the host */
+  FFTFPGA_BACKEND_HYBRID,     /**< FPGA and FFTW on the host */
+  FFTFPGA_BACKEND_MODEL       /**< software model of the kernels on the host */
+} fftfpga_backend_t;
+
 /**
  * Record time in milliseconds of different FPGA runtime stages
  */
@@ -36,8 +47,29 @@ typedef struct fpga_timing {
   double svm_copyin_t;    /**< Time to copy in data to SVM */
   double svm_copyout_t;   /**< Time to copy data out of SVM */ 
   bool valid;             /**< Represents true signifying valid execution */
+  fftfpga_backend_t backend; /**< Backend that computed the transform */
 } fpga_t;
 
+/**
+ * Opaque handle to single precision complex data resident in the global memory of the FPGA
+ */
+typedef struct fftfpga_buffer fftfpga_buffer_t;
+
+/**
+ * Opaque handle to a transform submitted for micro-batching
+ */
+typedef struct fftfpga_request fftfpga_request_t;
+
+/**
+ * Producer of a streamed batch: fills the slot with the input of the k-th transform, returns false if the stream has ended
+ */
+typedef bool (*fftfpga_produce_t)(float2 *slot, const size_t k, void *user_data);
+
+/**
+ * Consumer of a streamed batch: the slot holds the output of the k-th transform until the consumer returns
+ */
+typedef void (*fftfpga_consume_t)(const float2 *slot, const size_t k, void *user_data);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -60,6 +92,21 @@ extern int fpga_initialize(const char *platform_name, const char *path, const bo
  */
 extern void fpga_final();
 
+/** 
+ * @brief Configure the fallback to FFTW on the host, used when no device or bitstream is loaded, the bitstream lacks the kernels or size required, or the transform is too small to benefit from the FPGA. Disabled by default, unless the environment variable FFTFPGA_FALLBACK=1 is set.
+ * @param enable          : toggle the fallback
+ * @param fpga_n          : number of points per dimension the loaded bitstream is synthesized for, 0 if unknown
+ * @param min_fpga_points : transforms with fewer points, counting all batches, are computed on the host
+ */
+extern void fftfpga_set_fallback(const bool enable, const unsigned fpga_n, const unsigned min_fpga_points);
+
+/**
+ * @brief Configure how the library and fftfpga_request_wait() wait for the FPGA. By default the calling thread polls for 20 microseconds, then sleeps until a callback of the completion event wakes it, instead of blocking in clFinish() or clWaitForEvents(), which some runtimes implement by spinning.
+ * @param callbacks : wait using event callbacks, else using clFinish() and clWaitForEvents()
+ * @param spin_us   : microseconds to poll for the completion before sleeping
+ */
+extern void fftfpga_set_wait_policy(const bool callbacks, const unsigned spin_us);
+
 /** 
  * @brief Allocate memory of double precision complex floating points
  * @param sz  : size_t - size to allocate
@@ -75,10 +122,10 @@ extern void* fftfpga_complex_malloc(const size_t sz);
 extern void* fftfpgaf_complex_malloc(const size_t sz);
 
 /**
- * @brief  compute an out-of-place double precision complex 1D-FFT on the FPGA
+ * @brief  compute an out-of-place double precision complex 1D-FFT on the FPGA in single precision, converting in chunks overlapped with the transfers
  * @param  N    : integer pointer to size of FFT3d  
- * @param  inp  : double2 pointer to input data of size N
- * @param  out  : double2 pointer to output data of size N
+ * @param  inp  : double2 pointer to input data of size [N * iter]
+ * @param  out  : double2 pointer to output data of size [N * iter]
  * @param  inv  : int toggle to activate backward FFT
  * @param  iter : number of iterations of the N point FFT
  * @return fpga_t : time taken in milliseconds for data transfers and execution
@@ -96,6 +143,27 @@ extern fpga_t fftfpga_c2c_1d(const unsigned N, const double2 *inp, double2 *out,
  */
 extern fpga_t fftfpgaf_c2c_1d(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned iter);
 
+/**
+ * @brief  compute an out-of-place single precision complex 1D-FFT on the FPGA with the output in natural order instead of bit reversed order. The fft1d_natural bitstream reorders on chip, otherwise the output is reordered on the host while it is transferred.
+ * @param  N     : unsigned integer size of FFT1d
+ * @param  inp   : float2 pointer to input data of size [N * batch]
+ * @param  out   : float2 pointer to output data of size [N * batch]
+ * @param  inv   : toggle to activate backward FFT
+ * @param  batch : number of transforms
+ * @return fpga_t : time taken in milliseconds for data transfers and execution, pcie_read_t including the reordering on the host
+ */
+extern fpga_t fftfpgaf_c2c_1d_natural(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch);
+
+/**
+ * @brief  compute an out-of-place single precision complex 1D-FFT larger than the 1D engine using the four-step decomposition on the 2D engine of the fft_large bitstream, with the intermediate result in the DDR of the FPGA
+ * @param  N    : unsigned integer size of FFT1d, the square of the size of the 2D engine
+ * @param  inp  : float2 pointer to input data of size N
+ * @param  out  : float2 pointer to output data of size N in natural order
+ * @param  inv  : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_1d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv);
+
 /**
  * @brief  compute an out-of-place single precision complex 1D-FFT on the FPGA
  * @param  N    : integer pointer to size of FFT3d  
@@ -130,6 +198,16 @@ extern fpga_t fftfpgaf_c2c_2d_bram(const unsigned N, const float2 *inp, float2 *
  */
 extern fpga_t fftfpgaf_c2c_2d_bram_svm(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
 
+/**
+ * @brief  compute an out-of-place double precision complex 2D-FFT using the DDR of the FPGA in single precision, converting in chunks overlapped with the transfers
+ * @param  N    : integer pointer to size of FFT2d
+ * @param  inp  : double2 pointer to input data of size [N * N]
+ * @param  out  : double2 pointer to output data of size [N * N]
+ * @param  inv  : int toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution, pcie_write_t and pcie_read_t including the conversions
+ */
+extern fpga_t fftfpga_c2c_2d_ddr(const unsigned N, const double2 *inp, double2 *out, const bool inv);
+
 /**
  * @brief  compute an out-of-place single precision complex 2D-FFT using the DDR of the FPGA
  * @param  N    : integer pointer to size of FFT2d  
@@ -151,6 +229,27 @@ extern fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *o
  */
 extern fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving);
 
+/**
+ * @brief  compute a batch of out-of-place single precision complex 3D-FFTs using the persistent bitstream, launching only fetch and store per call
+ * @param  N        : unsigned integer size of FFT3d, the size the bitstream is synthesized for
+ * @param  inp      : float2 pointer to input data of size [N * N * N * how_many]
+ * @param  out      : float2 pointer to output data of size [N * N * N * how_many]
+ * @param  inv      : toggle to activate backward FFT
+ * @param  how_many : number of transforms
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_persistent(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
+
+/**
+ * @brief  compute an out-of-place double precision complex 3D-FFT using the DDR of the FPGA in single precision, converting in chunks overlapped with the transfers
+ * @param  N    : integer pointer addressing the size of FFT3d
+ * @param  inp  : double2 pointer to input data of size [N * N * N]
+ * @param  out  : double2 pointer to output data of size [N * N * N]
+ * @param  inv  : int toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution, pcie_write_t and pcie_read_t including the conversions
+ */
+extern fpga_t fftfpga_c2c_3d_ddr(const unsigned N, const double2 *inp, double2 *out, const bool inv);
+
 /**
  * @brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA
  * @param  N    : integer pointer addressing the size of FFT3d  
@@ -161,8 +260,77 @@ extern fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *
  */
 extern fpga_t fftfpgaf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv);
 
+/**
+ * @brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA, leaving the output transposed instead of reordering it on chip. Requires the fft3d_ddr_transposed bitstream.
+ *         Point (z, y, x) of the transform is at out[(x * N + y) * N + z]. A transposed input is transformed back to the natural order, so forward transforms return transposed spectra and backward transforms of them natural data.
+ * @param  N    : unsigned integer size of FFT3d
+ * @param  inp  : float2 pointer to input data of size [N * N * N], natural or transposed
+ * @param  out  : float2 pointer to output data of size [N * N * N], in the other order than the input
+ * @param  inv  : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_transposed(const unsigned N, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  compute a single precision complex 3D-FFT using the DDR of the FPGA of an input that is zero outside of the subcube [0, m_in)^3, such as a zero-padded cube, of which only the subcube [0, m_out)^3 of the output is required. Only the subcubes are transferred over PCIe. Requires the fft3d_ddr_pruned bitstream.
+ * @param  N     : unsigned integer size of FFT3d
+ * @param  m_in  : unsigned integer size of the input subcube, at most N
+ * @param  m_out : unsigned integer size of the output subcube, at most N
+ * @param  inp   : float2 pointer to the input subcube of size [m_in * m_in * m_in]
+ * @param  out   : float2 pointer to the output subcube of size [m_out * m_out * m_out]
+ * @param  inv   : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_pruned(const unsigned N, const unsigned m_in, const unsigned m_out, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA on split complex data, whose real and imaginary parts are separate arrays, without interleaving them on the host. Requires the fft3d_ddr_split bitstream.
+ * @param  N      : unsigned integer size of FFT3d
+ * @param  inp_re : float pointer to the real part of the input of size [N * N * N]
+ * @param  inp_im : float pointer to the imaginary part of the input of size [N * N * N]
+ * @param  out_re : float pointer to the real part of the output of size [N * N * N]
+ * @param  out_im : float pointer to the imaginary part of the output of size [N * N * N]
+ * @param  inv    : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_split(const unsigned N, const float *inp_re, const float *inp_im, float *out_re, float *out_im, const bool inv);
+
 extern fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving, const unsigned how_many);
 
+/**
+ * @brief  compute a batch of out-of-place single precision complex 3D-FFTs using the DDR of the FPGA, writing each input to the FPGA from and reading each output back to its own array, e.g. the transforms of several processes, without gathering them on the host
+ * @param  N        : unsigned integer size of FFT3d
+ * @param  inp      : [how_many] float2 pointers to the inputs of size [N * N * N]
+ * @param  out      : [how_many] float2 pointers to the outputs of size [N * N * N]
+ * @param  inv      : toggle to activate backward FFT
+ * @param  how_many : number of transforms, at least 2
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_batch_gather(const unsigned N, const float2 *const *inp, float2 *const *out, const bool inv, const unsigned how_many);
+
+/**
+ * @brief  compute a batch of out-of-place single precision complex 3D-FFTs split between the FPGA and multithreaded FFTW on the host. The share of each side adapts to the throughput measured in previous calls.
+ * @param  N    : unsigned integer size of FFT3d  
+ * @param  inp  : float2 pointer to input data of size [N * N * N * how_many]
+ * @param  out  : float2 pointer to output data of size [N * N * N * how_many]
+ * @param  inv  : toggle to activate backward FFT
+ * @param  interleaving : enable burst interleaved global memory buffers
+ * @param  how_many : number of batched computations
+ * @return fpga_t : time taken in milliseconds for the FPGA data transfers, exec_t being the total time of the batch
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_batch_hybrid(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving, const unsigned how_many);
+
+/**
+ * @brief  compute a stream of out-of-place single precision complex 3D-FFTs using the DDR of the FPGA, the inputs being produced and the outputs consumed one transform at a time. The callbacks are called in order from a thread of the library while the FPGA computes the next transform, so that the memory required does not depend on the length of the stream.
+ * @param  N         : unsigned integer size of FFT3d
+ * @param  inv       : toggle to activate backward FFT
+ * @param  produce   : fills a slot of [N * N * N] points with the next input
+ * @param  consume   : reads the output of a transform from a slot of [N * N * N] points
+ * @param  user_data : passed to the callbacks
+ * @return fpga_t : time taken in milliseconds for data transfers and execution, summed over the stream
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_stream(const unsigned N, const bool inv, fftfpga_produce_t produce, fftfpga_consume_t consume, void *user_data);
+
 /**
  * @brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA and Shared Virtual Memory for Host to Device Communication
  * @param  N    : unsigned integer size of FFT3d  
@@ -185,6 +353,153 @@ extern fpga_t fftfpgaf_c2c_3d_ddr_svm(const unsigned N, const float2 *inp, float
  */
 extern fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
 
+/**
+ * @brief  upload the filter of 3D convolutions to the global memory of the FPGA, where it stays until replaced or released by fpga_final()
+ * @param  N      : unsigned integer size of FFT3d
+ * @param  filter : float2 pointer to the transformed filter of size [N * N * N] in natural order
+ * @return fpga_t : time taken in milliseconds for the data transfer
+ */
+extern fpga_t fftfpgaf_conv3d_set_kernel(const unsigned N, const float2 *filter);
+
+/**
+ * @brief  compute a single precision complex 3D convolution with the filter set by fftfpgaf_conv3d_set_kernel(), as the backward FFT of the product of the forward FFT of the input with the filter. The intermediate result remains on the FPGA.
+ * @param  N    : unsigned integer size of FFT3d, same as the filter
+ * @param  inp  : float2 pointer to input data of size [N * N * N]
+ * @param  out  : float2 pointer to output data of size [N * N * N], scaled by N * N * N as the backward FFT is not normalized
+ * @return fpga_t : time taken in milliseconds for data transfers and execution of both transforms
+ */
+extern fpga_t fftfpgaf_conv3d(const unsigned N, const float2 *inp, float2 *out);
+
+/**
+ * @brief  compute the gradient of a field by spectral differentiation, as the backward FFTs of the product of the forward FFT of the field with i * scale * k of each component of the wave vector. The field is transferred once and its spectrum remains on the FPGA. Requires the fft3d_ddr_gradient bitstream.
+ * @param  N      : unsigned integer size of FFT3d
+ * @param  inp    : float2 pointer to the field of size [N * N * N]
+ * @param  grad_x : float2 pointer to the derivative along x, the fastest dimension, of size [N * N * N]
+ * @param  grad_y : float2 pointer to the derivative along y of size [N * N * N]
+ * @param  grad_z : float2 pointer to the derivative along z of size [N * N * N]
+ * @param  scale  : factor of the wave numbers, 2 * pi / L for a box of length L, which can include the normalization 1 / (N * N * N) of the backward FFTs
+ * @return fpga_t : time taken in milliseconds for data transfers and execution of all transforms
+ */
+extern fpga_t fftfpgaf_gradient3d(const unsigned N, const float2 *inp, float2 *grad_x, float2 *grad_y, float2 *grad_z, const float scale);
+
+/**
+ * @brief  set the coefficients inside a cutoff sphere of 3D transforms, such as the G-vectors of plane-wave codes. Their slot map of the cube is uploaded to the global memory of the FPGA, where it stays until replaced or released by fpga_final(). Requires the fft3d_ddr_sphere bitstream.
+ * @param  N   : unsigned integer size of FFT3d
+ * @param  map : index (z * N + y) * N + x in the cube of each packed coefficient, all distinct
+ * @param  num : number of packed coefficients
+ * @return fpga_t : time taken in milliseconds for the data transfer
+ */
+extern fpga_t fftfpgaf_sphere_set_map(const unsigned N, const unsigned *map, const size_t num);
+
+/**
+ * @brief  compute a single precision complex 3D-FFT of the coefficients packed inside the sphere set by fftfpgaf_sphere_set_map(), scattered into the cube on the FPGA with zeros outside of the sphere
+ * @param  N      : unsigned integer size of FFT3d, same as the map
+ * @param  packed : float2 pointer to the packed coefficients of size [num] of the map
+ * @param  grid   : float2 pointer to output data of size [N * N * N]
+ * @param  inv    : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_sphere_to_grid(const unsigned N, const float2 *packed, float2 *grid, const bool inv);
+
+/**
+ * @brief  compute a single precision complex 3D-FFT of a cube, gathering only the coefficients inside the sphere set by fftfpgaf_sphere_set_map() on the FPGA
+ * @param  N      : unsigned integer size of FFT3d, same as the map
+ * @param  grid   : float2 pointer to input data of size [N * N * N]
+ * @param  packed : float2 pointer to the packed coefficients of size [num] of the map
+ * @param  inv    : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_grid_to_sphere(const unsigned N, const float2 *grid, float2 *packed, const bool inv);
+
+/**
+ * @brief  copy the data accessed by the load and store callbacks of fftfpgaf_c2c_3d_ddr() to the global memory of the FPGA, where it stays until replaced or released by fpga_final(). Transforms of another size than N are passed NULL instead.
+ * @param  N          : unsigned integer size of FFT3d
+ * @param  load_data  : float2 pointer to data of size [N * N * N] passed to load_cb, NULL if unused
+ * @param  store_data : float2 pointer to data of size [N * N * N] passed to store_cb, NULL if unused
+ * @return fpga_t : time taken in milliseconds for the data transfers
+ */
+extern fpga_t fftfpgaf_set_callback_data(const unsigned N, const float2 *load_data, const float2 *store_data);
+
+/**
+ * @brief  create a buffer of single precision complex points in the global memory of the FPGA, on the host if no device is initialized. The global memory is released by fpga_final(), the handle by fftfpga_buffer_free().
+ * @param  num_pts : number of points
+ * @return handle to the buffer, NULL on failure
+ */
+extern fftfpga_buffer_t* fftfpga_buffer_create(const size_t num_pts);
+
+/**
+ * @brief  release a buffer
+ * @param  buf : handle to the buffer, may be NULL
+ */
+extern void fftfpga_buffer_free(fftfpga_buffer_t *buf);
+
+/**
+ * @brief  number of points of a buffer
+ * @param  buf : handle to the buffer
+ * @return number of points, 0 if NULL
+ */
+extern size_t fftfpga_buffer_size(const fftfpga_buffer_t *buf);
+
+/**
+ * @brief  copy data from the host to a buffer
+ * @param  buf : handle to the buffer
+ * @param  src : float2 pointer to data of the size of the buffer
+ * @return fpga_t : time taken in milliseconds for the data transfer
+ */
+extern fpga_t fftfpga_buffer_write(fftfpga_buffer_t *buf, const float2 *src);
+
+/**
+ * @brief  copy data from a buffer to the host
+ * @param  buf : handle to the buffer
+ * @param  dst : float2 pointer to memory of the size of the buffer
+ * @return fpga_t : time taken in milliseconds for the data transfer
+ */
+extern fpga_t fftfpga_buffer_read(const fftfpga_buffer_t *buf, float2 *dst);
+
+/**
+ * @brief  compute a single precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose on buffers that remain in the global memory of the FPGA, without transfers over PCIe
+ * @param  N    : unsigned integer size of FFT3d
+ * @param  inp  : handle to the input buffer of at least [N * N * N] points
+ * @param  out  : handle to the output buffer of at least [N * N * N] points, may be the input buffer
+ * @param  inv  : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for execution, and for data transfers only if computed on the host
+ */
+extern fpga_t fftfpgaf_c2c_3d_ddr_buffer(const unsigned N, const fftfpga_buffer_t *inp, fftfpga_buffer_t *out, const bool inv);
+
+/**
+ * @brief  compute an out-of-place single precision complex 3D-FFT larger than the on-chip transpose buffers of the 3D bitstreams, using the 2D engine of the fft_large bitstream and the DDR of the FPGA for all transposes
+ * @param  N    : unsigned integer denoting the size of FFT3d, the size of the 2D engine
+ * @param  inp  : float2 pointer to input data of size [N * N * N]
+ * @param  out  : float2 pointer to output data of size [N * N * N]
+ * @param  inv  : toggle to activate backward FFT
+ * @return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+extern fpga_t fftfpgaf_c2c_3d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  configure the micro-batching of fftfpgaf_c2c_3d_ddr_submit(). By default a request waits at most 200 microseconds for 15 others.
+ * @param  window_us    : longest time in microseconds a request waits for others of the same size and direction
+ * @param  max_requests : number of requests of the same size and direction computed as soon as they are queued, at least 1
+ */
+extern void fftfpga_set_microbatch(const unsigned window_us, const unsigned max_requests);
+
+/**
+ * @brief  submit an out-of-place single precision complex 3D-FFT using the DDR of the FPGA, computed by a thread of the library together with the requests of the same size and direction submitted within the window. Other transforms of the library must not be called while requests are pending.
+ * @param  N    : unsigned integer size of FFT3d
+ * @param  inp  : float2 pointer to input data of size [N * N * N], read until the request completes
+ * @param  out  : float2 pointer to output data of size [N * N * N]
+ * @param  inv  : toggle to activate backward FFT
+ * @return handle to wait for using fftfpga_request_wait(), NULL if invalid
+ */
+extern fftfpga_request_t* fftfpgaf_c2c_3d_ddr_submit(const unsigned N, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  wait for a submitted request, polling and then sleeping as set by fftfpga_set_wait_policy(), and release it
+ * @param  req : handle returned by fftfpgaf_c2c_3d_ddr_submit(), may be NULL
+ * @return fpga_t : share of the request in the time taken for data transfers and execution of its batch, invalid if NULL
+ */
+extern fpga_t fftfpga_request_wait(fftfpga_request_t *req);
+
 #ifdef __cplusplus
 }
 #endif
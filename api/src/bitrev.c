@@ -0,0 +1,97 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "fftfpga/fftfpga.h"
+#include "bitrev.h"
+#include "parallel.h"
+
+// log2 of the edge of the tiles permuted in cache, 32 x 32 points of 8 bytes
+#define LOG_TILE 5
+
+/**
+ * Transforms permuted by the threads, split by tiles over all transforms
+ */
+typedef struct {
+  float2 *out;
+  const float2 *inp;
+  unsigned log_n;
+} bitrev_work_t;
+
+static unsigned reverse(unsigned x, const unsigned bits){
+  unsigned y = 0;
+  for(unsigned i = 0; i < bits; i++){
+    y = (y << 1) | (x & 1);
+    x >>= 1;
+  }
+  return y;
+}
+
+/**
+ * \brief  permute tiles of a range. An index of log_n bits is split into the
+ *         fields [a | b | c], a and c having q bits. The tile of a given b
+ *         holds the 2^q rows a of 2^q contiguous points c, which are read
+ *         contiguously and written contiguously to the rows rev(c) at the
+ *         columns rev(a) of the tile rev(b).
+ */
+static void permute_tiles(void *arg, const size_t begin, const size_t end){
+  const bitrev_work_t *work = (const bitrev_work_t*)arg;
+  const unsigned log_n = work->log_n;
+  const unsigned q = (log_n / 2 < LOG_TILE) ? log_n / 2 : LOG_TILE;
+  const unsigned mid = log_n - 2 * q;
+  const size_t N = (size_t)1 << log_n;
+  const unsigned T = 1u << q;
+  const size_t tiles = (size_t)1 << mid;
+
+  float2 tile[1 << LOG_TILE][1 << LOG_TILE];
+  unsigned rev_q[1 << LOG_TILE];
+  for(unsigned i = 0; i < T; i++){
+    rev_q[i] = reverse(i, q);
+  }
+
+  for(size_t t = begin; t < end; t++){
+    const size_t batch = t / tiles;
+    const unsigned b = (unsigned)(t % tiles);
+    const float2 *src = &work->inp[batch * N + ((size_t)b << q)];
+    float2 *dst = &work->out[batch * N + ((size_t)reverse(b, mid) << q)];
+
+    // rows of the tile in bit reversed order
+    for(unsigned a = 0; a < T; a++){
+      const float2 *row = &src[(size_t)a << (log_n - q)];
+      float2 *trow = tile[rev_q[a]];
+      for(unsigned c = 0; c < T; c++){
+        trow[c] = row[c];
+      }
+    }
+
+    // columns of the tile in bit reversed order
+    for(unsigned c = 0; c < T; c++){
+      float2 *row = &dst[(size_t)rev_q[c] << (log_n - q)];
+      for(unsigned a = 0; a < T; a++){
+        row[a] = tile[a][c];
+      }
+    }
+  }
+}
+
+/**
+ * \brief  permute a batch of 1D transforms from bit reversed to natural order, or back, using a cache blocked permutation split among threads
+ * \param  out      : float2 pointer to output of size [how_many * N], not overlapping the input
+ * \param  inp      : float2 pointer to input of size [how_many * N]
+ * \param  N        : number of points of a transform, a power of 2
+ * \param  how_many : number of transforms
+ * \param  threads  : maximum number of threads
+ */
+void bitrev_permute(float2 *out, const float2 *inp, const unsigned N, const size_t how_many, const unsigned threads){
+  unsigned log_n = 0;
+  while((1u << log_n) < N)
+    log_n++;
+
+  const unsigned q = (log_n / 2 < LOG_TILE) ? log_n / 2 : LOG_TILE;
+  const size_t num_tiles = how_many << (log_n - 2 * q);
+
+  bitrev_work_t work = {out, inp, log_n};
+  parallel_range(permute_tiles, &work, num_tiles, how_many * N, threads);
+}
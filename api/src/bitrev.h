@@ -0,0 +1,11 @@
+// Author: Arjun Ramaswami
+
+#ifndef BITREV_H
+#define BITREV_H
+
+#include <stddef.h>
+#include "fftfpga/fftfpga.h"
+
+void bitrev_permute(float2 *out, const float2 *inp, const unsigned N, const size_t how_many, const unsigned threads);
+
+#endif
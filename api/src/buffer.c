@@ -0,0 +1,221 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "buffer.h"
+#include "completion.h"
+
+/**
+ * Buffers created on the device, whose global memory is released with the
+ * context even if the handles are not yet freed
+ */
+static fftfpga_buffer_t *buffers = NULL;
+
+/**
+ * \brief  release the global memory of all buffers, the handles remain valid until freed
+ */
+void buffer_cleanup(){
+  for(fftfpga_buffer_t *buf = buffers; buf != NULL; buf = buf->next){
+    if(buf->d_data)
+      clReleaseMemObject(buf->d_data);
+    buf->d_data = NULL;
+  }
+  buffers = NULL;
+}
+
+/**
+ * \brief  remove a buffer from the list of device buffers
+ */
+static void unlink_buffer(fftfpga_buffer_t *buf){
+  for(fftfpga_buffer_t **it = &buffers; *it != NULL; it = &(*it)->next){
+    if(*it == buf){
+      *it = buf->next;
+      break;
+    }
+  }
+  buf->next = NULL;
+}
+
+/**
+ * \brief  create a buffer of single precision complex points in the global memory of the FPGA, or on the host if no device is initialized
+ * \param  num_pts : number of points
+ * \return handle to the buffer, NULL on failure
+ */
+fftfpga_buffer_t* fftfpga_buffer_create(const size_t num_pts){
+  cl_int status = 0;
+
+  if(num_pts == 0){
+    return NULL;
+  }
+
+  fftfpga_buffer_t *buf = (fftfpga_buffer_t*)calloc(1, sizeof(fftfpga_buffer_t));
+  if(buf == NULL){
+    return NULL;
+  }
+  buf->num_pts = num_pts;
+
+  if(context == NULL){
+    buf->h_data = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+    if(buf->h_data == NULL){
+      free(buf);
+      return NULL;
+    }
+    return buf;
+  }
+
+  // same bank as the input read by fetch and the output written by store
+  buf->d_data = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate device buffer\n");
+
+  buf->next = buffers;
+  buffers = buf;
+  return buf;
+}
+
+/**
+ * \brief  release a buffer, also after fpga_final()
+ * \param  buf : handle to the buffer, may be NULL
+ */
+void fftfpga_buffer_free(fftfpga_buffer_t *buf){
+  if(buf == NULL){
+    return;
+  }
+
+  if(buf->d_data){
+    unlink_buffer(buf);
+    clReleaseMemObject(buf->d_data);
+  }
+  free(buf->h_data);
+  free(buf);
+}
+
+/**
+ * \brief  number of points of a buffer
+ * \param  buf : handle to the buffer
+ * \return number of points, 0 if NULL
+ */
+size_t fftfpga_buffer_size(const fftfpga_buffer_t *buf){
+  return buf ? buf->num_pts : 0;
+}
+
+/**
+ * \brief  copy data from the host to a buffer
+ * \param  buf : handle to the buffer
+ * \param  src : float2 pointer to data of the size of the buffer
+ * \return fpga_t : time taken in milliseconds for the data transfer
+ */
+fpga_t fftfpga_buffer_write(fftfpga_buffer_t *buf, const float2 *src){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+
+  if(buf == NULL || src == NULL || (buf->d_data == NULL && buf->h_data == NULL)){
+    return fft_time;
+  }
+
+  if(buf->h_data){
+    memcpy(buf->h_data, src, sizeof(float2) * buf->num_pts);
+    fft_time.backend = FFTFPGA_BACKEND_CPU;
+    fft_time.valid = 1;
+    return fft_time;
+  }
+
+  queue_setup();
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, buf->d_data, CL_FALSE, 0, sizeof(float2) * buf->num_pts, src, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  queue_cleanup();
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  copy data from a buffer to the host
+ * \param  buf : handle to the buffer
+ * \param  dst : float2 pointer to memory of the size of the buffer
+ * \return fpga_t : time taken in milliseconds for the data transfer
+ */
+fpga_t fftfpga_buffer_read(const fftfpga_buffer_t *buf, float2 *dst){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+
+  if(buf == NULL || dst == NULL || (buf->d_data == NULL && buf->h_data == NULL)){
+    return fft_time;
+  }
+
+  if(buf->h_data){
+    memcpy(dst, buf->h_data, sizeof(float2) * buf->num_pts);
+    fft_time.backend = FFTFPGA_BACKEND_CPU;
+    fft_time.valid = 1;
+    return fft_time;
+  }
+
+  queue_setup();
+
+  cl_event readBuf_event;
+  status = clEnqueueReadBuffer(queue1, buf->d_data, CL_FALSE, 0, sizeof(float2) * buf->num_pts, dst, 0, NULL, &readBuf_event);
+  checkError(status, "Failed to copy data from device to host");
+
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading DDR using PCIe");
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  queue_cleanup();
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  allocate host memory with CL_MEM_ALLOC_HOST_PTR and map it until host_buffer_unmap(), such that the runtime transfers from and to pinned memory
+ * \param  queue   : queue of the map and of the transfers
+ * \param  buf     : buffer backing the memory, released by host_buffer_unmap()
+ * \param  num_pts : number of points
+ * \return pointer to the mapped memory
+ */
+float2* host_buffer_map(cl_command_queue queue, cl_mem *buf, const size_t num_pts){
+  cl_int status = 0;
+
+  *buf = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate pinned host buffer\n");
+
+  float2 *data = (float2*)clEnqueueMapBuffer(queue, *buf, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, sizeof(float2) * num_pts, 0, NULL, NULL, &status);
+  checkError(status, "Failed to map pinned host buffer");
+  return data;
+}
+
+/**
+ * \brief  unmap and release host memory mapped by host_buffer_map()
+ */
+void host_buffer_unmap(cl_command_queue queue, cl_mem buf, float2 *data){
+  cl_int status = clEnqueueUnmapMemObject(queue, buf, data, 0, NULL, NULL);
+  checkError(status, "Failed to unmap pinned host buffer");
+  status = wait_queue(queue);
+  checkError(status, "Failed to finish unmap");
+  clReleaseMemObject(buf);
+}
@@ -0,0 +1,27 @@
+// Author: Arjun Ramaswami
+
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+#include "CL/opencl.h"
+#include "fftfpga/fftfpga.h"
+
+/**
+ * Data resident in the global memory of the FPGA, or on the host if no
+ * device was initialized when the buffer was created
+ */
+struct fftfpga_buffer {
+  size_t num_pts;
+  cl_mem d_data;
+  float2 *h_data;
+  struct fftfpga_buffer *next;  /**< list of buffers released by fpga_final */
+};
+
+void buffer_cleanup();
+
+float2* host_buffer_map(cl_command_queue queue, cl_mem *buf, const size_t num_pts);
+
+void host_buffer_unmap(cl_command_queue queue, cl_mem buf, float2 *data);
+
+#endif
@@ -0,0 +1,135 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "callback.h"
+
+/**
+ * Buffers passed to the load and store callbacks of fetch and store, 
+ * resident in the global memory of the FPGA
+ */
+static struct {
+  unsigned N;           /**< size of the transforms the buffers were set for */
+  cl_mem d_load;
+  cl_mem d_store;
+} callback = {0, NULL, NULL};
+
+/**
+ * \brief  release the buffers of the callbacks
+ */
+void callback_cleanup(){
+  if(callback.d_load)
+    clReleaseMemObject(callback.d_load);
+  if(callback.d_store)
+    clReleaseMemObject(callback.d_store);
+
+  callback.N = 0;
+  callback.d_load = NULL;
+  callback.d_store = NULL;
+}
+
+/**
+ * \brief  create a device buffer and copy data to it
+ * \return time taken in milliseconds for the data transfer
+ */
+static double upload(cl_mem *d_data, const float2 *data, const size_t num_pts, cl_mem_flags flags){
+  cl_int status = 0;
+
+  *d_data = clCreateBuffer(context, CL_MEM_READ_ONLY | flags, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate callback device buffer\n");
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, *d_data, CL_TRUE, 0, sizeof(float2) * num_pts, data, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy callback data to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+  clReleaseEvent(writeBuf_event);
+
+  return (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+}
+
+/**
+ * \brief  copy the data accessed by the load and store callbacks of fftfpgaf_c2c_3d_ddr() to the global memory of the FPGA, where it remains until replaced or fpga_final(). Only transforms of size N receive the data.
+ * \param  N          : unsigned integer denoting the size of FFT3d
+ * \param  load_data  : float2 pointer to data of size [N * N * N] passed to load_cb, NULL if not required
+ * \param  store_data : float2 pointer to data of size [N * N * N] passed to store_cb, NULL if not required
+ * \return fpga_t : time taken in milliseconds for the data transfers
+ */
+fpga_t fftfpgaf_set_callback_data(const unsigned N, const float2 *load_data, const float2 *store_data){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+
+  if(context == NULL || num_pts == 0){
+    return fft_time;
+  }
+
+  callback_cleanup();
+
+  queue_setup();
+  // the parameters of fetch and store are annotated DDR_BUFFER_LOCATION, as
+  // those of transpose3D, whose buffer is in the second bank
+  if(load_data != NULL){
+    fft_time.pcie_write_t += upload(&callback.d_load, load_data, num_pts, CL_CHANNEL_2_INTELFPGA);
+  }
+  if(store_data != NULL){
+    fft_time.pcie_write_t += upload(&callback.d_store, store_data, num_pts, CL_CHANNEL_2_INTELFPGA);
+  }
+  queue_cleanup();
+
+  callback.N = N;
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  set a buffer of the callbacks as the second argument of a kernel,
+ *         if its signature has one. fetch and store of bitstreams
+ *         synthesized without callbacks, such as fft3d_ddr_batch.cl, only
+ *         have their first argument.
+ */
+static void set_arg(cl_kernel kernel, cl_mem d_data, const char *msg){
+  cl_int status = 0;
+  cl_uint num_args = 0;
+
+  status = clGetKernelInfo(kernel, CL_KERNEL_NUM_ARGS, sizeof(cl_uint), &num_args, NULL);
+  checkError(status, "Failed to query the number of kernel args");
+  if(num_args < 2)
+    return;
+
+  status = clSetKernelArg(kernel, 1, sizeof(cl_mem), d_data ? (void *)&d_data : NULL);
+  checkError(status, msg);
+}
+
+/**
+ * \brief  set the buffers of the callbacks as the second argument of fetch
+ *         and store. Transforms of another size than the buffers were set
+ *         for receive NULL as if none were set, since the callbacks would
+ *         access the buffers out of bounds.
+ * \param  fetch_kernel : fetch kernel, NULL to skip
+ * \param  store_kernel : store kernel, NULL to skip
+ * \param  N            : size of the transform computed by the kernels
+ */
+void callback_set_args(cl_kernel fetch_kernel, cl_kernel store_kernel, const unsigned N){
+  const bool matches = (callback.N == N);
+
+#ifdef DEBUG
+  if(!matches && (callback.d_load || callback.d_store))
+    printf("-- Callback data set for N = %u, not passed to a transform of size %u\n", callback.N, N);
+#endif
+
+  if(fetch_kernel != NULL)
+    set_arg(fetch_kernel, matches ? callback.d_load : NULL, "Failed to set fetch kernel arg 1");
+
+  if(store_kernel != NULL)
+    set_arg(store_kernel, matches ? callback.d_store : NULL, "Failed to set store kernel arg 1");
+}
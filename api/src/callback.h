@@ -0,0 +1,12 @@
+// Author: Arjun Ramaswami
+
+#ifndef CALLBACK_H
+#define CALLBACK_H
+
+#include "CL/opencl.h"
+
+void callback_set_args(cl_kernel fetch_kernel, cl_kernel store_kernel, const unsigned N);
+
+void callback_cleanup();
+
+#endif
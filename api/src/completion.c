@@ -0,0 +1,200 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "completion.h"
+
+// maximum number of queues and events waited for at once using callbacks
+#define MAX_WAIT 16
+
+/**
+ * Policy of the waits of the library, callbacks with a short spin by default
+ */
+static atomic_bool use_callbacks = true;
+static atomic_uint spin_us = 20;
+
+static long long now_ns(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+/**
+ * \brief  configure how the library waits for the FPGA
+ * \param  callbacks : wait for callbacks of the completion events instead of clFinish() and clWaitForEvents()
+ * \param  spin      : microseconds to poll for the completion before sleeping
+ */
+void fftfpga_set_wait_policy(const bool callbacks, const unsigned spin){
+  atomic_store(&use_callbacks, callbacks);
+  atomic_store(&spin_us, spin);
+}
+
+/**
+ * \brief  prepare to wait for a number of operations
+ */
+void completion_init(completion_t *c, const unsigned pending){
+  pthread_mutex_init(&c->lock, NULL);
+  pthread_cond_init(&c->cond, NULL);
+  atomic_init(&c->pending, pending);
+}
+
+/**
+ * \brief  mark one of the operations complete, waking the waiting thread after the last one
+ */
+void completion_signal(completion_t *c){
+  pthread_mutex_lock(&c->lock);
+  if(atomic_fetch_sub(&c->pending, 1) == 1)
+    pthread_cond_broadcast(&c->cond);
+  pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * \brief  poll for the operations for the spin time of the policy, then sleep until they complete. The lock is always taken so that the completion can be destroyed once this returns.
+ */
+void completion_wait(completion_t *c){
+  const unsigned spin = atomic_load(&spin_us);
+  if(spin > 0){
+    const long long deadline = now_ns() + (long long)spin * 1000ll;
+    while(atomic_load_explicit(&c->pending, memory_order_acquire) != 0 && now_ns() < deadline)
+      ;
+  }
+
+  pthread_mutex_lock(&c->lock);
+  while(atomic_load(&c->pending) != 0)
+    pthread_cond_wait(&c->cond, &c->lock);
+  pthread_mutex_unlock(&c->lock);
+}
+
+void completion_destroy(completion_t *c){
+  pthread_cond_destroy(&c->cond);
+  pthread_mutex_destroy(&c->lock);
+}
+
+/**
+ * Completion of events, recording whether a command terminated abnormally
+ */
+typedef struct {
+  completion_t done;
+  atomic_int status;
+} event_wait_t;
+
+static void CL_CALLBACK event_complete(cl_event event, cl_int exec_status, void *user_data){
+  (void)event;
+  event_wait_t *wait = (event_wait_t*)user_data;
+  if(exec_status < 0)
+    atomic_store(&wait->status, CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST);
+  completion_signal(&wait->done);
+}
+
+/**
+ * \brief  wait for events of commands enqueued to the queues of the library or flushed queues, replacing clWaitForEvents()
+ * \param  num_events : number of events
+ * \param  events     : events to wait for
+ * \return CL_SUCCESS or the error of clWaitForEvents()
+ */
+cl_int wait_events(const cl_uint num_events, const cl_event *events){
+  if(!atomic_load(&use_callbacks) || num_events == 0 || num_events > MAX_WAIT || events == NULL)
+    return clWaitForEvents(num_events, events);
+
+  // callbacks are only called for commands submitted to the device
+  cl_command_queue queues[] = {queue1, queue2, queue3, queue4, queue5, queue6, queue7, queue8};
+  for(size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++){
+    if(queues[i] != NULL)
+      clFlush(queues[i]);
+  }
+
+  event_wait_t wait;
+  completion_init(&wait.done, num_events);
+  atomic_init(&wait.status, CL_SUCCESS);
+
+  cl_uint registered = 0;
+  for(; registered < num_events; registered++){
+    if(clSetEventCallback(events[registered], CL_COMPLETE, event_complete, &wait) != CL_SUCCESS)
+      break;
+  }
+  for(cl_uint i = registered; i < num_events; i++)
+    completion_signal(&wait.done);
+
+  completion_wait(&wait.done);
+  completion_destroy(&wait.done);
+
+  // events without callbacks are waited for by the runtime
+  if(registered < num_events)
+    return clWaitForEvents(num_events - registered, &events[registered]);
+  return atomic_load(&wait.status);
+}
+
+/**
+ * \brief  wait for the commands enqueued to the queues, replacing a sequence of clFinish()
+ * \param  num_queues : number of queues
+ * \param  queues     : queues to wait for
+ * \return CL_SUCCESS or the first error
+ */
+cl_int wait_queues(const unsigned num_queues, const cl_command_queue *queues){
+  cl_int status = CL_SUCCESS;
+
+  if(!atomic_load(&use_callbacks) || num_queues > MAX_WAIT){
+    for(unsigned i = 0; i < num_queues; i++){
+      cl_int err = clFinish(queues[i]);
+      if(status == CL_SUCCESS)
+        status = err;
+    }
+    return status;
+  }
+
+  // a marker completes after the commands enqueued before it, the marker of the last queue after the others
+  cl_event markers[MAX_WAIT];
+  cl_uint num_markers = 0;
+  for(unsigned i = 0; i + 1 < num_queues; i++){
+    cl_int err = clEnqueueMarkerWithWaitList(queues[i], 0, NULL, &markers[num_markers]);
+    if(err == CL_SUCCESS){
+      num_markers++;
+      err = clFlush(queues[i]);
+    }
+    else
+      err = clFinish(queues[i]);
+    if(status == CL_SUCCESS)
+      status = err;
+  }
+
+  cl_event last = NULL;
+  if(num_queues > 0){
+    cl_int err = clEnqueueMarkerWithWaitList(queues[num_queues - 1], num_markers, (num_markers > 0) ? markers : NULL, &last);
+    if(err == CL_SUCCESS)
+      err = clFlush(queues[num_queues - 1]);
+    else{
+      last = NULL;
+      err = clFinish(queues[num_queues - 1]);
+    }
+    if(status == CL_SUCCESS)
+      status = err;
+  }
+
+  cl_int err = CL_SUCCESS;
+  if(last != NULL){
+    err = wait_events(1, &last);
+    clReleaseEvent(last);
+  }
+  else if(num_markers > 0)
+    err = wait_events(num_markers, markers);
+  if(status == CL_SUCCESS)
+    status = err;
+
+  for(cl_uint i = 0; i < num_markers; i++)
+    clReleaseEvent(markers[i]);
+  return status;
+}
+
+/**
+ * \brief  wait for the commands enqueued to a queue, replacing clFinish()
+ */
+cl_int wait_queue(cl_command_queue queue){
+  return wait_queues(1, &queue);
+}
@@ -0,0 +1,34 @@
+// Author: Arjun Ramaswami
+
+#ifndef COMPLETION_H
+#define COMPLETION_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "CL/opencl.h"
+
+/**
+ * Count of pending operations a thread waits for, spinning for the time of the wait policy before sleeping
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  atomic_uint pending;
+} completion_t;
+
+void completion_init(completion_t *c, const unsigned pending);
+
+void completion_signal(completion_t *c);
+
+void completion_wait(completion_t *c);
+
+void completion_destroy(completion_t *c);
+
+cl_int wait_events(const cl_uint num_events, const cl_event *events);
+
+cl_int wait_queues(const unsigned num_queues, const cl_command_queue *queues);
+
+cl_int wait_queue(cl_command_queue queue);
+
+#endif
@@ -0,0 +1,255 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include "CL/opencl.h"
+
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "misc.h"
+#include "cpu_fft.h"
+#include "fallback.h"
+#include "completion.h"
+#include "convert.h"
+#include "parallel.h"
+
+// AVX is selected at runtime, the library being built for any x86 host
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CONVERT_AVX
+#endif
+
+/**
+ * Points converted by the threads, split by points
+ */
+typedef struct {
+  float2 *sp;
+  double2 *dp;
+  bool narrow;          /**< double to single precision, else the reverse */
+} convert_work_t;
+
+static void narrow_scalar(float2 *out, const double2 *inp, const size_t num_pts){
+  for(size_t i = 0; i < num_pts; i++){
+    out[i].x = (float)inp[i].x;
+    out[i].y = (float)inp[i].y;
+  }
+}
+
+static void widen_scalar(double2 *out, const float2 *inp, const size_t num_pts){
+  for(size_t i = 0; i < num_pts; i++){
+    out[i].x = (double)inp[i].x;
+    out[i].y = (double)inp[i].y;
+  }
+}
+
+#ifdef CONVERT_AVX
+/**
+ * \brief  convert 4 points, 8 values, per iteration, rounding to nearest as the scalar conversion
+ */
+__attribute__((target("avx")))
+static void narrow_avx(float2 *out, const double2 *inp, const size_t num_pts){
+  const double *src = (const double*)inp;
+  float *dst = (float*)out;
+  size_t i = 0;
+  for(; i + 4 <= num_pts; i += 4){
+    __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(&src[2 * i]));
+    __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(&src[2 * i + 4]));
+    _mm_storeu_ps(&dst[2 * i], lo);
+    _mm_storeu_ps(&dst[2 * i + 4], hi);
+  }
+  narrow_scalar(&out[i], &inp[i], num_pts - i);
+}
+
+__attribute__((target("avx")))
+static void widen_avx(double2 *out, const float2 *inp, const size_t num_pts){
+  const float *src = (const float*)inp;
+  double *dst = (double*)out;
+  size_t i = 0;
+  for(; i + 4 <= num_pts; i += 4){
+    __m256d lo = _mm256_cvtps_pd(_mm_loadu_ps(&src[2 * i]));
+    __m256d hi = _mm256_cvtps_pd(_mm_loadu_ps(&src[2 * i + 4]));
+    _mm256_storeu_pd(&dst[2 * i], lo);
+    _mm256_storeu_pd(&dst[2 * i + 4], hi);
+  }
+  widen_scalar(&out[i], &inp[i], num_pts - i);
+}
+#endif
+
+static void convert_range(void *arg, const size_t begin, const size_t end){
+  const convert_work_t *work = (const convert_work_t*)arg;
+  const size_t count = end - begin;
+  float2 *sp = &work->sp[begin];
+  double2 *dp = &work->dp[begin];
+
+#ifdef CONVERT_AVX
+  if(__builtin_cpu_supports("avx")){
+    if(work->narrow)
+      narrow_avx(sp, dp, count);
+    else
+      widen_avx(dp, sp, count);
+    return;
+  }
+#endif
+
+  if(work->narrow)
+    narrow_scalar(sp, dp, count);
+  else
+    widen_scalar(dp, sp, count);
+}
+
+/**
+ * \brief  convert between single and double precision points, splitting the range among threads
+ */
+static void convert(float2 *sp, double2 *dp, const size_t num_pts, const bool narrow, const unsigned threads){
+  convert_work_t work = {sp, dp, narrow};
+  parallel_range(convert_range, &work, num_pts, num_pts, threads);
+}
+
+/**
+ * \brief  convert double precision points to single precision using AVX, if the host supports it, split among threads
+ * \param  out     : float2 pointer to output of size num_pts
+ * \param  inp     : double2 pointer to input of size num_pts
+ * \param  threads : maximum number of threads
+ */
+void convert_narrow(float2 *out, const double2 *inp, const size_t num_pts, const unsigned threads){
+  convert(out, (double2*)inp, num_pts, true, threads);
+}
+
+/**
+ * \brief  convert single precision points to double precision using AVX, if the host supports it, split among threads
+ * \param  out     : double2 pointer to output of size num_pts
+ * \param  inp     : float2 pointer to input of size num_pts
+ * \param  threads : maximum number of threads
+ */
+void convert_widen(double2 *out, const float2 *inp, const size_t num_pts, const unsigned threads){
+  convert((float2*)inp, out, num_pts, false, threads);
+}
+
+/**
+ * \brief  number of single precision points of the staging buffer of convert_write() and convert_read(), two chunks
+ */
+size_t convert_stage_points(const size_t num_pts){
+  return 2 * ((num_pts < CONVERT_CHUNK_POINTS) ? num_pts : CONVERT_CHUNK_POINTS);
+}
+
+/**
+ * \brief  convert double precision points to single precision in chunks into the pinned staging buffer and write them to the device, converting each chunk while the previous one is transferred
+ * \param  queue  : queue of the transfers
+ * \param  d_buf  : device buffer of size [num_pts] single precision points
+ * \param  inp    : double2 pointer to input of size num_pts
+ * \param  stage  : float2 pointer to convert_stage_points(num_pts) points mapped by host_buffer_map()
+ * \return time taken in milliseconds for the overlapped conversion and transfers
+ */
+double convert_write(cl_command_queue queue, cl_mem d_buf, const double2 *inp, float2 *stage, const size_t num_pts){
+  cl_int status = 0;
+  const size_t chunk = convert_stage_points(num_pts) / 2;
+  const size_t num_chunks = (chunk > 0) ? (num_pts + chunk - 1) / chunk : 0;
+  const unsigned threads = cpu_fft_num_threads();
+  cl_event write_event[2];
+
+  double start = getTimeinMilliSec();
+
+  for(size_t c = 0; c < num_chunks; c++){
+    size_t first = c * chunk;
+    size_t count = (num_pts - first < chunk) ? num_pts - first : chunk;
+    float2 *slot = &stage[(c & 1) * chunk];
+
+    // the slot is free once the chunk before the previous one is transferred
+    if(c >= 2){
+      status = wait_events(1, &write_event[c & 1]);
+      checkError(status, "failed to finish writing buffer using PCIe");
+      clReleaseEvent(write_event[c & 1]);
+    }
+
+    convert_narrow(slot, &inp[first], count, threads);
+
+    status = clEnqueueWriteBuffer(queue, d_buf, CL_FALSE, sizeof(float2) * first, sizeof(float2) * count, slot, 0, NULL, &write_event[c & 1]);
+    checkError(status, "Failed to copy data to device");
+  }
+
+  for(size_t c = (num_chunks > 2) ? num_chunks - 2 : 0; c < num_chunks; c++){
+    status = wait_events(1, &write_event[c & 1]);
+    checkError(status, "failed to finish writing buffer using PCIe");
+    clReleaseEvent(write_event[c & 1]);
+  }
+
+  return getTimeinMilliSec() - start;
+}
+
+/**
+ * \brief  read single precision points from the device in chunks and convert them to double precision, converting each chunk while the next one is transferred
+ * \param  queue  : queue of the transfers
+ * \param  d_buf  : device buffer of size [num_pts] single precision points
+ * \param  out    : double2 pointer to output of size num_pts
+ * \param  stage  : float2 pointer to convert_stage_points(num_pts) points mapped by host_buffer_map()
+ * \return time taken in milliseconds for the overlapped transfers and conversion
+ */
+double convert_read(cl_command_queue queue, cl_mem d_buf, double2 *out, float2 *stage, const size_t num_pts){
+  cl_int status = 0;
+  const size_t chunk = convert_stage_points(num_pts) / 2;
+  const size_t num_chunks = (chunk > 0) ? (num_pts + chunk - 1) / chunk : 0;
+  const unsigned threads = cpu_fft_num_threads();
+  cl_event read_event[2];
+
+  if(num_chunks == 0)
+    return 0.0;
+
+  double start = getTimeinMilliSec();
+
+  status = clEnqueueReadBuffer(queue, d_buf, CL_FALSE, 0, sizeof(float2) * chunk, stage, 0, NULL, &read_event[0]);
+  checkError(status, "Failed to copy data from device");
+
+  for(size_t c = 0; c < num_chunks; c++){
+    size_t first = c * chunk;
+    size_t count = (num_pts - first < chunk) ? num_pts - first : chunk;
+
+    // the other slot was converted in the previous iteration
+    if(c + 1 < num_chunks){
+      size_t next = first + chunk;
+      size_t next_count = (num_pts - next < chunk) ? num_pts - next : chunk;
+      status = clEnqueueReadBuffer(queue, d_buf, CL_FALSE, sizeof(float2) * next, sizeof(float2) * next_count, &stage[((c + 1) & 1) * chunk], 0, NULL, &read_event[(c + 1) & 1]);
+      checkError(status, "Failed to copy data from device");
+    }
+
+    status = wait_events(1, &read_event[c & 1]);
+    checkError(status, "failed to finish reading buffer using PCIe");
+    clReleaseEvent(read_event[c & 1]);
+
+    convert_widen(&out[first], &stage[(c & 1) * chunk], count, threads);
+  }
+
+  return getTimeinMilliSec() - start;
+}
+
+/**
+ * \brief  compute a double precision transform using FFTW on the host in single precision, as on the FPGA
+ * \return fpga_t : exec_t being the time taken on the host including the conversions, backend set to the host
+ */
+fpga_t convert_fallback(const unsigned dim, const unsigned N, const double2 *inp, double2 *out, const bool inv, const unsigned how_many){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  fft_time.backend = FFTFPGA_BACKEND_CPU;
+
+  size_t num_pts = how_many;
+  for(unsigned d = 0; d < dim; d++)
+    num_pts *= N;
+
+  float2 *tmp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  if(tmp == NULL){
+    return fft_time;
+  }
+
+  const unsigned threads = cpu_fft_num_threads();
+  double start = getTimeinMilliSec();
+
+  convert_narrow(tmp, inp, num_pts, threads);
+  fft_time = fallback_c2c(dim, N, tmp, tmp, inv, how_many);
+  if(fft_time.valid){
+    convert_widen(out, tmp, num_pts, threads);
+    fft_time.exec_t = getTimeinMilliSec() - start;
+  }
+
+  free(tmp);
+  return fft_time;
+}
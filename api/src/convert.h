@@ -0,0 +1,26 @@
+// Author: Arjun Ramaswami
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CL/opencl.h"
+#include "fftfpga/fftfpga.h"
+
+// points of a chunk converted while the previous chunk is transferred
+#define CONVERT_CHUNK_POINTS (1 << 20)
+
+void convert_narrow(float2 *out, const double2 *inp, const size_t num_pts, const unsigned threads);
+
+void convert_widen(double2 *out, const float2 *inp, const size_t num_pts, const unsigned threads);
+
+size_t convert_stage_points(const size_t num_pts);
+
+double convert_write(cl_command_queue queue, cl_mem d_buf, const double2 *inp, float2 *stage, const size_t num_pts);
+
+double convert_read(cl_command_queue queue, cl_mem d_buf, double2 *out, float2 *stage, const size_t num_pts);
+
+fpga_t convert_fallback(const unsigned dim, const unsigned N, const double2 *inp, double2 *out, const bool inv, const unsigned how_many);
+
+#endif
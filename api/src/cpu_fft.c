@@ -0,0 +1,177 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fftw3.h>
+
+#include "cpu_fft.h"
+
+#define MAX_CACHED_PLANS 16
+
+/**
+ * FFTW plan along with the parameters it was created for
+ */
+typedef struct {
+  unsigned dim;
+  unsigned N;
+  unsigned threads;
+  bool inv;
+  bool inplace;
+  bool unaligned;
+  fftwf_plan plan;
+} cpu_plan_t;
+
+static cpu_plan_t plan_cache[MAX_CACHED_PLANS];
+static unsigned num_plans = 0, next_evict = 0;
+
+// FFTW planner is not thread safe, executing a plan is
+static pthread_mutex_t planner_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t threads_once = PTHREAD_ONCE_INIT;
+
+static void init_fftw_threads(){
+  if(fftwf_init_threads() == 0){
+    fprintf(stderr, "Failed to initialize FFTW threads\n");
+  }
+}
+
+/**
+ * \brief  number of host threads to use for FFTW, FFTFPGA_CPU_THREADS overrides the number of online cores
+ * \return number of threads, at least 1
+ */
+unsigned cpu_fft_num_threads(){
+  const char *env = getenv("FFTFPGA_CPU_THREADS");
+  if(env != NULL && atoi(env) > 0){
+    return (unsigned)atoi(env);
+  }
+
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return (cores > 0) ? (unsigned)cores : 1;
+}
+
+/**
+ * \brief  find a cached plan of a single transform or create one by measuring on scratch buffers. Batches execute the plan once per transform, so that the plan does not depend on the size of the batch.
+ * \return plan or NULL if FFTW could not create one
+ */
+static fftwf_plan get_plan(const unsigned dim, const unsigned N, const bool inv, const unsigned threads, const bool inplace, const bool unaligned){
+
+  fftwf_plan plan = NULL;
+
+  pthread_mutex_lock(&planner_lock);
+  for(unsigned i = 0; i < num_plans; i++){
+    cpu_plan_t *p = &plan_cache[i];
+    if(p->dim == dim && p->N == N && p->inv == inv && p->threads == threads && p->inplace == inplace && p->unaligned == unaligned){
+      plan = p->plan;
+      break;
+    }
+  }
+
+  if(plan == NULL){
+    const size_t sz = (dim == 1) ? N : (dim == 2) ? (size_t)N * N : (size_t)N * N * N;
+    int n[3] = {N, N, N};
+    unsigned flags = FFTW_MEASURE | (unaligned ? FFTW_UNALIGNED : 0);
+
+    fftwf_complex *scratch_in = fftwf_alloc_complex(sz);
+    fftwf_complex *scratch_out = inplace ? scratch_in : fftwf_alloc_complex(sz);
+
+    if(scratch_in != NULL && scratch_out != NULL){
+      fftwf_plan_with_nthreads(threads);
+      plan = fftwf_plan_many_dft(dim, n, 1, scratch_in, NULL, 1, (int)sz, scratch_out, NULL, 1, (int)sz, inv ? FFTW_BACKWARD : FFTW_FORWARD, flags);
+    }
+
+    fftwf_free(scratch_in);
+    if(!inplace)
+      fftwf_free(scratch_out);
+
+    if(plan != NULL){
+      // replace the oldest entry once the cache is full
+      unsigned slot = num_plans;
+      if(num_plans == MAX_CACHED_PLANS){
+        slot = next_evict;
+        next_evict = (next_evict + 1) % MAX_CACHED_PLANS;
+        fftwf_destroy_plan(plan_cache[slot].plan);
+      }
+      else{
+        num_plans++;
+      }
+      cpu_plan_t entry = {dim, N, threads, inv, inplace, unaligned, plan};
+      plan_cache[slot] = entry;
+    }
+  }
+  pthread_mutex_unlock(&planner_lock);
+
+  return plan;
+}
+
+/**
+ * \brief  plan of a single transform on the given buffers, which are the first of a batch
+ */
+static fftwf_plan plan_for(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned threads){
+
+  pthread_once(&threads_once, init_fftw_threads);
+
+  const bool inplace = ((const void*)inp == (void*)out);
+  // plans are measured on fftw allocated buffers, whose alignment may differ from the user's
+  // and from that of the following transforms of a batch of single points
+  const bool unaligned = (fftwf_alignment_of((float*)inp) != 0) || (fftwf_alignment_of((float*)out) != 0) || (N == 1);
+
+  return get_plan(dim, N, inv, (threads > 0) ? threads : 1, inplace, unaligned);
+}
+
+/**
+ * \brief  plan the transforms of cpu_fft_c2c() on the given buffers ahead of time, so that measuring the plan is not part of timing the transforms
+ * \return true if a plan is available
+ */
+bool cpu_fft_plan(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned threads){
+
+  if(inp == NULL || out == NULL || dim < 1 || dim > 3 || N == 0){
+    return false;
+  }
+
+  return plan_for(dim, N, inp, out, inv, threads) != NULL;
+}
+
+/**
+ * \brief  compute batched single precision complex FFTs on the host using multithreaded FFTW plans, which are cached across calls
+ * \param  dim      : number of dimensions 1, 2 or 3
+ * \param  N        : number of points along each dimension
+ * \param  inp      : float2 pointer to input data of size [how_many * N^dim]
+ * \param  out      : float2 pointer to output data of size [how_many * N^dim]
+ * \param  inv      : toggle to activate backward FFT
+ * \param  how_many : number of transforms
+ * \param  threads  : number of host threads used by FFTW
+ * \return true if successful
+ */
+bool cpu_fft_c2c(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many, const unsigned threads){
+
+  if(inp == NULL || out == NULL || dim < 1 || dim > 3 || N == 0 || how_many == 0){
+    return false;
+  }
+
+  fftwf_plan plan = plan_for(dim, N, inp, out, inv, threads);
+  if(plan == NULL){
+    return false;
+  }
+
+  // a transform of more than one point is a multiple of the alignment, so each one is aligned as the first
+  const size_t dist = (dim == 1) ? N : (dim == 2) ? (size_t)N * N : (size_t)N * N * N;
+  for(unsigned i = 0; i < how_many; i++){
+    fftwf_execute_dft(plan, (fftwf_complex*)&inp[i * dist], (fftwf_complex*)&out[i * dist]);
+  }
+  return true;
+}
+
+/**
+ * \brief  destroy cached FFTW plans
+ */
+void cpu_fft_cleanup(){
+  pthread_mutex_lock(&planner_lock);
+  for(unsigned i = 0; i < num_plans; i++){
+    fftwf_destroy_plan(plan_cache[i].plan);
+  }
+  num_plans = 0;
+  next_evict = 0;
+  pthread_mutex_unlock(&planner_lock);
+}
@@ -0,0 +1,17 @@
+// Author: Arjun Ramaswami
+
+#ifndef CPU_FFT_H
+#define CPU_FFT_H
+
+#include <stdbool.h>
+#include "fftfpga/fftfpga.h"
+
+unsigned cpu_fft_num_threads();
+
+bool cpu_fft_plan(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned threads);
+
+bool cpu_fft_c2c(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many, const unsigned threads);
+
+void cpu_fft_cleanup();
+
+#endif
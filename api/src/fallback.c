@@ -0,0 +1,233 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#define CL_VERSION_2_0
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "fallback.h"
+#include "cpu_fft.h"
+#include "misc.h"
+
+// below this number of points, PCIe transfers and kernel launches dominate the FPGA runtime
+#define DEFAULT_MIN_FPGA_POINTS 32768
+
+/**
+ * Policy to select the host as backend
+ */
+static struct {
+  bool enabled;
+  unsigned fpga_n;           /**< points per dimension of the loaded bitstream, 0 if unknown */
+  size_t min_fpga_points;    /**< smaller transforms are computed on the host */
+} fallback = {false, 0, DEFAULT_MIN_FPGA_POINTS};
+
+static pthread_once_t fallback_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Kernels of the loaded program, probed once by fpga_initialize()
+ */
+static struct {
+  char *names;      /**< semicolon separated kernel names, NULL if not probed */
+  bool known;       /**< false if the runtime did not report the names */
+} program_kernels = {NULL, false};
+
+static void init_fallback(){
+  const char *env = getenv("FFTFPGA_FALLBACK");
+  if(env != NULL && atoi(env) != 0){
+    fallback.enabled = true;
+  }
+}
+
+/**
+ * \brief  Configure the fallback to FFTW on the host when the FPGA cannot or should not compute a transform
+ * \param  enable : toggle the fallback, which is disabled by default unless FFTFPGA_FALLBACK=1 is set
+ * \param  fpga_n : number of points per dimension the loaded bitstream is synthesized for, 0 if unknown
+ * \param  min_fpga_points : transforms with fewer points, counting all batches, are computed on the host
+ */
+void fftfpga_set_fallback(const bool enable, const unsigned fpga_n, const unsigned min_fpga_points){
+  pthread_once(&fallback_once, init_fallback);
+  fallback.enabled = enable;
+  fallback.fpga_n = fpga_n;
+  fallback.min_fpga_points = min_fpga_points;
+}
+
+/**
+ * \brief  read the names of the kernels of the loaded program, so that the fallback does not probe the bitstream on every transform
+ */
+void fallback_probe_kernels(){
+  fallback_cleanup();
+  if(program == NULL){
+    return;
+  }
+
+  size_t sz = 0;
+  cl_int status = clGetProgramInfo(program, CL_PROGRAM_KERNEL_NAMES, 0, NULL, &sz);
+  if(status != CL_SUCCESS || sz == 0){
+    return;
+  }
+
+  program_kernels.names = (char*)malloc(sz);
+  if(program_kernels.names == NULL){
+    return;
+  }
+  status = clGetProgramInfo(program, CL_PROGRAM_KERNEL_NAMES, sz, program_kernels.names, NULL);
+  if(status != CL_SUCCESS){
+    fallback_cleanup();
+    return;
+  }
+  program_kernels.known = true;
+}
+
+/**
+ * \brief  release the kernel names of the program
+ */
+void fallback_cleanup(){
+  free(program_kernels.names);
+  program_kernels.names = NULL;
+  program_kernels.known = false;
+}
+
+/**
+ * \brief  find a kernel name in the semicolon separated names of the program
+ */
+static bool kernel_listed(const char *kernel){
+  const size_t len = strlen(kernel);
+  for(const char *name = program_kernels.names; name != NULL && *name != '\0'; ){
+    const char *end = strchr(name, ';');
+    size_t name_len = (end != NULL) ? (size_t)(end - name) : strlen(name);
+    if(name_len == len && strncmp(name, kernel, len) == 0){
+      return true;
+    }
+    name = (end != NULL) ? end + 1 : name + name_len;
+  }
+  return false;
+}
+
+/**
+ * \brief  check if all kernels required by a transform are found in the loaded bitstream. Runtimes that do not report the names of the kernels are assumed to have all.
+ */
+bool kernels_available(const char **kernels){
+  if(program == NULL){
+    return false;
+  }
+  if(!program_kernels.known){
+    return true;
+  }
+
+  for(unsigned i = 0; kernels != NULL && kernels[i] != NULL; i++){
+    if(!kernel_listed(kernels[i])){
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief  decide if a transform has to be computed on the host instead of the FPGA
+ * \param  dim      : number of dimensions
+ * \param  N        : number of points along each dimension
+ * \param  how_many : number of transforms
+ * \param  kernels  : NULL terminated list of kernel names required on the FPGA
+ * \return true if the fallback is enabled and the FPGA is missing, does not support the size or is expected to be slower
+ */
+bool fallback_required(const unsigned dim, const unsigned N, const unsigned how_many, const char **kernels){
+  pthread_once(&fallback_once, init_fallback);
+
+  if(!fallback.enabled){
+    return false;
+  }
+
+  // non power of 2 sizes are not supported by the kernels
+  if((N & (N-1)) != 0){
+    return true;
+  }
+
+  if(fallback.fpga_n != 0 && N != fallback.fpga_n){
+    return true;
+  }
+
+  size_t num_pts = (size_t)how_many * (dim == 1 ? N : dim == 2 ? N * N : N * N * N);
+  if(num_pts < fallback.min_fpga_points){
+    return true;
+  }
+
+  return !kernels_available(kernels);
+}
+
+static unsigned bit_reversed(unsigned x, const unsigned bits){
+  unsigned y = 0;
+  for(unsigned i = 0; i < bits; i++){
+    y <<= 1;
+    y |= x & 1;
+    x >>= 1;
+  }
+  return y;
+}
+
+/**
+ * \brief  compute the transform using FFTW on the host
+ * \param  bitrev : output 1D transforms in bit reversed order
+ */
+static fpga_t compute_on_host(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many, const bool bitrev){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  fft_time.backend = FFTFPGA_BACKEND_CPU;
+
+#ifdef DEBUG
+  printf("-- Computing %uD FFT of size %u on the host\n", dim, N);
+#endif
+
+  double start = getTimeinMilliSec();
+  if(!cpu_fft_c2c(dim, N, inp, out, inv, how_many, cpu_fft_num_threads())){
+    return fft_time;
+  }
+
+  // 1D FFT on the FPGA outputs in bit reversed order
+  if(bitrev && dim == 1 && (N & (N-1)) == 0){
+    unsigned log_n = 0;
+    while((1u << log_n) < N)
+      log_n++;
+
+    for(size_t b = 0; b < how_many; b++){
+      float2 *batch = &out[b * N];
+      for(unsigned i = 0; i < N; i++){
+        unsigned j = bit_reversed(i, log_n);
+        if(i < j){
+          float2 tmp = batch[i];
+          batch[i] = batch[j];
+          batch[j] = tmp;
+        }
+      }
+    }
+  }
+
+  fft_time.exec_t = getTimeinMilliSec() - start;
+  fft_time.valid = true;
+  return fft_time;
+}
+
+/**
+ * \brief  compute the transform using FFTW on the host with the same output layout as the FPGA
+ * \param  dim      : number of dimensions
+ * \param  N        : number of points along each dimension
+ * \param  inp      : float2 pointer to input data of size [how_many * N^dim]
+ * \param  out      : float2 pointer to output data of size [how_many * N^dim]
+ * \param  inv      : toggle to activate backward FFT
+ * \param  how_many : number of transforms
+ * \return fpga_t : exec_t being the time taken on the host, backend set to the host
+ */
+fpga_t fallback_c2c(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  return compute_on_host(dim, N, inp, out, inv, how_many, true);
+}
+
+/**
+ * \brief  compute the transform using FFTW on the host with the output in natural order, also for 1D transforms
+ * \return fpga_t : exec_t being the time taken on the host, backend set to the host
+ */
+fpga_t fallback_c2c_natural(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  return compute_on_host(dim, N, inp, out, inv, how_many, false);
+}
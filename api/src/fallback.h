@@ -0,0 +1,21 @@
+// Author: Arjun Ramaswami
+
+#ifndef FALLBACK_H
+#define FALLBACK_H
+
+#include <stdbool.h>
+#include "fftfpga/fftfpga.h"
+
+void fallback_probe_kernels();
+
+void fallback_cleanup();
+
+bool kernels_available(const char **kernels);
+
+bool fallback_required(const unsigned dim, const unsigned N, const unsigned how_many, const char **kernels);
+
+fpga_t fallback_c2c(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
+
+fpga_t fallback_c2c_natural(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
+
+#endif
@@ -14,124 +14,131 @@
 #include "svm.h"
 #include "opencl_utils.h"
 #include "misc.h"
+#include "fallback.h"
+#include "cpu_fft.h"
+#include "bitrev.h"
+#include "completion.h"
+#include "convert.h"
+#include "buffer.h"
+
+// kernels required in the bitstream
+static const char *fft1d_kernels[] = {"fft1d", NULL};
+static const char *fft1d_natural_kernels[] = {"fft1d", "store", NULL};
+static const char *fft1d_large_kernels[] = {"fft2d", "twiddle", NULL};
 
 /**
- * \brief  compute an out-of-place double precision complex 1D-FFT on the FPGA
- * \param  N    : unsigned integer to the number of points in 1D FFT
- * \param  inp  : double2 pointer to input data of size N
- * \param  out  : double2 pointer to output data of size N
- * \param  inv  : int toggle to activate backward FFT
- * \param  batch : number of batched executions of 1D FFT
- * \return fpga_t : time taken in milliseconds for data transfers and execution
+ * \brief  enqueue the fetch and fft1d kernels of a batch of 1D-FFTs on buffers in the global memory and wait for their completion. Queues are set up by the caller.
+ * \param  N         : unsigned integer to the number of points in FFT1d
+ * \param  d_inData  : device buffer of size [N * batch] read by fetch
+ * \param  d_outData : device buffer of size [N * batch] written by fft1d in bit reversed order
+ * \param  inv       : toggle for backward transforms
+ * \param  batch     : number of batched executions of 1D FFT
+ * \return time taken in milliseconds for the execution
  */
-fpga_t fftfpga_c2c_1d(const unsigned N, const double2 *inp, double2 *out, const bool inv, const unsigned batch){
-  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
-  cl_kernel fetch_kernel = NULL, fft_kernel = NULL;
+static double fft1d_exec(const unsigned N, cl_mem d_inData, cl_mem d_outData, const bool inv, const unsigned batch){
   cl_int status = 0;
 
-  // if N is not a power of 2
-  if(inp == NULL || out == NULL || ((N & (N-1)) !=0)){
-    return fft_time;
-  }
-
-  queue_setup();
-
-  cl_mem d_inData, d_outData;
-  d_inData = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(double2) * N * batch, NULL, &status);
-  checkError(status, "Failed to allocate input device buffer\n");
-
-  d_outData = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(double2) * N * batch, NULL, &status);
-  checkError(status, "Failed to allocate output device buffer\n");
-
-  printf("-- Copying data from host to device\n");
-  // Copy data from host to device
-  cl_event writeBuf_event;
-  status = clEnqueueWriteBuffer(queue1, d_inData, CL_TRUE, 0, sizeof(double2) * N * batch, inp, 0, NULL, &writeBuf_event);
-  checkError(status, "Failed to copy data to device");
-
-  status = clFinish(queue1);
-  checkError(status, "failed to finish writing buffer using PCIe");
-
-  cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
-  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
-  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
-
-  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
-
   // Can't pass bool to device, so convert it to int
   int inverse_int = (int)inv;
 
   // Create Kernels - names must match the kernel name in the original CL file
-  fetch_kernel = clCreateKernel(program, "fetch", &status);
+  cl_kernel kernel1 = clCreateKernel(program, "fetch", &status);
   checkError(status, "Failed to create fetch kernel");
 
-  fft_kernel = clCreateKernel(program, "fft1d", &status);
+  cl_kernel kernel2 = clCreateKernel(program, "fft1d", &status);
   checkError(status, "Failed to create fft1d kernel");
   // Set the kernel arguments
-  // from here
-  status = clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData);
-  checkError(status, "Failed to set fetch_kernel arg 0");
-  status = clSetKernelArg(fft_kernel, 0, sizeof(cl_mem), (void *)&d_outData);
-  checkError(status, "Failed to set fft_kernel arg 0");
-  status = clSetKernelArg(fft_kernel, 1, sizeof(cl_int), (void*)&batch);
-  checkError(status, "Failed to set fft_kernel arg 1");
-  status = clSetKernelArg(fft_kernel, 2, sizeof(cl_int), (void*)&inverse_int);
-  checkError(status, "Failed to set fft_kernel arg 2");
-
-  printf(inverse_int ? "\tInverse FFT" : "\tFFT");
-  printf(" kernel initialization is complete.\n");
+  status = clSetKernelArg(kernel1, 0, sizeof(cl_mem), (void *)&d_inData);
+  checkError(status, "Failed to set kernel1 arg 0");
+  status = clSetKernelArg(kernel2, 0, sizeof(cl_mem), (void *)&d_outData);
+  checkError(status, "Failed to set kernel arg 0");
+  status = clSetKernelArg(kernel2, 1, sizeof(cl_int), (void*)&batch);
+  checkError(status, "Failed to set kernel arg 1");
+  status = clSetKernelArg(kernel2, 2, sizeof(cl_int), (void*)&inverse_int);
+  checkError(status, "Failed to set kernel arg 2");
 
   size_t ls = N/8;
   size_t gs = batch * ls;
 
   printf("-- Executing kernels\n");
+  cl_event startExec_event, endExec_event;
   // Measure execution time
-  cl_event exec_event;
+  // Launch the kernel - we launch a single work item hence enqueue a task
   // FFT1d kernel is the SWI kernel
-  status = clEnqueueTask(queue1, fft_kernel, 0, NULL, &exec_event);
+  status = clEnqueueTask(queue1, kernel2, 0, NULL, &endExec_event);
   checkError(status, "Failed to launch fft1d kernel");
 
-  status = clEnqueueNDRangeKernel(queue2, fetch_kernel, 1, NULL, &gs, &ls, 0, NULL, NULL);
+  status = clEnqueueNDRangeKernel(queue2, kernel1, 1, NULL, &gs, &ls, 0, NULL, &startExec_event);
   checkError(status, "Failed to launch fetch kernel");
   
   // Wait for command queue to complete pending events
-  status = clFinish(queue1);
-  checkError(status, "Failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "Failed to finish queue2");
+  status = wait_queues(2, (cl_command_queue[]){queue1, queue2});
+  checkError(status, "failed to finish queues");
   
   // Record execution time
   cl_ulong kernel_start = 0, kernel_end = 0;
-  clGetEventProfilingInfo(exec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
-  clGetEventProfilingInfo(exec_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
+  clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
+  clGetEventProfilingInfo(endExec_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
 
-  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
+  if(kernel1)
+    clReleaseKernel(kernel1);
+  if(kernel2)
+    clReleaseKernel(kernel2);
 
-  // Copy results from device to host
-  printf("-- Transfering results back to host\n");
-  cl_event readBuf_event;
-  status = clEnqueueReadBuffer(queue1, d_outData, CL_TRUE, 0, sizeof(float2) * N * batch, out, 0, NULL, &readBuf_event);
-  checkError(status, "Failed to copy data from device");
+  return (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
+}
 
-  status = clFinish(queue1);
-  checkError(status, "failed to finish reading buffer using PCIe");
+/**
+ * \brief  compute an out-of-place double precision complex 1D-FFT on the FPGA in single precision. The conversions overlap with the transfers, see convert_write() and convert_read().
+ * \param  N    : unsigned integer to the number of points in 1D FFT
+ * \param  inp  : double2 pointer to input data of size [N * batch]
+ * \param  out  : double2 pointer to output data of size [N * batch]
+ * \param  inv  : toggle to activate backward FFT
+ * \param  batch : number of batched executions of 1D FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution, pcie_write_t and pcie_read_t including the conversions
+ */
+fpga_t fftfpga_c2c_1d(const unsigned N, const double2 *inp, double2 *out, const bool inv, const unsigned batch){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
 
-  cl_ulong readBuf_start = 0, readBuf_end = 0;
-  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
-  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && batch > 0 && fallback_required(1, N, batch, fft1d_kernels)){
+    return convert_fallback(1, N, inp, out, inv, batch);
+  }
 
-  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06); 
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || batch == 0 || ((N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  const size_t num_pts = (size_t)N * batch;
+  queue_setup();
+
+  cl_mem stage_buf;
+  float2 *stage = host_buffer_map(queue1, &stage_buf, convert_stage_points(num_pts));
+
+  // the kernels compute in single precision
+  cl_mem d_inData, d_outData;
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  fft_time.pcie_write_t = convert_write(queue1, d_inData, inp, stage, num_pts);
+
+  fft_time.exec_t = fft1d_exec(N, d_inData, d_outData, inv, batch);
+
+  fft_time.pcie_read_t = convert_read(queue1, d_outData, out, stage, num_pts);
 
   // Cleanup
   if (d_inData)
   	clReleaseMemObject(d_inData);
   if (d_outData) 
 	  clReleaseMemObject(d_outData);
-  if(fetch_kernel)
-    clReleaseKernel(fetch_kernel);
-  if(fft_kernel)
-    clReleaseKernel(fft_kernel);
+  host_buffer_unmap(queue1, stage_buf, stage);
   queue_cleanup();
+
   fft_time.valid = 1;
   return fft_time;
 }
@@ -148,9 +155,13 @@ fpga_t fftfpga_c2c_1d(const unsigned N, const double2 *inp, double2 *out, const
 fpga_t fftfpgaf_c2c_1d(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch){
 
   fpga_t fft_time = {0.0, 0.0, 0.0, 0};
-  cl_kernel kernel1 = NULL, kernel2 = NULL;
   cl_int status = 0;
 
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && batch > 0 && fallback_required(1, N, batch, fft1d_kernels)){
+    return fallback_c2c(1, N, inp, out, inv, batch);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
     return fft_time;
@@ -172,74 +183,376 @@ fpga_t fftfpgaf_c2c_1d(const unsigned N, const float2 *inp, float2 *out, const b
 
   printf("-- Copying data from host to device\n");
   // Copy data from host to device
-  status = clEnqueueWriteBuffer(queue1, d_inData, CL_TRUE, 0, sizeof(float2) * N * batch, inp, 0, NULL, NULL);
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * N * batch, inp, 0, NULL, NULL);
   checkError(status, "Failed to copy data to device");
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish writing buffer using PCIe");
 
+  fft_time.exec_t = fft1d_exec(N, d_inData, d_outData, inv, batch);
+
+  // Copy results from device to host
+  printf("-- Transfering results back to host\n");
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * N * batch, out, 0, NULL, NULL);
+  checkError(status, "Failed to copy data from device");
+
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading buffer using PCIe");
+
+  // Cleanup
+  if (d_inData)
+  	clReleaseMemObject(d_inData);
+  if (d_outData) 
+	  clReleaseMemObject(d_outData);
+  queue_cleanup();
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+// points of a chunk of the output read while the previous chunk is reordered
+#define READ_CHUNK_POINTS (1 << 18)
+
+/**
+ * \brief  read the bit reversed output of a batch of 1D-FFTs in chunks, reordering each chunk on the host while the next is transferred
+ * \param  d_outData : device buffer of size [N * batch]
+ * \param  out       : float2 pointer to output data of size [N * batch] in natural order
+ * \param  stage     : float2 pointer to two chunks of READ_CHUNK_POINTS, at least two transforms
+ * \return time taken in milliseconds for the overlapped transfers and reordering
+ */
+static double read_natural(cl_mem d_outData, float2 *out, float2 *stage, const unsigned N, const unsigned batch){
+  cl_int status = 0;
+  const size_t chunk = (READ_CHUNK_POINTS / N > 0) ? READ_CHUNK_POINTS / N : 1;
+  const size_t num_chunks = (batch + chunk - 1) / chunk;
+  const unsigned threads = cpu_fft_num_threads();
+  cl_event read_event[2];
+
+  double start = getTimeinMilliSec();
+
+  size_t count = (batch < chunk) ? batch : chunk;
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * N * count, stage, 0, NULL, &read_event[0]);
+  checkError(status, "Failed to copy data from device");
+
+  for(size_t c = 0; c < num_chunks; c++){
+    size_t first = c * chunk;
+    count = (batch - first < chunk) ? batch - first : chunk;
+
+    if(c + 1 < num_chunks){
+      size_t next = first + chunk;
+      size_t next_count = (batch - next < chunk) ? batch - next : chunk;
+      status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, sizeof(float2) * N * next, sizeof(float2) * N * next_count, &stage[((c + 1) & 1) * chunk * N], 0, NULL, &read_event[(c + 1) & 1]);
+      checkError(status, "Failed to copy data from device");
+    }
+
+    status = wait_events(1, &read_event[c & 1]);
+    checkError(status, "failed to finish reading buffer using PCIe");
+    clReleaseEvent(read_event[c & 1]);
+
+    bitrev_permute(&out[first * N], &stage[(c & 1) * chunk * N], N, count, threads);
+  }
+
+  return getTimeinMilliSec() - start;
+}
+
+/**
+ * \brief  compute an out-of-place single precision complex 1D-FFT on the FPGA with the output in natural order. Bitstreams with a store kernel reorder on chip, otherwise the output is reordered on the host while it is transferred.
+ * \param  N    : unsigned integer to the number of points in FFT1d  
+ * \param  inp  : float2 pointer to input data of size [N * batch]
+ * \param  out  : float2 pointer to output data of size [N * batch]
+ * \param  inv  : toggle for backward transforms
+ * \param  batch : number of batched executions of 1D FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution, pcie_read_t including the reordering on the host
+ */
+fpga_t fftfpgaf_c2c_1d_natural(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_kernel fetch_kernel = NULL, fft_kernel = NULL, store_kernel = NULL;
+  cl_int status = 0;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && batch > 0 && fallback_required(1, N, batch, fft1d_kernels)){
+    return fallback_c2c_natural(1, N, inp, out, inv, batch);
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || batch == 0 || N < 8 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  // bitstreams reordering on chip provide a store kernel
+  bool on_chip = kernels_available(fft1d_natural_kernels);
+
+  float2 *stage = NULL;
+  if(!on_chip){
+    size_t chunk = (READ_CHUNK_POINTS / N > 0) ? READ_CHUNK_POINTS / N : 1;
+    stage = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * 2 * chunk * N);
+    if(stage == NULL){
+      return fft_time;
+    }
+  }
+
+  queue_setup();
+
+  cl_mem d_inData, d_outData;
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float2) * N * batch, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * N * batch, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * N * batch, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish writing buffer using PCIe");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
   // Can't pass bool to device, so convert it to int
   int inverse_int = (int)inv;
 
-  // Create Kernels - names must match the kernel name in the original CL file
-  kernel1 = clCreateKernel(program, "fetch", &status);
+  fetch_kernel = clCreateKernel(program, "fetch", &status);
   checkError(status, "Failed to create fetch kernel");
-
-  kernel2 = clCreateKernel(program, "fft1d", &status);
+  fft_kernel = clCreateKernel(program, "fft1d", &status);
   checkError(status, "Failed to create fft1d kernel");
-  // Set the kernel arguments
-  status = clSetKernelArg(kernel1, 0, sizeof(cl_mem), (void *)&d_inData);
-  checkError(status, "Failed to set kernel1 arg 0");
-  status = clSetKernelArg(kernel2, 0, sizeof(cl_mem), (void *)&d_outData);
-  checkError(status, "Failed to set kernel arg 0");
-  status = clSetKernelArg(kernel2, 1, sizeof(cl_int), (void*)&batch);
-  checkError(status, "Failed to set kernel arg 1");
-  status = clSetKernelArg(kernel2, 2, sizeof(cl_int), (void*)&inverse_int);
-  checkError(status, "Failed to set kernel arg 2");
+  if(on_chip){
+    store_kernel = clCreateKernel(program, "store", &status);
+    checkError(status, "Failed to create store kernel");
+  }
+
+  status = clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData);
+  checkError(status, "Failed to set fetch kernel arg 0");
+  if(on_chip){
+    status = clSetKernelArg(fft_kernel, 0, sizeof(cl_int), (void*)&batch);
+    checkError(status, "Failed to set fft1d kernel arg 0");
+    status = clSetKernelArg(fft_kernel, 1, sizeof(cl_int), (void*)&inverse_int);
+    checkError(status, "Failed to set fft1d kernel arg 1");
+    status = clSetKernelArg(store_kernel, 0, sizeof(cl_mem), (void *)&d_outData);
+    checkError(status, "Failed to set store kernel arg 0");
+    status = clSetKernelArg(store_kernel, 1, sizeof(cl_int), (void*)&batch);
+    checkError(status, "Failed to set store kernel arg 1");
+  }
+  else{
+    status = clSetKernelArg(fft_kernel, 0, sizeof(cl_mem), (void *)&d_outData);
+    checkError(status, "Failed to set fft1d kernel arg 0");
+    status = clSetKernelArg(fft_kernel, 1, sizeof(cl_int), (void*)&batch);
+    checkError(status, "Failed to set fft1d kernel arg 1");
+    status = clSetKernelArg(fft_kernel, 2, sizeof(cl_int), (void*)&inverse_int);
+    checkError(status, "Failed to set fft1d kernel arg 2");
+  }
 
   size_t ls = N/8;
   size_t gs = batch * ls;
 
-  printf("-- Executing kernels\n");
   cl_event startExec_event, endExec_event;
-  // Measure execution time
-  // Launch the kernel - we launch a single work item hence enqueue a task
-  // FFT1d kernel is the SWI kernel
-  status = clEnqueueTask(queue1, kernel2, 0, NULL, &endExec_event);
+  if(on_chip){
+    status = clEnqueueTask(queue3, store_kernel, 0, NULL, &endExec_event);
+    checkError(status, "Failed to launch store kernel");
+  }
+
+  status = clEnqueueTask(queue1, fft_kernel, 0, NULL, on_chip ? NULL : &endExec_event);
   checkError(status, "Failed to launch fft1d kernel");
 
-  status = clEnqueueNDRangeKernel(queue2, kernel1, 1, NULL, &gs, &ls, 0, NULL, &startExec_event);
+  status = clEnqueueNDRangeKernel(queue2, fetch_kernel, 1, NULL, &gs, &ls, 0, NULL, &startExec_event);
   checkError(status, "Failed to launch fetch kernel");
-  
-  // Wait for command queue to complete pending events
-  status = clFinish(queue1);
-  checkError(status, "Failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "Failed to finish queue2");
-  
-  // Record execution time
+
+  status = wait_queues(3, (cl_command_queue[]){queue1, queue2, queue3});
+  checkError(status, "failed to finish queues");
+
   cl_ulong kernel_start = 0, kernel_end = 0;
   clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
   clGetEventProfilingInfo(endExec_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
   fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
 
-  // Copy results from device to host
-  printf("-- Transfering results back to host\n");
-  status = clEnqueueReadBuffer(queue1, d_outData, CL_TRUE, 0, sizeof(float2) * N * batch, out, 0, NULL, NULL);
+  if(on_chip){
+    cl_event readBuf_event;
+    status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * N * batch, out, 0, NULL, &readBuf_event);
+    checkError(status, "Failed to copy data from device");
+
+    status = wait_queue(queue1);
+    checkError(status, "failed to finish reading buffer using PCIe");
+
+    cl_ulong readBuf_start = 0, readBuf_end = 0;
+    clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+    clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+    fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+  }
+  else{
+    fft_time.pcie_read_t = read_natural(d_outData, out, stage, N, batch);
+  }
+
+  // Cleanup
+  if (d_inData)
+    clReleaseMemObject(d_inData);
+  if (d_outData) 
+    clReleaseMemObject(d_outData);
+  if(fetch_kernel)
+    clReleaseKernel(fetch_kernel);
+  if(fft_kernel)
+    clReleaseKernel(fft_kernel);
+  if(store_kernel)
+    clReleaseKernel(store_kernel);
+  queue_cleanup();
+  free(stage);
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  compute an out-of-place single precision complex 1D-FFT larger than the 1D engine using the four-step decomposition on the 2D engine of the fft_large bitstream. The N = n * n points are transformed as n x n matrix: the first pass transforms its columns, multiplies the twiddle factors and writes the result transposed to DDR, the second pass transforms the rows and writes them transposed.
+ * \param  N    : unsigned integer to the number of points in FFT1d, the square of the power of 2 sized 2D engine
+ * \param  inp  : float2 pointer to input data of size N
+ * \param  out  : float2 pointer to output data of size N in natural order
+ * \param  inv  : toggle for backward transforms
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_1d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_kernel fetch_kernel = NULL, fft_kernel = NULL, twiddle_kernel = NULL, transpose_kernel = NULL;
+  cl_int status = 0;
+  int mangle_int = 0, tiled_int = 0, offset = 0;
+
+  // size of the 2D engine
+  unsigned n = 1;
+  while((size_t)n * n < N)
+    n <<= 1;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && (size_t)n * n == N && fallback_required(2, n, 1, fft1d_large_kernels)){
+    return fallback_c2c_natural(1, N, inp, out, inv, 1);
+  }
+
+  // if N is not the square of a power of 2
+  if(inp == NULL || out == NULL || (size_t)n * n != N || n < 8){
+    return fft_time;
+  }
+
+  queue_setup();
+
+  cl_mem d_inData, d_outData, d_tmp;
+
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float2) * N, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float2) * N, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+  d_tmp = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * N, NULL, &status);
+  checkError(status, "Failed to allocate intermediate device buffer\n");
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * N, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish writing buffer using PCIe");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  // Can't pass bool to device, so convert it to int
+  int inverse_int = (int)inv;
+
+  fetch_kernel = clCreateKernel(program, "fetch", &status);
+  checkError(status, "Failed to create fetch kernel");
+  fft_kernel = clCreateKernel(program, "fft2d", &status);
+  checkError(status, "Failed to create fft2d kernel");
+  twiddle_kernel = clCreateKernel(program, "twiddle", &status);
+  checkError(status, "Failed to create twiddle kernel");
+  transpose_kernel = clCreateKernel(program, "transpose", &status);
+  checkError(status, "Failed to create transpose kernel");
+
+  size_t lws[] = {n};
+  size_t gws[] = {N / 8};
+
+  cl_event startExec_event[2], endExec_event[2];
+  for(size_t i = 0; i < 2; i++){
+    // the first pass reads the columns of the input and multiplies the twiddle factors
+    int first_pass = (i == 0);
+
+    status = clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), i == 0 ? (void *)&d_inData : (void *)&d_tmp);
+    checkError(status, "Failed to set fetch kernel arg 0");
+    status = clSetKernelArg(fetch_kernel, 1, sizeof(cl_int), (void*)&mangle_int);
+    checkError(status, "Failed to set fetch kernel arg 1");
+    status = clSetKernelArg(fetch_kernel, 2, sizeof(cl_int), (void*)&first_pass);
+    checkError(status, "Failed to set fetch kernel arg 2");
+    status = clSetKernelArg(fetch_kernel, 3, sizeof(cl_int), (void*)&offset);
+    checkError(status, "Failed to set fetch kernel arg 3");
+    status = clSetKernelArg(fetch_kernel, 4, sizeof(cl_int), (void*)&n);
+    checkError(status, "Failed to set fetch kernel arg 4");
+    status = clSetKernelArg(fetch_kernel, 5, sizeof(cl_int), (void*)&tiled_int);
+    checkError(status, "Failed to set fetch kernel arg 5");
+    status = clEnqueueNDRangeKernel(queue1, fetch_kernel, 1, 0, gws, lws, 0, NULL, &startExec_event[i]);
+    checkError(status, "Failed to launch fetch kernel");
+
+    status = clSetKernelArg(fft_kernel, 0, sizeof(cl_int), (void*)&inverse_int);
+    checkError(status, "Failed to set fft2d kernel arg 0");
+    status = clEnqueueTask(queue2, fft_kernel, 0, NULL, NULL);
+    checkError(status, "Failed to launch fft2d kernel");
+
+    status = clSetKernelArg(twiddle_kernel, 0, sizeof(cl_int), (void*)&first_pass);
+    checkError(status, "Failed to set twiddle kernel arg 0");
+    status = clSetKernelArg(twiddle_kernel, 1, sizeof(cl_int), (void*)&inverse_int);
+    checkError(status, "Failed to set twiddle kernel arg 1");
+    status = clEnqueueTask(queue4, twiddle_kernel, 0, NULL, NULL);
+    checkError(status, "Failed to launch twiddle kernel");
+
+    status = clSetKernelArg(transpose_kernel, 0, sizeof(cl_mem), i == 0 ? (void *)&d_tmp : (void *)&d_outData);
+    checkError(status, "Failed to set transpose kernel arg 0");
+    status = clSetKernelArg(transpose_kernel, 1, sizeof(cl_int), (void*)&mangle_int);
+    checkError(status, "Failed to set transpose kernel arg 1");
+    status = clSetKernelArg(transpose_kernel, 2, sizeof(cl_int), (void*)&offset);
+    checkError(status, "Failed to set transpose kernel arg 2");
+    status = clSetKernelArg(transpose_kernel, 3, sizeof(cl_int), (void*)&n);
+    checkError(status, "Failed to set transpose kernel arg 3");
+    status = clSetKernelArg(transpose_kernel, 4, sizeof(cl_int), (void*)&tiled_int);
+    checkError(status, "Failed to set transpose kernel arg 4");
+    status = clEnqueueNDRangeKernel(queue3, transpose_kernel, 1, 0, gws, lws, 0, NULL, &endExec_event[i]);
+    checkError(status, "Failed to launch transpose kernel");
+
+    // the intermediate result has to be written before the second pass reads it
+    status = wait_queues(4, (cl_command_queue[]){queue1, queue2, queue4, queue3});
+    checkError(status, "failed to finish queues");
+  }
+
+  cl_ulong kernel_start = 0, kernel_end = 0;
+  for(size_t i = 0; i < 2; i++){
+    clGetEventProfilingInfo(startExec_event[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
+    clGetEventProfilingInfo(endExec_event[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
+    fft_time.exec_t += (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
+  }
+
+  cl_event readBuf_event;
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * N, out, 0, NULL, &readBuf_event);
   checkError(status, "Failed to copy data from device");
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish reading buffer using PCIe");
 
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
   // Cleanup
   if (d_inData)
-  	clReleaseMemObject(d_inData);
+    clReleaseMemObject(d_inData);
   if (d_outData) 
-	  clReleaseMemObject(d_outData);
-  if(kernel1)
-    clReleaseKernel(kernel1);
-  if(kernel2)
-    clReleaseKernel(kernel2);
+    clReleaseMemObject(d_outData);
+  if (d_tmp)
+    clReleaseMemObject(d_tmp);
+  if(fetch_kernel)
+    clReleaseKernel(fetch_kernel);
+  if(fft_kernel)
+    clReleaseKernel(fft_kernel);
+  if(twiddle_kernel)
+    clReleaseKernel(twiddle_kernel);
+  if(transpose_kernel)
+    clReleaseKernel(transpose_kernel);
   queue_cleanup();
 
   fft_time.valid = 1;
@@ -260,6 +573,11 @@ fpga_t fftfpgaf_c2c_1d_svm(const unsigned N, const float2 *inp, float2 *out, con
   cl_int status = 0;
   unsigned num_pts = N * batch;
   
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && batch > 0 && fallback_required(1, N, batch, fft1d_kernels)){
+    return fallback_c2c(1, N, inp, out, inv, batch);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || !(svm_enabled)){
     return fft_time;
@@ -277,34 +595,9 @@ fpga_t fftfpgaf_c2c_1d_svm(const unsigned N, const float2 *inp, float2 *out, con
   // Setup Queues to the kernels
   queue_setup();
 
-  // allocate SVM buffers
-  float2 *h_inData, *h_outData;
-  h_inData = (float2 *)clSVMAlloc(context, CL_MEM_READ_ONLY, sizeof(float2) * num_pts, 0);
-  h_outData = (float2 *)clSVMAlloc(context, CL_MEM_WRITE_ONLY, sizeof(float2) * num_pts, 0);
-
-  // copy data into h_inData
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_inData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map input data");
-
-  for(size_t i = 0; i < num_pts; i++){
-    h_inData[i].x = inp[i].x;
-    h_inData[i].y = inp[i].y;
-  }
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_inData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap input data");
-
-  // initialize h_outData with zeroes
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_outData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map input data");
-
-  for(size_t i = 0; i < num_pts; i++){
-    h_outData[i].x = 0.0;
-    h_outData[i].y = 0.0;
-  }
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_outData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap input data");
+  // SVM pointers, the host memory itself with fine grained system SVM
+  float2 *h_inData = svm_input(queue1, inp, num_pts);
+  float2 *h_outData = svm_output(out, num_pts);
 
   // write to fetch kernel using SVM based PCIe
   status = clSetKernelArgSVMPointer(fetch_kernel, 0, (void *)h_inData);
@@ -332,10 +625,8 @@ fpga_t fftfpgaf_c2c_1d_svm(const unsigned N, const float2 *inp, float2 *out, con
   status = clEnqueueNDRangeKernel(queue2, fetch_kernel, 1, NULL, &gs, &ls, 0, NULL, &startExec_event);
   checkError(status, "Failed to launch fetch kernel");
 
-  status = clFinish(queue2);
-  checkError(status, "failed to finish");
-  status = clFinish(queue1);
-  checkError(status, "failed to finish");
+  status = wait_queues(2, (cl_command_queue[]){queue2, queue1});
+  checkError(status, "failed to finish queues");
 
   cl_ulong kernel_start = 0, kernel_end = 0;
 
@@ -344,22 +635,10 @@ fpga_t fftfpgaf_c2c_1d_svm(const unsigned N, const float2 *inp, float2 *out, con
 
   fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
 
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_READ,
-    (void *)h_outData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map out data");
-
-  for(size_t i = 0; i < num_pts; i++){
-    out[i].x = h_outData[i].x;
-    out[i].y = h_outData[i].y;
-  }
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_outData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap out data");
+  svm_read(queue1, out, h_outData, num_pts);
 
-  if (h_inData)
-    clSVMFree(context, h_inData);
-  if (h_outData)
-    clSVMFree(context, h_outData);
+  svm_release(inp, h_inData);
+  svm_release(out, h_outData);
 
   queue_cleanup();
 
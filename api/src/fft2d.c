@@ -14,62 +14,39 @@
 #include "svm.h"
 #include "opencl_utils.h"
 #include "misc.h"
+#include "fallback.h"
+#include "completion.h"
+#include "convert.h"
+#include "buffer.h"
+
+// kernels required in the bitstream
+static const char *fft2d_ddr_kernels[] = {"fft2d", NULL};
+static const char *fft2d_bram_kernels[] = {"fft2da", NULL};
 
 /**
- * \brief  compute an out-of-place single precision complex 2D-FFT using the DDR of the FPGA
- * \param  N    : integer pointer to size of FFT2d  
- * \param  inp  : float2 pointer to input data of size [N * N]
- * \param  out  : float2 pointer to output data of size [N * N]
- * \param  inv  : int toggle to activate backward FFT
- * \param  iter : int toggle to activate backward FFT
- * \return fpga_t : time taken in milliseconds for data transfers and execution
+ * \brief  enqueue the two passes of a 2D-FFT using the DDR of the FPGA on buffers in the global memory and wait for their completion. Queues are set up by the caller.
+ * \param  N         : integer pointer to size of FFT2d
+ * \param  d_inData  : device buffer of size [N * N] read by the first pass
+ * \param  d_outData : device buffer of size [N * N] written by the second pass
+ * \param  inv       : toggle to activate backward FFT
+ * \return time taken in milliseconds for the execution
  */
-fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv){
-  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0};
-  cl_kernel fetch_kernel = NULL, fft_kernel = NULL, transpose_kernel = NULL;
+static double fft2d_ddr_exec(const unsigned N, cl_mem d_inData, cl_mem d_outData, const bool inv){
   cl_int status = 0;
   int mangle_int = 0;
 
-  // if N is not a power of 2
-  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
-    return fft_time;
-  }
-
-  queue_setup();
-
-  cl_mem d_inData, d_outData, d_tmp;
-
-  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float2) * N * N, NULL, &status);
-  checkError(status, "Failed to allocate input device buffer\n");
-  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float2) * N * N, NULL, &status);
-  checkError(status, "Failed to allocate output device buffer\n");
-  d_tmp = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * N * N, NULL, &status);
+  cl_mem d_tmp = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * N * N, NULL, &status);
   checkError(status, "Failed to allocate output device buffer\n");
 
-  // Copy data from host to device
-  cl_event writeBuf_event;
-  status = clEnqueueWriteBuffer(queue1, d_inData, CL_TRUE, 0, sizeof(float2) * N * N, inp, 0, NULL, &writeBuf_event);
-  checkError(status, "Failed to copy data to device");
-
-  status = clFinish(queue1);
-  checkError(status, "failed to finish writing buffer using PCIe");
-
-  cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
-
-  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
-  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
-
-  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06); 
-
   // Can't pass bool to device, so convert it to int
   int inverse_int = (int)inv;
 
   // Create Kernels - names must match the kernel name in the original CL file
-  fft_kernel = clCreateKernel(program, "fft2d", &status);
+  cl_kernel fft_kernel = clCreateKernel(program, "fft2d", &status);
   checkError(status, "Failed to create kernel");
-  fetch_kernel = clCreateKernel(program, "fetch", &status);
+  cl_kernel fetch_kernel = clCreateKernel(program, "fetch", &status);
   checkError(status, "Failed to create kernel");
-  transpose_kernel = clCreateKernel(program, "transpose", &status);
+  cl_kernel transpose_kernel = clCreateKernel(program, "transpose", &status);
   checkError(status, "Failed to create kernel");
 
   cl_event startExec_event[2], endExec_event[2];
@@ -105,12 +82,8 @@ fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *out, con
     checkError(status, "Failed to launch kernel");
 
     // Wait for all command queues to complete pending events
-    status = clFinish(queue1);
-    checkError(status, "failed to finish");
-    status = clFinish(queue2);
-    checkError(status, "failed to finish");
-    status = clFinish(queue3);
-    checkError(status, "failed to finish");
+    status = wait_queues(3, (cl_command_queue[]){queue1, queue2, queue3});
+    checkError(status, "failed to finish queues");
   }
 
   cl_ulong kernel_start = 0, kernel_end = 0;
@@ -118,19 +91,134 @@ fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *out, con
   clGetEventProfilingInfo(startExec_event[0], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
   clGetEventProfilingInfo(endExec_event[0], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
 
-  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
+  double exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
 
   clGetEventProfilingInfo(startExec_event[1], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
   clGetEventProfilingInfo(endExec_event[1], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
 
-  fft_time.exec_t += (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
+  exec_t += (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
+
+  if (d_tmp)
+	  clReleaseMemObject(d_tmp);
+  if(fft_kernel)
+    clReleaseKernel(fft_kernel);
+  if(fetch_kernel)
+    clReleaseKernel(fetch_kernel);
+  if(transpose_kernel)
+    clReleaseKernel(transpose_kernel);
+
+  return exec_t;
+}
+
+/**
+ * \brief  compute an out-of-place double precision complex 2D-FFT using the DDR of the FPGA in single precision. The conversions overlap with the transfers, see convert_write() and convert_read().
+ * \param  N    : integer pointer to size of FFT2d
+ * \param  inp  : double2 pointer to input data of size [N * N]
+ * \param  out  : double2 pointer to output data of size [N * N]
+ * \param  inv  : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution, pcie_write_t and pcie_read_t including the conversions
+ */
+fpga_t fftfpga_c2c_2d_ddr(const unsigned N, const double2 *inp, double2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(2, N, 1, fft2d_ddr_kernels)){
+    return convert_fallback(2, N, inp, out, inv, 1);
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  const size_t num_pts = (size_t)N * N;
+  queue_setup();
+
+  cl_mem stage_buf;
+  float2 *stage = host_buffer_map(queue1, &stage_buf, convert_stage_points(num_pts));
+
+  // the kernels compute in single precision
+  cl_mem d_inData, d_outData;
+
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  fft_time.pcie_write_t = convert_write(queue1, d_inData, inp, stage, num_pts);
+
+  fft_time.exec_t = fft2d_ddr_exec(N, d_inData, d_outData, inv);
+
+  fft_time.pcie_read_t = convert_read(queue1, d_outData, out, stage, num_pts);
+
+  // Cleanup
+  if (d_inData)
+  	clReleaseMemObject(d_inData);
+  if (d_outData) 
+	  clReleaseMemObject(d_outData);
+  host_buffer_unmap(queue1, stage_buf, stage);
+  queue_cleanup();
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  compute an out-of-place single precision complex 2D-FFT using the DDR of the FPGA
+ * \param  N    : integer pointer to size of FFT2d  
+ * \param  inp  : float2 pointer to input data of size [N * N]
+ * \param  out  : float2 pointer to output data of size [N * N]
+ * \param  inv  : int toggle to activate backward FFT
+ * \param  iter : int toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(2, N, 1, fft2d_ddr_kernels)){
+    return fallback_c2c(2, N, inp, out, inv, 1);
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  queue_setup();
+
+  cl_mem d_inData, d_outData;
+
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float2) * N * N, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float2) * N * N, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  // Copy data from host to device
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * N * N, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish writing buffer using PCIe");
+
+  cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
+
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06); 
+
+  fft_time.exec_t = fft2d_ddr_exec(N, d_inData, d_outData, inv);
 
   // Copy results from device to host
   cl_event readBuf_event;
-  status = clEnqueueReadBuffer(queue1, d_outData, CL_TRUE, 0, sizeof(float2) * N * N, out, 0, NULL, &readBuf_event);
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * N * N, out, 0, NULL, &readBuf_event);
   checkError(status, "Failed to copy data from device");
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish reading buffer using PCIe");
 
   cl_ulong readBuf_start = 0, readBuf_end = 0;
@@ -144,14 +232,6 @@ fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *out, con
   	clReleaseMemObject(d_inData);
   if (d_outData) 
 	  clReleaseMemObject(d_outData);
-  if (d_tmp)
-	  clReleaseMemObject(d_tmp);
-  if(fft_kernel)
-    clReleaseKernel(fft_kernel);
-  if(fetch_kernel)
-    clReleaseKernel(fetch_kernel);
-  if(transpose_kernel)
-    clReleaseKernel(transpose_kernel);
   queue_cleanup();
 
   fft_time.valid = 1;
@@ -176,6 +256,11 @@ fpga_t fftfpgaf_c2c_2d_bram(const unsigned N, const float2 *inp, float2 *out, co
   cl_int status = 0;
   unsigned num_pts = how_many * N * N;
 
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && how_many > 0 && fallback_required(2, N, how_many, fft2d_bram_kernels)){
+    return fallback_c2c(2, N, inp, out, inv, how_many);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
     return fft_time;
@@ -203,10 +288,10 @@ fpga_t fftfpgaf_c2c_2d_bram(const unsigned N, const float2 *inp, float2 *out, co
 
  // Copy data from host to device
   cl_event writeBuf_event;
-  status = clEnqueueWriteBuffer(queue1, d_inData, CL_TRUE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
   checkError(status, "Failed to copy data to device");
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish");
 
   cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
@@ -279,16 +364,8 @@ fpga_t fftfpgaf_c2c_2d_bram(const unsigned N, const float2 *inp, float2 *out, co
   checkError(status, "Failed to launch store kernel");
 
   // Wait for all command queues to complete pending events
-  status = clFinish(queue1);
-  checkError(status, "failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish queue2");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue3");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue4");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue5");
+  status = wait_queues(5, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5});
+  checkError(status, "failed to finish queues");
 
   cl_ulong kernel_start = 0, kernel_end = 0;
 
@@ -300,10 +377,10 @@ fpga_t fftfpgaf_c2c_2d_bram(const unsigned N, const float2 *inp, float2 *out, co
   // Copy results from device to host
   cl_event readBuf_event;
 
-  status = clEnqueueReadBuffer(queue1, d_outData, CL_TRUE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
   checkError(status, "Failed to copy data from device");
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish reading buffer using PCIe");
 
   cl_ulong readBuf_start = 0, readBuf_end = 0;
@@ -354,40 +431,20 @@ fpga_t fftfpgaf_c2c_2d_bram_svm(const unsigned N, const float2 *inp, float2 *out
   cl_kernel fetch_kernel = NULL, store_kernel = NULL;
   cl_kernel transpose_kernel = NULL;
 
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && how_many > 0 && fallback_required(2, N, how_many, fft2d_bram_kernels)){
+    return fallback_c2c(2, N, inp, out, inv, how_many);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || (!svm_enabled))
     return fft_time;
 
   queue_setup();
 
-  // allocate SVM buffers
-  float2 *h_inData, *h_outData;
-  h_inData = (float2 *)clSVMAlloc(context, CL_MEM_READ_ONLY, sizeof(float2) * num_pts, 0);
-  h_outData = (float2 *)clSVMAlloc(context, CL_MEM_WRITE_ONLY, sizeof(float2) * num_pts, 0);
-
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_inData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map input data");
-
-  // copy data into h_inData
-  for(size_t i = 0; i < num_pts; i++){
-    h_inData[i].x = inp[i].x;
-    h_inData[i].y = inp[i].y;
-  }
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_inData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap input data");
-
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_outData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map input data");
-
-  // copy data into h_inData
-  for(size_t i = 0; i < num_pts; i++){
-    h_outData[i].x = 0.0;
-    h_outData[i].y = 0.0;
-  }
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_outData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap input data");
+  // SVM pointers, the host memory itself with fine grained system SVM
+  float2 *h_inData = svm_input(queue1, inp, num_pts);
+  float2 *h_outData = svm_output(out, num_pts);
 
   // Can't pass bool to device, so convert it to int
   int inverse_int = (int)inv;
@@ -453,16 +510,8 @@ fpga_t fftfpgaf_c2c_2d_bram_svm(const unsigned N, const float2 *inp, float2 *out
   checkError(status, "Failed to launch store kernel");
 
   // Wait for all command queues to complete pending events
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue5");
-  status = clFinish(queue1);
-  checkError(status, "failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish queue2");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue3");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue4");
+  status = wait_queues(5, (cl_command_queue[]){queue5, queue1, queue2, queue3, queue4});
+  checkError(status, "failed to finish queues");
 
   cl_ulong kernel_start = 0, kernel_end = 0;
   clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
@@ -470,22 +519,10 @@ fpga_t fftfpgaf_c2c_2d_bram_svm(const unsigned N, const float2 *inp, float2 *out
 
   fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
 
- status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_READ,
-    (void *)h_outData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map out data");
-
-  for(size_t i = 0; i < num_pts; i++){
-    out[i].x = h_outData[i].x;
-    out[i].y = h_outData[i].y;
-  }
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_outData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap out data");
+  svm_read(queue1, out, h_outData, num_pts);
 
-  if (h_inData)
-    clSVMFree(context, h_inData);
-  if (h_outData)
-    clSVMFree(context, h_outData);
+  svm_release(inp, h_inData);
+  svm_release(out, h_outData);
 
   queue_cleanup();
 
@@ -13,11 +13,23 @@
 #include "fftfpga/fftfpga.h"
 #include "opencl_utils.h"
 #include "misc.h"
+#include "fallback.h"
+#include "callback.h"
+#include "buffer.h"
+#include "fft3d.h"
+#include "completion.h"
+#include "convert.h"
 
 #define WR_GLOBALMEM 0
 #define RD_GLOBALMEM 1
 #define BATCH 2
 
+// kernels required in the bitstream
+static const char *fft3d_bram_kernels[] = {"fft3da", "transpose2d", NULL};
+const char *fft3d_ddr_kernels[] = {"fft3da", "transpose", NULL};
+static const char *fft3d_ddr_transposed_kernels[] = {"fft3da", "store_transposed", NULL};
+static const char *fft3d_large_kernels[] = {"fft2d", "twiddle", NULL};
+
 /**
  * \brief  compute an out-of-place single precision complex 3D-FFT using the BRAM of the FPGA
  * \param  N    : unsigned integer denoting the size of FFT3d  
@@ -35,6 +47,11 @@ fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *out, co
   cl_kernel fetch_kernel = NULL, store_kernel = NULL;
   cl_kernel transpose_kernel = NULL, transpose3d_kernel = NULL;
 
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(3, N, 1, fft3d_bram_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, 1);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
     return fft_time;
@@ -60,10 +77,10 @@ fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *out, co
   checkError(status, "Failed to allocate output device buffer\n");
 
   cl_event writeBuf_event;
-  status = clEnqueueWriteBuffer(queue1, d_inData, CL_TRUE, 0, sizeof(float2) * N * N * N, inp, 0, NULL, &writeBuf_event);
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * N * N * N, inp, 0, NULL, &writeBuf_event);
   checkError(status, "Failed to copy data to device");
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish");
 
   cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
@@ -134,20 +151,8 @@ fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *out, co
   checkError(status, "Failed to launch fetch kernel");
 
   // Wait for all command queues to complete pending events
-  status = clFinish(queue1);
-  checkError(status, "failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish queue2");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue3");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue4");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue5");
-  status = clFinish(queue6);
-  checkError(status, "failed to finish queue6");
-  status = clFinish(queue7);
-  checkError(status, "failed to finish queue7");
+  status = wait_queues(7, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5, queue6, queue7});
+  checkError(status, "failed to finish queues");
 
   cl_ulong kernel_start = 0, kernel_end = 0;
 
@@ -158,9 +163,9 @@ fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *out, co
 
   // Copy results from device to host
   cl_event readBuf_event;
-  status = clEnqueueReadBuffer(queue1, d_outData, CL_TRUE, 0, sizeof(float2) * N * N * N, out, 0, NULL, &readBuf_event);
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * N * N * N, out, 0, NULL, &readBuf_event);
   checkError(status, "Failed to copy data from device");
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish reading buffer using PCIe");
 
   cl_ulong readBuf_start = 0, readBuf_end = 0;
@@ -196,154 +201,262 @@ fpga_t fftfpgaf_c2c_3d_bram(const unsigned N, const float2 *inp, float2 *out, co
 }
 
 /**
- * \brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose
- * \param  N    : unsigned integer denoting the size of FFT3d  
- * \param  inp  : float2 pointer to input data of size [N * N * N]
- * \param  out  : float2 pointer to output data of size [N * N * N]
- * \param  inv  : toggle to activate backward FFT
- * \return fpga_t : time taken in milliseconds for data transfers and execution
+ * \brief  create the kernels and the transpose buffer of a bitstream using the DDR for 3D Transpose, to be reused by transforms of size N. Variants of the bitstream replace fetch and store only.
+ * \param  fft   : kernels and buffer, released by fft3d_ddr_release()
+ * \param  N     : unsigned integer denoting the size of FFT3d
+ * \param  fetch : name of the fetch kernel, NULL for fetch and its load callback
+ * \param  store : name of the store kernel, NULL for store and its store callback
  */
-fpga_t fftfpgaf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv) {
-  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+void fft3d_ddr_create(fft3d_ddr_t *fft, const unsigned N, const char *fetch, const char *store){
   cl_int status = 0;
   unsigned num_pts = N * N * N;
-  // 0 - WR_GLOBALMEM, 1 - RD_GLOBALMEM, 2 - BATCH
-  int mode = WR_GLOBALMEM;
-  
-  // if N is not a power of 2
-  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
-    return fft_time;
-  }
 
-  // Can't pass bool to device, so convert it to int
-  int inverse_int = (int)inv;
+  fft->N = N;
+  fft->fetch_callback = (fetch == NULL);
+  fft->store_callback = (store == NULL);
 
   // Setup kernels
-  cl_kernel fetch_kernel = clCreateKernel(program, "fetch", &status);
+  fft->fetch = clCreateKernel(program, fetch ? fetch : "fetch", &status);
   checkError(status, "Failed to create fetch kernel");
-  cl_kernel ffta_kernel = clCreateKernel(program, "fft3da", &status);
+  fft->ffta = clCreateKernel(program, "fft3da", &status);
   checkError(status, "Failed to create fft3da kernel");
-  cl_kernel transpose_kernel = clCreateKernel(program, "transpose", &status);
+  fft->transpose = clCreateKernel(program, "transpose", &status);
   checkError(status, "Failed to create transpose kernel");
-  cl_kernel fftb_kernel = clCreateKernel(program, "fft3db", &status);
+  fft->fftb = clCreateKernel(program, "fft3db", &status);
   checkError(status, "Failed to create fft3db kernel");
-  cl_kernel transpose3D_kernel = clCreateKernel(program, "transpose3D", &status);
+  fft->transpose3D = clCreateKernel(program, "transpose3D", &status);
   checkError(status, "Failed to create transpose3D kernel");
-  cl_kernel fftc_kernel = clCreateKernel(program, "fft3dc", &status);
+  fft->fftc = clCreateKernel(program, "fft3dc", &status);
   checkError(status, "Failed to create fft3dc kernel");
-  cl_kernel store_kernel = clCreateKernel(program, "store", &status);
+  fft->store = clCreateKernel(program, store ? store : "store", &status);
   checkError(status, "Failed to create store kernel");
 
-  // Setup Queues to the kernels
-  queue_setup();
-
-  // Device memory buffers
-  cl_mem d_inData, d_transpose, d_outData;
-  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
-  checkError(status, "Failed to allocate input device buffer\n");
-
-  d_transpose = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
-  checkError(status, "Failed to allocate output device buffer\n");
-
-  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  fft->d_transpose = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
   checkError(status, "Failed to allocate output device buffer\n");
+}
 
-  // Copy data from host to device
-  cl_event writeBuf_event;
-  status = clEnqueueWriteBuffer(queue1, d_inData, CL_TRUE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
-  checkError(status, "Failed to copy data to device");
-
-  status = clFinish(queue1);
-  checkError(status, "Failed to finish data transfer to device");
+/**
+ * \brief  set the arguments following the first one of a kernel
+ * \param  args : list terminated by {0, NULL}, may be NULL
+ */
+static void set_kernel_args(cl_kernel kernel, const kernel_arg_t *args, const char *name){
+  cl_int status = 0;
 
-  cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
+  for(cl_uint i = 0; args != NULL && args[i].value != NULL; i++){
+    status = clSetKernelArg(kernel, i + 1, args[i].size, args[i].value);
+    checkError(status, name);
+  }
+}
 
-  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
-  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+/**
+ * \brief  set the arguments of the kernels of a 3D-FFT using the DDR of the FPGA for 3D Transpose on buffers in the global memory
+ * \param  fft        : kernels created by fft3d_ddr_create()
+ * \param  d_inData   : device buffer read by fetch, of size [N * N * N] for fetch
+ * \param  d_outData  : device buffer written by store, of size [N * N * N] for store, may be d_inData as fetch completes before the first store
+ * \param  inv        : toggle to activate backward FFT
+ * \param  fetch_args : arguments of fetch following d_inData, terminated by {0, NULL}, NULL if none
+ * \param  store_args : arguments of store following d_outData, terminated by {0, NULL}, NULL if none
+ */
+void fft3d_ddr_set_args(fft3d_ddr_t *fft, cl_mem d_inData, cl_mem d_outData, const bool inv, const kernel_arg_t *fetch_args, const kernel_arg_t *store_args){
+  cl_int status = 0;
 
-  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06); 
+  // Can't pass bool to device, so convert it to int
+  int inverse_int = (int)inv;
 
-  status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData);
+  status=clSetKernelArg(fft->fetch, 0, sizeof(cl_mem), (void *)&d_inData);
   checkError(status, "Failed to set fetch kernel arg");
 
-  status=clSetKernelArg(ffta_kernel, 0, sizeof(cl_int), (void*)&inverse_int);
+  status=clSetKernelArg(fft->ffta, 0, sizeof(cl_int), (void*)&inverse_int);
   checkError(status, "Failed to set ffta kernel arg");
-  status=clSetKernelArg(fftb_kernel, 0, sizeof(cl_int), (void*)&inverse_int);
+  status=clSetKernelArg(fft->fftb, 0, sizeof(cl_int), (void*)&inverse_int);
   checkError(status, "Failed to set fftb kernel arg");
 
-  status=clSetKernelArg(transpose3D_kernel, 0, sizeof(cl_mem), (void *)&d_transpose);
+  status=clSetKernelArg(fft->transpose3D, 0, sizeof(cl_mem), (void *)&fft->d_transpose);
   checkError(status, "Failed to set transpose3D kernel arg 0");
 
-  status=clSetKernelArg(transpose3D_kernel, 1, sizeof(cl_mem), (void *)&d_transpose);
+  status=clSetKernelArg(fft->transpose3D, 1, sizeof(cl_mem), (void *)&fft->d_transpose);
   checkError(status, "Failed to set transpose3D kernel arg 1");
 
-  mode = WR_GLOBALMEM;
-  status=clSetKernelArg(transpose3D_kernel, 2, sizeof(cl_int), (void*)&mode);
-  checkError(status, "Failed to set transpose3D kernel arg 2");
-
-  status=clSetKernelArg(fftc_kernel, 0, sizeof(cl_int), (void*)&inverse_int);
+  status=clSetKernelArg(fft->fftc, 0, sizeof(cl_int), (void*)&inverse_int);
   checkError(status, "Failed to set fftc kernel arg");
-  status=clSetKernelArg(store_kernel, 0, sizeof(cl_mem), (void *)&d_outData);
+  status=clSetKernelArg(fft->store, 0, sizeof(cl_mem), (void *)&d_outData);
   checkError(status, "Failed to set store2 kernel arg");
 
+  set_kernel_args(fft->fetch, fetch_args, "Failed to set fetch kernel arg");
+  set_kernel_args(fft->store, store_args, "Failed to set store kernel arg");
+
+  // data of the load and store callbacks, if set, of the default fetch and
+  // store
+  if(fft->fetch_callback || fft->store_callback)
+    callback_set_args(fft->fetch_callback ? fft->fetch : NULL, fft->store_callback ? fft->store : NULL, fft->N);
+}
+
+/**
+ * \brief  enqueue the kernels of a 3D-FFT whose arguments are set by fft3d_ddr_set_args(), without waiting for their completion. Queues are set up by the caller.
+ * \param  fft         : kernels created by fft3d_ddr_create()
+ * \param  num_wait    : number of events in wait
+ * \param  wait        : events fetch waits for, NULL if none
+ * \param  fetch_event : event of fetch, NULL if not required
+ * \param  store_event : event of store, NULL if not required
+ */
+void fft3d_ddr_enqueue(fft3d_ddr_t *fft, const cl_uint num_wait, const cl_event *wait, cl_event *fetch_event, cl_event *store_event){
+  cl_int status = 0;
+  // 0 - WR_GLOBALMEM, 1 - RD_GLOBALMEM, 2 - BATCH
+  int mode = WR_GLOBALMEM;
+
   // Kernel Execution
-  cl_event startExec_event, endExec_event;
-  status = clEnqueueTask(queue7, store_kernel, 0, NULL, &endExec_event);
+  status = clEnqueueTask(queue7, fft->store, 0, NULL, store_event);
   checkError(status, "Failed to launch transpose kernel");
 
-  status = clEnqueueTask(queue6, fftc_kernel, 0, NULL, NULL);
+  status = clEnqueueTask(queue6, fft->fftc, 0, NULL, NULL);
   checkError(status, "Failed to launch fft kernel");
 
-  status = clEnqueueTask(queue5, transpose3D_kernel, 0, NULL, NULL);
+  mode = WR_GLOBALMEM;
+  status=clSetKernelArg(fft->transpose3D, 2, sizeof(cl_int), (void*)&mode);
+  checkError(status, "Failed to set transpose3D kernel arg 2");
+
+  status = clEnqueueTask(queue5, fft->transpose3D, 0, NULL, NULL);
   checkError(status, "Failed to launch write of transpose3d kernel");
 
   // enqueue fetch to same queue as the store kernel due to data dependency
   // therefore, not swapped
   mode = RD_GLOBALMEM;
-  status=clSetKernelArg(transpose3D_kernel, 2, sizeof(cl_int), (void*)&mode);
+  status=clSetKernelArg(fft->transpose3D, 2, sizeof(cl_int), (void*)&mode);
   checkError(status, "Failed to set transpose3D kernel arg 2");
 
-  status = clEnqueueTask(queue5, transpose3D_kernel, 0, NULL, NULL);
+  status = clEnqueueTask(queue5, fft->transpose3D, 0, NULL, NULL);
   checkError(status, "Failed to launch read of transpose3d kernel");
 
-  status = clEnqueueTask(queue4, fftb_kernel, 0, NULL, NULL);
+  status = clEnqueueTask(queue4, fft->fftb, 0, NULL, NULL);
   checkError(status, "Failed to launch second fft kernel");
 
-  status = clEnqueueTask(queue3, transpose_kernel, 0, NULL, NULL);
+  status = clEnqueueTask(queue3, fft->transpose, 0, NULL, NULL);
   checkError(status, "Failed to launch transpose kernel");
 
-  status = clEnqueueTask(queue2, ffta_kernel, 0, NULL, NULL);
+  status = clEnqueueTask(queue2, fft->ffta, 0, NULL, NULL);
   checkError(status, "Failed to launch fft kernel");
 
-  status = clEnqueueTask(queue1, fetch_kernel, 0, NULL, &startExec_event);
+  status = clEnqueueTask(queue1, fft->fetch, num_wait, wait, fetch_event);
   checkError(status, "Failed to launch fetch kernel");
+}
 
-  status = clFinish(queue1);
-  checkError(status, "failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish queue2");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue3");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue4");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue5");
-  status = clFinish(queue6);
-  checkError(status, "failed to finish queue6");
-  status = clFinish(queue7);
-  checkError(status, "failed to finish queue7");
+/**
+ * \brief  enqueue the kernels of a 3D-FFT using the DDR of the FPGA for 3D Transpose on buffers in the global memory and wait for their completion. Queues are set up by the caller.
+ * \param  fft        : kernels created by fft3d_ddr_create()
+ * \param  d_inData   : device buffer read by fetch
+ * \param  d_outData  : device buffer written by store
+ * \param  inv        : toggle to activate backward FFT
+ * \param  fetch_args : arguments of fetch following d_inData, terminated by {0, NULL}, NULL if none
+ * \param  store_args : arguments of store following d_outData, terminated by {0, NULL}, NULL if none
+ * \return time taken in milliseconds for the execution
+ */
+double fft3d_ddr_run(fft3d_ddr_t *fft, cl_mem d_inData, cl_mem d_outData, const bool inv, const kernel_arg_t *fetch_args, const kernel_arg_t *store_args){
+  cl_int status = 0;
+  cl_event startExec_event, endExec_event;
+
+  fft3d_ddr_set_args(fft, d_inData, d_outData, inv, fetch_args, store_args);
+  fft3d_ddr_enqueue(fft, 0, NULL, &startExec_event, &endExec_event);
+
+  status = wait_queues(7, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5, queue6, queue7});
+  checkError(status, "failed to finish queues");
 
   cl_ulong kernel_start = 0, kernel_end = 0;
   clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
   clGetEventProfilingInfo(endExec_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
 
-  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
+  clReleaseEvent(startExec_event);
+  clReleaseEvent(endExec_event);
+
+  return (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06); 
+}
+
+/**
+ * \brief  release the kernels and the transpose buffer created by fft3d_ddr_create()
+ */
+void fft3d_ddr_release(fft3d_ddr_t *fft){
+  if (fft->d_transpose) 
+    clReleaseMemObject(fft->d_transpose);
+
+  if(fft->fetch) 
+    clReleaseKernel(fft->fetch);  
+  if(fft->transpose3D) 
+    clReleaseKernel(fft->transpose3D);  
+
+  if(fft->ffta) 
+    clReleaseKernel(fft->ffta);  
+  if(fft->fftb) 
+    clReleaseKernel(fft->fftb);  
+  if(fft->fftc) 
+    clReleaseKernel(fft->fftc);  
+
+  if(fft->transpose) 
+    clReleaseKernel(fft->transpose);  
+
+  if(fft->store) 
+    clReleaseKernel(fft->store);  
+}
+
+/**
+ * \brief  compute a single 3D-FFT using the DDR of the FPGA for 3D Transpose on buffers in the global memory, creating and releasing its kernels. Queues are set up by the caller.
+ * \param  N          : unsigned integer denoting the size of FFT3d
+ * \param  fetch      : name of the fetch kernel, NULL for fetch and its load callback
+ * \param  store      : name of the store kernel, NULL for store and its store callback
+ * \param  d_inData   : device buffer read by fetch
+ * \param  d_outData  : device buffer written by store
+ * \param  inv        : toggle to activate backward FFT
+ * \param  fetch_args : arguments of fetch following d_inData, terminated by {0, NULL}, NULL if none
+ * \param  store_args : arguments of store following d_outData, terminated by {0, NULL}, NULL if none
+ * \return time taken in milliseconds for the execution
+ */
+double fft3d_ddr_exec(const unsigned N, const char *fetch, const char *store, cl_mem d_inData, cl_mem d_outData, const bool inv, const kernel_arg_t *fetch_args, const kernel_arg_t *store_args){
+  fft3d_ddr_t fft;
+  fft3d_ddr_create(&fft, N, fetch, store);
+  double exec_t = fft3d_ddr_run(&fft, d_inData, d_outData, inv, fetch_args, store_args);
+  fft3d_ddr_release(&fft);
+  return exec_t;
+}
+
+/**
+ * \brief  transfer the input to the FPGA, compute a 3D-FFT using the DDR for 3D Transpose and transfer the output back
+ */
+static fpga_t fft3d_ddr_pcie(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool transposed){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  unsigned num_pts = N * N * N;
+
+  // Setup Queues to the kernels
+  queue_setup();
+
+  // Device memory buffers
+  cl_mem d_inData, d_outData;
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  // Copy data from host to device
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0.0, writeBuf_end = 0.0;
+
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06); 
+
+  fft_time.exec_t = fft3d_ddr_exec(N, NULL, transposed ? "store_transposed" : NULL, d_inData, d_outData, inv, NULL, NULL);
 
   // Copy results from device to host
   cl_event readBuf_event;
-  status = clEnqueueReadBuffer(queue1, d_outData, CL_TRUE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
   checkError(status, "Failed to copy data from device to host");
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish reading DDR using PCIe");
 
   cl_ulong readBuf_start = 0, readBuf_end = 0;
@@ -358,52 +471,391 @@ fpga_t fftfpgaf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, con
     clReleaseMemObject(d_inData);
   if (d_outData) 
     clReleaseMemObject(d_outData);
-  if (d_transpose) 
-    clReleaseMemObject(d_transpose);
 
-  if(fetch_kernel) 
-    clReleaseKernel(fetch_kernel);  
-  if(transpose3D_kernel) 
-    clReleaseKernel(transpose3D_kernel);  
+  fft_time.valid = 1;
+  return fft_time;
+}
 
-  if(ffta_kernel) 
-    clReleaseKernel(ffta_kernel);  
-  if(fftb_kernel) 
-    clReleaseKernel(fftb_kernel);  
-  if(fftc_kernel) 
-    clReleaseKernel(fftc_kernel);  
+/**
+ * \brief  compute an out-of-place double precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose in single precision. The conversions overlap with the transfers, see convert_write() and convert_read().
+ * \param  N    : unsigned integer denoting the size of FFT3d
+ * \param  inp  : double2 pointer to input data of size [N * N * N]
+ * \param  out  : double2 pointer to output data of size [N * N * N]
+ * \param  inv  : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution, pcie_write_t and pcie_read_t including the conversions
+ */
+fpga_t fftfpga_c2c_3d_ddr(const unsigned N, const double2 *inp, double2 *out, const bool inv) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
 
-  if(transpose_kernel) 
-    clReleaseKernel(transpose_kernel);  
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(3, N, 1, fft3d_ddr_kernels)){
+    return convert_fallback(3, N, inp, out, inv, 1);
+  }
 
-  if(store_kernel) 
-    clReleaseKernel(store_kernel);  
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  const size_t num_pts = (size_t)N * N * N;
+  queue_setup();
+
+  cl_mem stage_buf;
+  float2 *stage = host_buffer_map(queue1, &stage_buf, convert_stage_points(num_pts));
+
+  // the kernels compute in single precision
+  cl_mem d_inData, d_outData;
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  fft_time.pcie_write_t = convert_write(queue1, d_inData, inp, stage, num_pts);
+
+  fft_time.exec_t = fft3d_ddr_exec(N, NULL, NULL, d_inData, d_outData, inv, NULL, NULL);
+
+  fft_time.pcie_read_t = convert_read(queue1, d_outData, out, stage, num_pts);
+
+  host_buffer_unmap(queue1, stage_buf, stage);
+  queue_cleanup();
+
+  if (d_inData)
+    clReleaseMemObject(d_inData);
+  if (d_outData) 
+    clReleaseMemObject(d_outData);
 
   fft_time.valid = 1;
   return fft_time;
 }
 
 /**
- * \brief compute an batched out-of-place single precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose
- * \param N    : unsigned integer denoting the size of FFT3d  
- * \param inp  : float2 pointer to input data of size [N * N * N]
- * \param out  : float2 pointer to output data of size [N * N * N]
- * \param inv  : toggle to activate backward FFT
- * \param interleaving : enable burst interleaved global memory buffers
- * \param how_many : number of batched computations
+ * \brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose
+ * \param  N    : unsigned integer denoting the size of FFT3d  
+ * \param  inp  : float2 pointer to input data of size [N * N * N]
+ * \param  out  : float2 pointer to output data of size [N * N * N]
+ * \param  inv  : toggle to activate backward FFT
  * \return fpga_t : time taken in milliseconds for data transfers and execution
  */
-fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving, const unsigned how_many) {
+fpga_t fftfpgaf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv) {
   fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(3, N, 1, fft3d_ddr_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, 1);
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  return fft3d_ddr_pcie(N, inp, out, inv, false);
+}
+
+/**
+ * \brief  reverse the order of the dimensions of a cube, point (z, y, x) moving to index (x * N + y) * N + z
+ * \return false if the temporary copy cannot be allocated
+ */
+static bool transpose_xyz(const unsigned N, float2 *data){
+  const size_t num_pts = (size_t)N * N * N;
+  float2 *tmp = (float2*)malloc(sizeof(float2) * num_pts);
+  if(tmp == NULL){
+    return false;
+  }
+
+  memcpy(tmp, data, sizeof(float2) * num_pts);
+  for(size_t z = 0; z < N; z++){
+    for(size_t y = 0; y < N; y++){
+      for(size_t x = 0; x < N; x++){
+        data[(x * N + y) * N + z] = tmp[(z * N + y) * N + x];
+      }
+    }
+  }
+
+  free(tmp);
+  return true;
+}
+
+/**
+ * \brief  compute an out-of-place single precision complex 3D-FFT using the fft3d_ddr_transposed bitstream, which leaves the output transposed instead of reordering it on chip. Point (z, y, x) of the transform is at out[(x * N + y) * N + z]. Transforming transposed data returns it to the natural order, so a forward transform, a pointwise operation and a backward transform round trip with both transforms skipping the reorder.
+ * \param  N    : unsigned integer denoting the size of FFT3d
+ * \param  inp  : float2 pointer to input data of size [N * N * N], natural or transposed
+ * \param  out  : float2 pointer to output data of size [N * N * N], in the other order than the input
+ * \param  inv  : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_transposed(const unsigned N, const float2 *inp, float2 *out, const bool inv) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+
+  // compute on the host if the FPGA cannot or should not, the transform
+  // commuting with the reversal of the dimensions
+  if(inp != NULL && out != NULL && fallback_required(3, N, 1, fft3d_ddr_transposed_kernels)){
+    fft_time = fallback_c2c(3, N, inp, out, inv, 1);
+    if(fft_time.valid && !transpose_xyz(N, out)){
+      fft_time.valid = 0;
+    }
+    return fft_time;
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  return fft3d_ddr_pcie(N, inp, out, inv, true);
+}
+
+/**
+ * \brief  compute a single precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose on buffers remaining in the global memory of the FPGA
+ * \param  N    : unsigned integer denoting the size of FFT3d  
+ * \param  inp  : handle to the input buffer of size [N * N * N]
+ * \param  out  : handle to the output buffer of size [N * N * N], may be the input buffer
+ * \param  inv  : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for execution, and for data transfers only if computed on the host
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_buffer(const unsigned N, const fftfpga_buffer_t *inp, fftfpga_buffer_t *out, const bool inv) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || N == 0 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  if(inp->num_pts < num_pts || out->num_pts < num_pts){
+    return fft_time;
+  }
+
+  // buffers created before the device or released by fpga_final()
+  if(inp->d_data == NULL || out->d_data == NULL){
+    if(inp->h_data == NULL || out->h_data == NULL || !fallback_required(3, N, 1, fft3d_ddr_kernels)){
+      return fft_time;
+    }
+    return fallback_c2c(3, N, inp->h_data, out->h_data, inv, 1);
+  }
+
+  // compute on the host if the FPGA should not, staging the data through the host
+  if(fallback_required(3, N, 1, fft3d_ddr_kernels)){
+    float2 *tmp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+    if(tmp == NULL){
+      return fft_time;
+    }
+
+    fpga_t read_time = fftfpga_buffer_read(inp, tmp);
+    fft_time = fallback_c2c(3, N, tmp, tmp, inv, 1);
+    fpga_t write_time = fftfpga_buffer_write(out, tmp);
+    free(tmp);
+
+    fft_time.pcie_read_t = read_time.pcie_read_t;
+    fft_time.pcie_write_t = write_time.pcie_write_t;
+    fft_time.valid = fft_time.valid && read_time.valid && write_time.valid;
+    return fft_time;
+  }
+
+  queue_setup();
+  fft_time.exec_t = fft3d_ddr_exec(N, NULL, NULL, inp->d_data, out->d_data, inv, NULL, NULL);
+  queue_cleanup();
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * Matrix in global memory read or written by a pass of the 2D engine of the fft_large bitstream
+ */
+typedef struct {
+  cl_mem buf;   /**< buffer holding the matrix */
+  int offset;   /**< index of the first point of the matrix */
+  int stride;   /**< number of points between consecutive rows */
+  int tiled;    /**< groups of 8 columns of a row are 8 * N points apart, see tiled_column() of fft2d_ddr.cl */
+} large_matrix_t;
+
+/**
+ * \brief  enqueue a pass of the 2D engine of the fft_large bitstream over an N x N matrix in global memory, transforming its rows and writing them transposed
+ * \param  src        : matrix to read
+ * \param  dest       : matrix to write the transposed result to
+ * \param  transposed : toggle to transform the columns of the matrix instead of its rows
+ * \param  start      : event of the fetch kernel, NULL if not required
+ * \param  end        : event of the transpose kernel, NULL if not required
+ */
+static void large_pass(cl_kernel *kernels, const unsigned N, const large_matrix_t *src, const large_matrix_t *dest, int transposed, int inverse, cl_event *start, cl_event *end){
   cl_int status = 0;
-  unsigned num_pts = N * N * N;
-  int mode = WR_GLOBALMEM;
-  
+  int mangle_int = 0, twiddle_int = 0;
+  size_t lws[] = {N};
+  size_t gws[] = {(size_t)N * N / 8};
+
+  status = clSetKernelArg(kernels[0], 0, sizeof(cl_mem), (void *)&src->buf);
+  checkError(status, "Failed to set fetch kernel arg 0");
+  status = clSetKernelArg(kernels[0], 1, sizeof(cl_int), (void*)&mangle_int);
+  checkError(status, "Failed to set fetch kernel arg 1");
+  status = clSetKernelArg(kernels[0], 2, sizeof(cl_int), (void*)&transposed);
+  checkError(status, "Failed to set fetch kernel arg 2");
+  status = clSetKernelArg(kernels[0], 3, sizeof(cl_int), (void*)&src->offset);
+  checkError(status, "Failed to set fetch kernel arg 3");
+  status = clSetKernelArg(kernels[0], 4, sizeof(cl_int), (void*)&src->stride);
+  checkError(status, "Failed to set fetch kernel arg 4");
+  status = clSetKernelArg(kernels[0], 5, sizeof(cl_int), (void*)&src->tiled);
+  checkError(status, "Failed to set fetch kernel arg 5");
+  status = clEnqueueNDRangeKernel(queue1, kernels[0], 1, 0, gws, lws, 0, NULL, start);
+  checkError(status, "Failed to launch fetch kernel");
+
+  status = clSetKernelArg(kernels[1], 0, sizeof(cl_int), (void*)&inverse);
+  checkError(status, "Failed to set fft2d kernel arg 0");
+  status = clEnqueueTask(queue2, kernels[1], 0, NULL, NULL);
+  checkError(status, "Failed to launch fft2d kernel");
+
+  // the twiddle stage of the four-step 1D FFT only forwards the results
+  status = clSetKernelArg(kernels[2], 0, sizeof(cl_int), (void*)&twiddle_int);
+  checkError(status, "Failed to set twiddle kernel arg 0");
+  status = clSetKernelArg(kernels[2], 1, sizeof(cl_int), (void*)&inverse);
+  checkError(status, "Failed to set twiddle kernel arg 1");
+  status = clEnqueueTask(queue4, kernels[2], 0, NULL, NULL);
+  checkError(status, "Failed to launch twiddle kernel");
+
+  status = clSetKernelArg(kernels[3], 0, sizeof(cl_mem), (void *)&dest->buf);
+  checkError(status, "Failed to set transpose kernel arg 0");
+  status = clSetKernelArg(kernels[3], 1, sizeof(cl_int), (void*)&mangle_int);
+  checkError(status, "Failed to set transpose kernel arg 1");
+  status = clSetKernelArg(kernels[3], 2, sizeof(cl_int), (void*)&dest->offset);
+  checkError(status, "Failed to set transpose kernel arg 2");
+  status = clSetKernelArg(kernels[3], 3, sizeof(cl_int), (void*)&dest->stride);
+  checkError(status, "Failed to set transpose kernel arg 3");
+  status = clSetKernelArg(kernels[3], 4, sizeof(cl_int), (void*)&dest->tiled);
+  checkError(status, "Failed to set transpose kernel arg 4");
+  status = clEnqueueNDRangeKernel(queue3, kernels[3], 1, 0, gws, lws, 0, NULL, end);
+  checkError(status, "Failed to launch transpose kernel");
+}
+
+/**
+ * \brief  compute an out-of-place single precision complex 3D-FFT whose size exceeds the on-chip transpose buffers of fft3d_ddr, using the 2D engine of the fft_large bitstream and the DDR of the FPGA for every transpose. Two passes over each xy-plane compute its 2D FFT in place, a pass over each xz-plane reads it transposed to compute the 1D FFTs along z.
+ * \param  N    : unsigned integer denoting the size of FFT3d, the size of the 2D engine
+ * \param  inp  : float2 pointer to input data of size [N * N * N]
+ * \param  out  : float2 pointer to output data of size [N * N * N]
+ * \param  inv  : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_kernel kernels[4] = {NULL, NULL, NULL, NULL};
+  const char *kernel_names[4] = {"fetch", "fft2d", "twiddle", "transpose"};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(3, N, 1, fft3d_large_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, 1);
+  }
+
   // if N is not a power of 2
-  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || (how_many <= 1)){
+  if(inp == NULL || out == NULL || N < 8 || ( (N & (N-1)) !=0)){
     return fft_time;
   }
 
+  queue_setup();
+
+  // the input buffer is overwritten by the 2D FFTs of the planes
+  cl_mem d_data, d_tmp;
+  d_data = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+  d_tmp = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate intermediate device buffer\n");
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_data, CL_FALSE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  for(size_t k = 0; k < 4; k++){
+    kernels[k] = clCreateKernel(program, kernel_names[k], &status);
+    checkError(status, "Failed to create kernel");
+  }
+
+  // Can't pass bool to device, so convert it to int
+  int inverse_int = (int)inv;
+  const int plane = (int)(N * N);
+
+  // each stage reads the result of the previous one from global memory
+  cl_event startExec_event, endExec_event;
+  for(size_t stage = 0; stage < 3; stage++){
+    for(unsigned i = 0; i < N; i++){
+      cl_event *start = (stage == 0 && i == 0) ? &startExec_event : NULL;
+      cl_event *end = (stage == 2 && i == N - 1) ? &endExec_event : NULL;
+
+      if(stage == 0){
+        large_matrix_t src = {d_data, i * plane, N, 0}, dest = {d_tmp, i * plane, N, 0};
+        large_pass(kernels, N, &src, &dest, 0, inverse_int, start, end);
+      }
+      else if(stage == 1){
+        // the 2D FFT of each xy-plane is written in tiles of 8 x-columns by N z-rows
+        large_matrix_t src = {d_tmp, i * plane, N, 0}, dest = {d_data, i * 8, plane, 1};
+        large_pass(kernels, N, &src, &dest, 0, inverse_int, start, end);
+      }
+      else{
+        // each work-group of the transposed fetch reads one tile of 8 * N consecutive points
+        large_matrix_t src = {d_data, i * plane, 8, 1}, dest = {d_tmp, i * N, plane, 0};
+        large_pass(kernels, N, &src, &dest, 1, inverse_int, start, end);
+      }
+    }
+
+    status = wait_queues(4, (cl_command_queue[]){queue1, queue2, queue4, queue3});
+    checkError(status, "failed to finish queues");
+  }
+
+  cl_ulong kernel_start = 0, kernel_end = 0;
+  clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
+  clGetEventProfilingInfo(endExec_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
+  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
+
+  cl_event readBuf_event;
+  status = clEnqueueReadBuffer(queue1, d_tmp, CL_FALSE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
+  checkError(status, "Failed to copy data from device to host");
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading DDR using PCIe");
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  queue_cleanup();
+
+  if (d_data)
+    clReleaseMemObject(d_data);
+  if (d_tmp)
+    clReleaseMemObject(d_tmp);
+  for(size_t k = 0; k < 4; k++){
+    if(kernels[k])
+      clReleaseKernel(kernels[k]);
+  }
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  enqueue a batch of 3D-FFTs using the DDR of the FPGA for 3D Transpose, each transform being read from and written to its own host pointer
+ * \param  N        : unsigned integer denoting the size of FFT3d
+ * \param  inp      : [how_many] float2 pointers to the inputs of size [N * N * N]
+ * \param  out      : [how_many] float2 pointers to the outputs of size [N * N * N]
+ * \param  inv      : toggle to activate backward FFT
+ * \param  how_many : number of transforms, at least 2
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+static fpga_t fft3d_ddr_batch(const unsigned N, const float2 *const *inp, float2 *const *out, const bool inv, const unsigned how_many) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  unsigned num_pts = N * N * N;
+  int mode = WR_GLOBALMEM;
+
   // Can't pass bool to device, so convert it to int
   const int inverse_int = (int)inv;
 
@@ -490,15 +942,15 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
 
   // First Phase 
   // Write to DDR first buffer
-  status = clEnqueueWriteBuffer(queue1, d_inData1, CL_TRUE, 0, sizeof(float2) * num_pts, inp, 0, NULL, NULL);
+  status = clEnqueueWriteBuffer(queue1, d_inData1, CL_FALSE, 0, sizeof(float2) * num_pts, inp[0], 0, NULL, NULL);
 
-  status = clFinish(queue1);
+  status = wait_queue(queue1);
   checkError(status, "failed to finish queue1");
 
   // Second Phase
   // Unblocking write to DDR second buffer from index num_pts
   cl_event write_event[2];
-  status = clEnqueueWriteBuffer(queue6, d_inData2, CL_FALSE, 0, sizeof(float2) * num_pts, (void*)&inp[num_pts], 0, NULL, &write_event[0]);
+  status = clEnqueueWriteBuffer(queue6, d_inData2, CL_FALSE, 0, sizeof(float2) * num_pts, (void*)inp[1], 0, NULL, &write_event[0]);
   checkError(status, "Failed to write to DDR buffer");
 
   // Compute First FFT already transferred
@@ -531,31 +983,21 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
   checkError(status, "Failed to launch store kernel");
 
   // Check finish of transfer and computations
-  clWaitForEvents(1, &write_event[0]);
+  wait_events(1, &write_event[0]);
   clReleaseEvent(write_event[0]);
 
-  status = clFinish(queue6);
-  checkError(status, "failed to finish queue 6");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue 5");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue 4");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue 3");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish queue 2");
-  status = clFinish(queue1);
-  checkError(status, "failed to finish queue 1");
+  status = wait_queues(6, (cl_command_queue[]){queue6, queue5, queue4, queue3, queue2, queue1});
+  checkError(status, "failed to finish queues");
 
   // Loop over the 3 stages
   for(size_t i = 0; i < how_many-2; i++){
 
     // Unblocking transfers between DDR and host 
     if( (i % 4) == 0){
-      status = clEnqueueWriteBuffer(queue7, d_inData3, CL_FALSE, 0, sizeof(float2) * num_pts, &inp[( (i+2) * num_pts)], 0, NULL, &write_event[1]);
+      status = clEnqueueWriteBuffer(queue7, d_inData3, CL_FALSE, 0, sizeof(float2) * num_pts, inp[i + 2], 0, NULL, &write_event[1]);
       checkError(status, "Failed to write to DDR buffer");
 
-      status = clEnqueueReadBuffer(queue6, d_outData1, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(i * num_pts)], 0, NULL, &write_event[0]);
+      status = clEnqueueReadBuffer(queue6, d_outData1, CL_FALSE, 0, sizeof(float2) * num_pts, out[i], 0, NULL, &write_event[0]);
       checkError(status, "Failed to read from DDR buffer");
 
       status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData2);
@@ -575,10 +1017,10 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
       checkError(status, "Failed to set store2 kernel arg");
     }
     else if( (i % 4) == 1){
-      status = clEnqueueWriteBuffer(queue7, d_inData4, CL_FALSE, 0, sizeof(float2) * num_pts, &inp[((i + 2) * num_pts)], 0, NULL, &write_event[1]);
+      status = clEnqueueWriteBuffer(queue7, d_inData4, CL_FALSE, 0, sizeof(float2) * num_pts, inp[i + 2], 0, NULL, &write_event[1]);
       checkError(status, "Failed to write to DDR buffer");
 
-      status = clEnqueueReadBuffer(queue6, d_outData2, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(i * num_pts)], 0, NULL, &write_event[0]);
+      status = clEnqueueReadBuffer(queue6, d_outData2, CL_FALSE, 0, sizeof(float2) * num_pts, out[i], 0, NULL, &write_event[0]);
       checkError(status, "Failed to read from DDR buffer");
 
       status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData3);
@@ -598,10 +1040,10 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
       checkError(status, "Failed to set store kernel arg");
     }
     else if( (i % 4) == 2){
-      status = clEnqueueWriteBuffer(queue7, d_inData1, CL_FALSE, 0, sizeof(float2) * num_pts, &inp[( (i + 2) * num_pts)], 0, NULL, &write_event[1]);
+      status = clEnqueueWriteBuffer(queue7, d_inData1, CL_FALSE, 0, sizeof(float2) * num_pts, inp[i + 2], 0, NULL, &write_event[1]);
       checkError(status, "Failed to write to DDR buffer");
 
-      status = clEnqueueReadBuffer(queue6, d_outData3, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(i * num_pts)], 0, NULL, &write_event[0]);
+      status = clEnqueueReadBuffer(queue6, d_outData3, CL_FALSE, 0, sizeof(float2) * num_pts, out[i], 0, NULL, &write_event[0]);
       checkError(status, "Failed to read from DDR buffer");
 
       status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData4);
@@ -621,10 +1063,10 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
       checkError(status, "Failed to set store kernel arg");
     }
     else{
-      status = clEnqueueWriteBuffer(queue7, d_inData2, CL_FALSE, 0, sizeof(float2) * num_pts, &inp[( (i+2) * num_pts)], 0, NULL, &write_event[1]);
+      status = clEnqueueWriteBuffer(queue7, d_inData2, CL_FALSE, 0, sizeof(float2) * num_pts, inp[i + 2], 0, NULL, &write_event[1]);
       checkError(status, "Failed to write to DDR buffer");
 
-      status = clEnqueueReadBuffer(queue6, d_outData4, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(i * num_pts)], 0, NULL, &write_event[0]);
+      status = clEnqueueReadBuffer(queue6, d_outData4, CL_FALSE, 0, sizeof(float2) * num_pts, out[i], 0, NULL, &write_event[0]);
       checkError(status, "Failed to read from DDR buffer");
 
       status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData1);
@@ -660,16 +1102,8 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
     status = clEnqueueTask(queue5, transpose3D_kernel, 0, NULL, NULL);
     checkError(status, "Failed to launch transpose3D_kernel kernel");
 
-    status = clFinish(queue1);
-    checkError(status, "failed to finish queue 1");
-    status = clFinish(queue2);
-    checkError(status, "failed to finish queue 2");
-    status = clFinish(queue3);
-    checkError(status, "failed to finish queue 3");
-    status = clFinish(queue4);
-    checkError(status, "failed to finish queue 4");
-    status = clFinish(queue5);
-    checkError(status, "failed to finish queue 5");
+    status = wait_queues(5, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5});
+    checkError(status, "failed to finish queues");
 
     mode = RD_GLOBALMEM;
     status=clSetKernelArg(transpose3D_kernel, 2, sizeof(cl_int), (void*)&mode);
@@ -684,28 +1118,16 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
     status = clEnqueueTask(queue3, store_kernel, 0, NULL, NULL);
     checkError(status, "Failed to launch transpose kernel");
 
-    status = clFinish(queue1);
-    checkError(status, "failed to finish queue1");
-    status = clFinish(queue2);
-    checkError(status, "failed to finish queue2");
-    status = clFinish(queue3);
-    checkError(status, "failed to finish queue3");
-    status = clFinish(queue4);
-    checkError(status, "failed to finish queue4");
-    status = clFinish(queue5);
-    checkError(status, "failed to finish queue5");
-    status = clFinish(queue6);
-    checkError(status, "failed to finish queue6");
-    status = clFinish(queue7);
-    checkError(status, "failed to finish queue7");
-
-    clWaitForEvents(2, write_event);
+    status = wait_queues(7, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5, queue6, queue7});
+    checkError(status, "failed to finish queues");
+
+    wait_events(2, write_event);
     clReleaseEvent(write_event[0]);
     clReleaseEvent(write_event[1]);
   }
 
   if( (how_many % 4) == 0){
-    status = clEnqueueReadBuffer(queue6, d_outData3, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 2) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData3, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 2], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
 
     status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData4);
@@ -725,7 +1147,7 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
     checkError(status, "Failed to set store2 kernel arg");
   }
   else if((how_many % 4) == 1){
-    status = clEnqueueReadBuffer(queue6, d_outData4, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 2) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData4, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 2], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
 
     status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData1);
@@ -745,7 +1167,7 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
     checkError(status, "Failed to set store2 kernel arg");
   }
   else if((how_many % 4) == 2){
-    status = clEnqueueReadBuffer(queue6, d_outData1, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 2) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData1, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 2], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
 
     status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData2);
@@ -765,7 +1187,7 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
     checkError(status, "Failed to set store2 kernel arg");
   }
   else{
-    status = clEnqueueReadBuffer(queue6, d_outData2, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 2) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData2, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 2], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
 
     status=clSetKernelArg(fetch_kernel, 0, sizeof(cl_mem), (void *)&d_inData3);
@@ -800,16 +1222,8 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
   status = clEnqueueTask(queue5, transpose3D_kernel, 0, NULL, NULL);
   checkError(status, "Failed to launch transpose3D_kernel kernel");
 
-  status = clFinish(queue1);
-  checkError(status, "failed to finish queue 1");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish queue 2");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue 3");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue 4");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue 5");
+  status = wait_queues(5, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5});
+  checkError(status, "failed to finish queues");
 
   mode = RD_GLOBALMEM;
   status=clSetKernelArg(transpose3D_kernel, 2, sizeof(cl_int), (void*)&mode);
@@ -824,38 +1238,32 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
   status = clEnqueueTask(queue3, store_kernel, 0, NULL, NULL);
   checkError(status, "Failed to launch store kernel");
 
-  clWaitForEvents(1, &write_event[0]);
+  wait_events(1, &write_event[0]);
   clReleaseEvent(write_event[0]);
-  status = clFinish(queue3);
-  checkError(status, "failed to finish queue3");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish queue4");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish queue5");
-  status = clFinish(queue6);
-  checkError(status, "failed to finish queue6");
+  status = wait_queues(4, (cl_command_queue[]){queue3, queue4, queue5, queue6});
+  checkError(status, "failed to finish queues");
 
   if( (how_many % 4) == 0){
-    status = clEnqueueReadBuffer(queue6, d_outData4, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 1) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData4, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 1], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
   }
   else if((how_many % 4) == 1){
-    status = clEnqueueReadBuffer(queue6, d_outData1, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 1) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData1, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 1], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
   }
   else if((how_many % 4) == 2){
-    status = clEnqueueReadBuffer(queue6, d_outData2, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 1) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData2, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 1], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
   }
   else{
-    status = clEnqueueReadBuffer(queue6, d_outData3, CL_FALSE, 0, sizeof(float2) * num_pts, &out[(how_many - 1) * num_pts], 0, NULL, &write_event[0]);
+    status = clEnqueueReadBuffer(queue6, d_outData3, CL_FALSE, 0, sizeof(float2) * num_pts, out[how_many - 1], 0, NULL, &write_event[0]);
     checkError(status, "Failed to read from DDR buffer");
   }
 
-  status = clFinish(queue6);
+  status = wait_queue(queue6);
   checkError(status, "failed to finish reading DDR using PCIe");
 
-  clWaitForEvents(1, &write_event[0]);
+  wait_events(1, &write_event[0]);
   clReleaseEvent(write_event[0]);
 
   fft_time.exec_t = getTimeinMilliSec() - fft_time.exec_t;
@@ -910,4 +1318,82 @@ fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *ou
 
   fft_time.valid = 1;
   return fft_time;
-}
\ No newline at end of file
+}
+
+/**
+ * \brief compute an batched out-of-place single precision complex 3D-FFT using the DDR of the FPGA for 3D Transpose
+ * \param N    : unsigned integer denoting the size of FFT3d  
+ * \param inp  : float2 pointer to input data of size [N * N * N]
+ * \param out  : float2 pointer to output data of size [N * N * N]
+ * \param inv  : toggle to activate backward FFT
+ * \param interleaving : enable burst interleaved global memory buffers
+ * \param how_many : number of batched computations
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving, const unsigned how_many) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+  
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && how_many > 0 && fallback_required(3, N, how_many, fft3d_ddr_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, how_many);
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || (how_many <= 1)){
+    return fft_time;
+  }
+
+  const float2 **inp_list = (const float2**)malloc(sizeof(float2*) * how_many);
+  float2 **out_list = (float2**)malloc(sizeof(float2*) * how_many);
+  if(inp_list != NULL && out_list != NULL){
+    for(size_t i = 0; i < how_many; i++){
+      inp_list[i] = &inp[i * num_pts];
+      out_list[i] = &out[i * num_pts];
+    }
+    fft_time = fft3d_ddr_batch(N, inp_list, out_list, inv, how_many);
+  }
+
+  free(inp_list);
+  free(out_list);
+  return fft_time;
+}
+
+/**
+ * \brief compute a batch of out-of-place single precision complex 3D-FFTs using the DDR of the FPGA for 3D Transpose, gathering the inputs from and scattering the outputs to separate arrays
+ * \param N    : unsigned integer denoting the size of FFT3d
+ * \param inp  : [how_many] float2 pointers to the inputs of size [N * N * N]
+ * \param out  : [how_many] float2 pointers to the outputs of size [N * N * N]
+ * \param inv  : toggle to activate backward FFT
+ * \param how_many : number of batched computations
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_batch_gather(const unsigned N, const float2 *const *inp, float2 *const *out, const bool inv, const unsigned how_many) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+
+  if(inp == NULL || out == NULL)
+    return fft_time;
+  for(size_t i = 0; i < how_many; i++){
+    if(inp[i] == NULL || out[i] == NULL)
+      return fft_time;
+  }
+
+  // compute on the host if the FPGA cannot or should not
+  if(how_many > 0 && fallback_required(3, N, how_many, fft3d_ddr_kernels)){
+    fft_time.valid = true;
+    for(size_t i = 0; i < how_many; i++){
+      fpga_t host_time = fallback_c2c(3, N, inp[i], out[i], inv, 1);
+      fft_time.exec_t += host_time.exec_t;
+      fft_time.valid = fft_time.valid && host_time.valid;
+      fft_time.backend = host_time.backend;
+    }
+    return fft_time;
+  }
+
+  // if N is not a power of 2
+  if(( (N & (N-1)) !=0) || (how_many <= 1)){
+    return fft_time;
+  }
+
+  return fft3d_ddr_batch(N, inp, out, inv, how_many);
+}
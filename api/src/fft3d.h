@@ -0,0 +1,43 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFT3D_H
+#define FFT3D_H
+
+#include <stdbool.h>
+#include "CL/opencl.h"
+
+// kernels required in the bitstream using the DDR for 3D Transpose
+extern const char *fft3d_ddr_kernels[];
+
+/**
+ * Kernels and transpose buffer of the bitstream using the DDR for 3D Transpose, created once for several transforms
+ */
+typedef struct {
+  unsigned N;
+  bool fetch_callback;      /**< fetch is the default one with a load callback */
+  bool store_callback;      /**< store is the default one with a store callback */
+  cl_kernel fetch, ffta, transpose, fftb, transpose3D, fftc, store;
+  cl_mem d_transpose;
+} fft3d_ddr_t;
+
+/**
+ * Argument of a kernel given by its size and a pointer to its value, as passed to clSetKernelArg
+ */
+typedef struct {
+  size_t size;
+  const void *value;
+} kernel_arg_t;
+
+void fft3d_ddr_create(fft3d_ddr_t *fft, const unsigned N, const char *fetch, const char *store);
+
+void fft3d_ddr_set_args(fft3d_ddr_t *fft, cl_mem d_inData, cl_mem d_outData, const bool inv, const kernel_arg_t *fetch_args, const kernel_arg_t *store_args);
+
+void fft3d_ddr_enqueue(fft3d_ddr_t *fft, const cl_uint num_wait, const cl_event *wait, cl_event *fetch_event, cl_event *store_event);
+
+double fft3d_ddr_run(fft3d_ddr_t *fft, cl_mem d_inData, cl_mem d_outData, const bool inv, const kernel_arg_t *fetch_args, const kernel_arg_t *store_args);
+
+void fft3d_ddr_release(fft3d_ddr_t *fft);
+
+double fft3d_ddr_exec(const unsigned N, const char *fetch, const char *store, cl_mem d_inData, cl_mem d_outData, const bool inv, const kernel_arg_t *fetch_args, const kernel_arg_t *store_args);
+
+#endif
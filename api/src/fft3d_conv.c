@@ -0,0 +1,242 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "misc.h"
+#include "fallback.h"
+#include "cpu_fft.h"
+#include "fft3d_conv.h"
+#include "fft3d.h"
+#include "completion.h"
+
+// kernels required in the bitstream
+static const char *fft3d_conv_kernels[] = {"fft3da", "transpose", "store_conv", NULL};
+
+/**
+ * Filter of the convolution, resident in the global memory of the FPGA or
+ * kept on the host if the convolution falls back to it
+ */
+static struct {
+  unsigned N;
+  cl_mem d_filter;
+  float2 *h_filter;
+} conv = {0, NULL, NULL};
+
+/**
+ * \brief  release the filter of the convolution
+ */
+void conv3d_cleanup(){
+  if(conv.d_filter)
+    clReleaseMemObject(conv.d_filter);
+  free(conv.h_filter);
+
+  conv.N = 0;
+  conv.d_filter = NULL;
+  conv.h_filter = NULL;
+}
+
+/**
+ * \brief  upload the filter of 3D convolutions to the global memory of the FPGA, where it stays until replaced or fpga_final()
+ * \param  N      : unsigned integer denoting the size of FFT3d
+ * \param  filter : float2 pointer to the transformed filter of size [N * N * N] in natural order
+ * \return fpga_t : time taken in milliseconds for the data transfer
+ */
+fpga_t fftfpgaf_conv3d_set_kernel(const unsigned N, const float2 *filter){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+
+  // if N is not a power of 2
+  if(filter == NULL || N == 0 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  conv3d_cleanup();
+
+  // keep the filter on the host if the FPGA cannot or should not compute
+  if(fallback_required(3, N, 1, fft3d_conv_kernels)){
+    conv.h_filter = (float2*)malloc(sizeof(float2) * num_pts);
+    if(conv.h_filter == NULL){
+      return fft_time;
+    }
+    memcpy(conv.h_filter, filter, sizeof(float2) * num_pts);
+    conv.N = N;
+
+    fft_time.backend = FFTFPGA_BACKEND_CPU;
+    fft_time.valid = 1;
+    return fft_time;
+  }
+
+  if(context == NULL){
+    return fft_time;
+  }
+
+  queue_setup();
+
+  // store reads the filter while writing to the first bank
+  conv.d_filter = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate filter device buffer\n");
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, conv.d_filter, CL_FALSE, 0, sizeof(float2) * num_pts, filter, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy filter to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish filter transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+  clReleaseEvent(writeBuf_event);
+
+  queue_cleanup();
+
+  conv.N = N;
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  convolve on the host using FFTW, with the filter kept by fftfpgaf_conv3d_set_kernel()
+ */
+static fpga_t conv3d_host(const unsigned N, const float2 *inp, float2 *out){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  fft_time.backend = FFTFPGA_BACKEND_CPU;
+  const size_t num_pts = (size_t)N * N * N;
+  const unsigned threads = cpu_fft_num_threads();
+
+  double start = getTimeinMilliSec();
+  if(!cpu_fft_c2c(3, N, inp, out, false, 1, threads)){
+    return fft_time;
+  }
+
+  for(size_t i = 0; i < num_pts; i++){
+    float2 a = out[i], b = conv.h_filter[i];
+    out[i].x = (a.x * b.x) - (a.y * b.y);
+    out[i].y = (a.x * b.y) + (a.y * b.x);
+  }
+
+  if(!cpu_fft_c2c(3, N, out, out, true, 1, threads)){
+    return fft_time;
+  }
+
+  fft_time.exec_t = getTimeinMilliSec() - start;
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  compute a single precision complex 3D convolution, i.e. the backward FFT of the product of the forward FFT of the input with the filter set by fftfpgaf_conv3d_set_kernel(). Both transforms are computed on the FPGA without transferring the intermediate result to the host.
+ * \param  N    : unsigned integer denoting the size of FFT3d, same as the filter
+ * \param  inp  : float2 pointer to input data of size [N * N * N]
+ * \param  out  : float2 pointer to output data of size [N * N * N], not normalized
+ * \return fpga_t : time taken in milliseconds for data transfers and execution of both transforms
+ */
+fpga_t fftfpgaf_conv3d(const unsigned N, const float2 *inp, float2 *out){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+
+  // filter has to be set for the same size
+  if(inp == NULL || out == NULL || N != conv.N){
+    return fft_time;
+  }
+
+  if(conv.h_filter != NULL){
+    return conv3d_host(N, inp, out);
+  }
+
+  // Setup kernels, fetch being the default one
+  fft3d_ddr_t fft;
+  fft3d_ddr_create(&fft, N, NULL, "store_conv");
+
+  // Setup Queues to the kernels
+  queue_setup();
+
+  // Device memory buffers, the spectrum being the output of the forward and input of the backward transform
+  cl_mem d_spatial, d_spectrum;
+  d_spatial = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_spectrum = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate spectrum device buffer\n");
+
+  // Copy data from host to device
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_spatial, CL_FALSE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  // Kernel Execution, the forward transform multiplied with the filter
+  // followed by the backward transform. Only the fetch of the backward
+  // transform waits for the store of the forward.
+  cl_event startExec_event, fwdStore_event, endExec_event;
+  const int multiply[2] = {1, 0};
+
+  kernel_arg_t fwd_args[] = {{sizeof(cl_mem), &conv.d_filter}, {sizeof(cl_int), &multiply[0]}, {0, NULL}};
+  fft3d_ddr_set_args(&fft, d_spatial, d_spectrum, false, NULL, fwd_args);
+  fft3d_ddr_enqueue(&fft, 0, NULL, &startExec_event, &fwdStore_event);
+
+  kernel_arg_t bwd_args[] = {{sizeof(cl_mem), &conv.d_filter}, {sizeof(cl_int), &multiply[1]}, {0, NULL}};
+  fft3d_ddr_set_args(&fft, d_spectrum, d_spatial, true, NULL, bwd_args);
+  fft3d_ddr_enqueue(&fft, 1, &fwdStore_event, NULL, &endExec_event);
+
+  status = wait_queues(7, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5, queue6, queue7});
+  checkError(status, "failed to finish queues");
+
+  cl_ulong kernel_start = 0, kernel_end = 0;
+  clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
+  clGetEventProfilingInfo(endExec_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
+
+  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
+
+  // Copy results from device to host
+  cl_event readBuf_event;
+  status = clEnqueueReadBuffer(queue1, d_spatial, CL_FALSE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
+  checkError(status, "Failed to copy data from device to host");
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading DDR using PCIe");
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  clReleaseEvent(writeBuf_event);
+  clReleaseEvent(startExec_event);
+  clReleaseEvent(fwdStore_event);
+  clReleaseEvent(endExec_event);
+  clReleaseEvent(readBuf_event);
+
+  queue_cleanup();
+
+  if (d_spatial)
+    clReleaseMemObject(d_spatial);
+  if (d_spectrum)
+    clReleaseMemObject(d_spectrum);
+
+  fft3d_ddr_release(&fft);
+
+  fft_time.valid = 1;
+  return fft_time;
+}
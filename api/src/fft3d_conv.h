@@ -0,0 +1,8 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFT3D_CONV_H
+#define FFT3D_CONV_H
+
+void conv3d_cleanup();
+
+#endif
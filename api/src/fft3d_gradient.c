@@ -0,0 +1,194 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "fallback.h"
+#include "completion.h"
+#include "fft3d.h"
+
+// kernels required in the bitstream
+static const char *fft3d_gradient_kernels[] = {"fft3da", "fetch_gradient", NULL};
+
+/**
+ * \brief  wave number of a frequency of an N point transform, the Nyquist frequency being 0 as it has no sign
+ */
+static float wave_number(const unsigned freq, const unsigned N){
+  if(freq < N / 2){
+    return (float)freq;
+  }
+  return (freq == N / 2) ? 0.0f : (float)((int)freq - (int)N);
+}
+
+/**
+ * \brief  compute the gradient on the host using FFTW
+ */
+static fpga_t gradient3d_host(const unsigned N, const float2 *inp, float2 *grad[3], const float scale){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  fft_time.backend = FFTFPGA_BACKEND_CPU;
+  const size_t num_pts = (size_t)N * N * N;
+
+  float2 *spectrum = (float2*)malloc(sizeof(float2) * num_pts);
+  if(spectrum == NULL){
+    return fft_time;
+  }
+
+  fpga_t time = fallback_c2c(3, N, inp, spectrum, false, 1);
+  fft_time.exec_t += time.exec_t;
+
+  for(unsigned c = 0; time.valid && c < 3; c++){
+    for(size_t z = 0; z < N; z++){
+      for(size_t y = 0; y < N; y++){
+        for(size_t x = 0; x < N; x++){
+          const size_t i = (z * N + y) * N + x;
+          const float k = scale * wave_number((c == 0) ? x : (c == 1) ? y : z, N);
+          grad[c][i].x = -spectrum[i].y * k;
+          grad[c][i].y = spectrum[i].x * k;
+        }
+      }
+    }
+
+    time = fallback_c2c(3, N, grad[c], grad[c], true, 1);
+    fft_time.exec_t += time.exec_t;
+  }
+
+  free(spectrum);
+  fft_time.valid = time.valid;
+  return fft_time;
+}
+
+/**
+ * \brief  compute the gradient of a field using spectral differentiation, i.e. the backward FFTs of the product of the forward FFT of the field with i * scale * k of each component of the wave vector. The input is transferred once and its spectrum remains on the FPGA, where fetch multiplies it for each component.
+ * \param  N      : unsigned integer denoting the size of FFT3d
+ * \param  inp    : float2 pointer to the field of size [N * N * N]
+ * \param  grad_x : float2 pointer to the derivative along x of size [N * N * N], x being the fastest dimension
+ * \param  grad_y : float2 pointer to the derivative along y of size [N * N * N]
+ * \param  grad_z : float2 pointer to the derivative along z of size [N * N * N]
+ * \param  scale  : factor of the wave numbers, 2 * pi / L for a box of length L, which can include the normalization 1 / (N * N * N) of the backward FFTs
+ * \return fpga_t : time taken in milliseconds for data transfers and execution of all transforms
+ */
+fpga_t fftfpgaf_gradient3d(const unsigned N, const float2 *inp, float2 *grad_x, float2 *grad_y, float2 *grad_z, const float scale){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+  float2 *grad[3] = {grad_x, grad_y, grad_z};
+
+  // if N is not a power of 2
+  if(inp == NULL || grad_x == NULL || grad_y == NULL || grad_z == NULL || N == 0 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  // compute on the host if the FPGA cannot or should not
+  if(fallback_required(3, N, 1, fft3d_gradient_kernels)){
+    return gradient3d_host(N, inp, grad, scale);
+  }
+
+  if(context == NULL || program == NULL){
+    return fft_time;
+  }
+
+  // store of the gradient bitstream is compiled with the identity store callback
+  fft3d_ddr_t fft;
+  fft3d_ddr_create(&fft, N, "fetch_gradient", "store");
+
+  // Setup Queues to the kernels
+  queue_setup();
+
+  // Device memory buffers, the spectrum being the output of the forward and input of the backward transforms
+  cl_mem d_spatial, d_spectrum, d_grad[3];
+  d_spatial = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_spectrum = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate spectrum device buffer\n");
+
+  for(unsigned c = 0; c < 3; c++){
+    d_grad[c] = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+    checkError(status, "Failed to allocate gradient device buffer\n");
+  }
+
+  // Copy data from host to device
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_spatial, CL_FALSE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  // Kernel Execution, the forward transform followed by a backward transform
+  // per component. Kernels are enqueued to the same queues in all passes,
+  // only the fetch of the first backward transform waits for the store of
+  // the forward. Each component is read on queue8 once stored, overlapping
+  // with the transform of the next.
+  const cl_mem no_callback = NULL;
+  const kernel_arg_t store_args[] = {{sizeof(cl_mem), &no_callback}, {0, NULL}};
+  cl_event startExec_event, store_event[4], readBuf_event[3];
+  for(int pass = 0; pass < 4; pass++){
+    cl_mem src = pass ? d_spectrum : d_spatial;
+    cl_mem dest = pass ? d_grad[pass - 1] : d_spectrum;
+    int component = pass - 1;
+    const kernel_arg_t fetch_args[] = {{sizeof(cl_int), &component}, {sizeof(cl_float), &scale}, {0, NULL}};
+
+    fft3d_ddr_set_args(&fft, src, dest, (pass > 0), fetch_args, store_args);
+    fft3d_ddr_enqueue(&fft, (pass == 1), (pass == 1) ? &store_event[0] : NULL, (pass == 0) ? &startExec_event : NULL, &store_event[pass]);
+
+    if(pass > 0){
+      status = clEnqueueReadBuffer(queue8, d_grad[pass - 1], CL_FALSE, 0, sizeof(float2) * num_pts, grad[pass - 1], 1, &store_event[pass], &readBuf_event[pass - 1]);
+      checkError(status, "Failed to copy data from device to host");
+    }
+  }
+
+  status = wait_queues(8, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5, queue6, queue7, queue8});
+  checkError(status, "failed to finish queues");
+
+  cl_ulong kernel_start = 0, kernel_end = 0;
+  clGetEventProfilingInfo(startExec_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
+  clGetEventProfilingInfo(store_event[3], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
+
+  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
+
+  for(unsigned c = 0; c < 3; c++){
+    cl_ulong readBuf_start = 0, readBuf_end = 0;
+    clGetEventProfilingInfo(readBuf_event[c], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+    clGetEventProfilingInfo(readBuf_event[c], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+
+    fft_time.pcie_read_t += (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+    clReleaseEvent(readBuf_event[c]);
+  }
+
+  clReleaseEvent(writeBuf_event);
+  clReleaseEvent(startExec_event);
+  for(unsigned pass = 0; pass < 4; pass++){
+    clReleaseEvent(store_event[pass]);
+  }
+
+  queue_cleanup();
+
+  if (d_spatial)
+    clReleaseMemObject(d_spatial);
+  if (d_spectrum)
+    clReleaseMemObject(d_spectrum);
+  for(unsigned c = 0; c < 3; c++){
+    if (d_grad[c])
+      clReleaseMemObject(d_grad[c]);
+  }
+
+  fft3d_ddr_release(&fft);
+
+  fft_time.valid = 1;
+  return fft_time;
+}
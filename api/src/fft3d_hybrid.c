@@ -0,0 +1,174 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "fftfpga/fftfpga.h"
+#include "cpu_fft.h"
+#include "misc.h"
+#include "fallback.h"
+#include "fft3d.h"
+
+// weight of the latest measurement in the running throughput estimate
+#define HYBRID_SMOOTHING 0.5
+
+/**
+ * Measured time per 3D FFT of each backend, for the last size used in each direction
+ */
+typedef struct {
+  unsigned N;
+  double fpga_ms;   /**< milliseconds per FFT on the FPGA, 0 if not yet measured */
+  double cpu_ms;    /**< milliseconds per FFT using FFTW on the host, 0 if not yet measured */
+} hybrid_state_t;
+
+// indexed by the direction, forward and backward transforms differing in throughput
+static hybrid_state_t hybrid_state[2] = {{0, 0.0, 0.0}, {0, 0.0, 0.0}};
+
+static pthread_mutex_t hybrid_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+  unsigned N;
+  const float2 *inp;
+  float2 *out;
+  bool inv;
+  unsigned how_many;
+  unsigned threads;
+  double time;
+  bool valid;
+} cpu_work_t;
+
+static void* cpu_worker(void *arg){
+  cpu_work_t *work = (cpu_work_t*)arg;
+
+  // measuring a new plan would count as slow transforms in the split
+  if(!cpu_fft_plan(3, work->N, work->inp, work->out, work->inv, work->threads)){
+    work->valid = false;
+    return NULL;
+  }
+
+  double start = getTimeinMilliSec();
+  work->valid = cpu_fft_c2c(3, work->N, work->inp, work->out, work->inv, work->how_many, work->threads);
+  work->time = getTimeinMilliSec() - start;
+
+  return NULL;
+}
+
+static double smooth(const double estimate, const double measured){
+  return (estimate == 0.0) ? measured : (HYBRID_SMOOTHING * measured) + ((1.0 - HYBRID_SMOOTHING) * estimate);
+}
+
+/**
+ * \brief  number of FFTs assigned to the host, proportional to the measured throughput of each side. A side without a measurement is given a single FFT to probe it.
+ */
+static unsigned cpu_share(const unsigned how_many, const double fpga_ms, const double cpu_ms){
+
+  if(how_many == 1){
+    return (cpu_ms > 0.0 && fpga_ms > 0.0 && cpu_ms < fpga_ms) ? 1 : 0;
+  }
+  if(cpu_ms == 0.0){
+    return 1;
+  }
+  if(fpga_ms == 0.0){
+    return how_many - 1;
+  }
+
+  const double cpu_rate = 1.0 / cpu_ms, fpga_rate = 1.0 / fpga_ms;
+  return (unsigned)lround(how_many * cpu_rate / (cpu_rate + fpga_rate));
+}
+
+/**
+ * \brief  compute a batch of out-of-place single precision complex 3D-FFTs, splitting the batch between multithreaded FFTW on the host and the FPGA using the DDR for 3D Transpose. The split follows the throughput measured over previous calls.
+ * \param  N    : unsigned integer denoting the size of FFT3d
+ * \param  inp  : float2 pointer to input data of size [N * N * N * how_many]
+ * \param  out  : float2 pointer to output data of size [N * N * N * how_many]
+ * \param  inv  : toggle to activate backward FFT
+ * \param  interleaving : enable burst interleaved global memory buffers
+ * \param  how_many : number of batched computations
+ * \return fpga_t : time taken in milliseconds for the FPGA data transfers and execution, exec_t being the total time
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_batch_hybrid(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving, const unsigned how_many) {
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && how_many > 0 && fallback_required(3, N, how_many, fft3d_ddr_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, how_many);
+  }
+
+  if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || (how_many == 0)){
+    return fft_time;
+  }
+
+  hybrid_state_t *state = &hybrid_state[inv ? 1 : 0];
+
+  pthread_mutex_lock(&hybrid_lock);
+  if(state->N != N){
+    state->N = N;
+    state->fpga_ms = 0.0;
+    state->cpu_ms = 0.0;
+  }
+  const unsigned num_cpu = cpu_share(how_many, state->fpga_ms, state->cpu_ms);
+  pthread_mutex_unlock(&hybrid_lock);
+
+  const unsigned num_fpga = how_many - num_cpu;
+
+#ifdef DEBUG
+  printf("-- Hybrid 3D FFT: %u on FPGA, %u on CPU\n", num_fpga, num_cpu);
+#endif
+
+  // the host keeps the tail of the batch, so that the output layout is unchanged
+  cpu_work_t work = {N, &inp[num_fpga * num_pts], &out[num_fpga * num_pts], inv, num_cpu, 1, 0.0, true};
+
+  // leave a core to drive the FPGA
+  const unsigned threads = cpu_fft_num_threads();
+  work.threads = (threads > 1 && num_fpga > 0) ? threads - 1 : threads;
+
+  double start = getTimeinMilliSec();
+
+  pthread_t cpu_thread;
+  bool cpu_running = false;
+  if(num_cpu > 0){
+    if(pthread_create(&cpu_thread, NULL, cpu_worker, &work) == 0){
+      cpu_running = true;
+    }
+    else{
+      cpu_worker(&work);
+    }
+  }
+
+  // the transfers and the execution, without the setup of the queues,
+  // buffers and kernels, which would bias small batches towards the host
+  double fpga_time = 0.0;
+  bool fpga_valid = true;
+  if(num_fpga > 0){
+    if(num_fpga > 1)
+      fft_time = fftfpgaf_c2c_3d_ddr_batch(N, inp, out, inv, interleaving, num_fpga);
+    else
+      fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, inv);
+    fpga_time = fft_time.exec_t + fft_time.pcie_write_t + fft_time.pcie_read_t;
+    fpga_valid = fft_time.valid;
+  }
+
+  if(cpu_running){
+    pthread_join(cpu_thread, NULL);
+  }
+
+  fft_time.exec_t = getTimeinMilliSec() - start;
+  fft_time.valid = fpga_valid && work.valid;
+  if(num_cpu > 0)
+    fft_time.backend = (num_fpga > 0) ? FFTFPGA_BACKEND_HYBRID : FFTFPGA_BACKEND_CPU;
+
+  pthread_mutex_lock(&hybrid_lock);
+  if(state->N == N){
+    if(num_fpga > 0 && fpga_valid)
+      state->fpga_ms = smooth(state->fpga_ms, fpga_time / num_fpga);
+    if(num_cpu > 0 && work.valid)
+      state->cpu_ms = smooth(state->cpu_ms, work.time / num_cpu);
+  }
+  pthread_mutex_unlock(&hybrid_lock);
+
+  return fft_time;
+}
@@ -0,0 +1,175 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "fallback.h"
+#include "fft3d_persistent.h"
+#include "completion.h"
+
+// kernels launched per request, the engines and transposes of the bitstream being autorun
+static const char *fft3d_persistent_kernels[] = {"fetch_persistent", "store_persistent", NULL};
+
+/**
+ * Kernels, queues and buffers of the persistent bitstream, created by the
+ * first transform and kept until fpga_final()
+ */
+static struct {
+  cl_kernel fetch;
+  cl_kernel store;
+  cl_command_queue queue_in;   /**< transfer to the device and fetch */
+  cl_command_queue queue_out;  /**< store and transfer to the host */
+  cl_mem d_inData;
+  cl_mem d_outData;
+  size_t num_pts;              /**< capacity of the buffers */
+} persistent = {NULL, NULL, NULL, NULL, NULL, NULL, 0};
+
+/**
+ * \brief  release the resources of the persistent bitstream
+ */
+void persistent_cleanup(){
+  if(persistent.d_inData)
+    clReleaseMemObject(persistent.d_inData);
+  if(persistent.d_outData)
+    clReleaseMemObject(persistent.d_outData);
+  if(persistent.queue_in)
+    clReleaseCommandQueue(persistent.queue_in);
+  if(persistent.queue_out)
+    clReleaseCommandQueue(persistent.queue_out);
+  if(persistent.fetch)
+    clReleaseKernel(persistent.fetch);
+  if(persistent.store)
+    clReleaseKernel(persistent.store);
+
+  persistent.fetch = NULL;
+  persistent.store = NULL;
+  persistent.queue_in = NULL;
+  persistent.queue_out = NULL;
+  persistent.d_inData = NULL;
+  persistent.d_outData = NULL;
+  persistent.num_pts = 0;
+}
+
+/**
+ * \brief  create the kernels and queues once and grow the buffers to the number of points
+ */
+static void persistent_setup(const size_t num_pts){
+  cl_int status = 0;
+
+  if(persistent.fetch == NULL){
+    persistent.fetch = clCreateKernel(program, "fetch_persistent", &status);
+    checkError(status, "Failed to create fetch_persistent kernel");
+    persistent.store = clCreateKernel(program, "store_persistent", &status);
+    checkError(status, "Failed to create store_persistent kernel");
+
+    persistent.queue_in = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+    checkError(status, "Failed to create persistent input queue");
+    persistent.queue_out = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+    checkError(status, "Failed to create persistent output queue");
+  }
+
+  if(num_pts > persistent.num_pts){
+    if(persistent.d_inData)
+      clReleaseMemObject(persistent.d_inData);
+    if(persistent.d_outData)
+      clReleaseMemObject(persistent.d_outData);
+
+    persistent.d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+    checkError(status, "Failed to allocate input device buffer\n");
+    persistent.d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+    checkError(status, "Failed to allocate output device buffer\n");
+
+    persistent.num_pts = num_pts;
+  }
+}
+
+/**
+ * \brief  compute a batch of out-of-place single precision complex 3D-FFTs on the persistent bitstream, whose FFT engines and transposes are autorun kernels. Only fetch and store are launched per call; kernels, queues and buffers are reused until fpga_final().
+ * \param  N        : unsigned integer denoting the size of FFT3d
+ * \param  inp      : float2 pointer to input data of size [N * N * N * how_many]
+ * \param  out      : float2 pointer to output data of size [N * N * N * how_many]
+ * \param  inv      : toggle to activate backward FFT
+ * \param  how_many : number of transforms
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_persistent(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N * how_many;
+
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && how_many > 0 && fallback_required(3, N, how_many, fft3d_persistent_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, how_many);
+  }
+
+  // if N is not a power of 2
+  if(inp == NULL || out == NULL || how_many == 0 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  if(context == NULL || program == NULL){
+    return fft_time;
+  }
+
+  persistent_setup(num_pts);
+
+  int inverse_int = inv;
+  status=clSetKernelArg(persistent.fetch, 0, sizeof(cl_mem), (void *)&persistent.d_inData);
+  checkError(status, "Failed to set fetch kernel arg 0");
+  status=clSetKernelArg(persistent.fetch, 1, sizeof(cl_int), (void*)&inverse_int);
+  checkError(status, "Failed to set fetch kernel arg 1");
+  status=clSetKernelArg(persistent.fetch, 2, sizeof(cl_uint), (void*)&how_many);
+  checkError(status, "Failed to set fetch kernel arg 2");
+  status=clSetKernelArg(persistent.store, 0, sizeof(cl_mem), (void *)&persistent.d_outData);
+  checkError(status, "Failed to set store kernel arg 0");
+  status=clSetKernelArg(persistent.store, 1, sizeof(cl_uint), (void*)&how_many);
+  checkError(status, "Failed to set store kernel arg 1");
+
+  // transfer and fetch on one queue, store and transfer back on the other,
+  // both waited for once
+  cl_event writeBuf_event, fetch_event, store_event, readBuf_event;
+  status = clEnqueueWriteBuffer(persistent.queue_in, persistent.d_inData, CL_FALSE, 0, sizeof(float2) * num_pts, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = clEnqueueTask(persistent.queue_out, persistent.store, 0, NULL, &store_event);
+  checkError(status, "Failed to launch store kernel");
+
+  status = clEnqueueTask(persistent.queue_in, persistent.fetch, 0, NULL, &fetch_event);
+  checkError(status, "Failed to launch fetch kernel");
+
+  status = clEnqueueReadBuffer(persistent.queue_out, persistent.d_outData, CL_FALSE, 0, sizeof(float2) * num_pts, out, 0, NULL, &readBuf_event);
+  checkError(status, "Failed to copy data from device to host");
+
+  status = wait_queues(2, (cl_command_queue[]){persistent.queue_in, persistent.queue_out});
+  checkError(status, "failed to finish queues");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  cl_ulong kernel_start = 0, kernel_end = 0;
+  clGetEventProfilingInfo(fetch_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &kernel_start, NULL);
+  clGetEventProfilingInfo(store_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &kernel_end, NULL);
+  fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  clReleaseEvent(writeBuf_event);
+  clReleaseEvent(fetch_event);
+  clReleaseEvent(store_event);
+  clReleaseEvent(readBuf_event);
+
+  fft_time.valid = 1;
+  return fft_time;
+}
@@ -0,0 +1,8 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFT3D_PERSISTENT_H
+#define FFT3D_PERSISTENT_H
+
+void persistent_cleanup();
+
+#endif
@@ -0,0 +1,151 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "fallback.h"
+#include "completion.h"
+#include "fft3d.h"
+
+// kernels required in the bitstream
+static const char *fft3d_pruned_kernels[] = {"fft3da", "fetch_pruned", "store_pruned", NULL};
+
+/**
+ * \brief  enqueue the kernels of the pruned bitstream and wait for their completion. Queues are set up by the caller.
+ * \param  m_in  : size of the input subcube in d_inData
+ * \param  m_out : size of the output subcube in d_outData
+ * \return time taken in milliseconds for the execution
+ */
+static double pruned_exec(const unsigned N, const unsigned m_in, const unsigned m_out, cl_mem d_inData, cl_mem d_outData, const bool inv){
+  const kernel_arg_t fetch_args[] = {{sizeof(cl_uint), &m_in}, {0, NULL}};
+  const kernel_arg_t store_args[] = {{sizeof(cl_uint), &m_out}, {0, NULL}};
+
+  return fft3d_ddr_exec(N, "fetch_pruned", "store_pruned", d_inData, d_outData, inv, fetch_args, store_args);
+}
+
+/**
+ * \brief  copy the subcube [0, m)^3 of a cube of size N from or to a packed cube of size m
+ * \param  pad : copy the subcube into the cube, zeroing it elsewhere, else crop the subcube from the cube
+ */
+static void pad_crop(const unsigned N, const unsigned m, float2 *cube, float2 *sub, const bool pad){
+  if(pad){
+    memset(cube, 0, sizeof(float2) * N * N * N);
+  }
+
+  for(size_t z = 0; z < m; z++){
+    for(size_t y = 0; y < m; y++){
+      if(pad){
+        memcpy(&cube[(z * N + y) * N], &sub[(z * m + y) * m], sizeof(float2) * m);
+      }
+      else{
+        memcpy(&sub[(z * m + y) * m], &cube[(z * N + y) * N], sizeof(float2) * m);
+      }
+    }
+  }
+}
+
+/**
+ * \brief  compute a single precision complex 3D-FFT of an input that is zero outside of the subcube [0, m_in)^3, of which only the subcube [0, m_out)^3 of the output is required. fetch synthesizes the zeros and store writes only the output subcube, so that the PCIe transfers scale with the subcubes.
+ * \param  N     : unsigned integer denoting the size of FFT3d
+ * \param  m_in  : unsigned integer size of the input subcube, at most N
+ * \param  m_out : unsigned integer size of the output subcube, at most N
+ * \param  inp   : float2 pointer to the input subcube of size [m_in * m_in * m_in]
+ * \param  out   : float2 pointer to the output subcube of size [m_out * m_out * m_out]
+ * \param  inv   : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_pruned(const unsigned N, const unsigned m_in, const unsigned m_out, const float2 *inp, float2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+  const size_t num_inp = (size_t)m_in * m_in * m_in;
+  const size_t num_out = (size_t)m_out * m_out * m_out;
+
+  // if N is not a power of 2 or the subcubes larger than the cube
+  if(inp == NULL || out == NULL || N == 0 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+  if(m_in == 0 || m_in > N || m_out == 0 || m_out > N){
+    return fft_time;
+  }
+
+  // pad and crop on the host if the FPGA cannot or should not compute
+  if(fallback_required(3, N, 1, fft3d_pruned_kernels)){
+    float2 *tmp = (float2*)malloc(sizeof(float2) * num_pts);
+    if(tmp == NULL){
+      return fft_time;
+    }
+
+    pad_crop(N, m_in, tmp, (float2*)inp, true);
+    fft_time = fallback_c2c(3, N, tmp, tmp, inv, 1);
+    if(fft_time.valid){
+      pad_crop(N, m_out, tmp, out, false);
+    }
+    free(tmp);
+    return fft_time;
+  }
+
+  if(context == NULL || program == NULL){
+    return fft_time;
+  }
+
+  queue_setup();
+
+  // Device memory buffers of the subcubes
+  cl_mem d_inData, d_outData;
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_inp, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_out, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  // Copy data from host to device
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * num_inp, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  fft_time.exec_t = pruned_exec(N, m_in, m_out, d_inData, d_outData, inv);
+
+  // Copy results from device to host
+  cl_event readBuf_event;
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * num_out, out, 0, NULL, &readBuf_event);
+  checkError(status, "Failed to copy data from device to host");
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading DDR using PCIe");
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  clReleaseEvent(writeBuf_event);
+  clReleaseEvent(readBuf_event);
+
+  queue_cleanup();
+
+  if (d_inData)
+    clReleaseMemObject(d_inData);
+  if (d_outData)
+    clReleaseMemObject(d_outData);
+
+  fft_time.valid = 1;
+  return fft_time;
+}
@@ -0,0 +1,273 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "fallback.h"
+#include "fft3d.h"
+#include "fft3d_sphere.h"
+#include "completion.h"
+
+// kernels required in the bitstream
+static const char *fft3d_sphere_kernels[] = {"fft3da", "fetch_sphere", "store_sphere", NULL};
+
+/**
+ * Index map of the coefficients inside the cutoff sphere. The slot map of
+ * the cube is resident in the global memory of the FPGA, the index map is
+ * kept on the host for the fallback.
+ */
+static struct {
+  unsigned N;
+  size_t num;          /**< number of packed coefficients */
+  unsigned *h_map;     /**< index of each coefficient in the cube */
+  cl_mem d_slot;       /**< position of each point of the cube in the packed array, -1 outside */
+} sphere = {0, 0, NULL, NULL};
+
+/**
+ * \brief  release the index map of the sphere
+ */
+void sphere_cleanup(){
+  if(sphere.d_slot)
+    clReleaseMemObject(sphere.d_slot);
+  free(sphere.h_map);
+
+  sphere.N = 0;
+  sphere.num = 0;
+  sphere.h_map = NULL;
+  sphere.d_slot = NULL;
+}
+
+/**
+ * \brief  set the coefficients inside a cutoff sphere, uploading their slot map of the cube to the global memory of the FPGA, where it stays until replaced or fpga_final()
+ * \param  N   : unsigned integer denoting the size of FFT3d
+ * \param  map : index (z * N + y) * N + x in the cube of each packed coefficient, all distinct
+ * \param  num : number of packed coefficients
+ * \return fpga_t : time taken in milliseconds for the data transfer
+ */
+fpga_t fftfpgaf_sphere_set_map(const unsigned N, const unsigned *map, const size_t num){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+
+  // if N is not a power of 2
+  if(map == NULL || N == 0 || ( (N & (N-1)) !=0) || num == 0 || num > num_pts){
+    return fft_time;
+  }
+
+  sphere_cleanup();
+
+  int *slot = (int*)malloc(sizeof(int) * num_pts);
+  sphere.h_map = (unsigned*)malloc(sizeof(unsigned) * num);
+  if(slot == NULL || sphere.h_map == NULL){
+    free(slot);
+    sphere_cleanup();
+    return fft_time;
+  }
+
+  // an index outside of the cube or repeated leaves the map unset
+  for(size_t i = 0; i < num_pts; i++){
+    slot[i] = -1;
+  }
+  for(size_t i = 0; i < num; i++){
+    if(map[i] >= num_pts || slot[map[i]] != -1){
+      free(slot);
+      sphere_cleanup();
+      return fft_time;
+    }
+    slot[map[i]] = (int)i;
+  }
+  memcpy(sphere.h_map, map, sizeof(unsigned) * num);
+
+  // keep only the index map on the host if the FPGA cannot or should not compute
+  if(fallback_required(3, N, 1, fft3d_sphere_kernels)){
+    free(slot);
+    sphere.N = N;
+    sphere.num = num;
+
+    fft_time.backend = FFTFPGA_BACKEND_CPU;
+    fft_time.valid = 1;
+    return fft_time;
+  }
+
+  if(context == NULL){
+    free(slot);
+    sphere_cleanup();
+    return fft_time;
+  }
+
+  queue_setup();
+
+  // fetch and store read the slot map while accessing the data in the first bank
+  sphere.d_slot = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_2_INTELFPGA, sizeof(int) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate slot map device buffer\n");
+
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, sphere.d_slot, CL_FALSE, 0, sizeof(int) * num_pts, slot, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy slot map to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish slot map transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  clReleaseEvent(writeBuf_event);
+  queue_cleanup();
+  free(slot);
+
+  sphere.N = N;
+  sphere.num = num;
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  enqueue the kernels of the sphere bitstream and wait for their completion. Queues are set up by the caller.
+ * \param  scatter : fetch scatters the packed coefficients of d_inData into the cube, else store gathers the sphere into d_outData
+ * \return time taken in milliseconds for the execution
+ */
+static double sphere_exec(const unsigned N, cl_mem d_inData, cl_mem d_outData, const bool inv, const bool scatter){
+  int fetch_sphere = scatter, store_sphere = !scatter;
+  const kernel_arg_t fetch_args[] = {{sizeof(cl_mem), &sphere.d_slot}, {sizeof(cl_int), &fetch_sphere}, {0, NULL}};
+  const kernel_arg_t store_args[] = {{sizeof(cl_mem), &sphere.d_slot}, {sizeof(cl_int), &store_sphere}, {0, NULL}};
+
+  return fft3d_ddr_exec(N, "fetch_sphere", "store_sphere", d_inData, d_outData, inv, fetch_args, store_args);
+}
+
+/**
+ * \brief  transfer the packed coefficients or the cube to the FPGA, compute the transform and transfer the cube or the packed coefficients back
+ */
+static fpga_t sphere_pcie(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool scatter){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+  const size_t num_inp = scatter ? sphere.num : num_pts;
+  const size_t num_out = scatter ? num_pts : sphere.num;
+
+  queue_setup();
+
+  // Device memory buffers, only the sphere being transferred on one side
+  cl_mem d_inData, d_outData;
+  d_inData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_inp, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+
+  d_outData = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_out, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  // Copy data from host to device
+  cl_event writeBuf_event;
+  status = clEnqueueWriteBuffer(queue1, d_inData, CL_FALSE, 0, sizeof(float2) * num_inp, inp, 0, NULL, &writeBuf_event);
+  checkError(status, "Failed to copy data to device");
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  fft_time.exec_t = sphere_exec(N, d_inData, d_outData, inv, scatter);
+
+  // Copy results from device to host
+  cl_event readBuf_event;
+  status = clEnqueueReadBuffer(queue1, d_outData, CL_FALSE, 0, sizeof(float2) * num_out, out, 0, NULL, &readBuf_event);
+  checkError(status, "Failed to copy data from device to host");
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading DDR using PCIe");
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  clReleaseEvent(writeBuf_event);
+  clReleaseEvent(readBuf_event);
+
+  queue_cleanup();
+
+  if (d_inData)
+    clReleaseMemObject(d_inData);
+  if (d_outData)
+    clReleaseMemObject(d_outData);
+
+  fft_time.valid = 1;
+  return fft_time;
+}
+
+/**
+ * \brief  compute a single precision complex 3D-FFT of coefficients packed inside the sphere set by fftfpgaf_sphere_set_map(). fetch scatters them into the cube on the FPGA, the points outside of the sphere being zero.
+ * \param  N      : unsigned integer denoting the size of FFT3d, same as the map
+ * \param  packed : float2 pointer to the packed coefficients of size [num] of the map
+ * \param  grid   : float2 pointer to output data of size [N * N * N]
+ * \param  inv    : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_sphere_to_grid(const unsigned N, const float2 *packed, float2 *grid, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+
+  // map has to be set for the same size
+  if(packed == NULL || grid == NULL || N == 0 || N != sphere.N){
+    return fft_time;
+  }
+
+  // scatter and transform in place on the host
+  if(sphere.d_slot == NULL){
+    memset(grid, 0, sizeof(float2) * num_pts);
+    for(size_t i = 0; i < sphere.num; i++){
+      grid[sphere.h_map[i]] = packed[i];
+    }
+    return fallback_c2c(3, N, grid, grid, inv, 1);
+  }
+
+  return sphere_pcie(N, packed, grid, inv, true);
+}
+
+/**
+ * \brief  compute a single precision complex 3D-FFT of a cube, of which only the coefficients inside the sphere set by fftfpgaf_sphere_set_map() are gathered by store on the FPGA and transferred back
+ * \param  N      : unsigned integer denoting the size of FFT3d, same as the map
+ * \param  grid   : float2 pointer to input data of size [N * N * N]
+ * \param  packed : float2 pointer to the packed coefficients of size [num] of the map
+ * \param  inv    : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_grid_to_sphere(const unsigned N, const float2 *grid, float2 *packed, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+
+  // map has to be set for the same size
+  if(grid == NULL || packed == NULL || N == 0 || N != sphere.N){
+    return fft_time;
+  }
+
+  // transform into a temporary cube on the host and gather
+  if(sphere.d_slot == NULL){
+    float2 *tmp = (float2*)malloc(sizeof(float2) * num_pts);
+    if(tmp == NULL){
+      return fft_time;
+    }
+
+    fft_time = fallback_c2c(3, N, grid, tmp, inv, 1);
+    for(size_t i = 0; fft_time.valid && i < sphere.num; i++){
+      packed[i] = tmp[sphere.h_map[i]];
+    }
+    free(tmp);
+    return fft_time;
+  }
+
+  return sphere_pcie(N, grid, packed, inv, false);
+}
@@ -0,0 +1,8 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFT3D_SPHERE_H
+#define FFT3D_SPHERE_H
+
+void sphere_cleanup();
+
+#endif
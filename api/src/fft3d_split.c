@@ -0,0 +1,156 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "fallback.h"
+#include "completion.h"
+#include "fft3d.h"
+
+// kernels required in the bitstream
+static const char *fft3d_split_kernels[] = {"fft3da", "fetch_split", "store_split", NULL};
+
+/**
+ * \brief  enqueue the kernels of the split bitstream and wait for their completion. Queues are set up by the caller.
+ * \param  d_inData  : device buffers of the real and imaginary parts of the input
+ * \param  d_outData : device buffers of the real and imaginary parts of the output
+ * \return time taken in milliseconds for the execution
+ */
+static double split_exec(const unsigned N, cl_mem d_inData[2], cl_mem d_outData[2], const bool inv){
+  const kernel_arg_t fetch_args[] = {{sizeof(cl_mem), &d_inData[1]}, {0, NULL}};
+  const kernel_arg_t store_args[] = {{sizeof(cl_mem), &d_outData[1]}, {0, NULL}};
+
+  return fft3d_ddr_exec(N, "fetch_split", "store_split", d_inData[0], d_outData[0], inv, fetch_args, store_args);
+}
+
+/**
+ * \brief  compute on the host using FFTW, interleaving the parts before and separating them after the transform
+ */
+static fpga_t split_host(const unsigned N, const float *inp_re, const float *inp_im, float *out_re, float *out_im, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  const size_t num_pts = (size_t)N * N * N;
+
+  float2 *tmp = (float2*)malloc(sizeof(float2) * num_pts);
+  if(tmp == NULL){
+    return fft_time;
+  }
+
+  for(size_t i = 0; i < num_pts; i++){
+    tmp[i].x = inp_re[i];
+    tmp[i].y = inp_im[i];
+  }
+
+  fft_time = fallback_c2c(3, N, tmp, tmp, inv, 1);
+
+  for(size_t i = 0; fft_time.valid && i < num_pts; i++){
+    out_re[i] = tmp[i].x;
+    out_im[i] = tmp[i].y;
+  }
+
+  free(tmp);
+  return fft_time;
+}
+
+/**
+ * \brief  compute an out-of-place single precision complex 3D-FFT using the DDR of the FPGA on split complex data, whose real and imaginary parts are separate arrays. fetch and store access the parts in separate banks, without interleaving them on the host.
+ * \param  N      : unsigned integer denoting the size of FFT3d
+ * \param  inp_re : float pointer to the real part of the input of size [N * N * N]
+ * \param  inp_im : float pointer to the imaginary part of the input of size [N * N * N]
+ * \param  out_re : float pointer to the real part of the output of size [N * N * N]
+ * \param  out_im : float pointer to the imaginary part of the output of size [N * N * N]
+ * \param  inv    : toggle to activate backward FFT
+ * \return fpga_t : time taken in milliseconds for data transfers and execution
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_split(const unsigned N, const float *inp_re, const float *inp_im, float *out_re, float *out_im, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+  const float *inp[2] = {inp_re, inp_im};
+  float *out[2] = {out_re, out_im};
+
+  // if N is not a power of 2
+  if(inp_re == NULL || inp_im == NULL || out_re == NULL || out_im == NULL || N == 0 || ( (N & (N-1)) !=0)){
+    return fft_time;
+  }
+
+  // compute on the host if the FPGA cannot or should not
+  if(fallback_required(3, N, 1, fft3d_split_kernels)){
+    return split_host(N, inp_re, inp_im, out_re, out_im, inv);
+  }
+
+  if(context == NULL || program == NULL){
+    return fft_time;
+  }
+
+  queue_setup();
+
+  // Device memory buffers, the real parts in the first and the imaginary
+  // parts in the third bank, the second being used by transpose3D
+  cl_mem d_inData[2], d_outData[2];
+  const cl_mem_flags bank[2] = {CL_CHANNEL_1_INTELFPGA, CL_CHANNEL_3_INTELFPGA};
+  for(unsigned p = 0; p < 2; p++){
+    d_inData[p] = clCreateBuffer(context, CL_MEM_READ_ONLY | bank[p], sizeof(float) * num_pts, NULL, &status);
+    checkError(status, "Failed to allocate input device buffer\n");
+
+    d_outData[p] = clCreateBuffer(context, CL_MEM_WRITE_ONLY | bank[p], sizeof(float) * num_pts, NULL, &status);
+    checkError(status, "Failed to allocate output device buffer\n");
+  }
+
+  // Copy data from host to device
+  cl_event writeBuf_event[2];
+  for(unsigned p = 0; p < 2; p++){
+    status = clEnqueueWriteBuffer(queue1, d_inData[p], CL_FALSE, 0, sizeof(float) * num_pts, inp[p], 0, NULL, &writeBuf_event[p]);
+    checkError(status, "Failed to copy data to device");
+  }
+
+  status = wait_queue(queue1);
+  checkError(status, "Failed to finish data transfer to device");
+
+  cl_ulong writeBuf_start = 0, writeBuf_end = 0;
+  clGetEventProfilingInfo(writeBuf_event[0], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &writeBuf_start, NULL);
+  clGetEventProfilingInfo(writeBuf_event[1], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &writeBuf_end, NULL);
+
+  fft_time.pcie_write_t = (cl_double)(writeBuf_end - writeBuf_start) * (cl_double)(1e-06);
+
+  fft_time.exec_t = split_exec(N, d_inData, d_outData, inv);
+
+  // Copy results from device to host
+  cl_event readBuf_event[2];
+  for(unsigned p = 0; p < 2; p++){
+    status = clEnqueueReadBuffer(queue1, d_outData[p], CL_FALSE, 0, sizeof(float) * num_pts, out[p], 0, NULL, &readBuf_event[p]);
+    checkError(status, "Failed to copy data from device to host");
+  }
+  status = wait_queue(queue1);
+  checkError(status, "failed to finish reading DDR using PCIe");
+
+  cl_ulong readBuf_start = 0, readBuf_end = 0;
+  clGetEventProfilingInfo(readBuf_event[0], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &readBuf_start, NULL);
+  clGetEventProfilingInfo(readBuf_event[1], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &readBuf_end, NULL);
+
+  fft_time.pcie_read_t = (cl_double)(readBuf_end - readBuf_start) * (cl_double)(1e-06);
+
+  for(unsigned p = 0; p < 2; p++){
+    clReleaseEvent(writeBuf_event[p]);
+    clReleaseEvent(readBuf_event[p]);
+  }
+
+  queue_cleanup();
+
+  for(unsigned p = 0; p < 2; p++){
+    if (d_inData[p])
+      clReleaseMemObject(d_inData[p]);
+    if (d_outData[p])
+      clReleaseMemObject(d_outData[p]);
+  }
+
+  fft_time.valid = 1;
+  return fft_time;
+}
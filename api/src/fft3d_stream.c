@@ -0,0 +1,295 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#define CL_VERSION_2_0
+#include <CL/cl_ext_intelfpga.h> // to disable interleaving & transfer data to specific banks - CL_CHANNEL_1_INTELFPGA
+#include "CL/opencl.h"
+
+#include "fpga_state.h"
+#include "fftfpga/fftfpga.h"
+#include "opencl_utils.h"
+#include "misc.h"
+#include "fallback.h"
+#include "fft3d.h"
+#include "buffer.h"
+#include "completion.h"
+
+/**
+ * Transfers and callbacks of one step of a stream, overlapping the execution of a transform
+ */
+typedef struct {
+  size_t num_pts;
+  fftfpga_produce_t produce;
+  fftfpga_consume_t consume;
+  void *user_data;
+  cl_command_queue queue;   /**< queue of the transfers, apart from the queues of the kernels */
+  float2 *h_in, *h_out;     /**< pinned host slots, mapped by host_buffer_map() */
+
+  bool do_produce;          /**< produce the k-th input and write it to d_in */
+  size_t produce_k;
+  cl_mem d_in;
+  bool do_consume;          /**< read the k-th output from d_out and consume it */
+  size_t consume_k;
+  cl_mem d_out;
+
+  bool produced;            /**< false if the stream has ended */
+  double pcie_write_t, pcie_read_t;
+
+  pthread_mutex_t lock;     /**< guards pending and quit, shared with the transfer thread */
+  pthread_cond_t cond;
+  bool pending;             /**< step is set up and not yet transferred */
+  bool quit;
+} stream_step_t;
+
+static double transfer_time(cl_event event){
+  cl_ulong start = 0, end = 0;
+  clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+  clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+  clReleaseEvent(event);
+  return (cl_double)(end - start) * (cl_double)(1e-06);
+}
+
+static void stream_transfer(stream_step_t *step){
+  cl_int status = 0;
+  cl_event event;
+
+  if(step->do_consume){
+    status = clEnqueueReadBuffer(step->queue, step->d_out, CL_FALSE, 0, sizeof(float2) * step->num_pts, step->h_out, 0, NULL, &event);
+    checkError(status, "Failed to copy data from device to host");
+    status = wait_queue(step->queue);
+    checkError(status, "Failed to finish transfer");
+    step->pcie_read_t += transfer_time(event);
+
+    step->consume(step->h_out, step->consume_k, step->user_data);
+  }
+
+  step->produced = false;
+  if(step->do_produce && step->produce(step->h_in, step->produce_k, step->user_data)){
+    status = clEnqueueWriteBuffer(step->queue, step->d_in, CL_FALSE, 0, sizeof(float2) * step->num_pts, step->h_in, 0, NULL, &event);
+    checkError(status, "Failed to copy data to device");
+    status = wait_queue(step->queue);
+    checkError(status, "Failed to finish transfer");
+    step->pcie_write_t += transfer_time(event);
+    step->produced = true;
+  }
+}
+
+/**
+ * \brief  thread of a stream, transferring each step handed over by stream_start() until stream_stop()
+ */
+static void* stream_thread(void *arg){
+  stream_step_t *step = (stream_step_t*)arg;
+
+  pthread_mutex_lock(&step->lock);
+  for(;;){
+    while(!step->pending && !step->quit)
+      pthread_cond_wait(&step->cond, &step->lock);
+    if(!step->pending)
+      break;
+
+    pthread_mutex_unlock(&step->lock);
+    stream_transfer(step);
+    pthread_mutex_lock(&step->lock);
+
+    step->pending = false;
+    pthread_cond_broadcast(&step->cond);
+  }
+  pthread_mutex_unlock(&step->lock);
+
+  return NULL;
+}
+
+/**
+ * \brief  hand the step over to the transfer thread, or transfer it inline if there is none
+ */
+static void stream_start(stream_step_t *step, const bool threaded){
+  if(!threaded){
+    stream_transfer(step);
+    return;
+  }
+
+  pthread_mutex_lock(&step->lock);
+  step->pending = true;
+  pthread_cond_broadcast(&step->cond);
+  pthread_mutex_unlock(&step->lock);
+}
+
+/**
+ * \brief  wait for the transfer thread to complete the step
+ */
+static void stream_wait(stream_step_t *step){
+  pthread_mutex_lock(&step->lock);
+  while(step->pending)
+    pthread_cond_wait(&step->cond, &step->lock);
+  pthread_mutex_unlock(&step->lock);
+}
+
+/**
+ * \brief  let the transfer thread return once the pending step is complete
+ */
+static void stream_stop(stream_step_t *step){
+  pthread_mutex_lock(&step->lock);
+  step->quit = true;
+  pthread_cond_broadcast(&step->cond);
+  pthread_mutex_unlock(&step->lock);
+}
+
+/**
+ * \brief  compute the transforms of a stream on the host, one at a time
+ */
+static fpga_t stream_on_host(const unsigned N, const bool inv, fftfpga_produce_t produce, fftfpga_consume_t consume, void *user_data){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  fft_time.backend = FFTFPGA_BACKEND_CPU;
+  const size_t num_pts = (size_t)N * N * N;
+
+  float2 *h_in = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  float2 *h_out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  if(h_in == NULL || h_out == NULL){
+    free(h_in);
+    free(h_out);
+    return fft_time;
+  }
+
+  fft_time.valid = true;
+  for(size_t k = 0; produce(h_in, k, user_data); k++){
+    fpga_t host_time = fallback_c2c(3, N, h_in, h_out, inv, 1);
+    if(!host_time.valid){
+      fft_time.valid = false;
+      break;
+    }
+    fft_time.exec_t += host_time.exec_t;
+    consume(h_out, k, user_data);
+  }
+
+  free(h_in);
+  free(h_out);
+  return fft_time;
+}
+
+/**
+ * \brief  compute a stream of out-of-place single precision complex 3D-FFTs using the DDR of the FPGA. A ring of two device buffers for inputs and outputs each lets a thread of the stream read the output of the previous transform and write the input of the next one while the current one is computed, calling the consumer and producer on mapped host slots in between. The kernels are created once for the stream.
+ * \param  N         : unsigned integer denoting the size of FFT3d
+ * \param  inv       : toggle to activate backward FFT
+ * \param  produce   : fills a slot of [N * N * N] points with the k-th input, false if the stream has ended
+ * \param  consume   : reads the k-th output from a slot of [N * N * N] points
+ * \param  user_data : passed to the callbacks
+ * \return fpga_t : time taken in milliseconds for data transfers and execution, summed over the stream
+ */
+fpga_t fftfpgaf_c2c_3d_ddr_stream(const unsigned N, const bool inv, fftfpga_produce_t produce, fftfpga_consume_t consume, void *user_data){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  cl_int status = 0;
+  const size_t num_pts = (size_t)N * N * N;
+
+  if(produce == NULL || consume == NULL || N == 0){
+    return fft_time;
+  }
+
+  // compute on the host if the FPGA cannot or should not
+  if(fallback_required(3, N, 1, fft3d_ddr_kernels)){
+    return stream_on_host(N, inv, produce, consume, user_data);
+  }
+
+  // if N is not a power of 2
+  if((N & (N-1)) != 0){
+    return fft_time;
+  }
+
+  stream_step_t step;
+  memset(&step, 0, sizeof(step));
+  step.num_pts = num_pts;
+  step.produce = produce;
+  step.consume = consume;
+  step.user_data = user_data;
+
+  queue_setup();
+  step.queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+  checkError(status, "Failed to create transfer queue");
+
+  cl_mem h_in_buf, h_out_buf;
+  step.h_in = host_buffer_map(step.queue, &h_in_buf, num_pts);
+  step.h_out = host_buffer_map(step.queue, &h_out_buf, num_pts);
+
+  cl_mem d_inData[2], d_outData[2];
+  d_inData[0] = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+  d_inData[1] = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_CHANNEL_3_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate input device buffer\n");
+  d_outData[0] = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_1_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+  d_outData[1] = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_CHANNEL_3_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
+  checkError(status, "Failed to allocate output device buffer\n");
+
+  // kernels and transpose buffer shared by the transforms of the stream
+  fft3d_ddr_t fft;
+  fft3d_ddr_create(&fft, N, NULL, NULL);
+
+  // the transfers of the neighbouring transforms use the other buffers of
+  // the ring, inline if the thread cannot be created
+  pthread_t thread;
+  pthread_mutex_init(&step.lock, NULL);
+  pthread_cond_init(&step.cond, NULL);
+  bool threaded = (pthread_create(&thread, NULL, stream_thread, &step) == 0);
+
+  // first input
+  step.do_produce = true;
+  step.produce_k = 0;
+  step.d_in = d_inData[0];
+  stream_start(&step, threaded);
+  stream_wait(&step);
+
+  size_t k = 0;
+  for(bool more = step.produced; more; k++){
+    step.do_consume = (k > 0);
+    step.consume_k = k - 1;
+    step.d_out = d_outData[(k + 1) % 2];
+    step.do_produce = true;
+    step.produce_k = k + 1;
+    step.d_in = d_inData[(k + 1) % 2];
+    stream_start(&step, threaded);
+
+    fft_time.exec_t += fft3d_ddr_run(&fft, d_inData[k % 2], d_outData[k % 2], inv, NULL, NULL);
+
+    stream_wait(&step);
+    more = step.produced;
+  }
+
+  // last output
+  if(k > 0){
+    step.do_produce = false;
+    step.do_consume = true;
+    step.consume_k = k - 1;
+    step.d_out = d_outData[(k - 1) % 2];
+    stream_start(&step, threaded);
+    stream_wait(&step);
+  }
+
+  if(threaded){
+    stream_stop(&step);
+    pthread_join(thread, NULL);
+  }
+  pthread_cond_destroy(&step.cond);
+  pthread_mutex_destroy(&step.lock);
+
+  fft_time.pcie_write_t = step.pcie_write_t;
+  fft_time.pcie_read_t = step.pcie_read_t;
+
+  fft3d_ddr_release(&fft);
+  for(size_t i = 0; i < 2; i++){
+    if(d_inData[i])
+      clReleaseMemObject(d_inData[i]);
+    if(d_outData[i])
+      clReleaseMemObject(d_outData[i]);
+  }
+  host_buffer_unmap(step.queue, h_in_buf, step.h_in);
+  host_buffer_unmap(step.queue, h_out_buf, step.h_out);
+  if(step.queue)
+    clReleaseCommandQueue(step.queue);
+  queue_cleanup();
+
+  fft_time.valid = 1;
+  return fft_time;
+}
@@ -13,12 +13,80 @@
 #include "fftfpga/fftfpga.h"
 #include "opencl_utils.h"
 #include "misc.h"
+#include "fallback.h"
+#include "fft3d.h"
+#include "callback.h"
 #include "svm.h"
+#include "completion.h"
+#include <pthread.h>
 
 #define WR_GLOBALMEM 0
 #define RD_GLOBALMEM 1
 #define BATCH 2
 
+// SVM buffers of the batch ring, for inputs and outputs each
+#define SVM_RING_SLOTS 2
+
+/**
+ * Copy of a batch element between the host and an SVM buffer of the ring
+ */
+typedef struct {
+  cl_command_queue queue;   /**< queue of the map and unmap, apart from the queues of the kernels */
+  float2 *svm;
+  float2 *host;
+  size_t num_pts;
+  bool copy_in;             /**< host to SVM if true, else SVM to host */
+  bool active;
+  double time;              /**< accumulated milliseconds */
+  pthread_t thread;
+  bool threaded;
+} svm_copy_t;
+
+static void* svm_copy(void *arg){
+  svm_copy_t *copy = (svm_copy_t*)arg;
+
+  double start = getTimeinMilliSec();
+  if(copy->copy_in)
+    svm_write(copy->queue, copy->svm, copy->host, copy->num_pts);
+  else
+    svm_read(copy->queue, copy->host, copy->svm, copy->num_pts);
+  copy->time += getTimeinMilliSec() - start;
+
+  return NULL;
+}
+
+/**
+ * \brief  start copying a batch element on a host thread, or copy it right away if no thread can be created
+ */
+static void svm_copy_start(svm_copy_t *copy, float2 *svm, float2 *host){
+  copy->svm = svm;
+  copy->host = host;
+  // nothing to copy if the kernels access the host memory itself
+  copy->active = (svm != host);
+  if(!copy->active)
+    return;
+
+  copy->threaded = (pthread_create(&copy->thread, NULL, svm_copy, copy) == 0);
+  if(!copy->threaded)
+    svm_copy(copy);
+}
+
+static void svm_copy_wait(svm_copy_t *copy){
+  if(copy->active && copy->threaded)
+    pthread_join(copy->thread, NULL);
+  copy->active = false;
+}
+
+/**
+ * \brief  SVM pointer of element i of a batch, the host memory of the element itself with fine grained system SVM, else a buffer of the ring
+ */
+static float2* batch_slot(float2 *const *ring, const float2 *host, const size_t i, const size_t num_pts){
+  if(svm_caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM)
+    return (float2*)&host[i * num_pts];
+
+  return ring[i % SVM_RING_SLOTS];
+}
+
 /**
  * \brief  compute an out-of-place single precision complex 3D FFT using the DDR for 3D Transpose where the data access between the host and the FPGA is using Shared Virtual Memory (SVM)
  * \param  N    : unsigned integer denoting  the size of FFT3d  
@@ -36,6 +104,11 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm(const unsigned N, const float2 *inp, float2 *out,
   // 0 - WR_GLOBALMEM, 1 - RD_GLOBALMEM, 2 - BATCH
   int mode = WR_GLOBALMEM;
 
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && fallback_required(3, N, 1, fft3d_ddr_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, 1);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || !(svm_enabled)){
     return fft_time;
@@ -75,33 +148,12 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm(const unsigned N, const float2 *inp, float2 *out,
     checkError(status, "Failed to allocate output device buffer\n");
   }
 
-  // allocate SVM buffers
-  float2 *h_inData, *h_outData;
-  h_inData = (float2 *)clSVMAlloc(context, CL_MEM_READ_ONLY, sizeof(float2) * num_pts, 0);
-  h_outData = (float2 *)clSVMAlloc(context, CL_MEM_WRITE_ONLY, sizeof(float2) * num_pts, 0);
-
-  size_t num_bytes = num_pts * sizeof(float2);
+  // SVM pointers, the host memory itself with fine grained system SVM
   double svm_copyin_t = getTimeinMilliSec();
-
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_inData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map input data");
-
-  // copy data into h_inData
-  memcpy(h_inData, inp, num_bytes);
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_inData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap input data");
+  float2 *h_inData = svm_input(queue1, inp, num_pts);
+  float2 *h_outData = svm_output(out, num_pts);
   fft_time.svm_copyin_t += getTimeinMilliSec() - svm_copyin_t;
 
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_outData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map input data");
-
-  // copy data into h_inData
-  memset(&h_outData[0], 0, num_bytes);
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_outData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap input data");
-
   /*
   * kernel arguments
   */
@@ -134,6 +186,9 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm(const unsigned N, const float2 *inp, float2 *out,
   status = clSetKernelArgSVMPointer(store_kernel, 0, (void*)h_outData);
   checkError(status, "Failed to set store kernel arg");
 
+  // data of the load and store callbacks, if set
+  callback_set_args(fetch_kernel, store_kernel, N);
+
   cl_event startExec_event, endExec_event;
   status = clEnqueueTask(queue7, store_kernel, 0, NULL, &endExec_event);
   checkError(status, "Failed to launch transpose kernel");
@@ -164,20 +219,8 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm(const unsigned N, const float2 *inp, float2 *out,
   status = clEnqueueTask(queue1, fetch_kernel, 0, NULL,  &startExec_event);
   checkError(status, "Failed to launch fetch kernel");
 
-  status = clFinish(queue7);
-  checkError(status, "failed to finish");
-  status = clFinish(queue6);
-  checkError(status, "failed to finish");
-  status = clFinish(queue5);
-  checkError(status, "failed to finish");
-  status = clFinish(queue4);
-  checkError(status, "failed to finish");
-  status = clFinish(queue3);
-  checkError(status, "failed to finish");
-  status = clFinish(queue2);
-  checkError(status, "failed to finish");
-  status = clFinish(queue1);
-  checkError(status, "failed to finish");
+  status = wait_queues(7, (cl_command_queue[]){queue7, queue6, queue5, queue4, queue3, queue2, queue1});
+  checkError(status, "failed to finish queues");
 
   cl_ulong kernel_start = 0, kernel_end = 0;
 
@@ -186,22 +229,12 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm(const unsigned N, const float2 *inp, float2 *out,
 
   fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
 
-  double svm_copyout_t = 0.0;
-  svm_copyout_t = getTimeinMilliSec();
-  status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_READ,
-    (void *)h_outData, sizeof(float2) * num_pts, 0, NULL, NULL);
-  checkError(status, "Failed to map out data");
-
-  memcpy(out, h_outData, num_bytes);
-
-  status = clEnqueueSVMUnmap(queue1, (void *)h_outData, 0, NULL, NULL);
-  checkError(status, "Failed to unmap out data");
+  double svm_copyout_t = getTimeinMilliSec();
+  svm_read(queue1, out, h_outData, num_pts);
   fft_time.svm_copyout_t += getTimeinMilliSec() - svm_copyout_t;
 
-  if (h_inData)
-    clSVMFree(context, h_inData);
-  if (h_outData)
-    clSVMFree(context, h_outData);
+  svm_release(inp, h_inData);
+  svm_release(out, h_outData);
 
   queue_cleanup();
 
@@ -247,6 +280,11 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
   // 0 - WR_GLOBALMEM, 1 - RD_GLOBALMEM, 2 - BATCH
   int mode_transpose = WR_GLOBALMEM;
 
+  // compute on the host if the FPGA cannot or should not
+  if(inp != NULL && out != NULL && how_many > 0 && fallback_required(3, N, how_many, fft3d_ddr_kernels)){
+    return fallback_c2c(3, N, inp, out, inv, how_many);
+  }
+
   // if N is not a power of 2
   if(inp == NULL || out == NULL || ( (N & (N-1)) !=0) || (how_many <= 0) || !svm_enabled){
     return fft_time;
@@ -284,42 +322,31 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
   cl_mem d_inOutData_1 = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_CHANNEL_2_INTELFPGA, sizeof(float2) * num_pts, NULL, &status);
   checkError(status, "Failed to allocate output device buffer\n");
 
-  // allocate and initialize SVM buffers
-  double svm_copyin_t = 0.0;
-  float2 *h_inData[how_many], *h_outData[how_many];
-  for(size_t i = 0; i < how_many; i++){
-    
-    h_inData[i] = (float2 *)clSVMAlloc(context, CL_MEM_READ_ONLY, sizeof(float2) * num_pts, 0);
-    h_outData[i] = (float2 *)clSVMAlloc(context, CL_MEM_WRITE_ONLY, sizeof(float2) * num_pts, 0);
-
-    size_t num_bytes = num_pts * sizeof(float2);
-
-    svm_copyin_t = getTimeinMilliSec();
-    status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_inData[i], sizeof(float2) * num_pts, 0, NULL, NULL);
-    checkError(status, "Failed to map input data");
-
-    // copy data into h_inData
-    memcpy(&h_inData[i][0], &inp[i*num_pts], num_bytes);
-
-    status = clEnqueueSVMUnmap(queue1, (void *)h_inData[i], 0, NULL, NULL);
-    checkError(status, "Failed to unmap input data");
-    fft_time.svm_copyin_t += getTimeinMilliSec() - svm_copyin_t;
-
-    status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_WRITE, (void *)h_outData[i], sizeof(float2) * num_pts, 0, NULL, NULL);
-    checkError(status, "Failed to map input data");
+  // a ring of SVM buffers, copies of the next inputs and previous outputs
+  // overlapping the kernels. Not needed with fine grained system SVM, the
+  // kernels reading and writing the batch in host memory.
+  float2 *h_inData[SVM_RING_SLOTS] = {NULL}, *h_outData[SVM_RING_SLOTS] = {NULL};
+  for(size_t i = 0; i < SVM_RING_SLOTS && !(svm_caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM); i++){
+    h_inData[i] = svm_alloc(CL_MEM_READ_ONLY, num_pts);
+    h_outData[i] = svm_alloc(CL_MEM_WRITE_ONLY, num_pts);
+  }
 
-    // set h_outData to 0
-    memset(&h_outData[i][0], 0, num_bytes);
+  svm_copy_t copy_in = {NULL, NULL, NULL, num_pts, true, false, 0.0};
+  svm_copy_t copy_out = {NULL, NULL, NULL, num_pts, false, false, 0.0};
+  copy_in.queue = clCreateCommandQueue(context, device, 0, &status);
+  checkError(status, "Failed to create SVM copy queue");
+  copy_out.queue = clCreateCommandQueue(context, device, 0, &status);
+  checkError(status, "Failed to create SVM copy queue");
 
-    status = clEnqueueSVMUnmap(queue1, (void *)h_outData[i], 0, NULL, NULL);
-    checkError(status, "Failed to unmap input data");
-  }
+  // first input before any kernel
+  svm_copy_start(&copy_in, batch_slot(h_inData, inp, 0, num_pts), (float2 *)&inp[0]);
+  svm_copy_wait(&copy_in);
 
   /*
   * kernel arguments
   */
   // write to fetch kernel using SVM based PCIe
-  status = clSetKernelArgSVMPointer(fetch_kernel, 0, (void *)h_inData[0]);
+  status = clSetKernelArgSVMPointer(fetch_kernel, 0, (void *)batch_slot(h_inData, inp, 0, num_pts));
   checkError(status, "Failed to set fetch1 kernel arg");
 
   status=clSetKernelArg(ffta_kernel, 0, sizeof(cl_int), (void*)&inverse_int);
@@ -342,10 +369,16 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
   status=clSetKernelArg(fftc_kernel, 0, sizeof(cl_int), (void*)&inverse_int);
   checkError(status, "Failed to set fftc kernel arg");
 
+  // data of the load and store callbacks, if set
+  callback_set_args(fetch_kernel, store_kernel, N);
+
   cl_event startExec_event, endExec_event;
   /*
   *  First batch write phase
   */
+  if(how_many > 1)
+    svm_copy_start(&copy_in, batch_slot(h_inData, inp, 1, num_pts), (float2 *)&inp[num_pts]);
+
   fft_time.exec_t = getTimeinMilliSec();
   status = clEnqueueTask(queue5, transpose3D_kernel, 0, NULL, NULL);
   checkError(status, "Failed to launch second transpose kernel");
@@ -362,20 +395,20 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
   status = clEnqueueTask(queue1, fetch_kernel, 0, NULL, &startExec_event);
   checkError(status, "Failed to launch fetch kernel");
 
-  status = clFinish(queue1);
-  checkError(status, "Failed to finish queue1");
-  status = clFinish(queue2);
-  checkError(status, "Failed to finish queue2");
-  status = clFinish(queue3);
-  checkError(status, "Failed to finish queue3");
-  status = clFinish(queue4);
-  checkError(status, "Failed to finish queue4");
-  status = clFinish(queue5);
-  checkError(status, "Failed to finish queue5");
+  status = wait_queues(5, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5});
+  checkError(status, "failed to finish queues");
+
+  svm_copy_wait(&copy_in);
 
   for(size_t i = 1; i < how_many; i++){
 
-    status = clSetKernelArgSVMPointer(fetch_kernel, 0, (void *)h_inData[i]);
+    // fetch of element i and store of element i - 1, while copying in i + 1 and copying out i - 2
+    if(i + 1 < how_many)
+      svm_copy_start(&copy_in, batch_slot(h_inData, inp, i + 1, num_pts), (float2 *)&inp[(i + 1) * num_pts]);
+    if(i >= 2)
+      svm_copy_start(&copy_out, batch_slot(h_outData, out, i - 2, num_pts), &out[(i - 2) * num_pts]);
+
+    status = clSetKernelArgSVMPointer(fetch_kernel, 0, (void *)batch_slot(h_inData, inp, i, num_pts));
     checkError(status, "Failed to set fetch kernel arg");
 
     status = clSetKernelArg(transpose3D_kernel, 0, sizeof(cl_mem), ((i % 2) == 1) ? (void*)&d_inOutData_0 : (void*)&d_inOutData_1);
@@ -388,7 +421,7 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
     status=clSetKernelArg(transpose3D_kernel, 2, sizeof(cl_int), (void*)&mode_transpose);
     checkError(status, "Failed to set transpose3D kernel arg 2");
 
-    status = clSetKernelArgSVMPointer(store_kernel, 0, (void *)h_outData[i-1]);
+    status = clSetKernelArgSVMPointer(store_kernel, 0, (void *)batch_slot(h_outData, out, i - 1, num_pts));
     checkError(status, "Failed to set store kernel arg");
 
     // Enqueue Tasks
@@ -413,21 +446,15 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
     status = clEnqueueTask(queue7, store_kernel, 0, NULL, NULL);
     checkError(status, "Failed to launch store kernel");
 
-    status = clFinish(queue1);
-    checkError(status, "Failed to finish queue1");
-    status = clFinish(queue2);
-    checkError(status, "Failed to finish queue2");
-    status = clFinish(queue3);
-    checkError(status, "Failed to finish queue3");
-    status = clFinish(queue4);
-    checkError(status, "Failed to finish queue4");
-    status = clFinish(queue5);
-    checkError(status, "Failed to finish queue5");
-    status = clFinish(queue6);
-    checkError(status, "Failed to finish queue6");
-    status = clFinish(queue7);
-    checkError(status, "Failed to finish queue7");
+    status = wait_queues(7, (cl_command_queue[]){queue1, queue2, queue3, queue4, queue5, queue6, queue7});
+    checkError(status, "failed to finish queues");
+
+    svm_copy_wait(&copy_in);
+    svm_copy_wait(&copy_out);
   }
+
+  if(how_many >= 2)
+    svm_copy_start(&copy_out, batch_slot(h_outData, out, how_many - 2, num_pts), &out[(how_many - 2) * num_pts]);
   
   status = clSetKernelArg(transpose3D_kernel, 0, sizeof(cl_mem), ((how_many % 2) == 0) ? (void*)&d_inOutData_1 : (void*)&d_inOutData_0);
   checkError(status, "Failed to set transpose3D kernel arg 0");
@@ -445,17 +472,13 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
   status = clEnqueueTask(queue6, fftc_kernel, 0, NULL, NULL);
   checkError(status, "Failed to launch fft kernel");
 
-  status = clSetKernelArgSVMPointer(store_kernel, 0, (void *)h_outData[how_many - 1]);
+  status = clSetKernelArgSVMPointer(store_kernel, 0, (void *)batch_slot(h_outData, out, how_many - 1, num_pts));
   checkError(status, "Failed to set store kernel arg");
   status = clEnqueueTask(queue7, store_kernel, 0, NULL, &endExec_event);
   checkError(status, "Failed to launch store kernel");
   
-  status = clFinish(queue5);
-  checkError(status, "Failed to finish queue5");
-  status = clFinish(queue6);
-  checkError(status, "Failed to finish queue6");
-  status = clFinish(queue7);
-  checkError(status, "Failed to finish queue7");
+  status = wait_queues(3, (cl_command_queue[]){queue5, queue6, queue7});
+  checkError(status, "failed to finish queues");
 
   fft_time.exec_t = getTimeinMilliSec() - fft_time.exec_t;
 
@@ -466,28 +489,21 @@ fpga_t fftfpgaf_c2c_3d_ddr_svm_batch(const unsigned N, const float2 *inp, float2
 
   fft_time.exec_t = (cl_double)(kernel_end - kernel_start) * (cl_double)(1e-06);
 
-  double svm_copyout_t = 0.0;
-  for(size_t i = 0; i < how_many; i++){
-
-    // copy data into h_outData
-    size_t num_bytes = num_pts * sizeof(float2);
-    svm_copyout_t = getTimeinMilliSec();
+  svm_copy_wait(&copy_out);
 
-    status = clEnqueueSVMMap(queue1, CL_TRUE, CL_MAP_READ,
-      (void *)h_outData[i], sizeof(float2) * num_pts, 0, NULL, NULL);
-    checkError(status, "Failed to map out data");
+  // last output after the last store
+  svm_copy_start(&copy_out, batch_slot(h_outData, out, how_many - 1, num_pts), &out[(how_many - 1) * num_pts]);
+  svm_copy_wait(&copy_out);
 
-    memcpy(&out[i*num_pts], &h_outData[i][0], num_bytes);
-
-    status = clEnqueueSVMUnmap(queue1, (void *)h_outData[i], 0, NULL, NULL);
-    checkError(status, "Failed to unmap out data");
-    fft_time.svm_copyout_t += getTimeinMilliSec() - svm_copyout_t;
-  }
+  fft_time.svm_copyin_t = copy_in.time;
+  fft_time.svm_copyout_t = copy_out.time;
 
-  for(size_t i = 0; i < how_many; i++){
-    clSVMFree(context, h_inData[i]);
-    clSVMFree(context, h_outData[i]);
+  for(size_t i = 0; i < SVM_RING_SLOTS; i++){
+    svm_release(NULL, h_inData[i]);
+    svm_release(NULL, h_outData[i]);
   }
+  clReleaseCommandQueue(copy_in.queue);
+  clReleaseCommandQueue(copy_out.queue);
 
   queue_cleanup();
 
@@ -14,6 +14,14 @@
 #include "svm.h"
 #include "opencl_utils.h"
 #include "misc.h"
+#include "cpu_fft.h"
+#include "fft3d_conv.h"
+#include "fft3d_persistent.h"
+#include "fft3d_sphere.h"
+#include "callback.h"
+#include "buffer.h"
+#include "microbatch.h"
+#include "fallback.h"
 
 cl_platform_id platform = NULL;
 cl_device_id *devices;
@@ -27,6 +35,7 @@ cl_command_queue queue7 = NULL, queue8 = NULL;
 
 //static int svm_handle;
 bool svm_enabled = false;
+cl_device_svm_capabilities svm_caps = 0;
 
 /** 
  * @brief Allocate memory of double precision complex floating points
@@ -99,7 +108,7 @@ int fpga_initialize(const char *platform_name, const char *path, const bool use_
   printf("\tChoosing first device by default\n");
 
   if(use_svm){
-    if(!check_valid_svm_device(device)){
+    if(!check_valid_svm_device(device, &svm_caps)){
       return -5;
     }
     else{
@@ -126,6 +135,8 @@ int fpga_initialize(const char *platform_name, const char *path, const bool use_
   status = clBuildProgram(program, 0, NULL, "", NULL, NULL);
   checkError(status, "Failed to build program");
 
+  fallback_probe_kernels();
+
   return 0;
 }
 
@@ -134,11 +145,24 @@ int fpga_initialize(const char *platform_name, const char *path, const bool use_
  */
 void fpga_final(){
   printf("-- Cleaning up FPGA resources ...\n");
+  microbatch_cleanup();
+  conv3d_cleanup();
+  persistent_cleanup();
+  sphere_cleanup();
+  callback_cleanup();
+  buffer_cleanup();
+  fallback_cleanup();
   if(program) 
     clReleaseProgram(program);
   if(context)
     clReleaseContext(context);
   free(devices);
+  program = NULL;
+  context = NULL;
+  devices = NULL;
+  svm_enabled = false;
+  svm_caps = 0;
+  cpu_fft_cleanup();
 }
 
 /**
@@ -15,6 +15,7 @@ extern cl_command_queue queue4, queue5, queue6;
 extern cl_command_queue queue7, queue8;
 
 extern bool svm_enabled;
+extern cl_device_svm_capabilities svm_caps;
 
 extern void queue_setup();
 extern void queue_cleanup();
@@ -0,0 +1,268 @@
+// Author: Arjun Ramaswami
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "fftfpga/fftfpga.h"
+#include "microbatch.h"
+#include "misc.h"
+
+/**
+ * Queue of requests and the dispatcher thread coalescing them
+ */
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t queued;        /**< signalled on submission, monotonic clock */
+  pthread_t thread;
+  bool running;
+  bool stop;
+  struct fftfpga_request *head, *tail;
+  unsigned window_us;           /**< longest wait after the oldest request */
+  unsigned max_requests;        /**< largest batch */
+  float2 *stage_inp, *stage_out;
+  size_t stage_pts;
+} mb = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, false, false, NULL, NULL, 200, 16, NULL, NULL, 0};
+
+static void monotonic_deadline(struct timespec *deadline, const double ms){
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+  const long long ns = deadline->tv_nsec + (long long)(ms * 1e6);
+  deadline->tv_sec += ns / 1000000000ll;
+  deadline->tv_nsec = ns % 1000000000ll;
+}
+
+/**
+ * \brief  number of queued requests of the size and direction of the oldest, called with the lock held
+ */
+static unsigned num_like_head(){
+  unsigned count = 0;
+  for(struct fftfpga_request *req = mb.head; req != NULL; req = req->next){
+    if(req->N == mb.head->N && req->inv == mb.head->inv)
+      count++;
+  }
+  return count;
+}
+
+/**
+ * \brief  remove up to max_requests requests of the size and direction of the oldest from the queue, called with the lock held
+ * \return list of the requests in order of submission
+ */
+static struct fftfpga_request* take_like_head(unsigned *num_reqs){
+  const unsigned N = mb.head->N;
+  const bool inv = mb.head->inv;
+  struct fftfpga_request *batch = NULL, **batch_tail = &batch;
+  struct fftfpga_request **link = &mb.head;
+  mb.tail = NULL;
+  *num_reqs = 0;
+
+  while(*link != NULL){
+    struct fftfpga_request *req = *link;
+    if(req->N == N && req->inv == inv && *num_reqs < mb.max_requests){
+      *link = req->next;
+      req->next = NULL;
+      *batch_tail = req;
+      batch_tail = &req->next;
+      (*num_reqs)++;
+    }
+    else{
+      mb.tail = req;
+      link = &req->next;
+    }
+  }
+  return batch;
+}
+
+/**
+ * \brief  compute the requests using one batched transform, each charged its share of the timings
+ */
+static void run_batch(struct fftfpga_request *batch, const unsigned num_reqs){
+  const unsigned N = batch->N;
+  const bool inv = batch->inv;
+  const size_t num_pts = (size_t)N * N * N;
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false};
+
+  if(num_reqs == 1){
+    batch->result = fftfpgaf_c2c_3d_ddr(N, batch->inp, batch->out, inv);
+    return;
+  }
+
+  if(num_pts * num_reqs > mb.stage_pts){
+    free(mb.stage_inp);
+    free(mb.stage_out);
+    mb.stage_inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts * num_reqs);
+    mb.stage_out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts * num_reqs);
+    mb.stage_pts = (mb.stage_inp != NULL && mb.stage_out != NULL) ? num_pts * num_reqs : 0;
+  }
+
+  if(mb.stage_pts != 0){
+    size_t i = 0;
+    for(struct fftfpga_request *req = batch; req != NULL; req = req->next, i++)
+      memcpy(&mb.stage_inp[i * num_pts], req->inp, sizeof(float2) * num_pts);
+
+    fft_time = fftfpgaf_c2c_3d_ddr_batch(N, mb.stage_inp, mb.stage_out, inv, false, num_reqs);
+  }
+
+  size_t i = 0;
+  for(struct fftfpga_request *req = batch; req != NULL; req = req->next, i++){
+    if(fft_time.valid)
+      memcpy(req->out, &mb.stage_out[i * num_pts], sizeof(float2) * num_pts);
+    req->result = fft_time;
+    req->result.pcie_write_t /= num_reqs;
+    req->result.pcie_read_t /= num_reqs;
+    req->result.exec_t /= num_reqs;
+  }
+}
+
+/**
+ * \brief  dispatcher: waits for the window of the oldest request to expire or for max_requests alike, then computes them as one batch
+ */
+static void* dispatch(void *arg){
+  (void)arg;
+  pthread_mutex_lock(&mb.lock);
+  while(true){
+    while(!mb.stop && mb.head == NULL)
+      pthread_cond_wait(&mb.queued, &mb.lock);
+    if(mb.head == NULL)
+      break;
+
+    // requests submitted after stop are computed without waiting
+    const double remaining_ms = mb.head->submit_t + mb.window_us * 1e-3 - getTimeinMilliSec();
+    struct timespec deadline;
+    monotonic_deadline(&deadline, remaining_ms > 0.0 ? remaining_ms : 0.0);
+    while(!mb.stop && num_like_head() < mb.max_requests && getTimeinMilliSec() < mb.head->submit_t + mb.window_us * 1e-3){
+      if(pthread_cond_timedwait(&mb.queued, &mb.lock, &deadline) != 0)
+        break;
+    }
+
+    unsigned num_reqs = 0;
+    struct fftfpga_request *batch = take_like_head(&num_reqs);
+    pthread_mutex_unlock(&mb.lock);
+
+    run_batch(batch, num_reqs);
+
+    // a request may be released as soon as it is signalled
+    for(struct fftfpga_request *req = batch; req != NULL; ){
+      struct fftfpga_request *next = req->next;
+      completion_signal(&req->done);
+      req = next;
+    }
+    pthread_mutex_lock(&mb.lock);
+  }
+  pthread_mutex_unlock(&mb.lock);
+  return NULL;
+}
+
+/**
+ * \brief  start the dispatcher, called with the lock held
+ */
+static bool dispatcher_start(){
+  if(mb.running)
+    return true;
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_destroy(&mb.queued);
+  pthread_cond_init(&mb.queued, &attr);
+  pthread_condattr_destroy(&attr);
+
+  mb.stop = false;
+  mb.running = (pthread_create(&mb.thread, NULL, dispatch, NULL) == 0);
+  return mb.running;
+}
+
+/**
+ * \brief  configure the micro-batching of fftfpgaf_c2c_3d_ddr_submit()
+ * \param  window_us    : longest time in microseconds a request waits for others of the same size and direction
+ * \param  max_requests : number of requests of the same size and direction computed as soon as they are queued, at least 1
+ */
+void fftfpga_set_microbatch(const unsigned window_us, const unsigned max_requests){
+  pthread_mutex_lock(&mb.lock);
+  mb.window_us = window_us;
+  mb.max_requests = (max_requests > 0) ? max_requests : 1;
+  pthread_cond_signal(&mb.queued);
+  pthread_mutex_unlock(&mb.lock);
+}
+
+/**
+ * \brief  submit an out-of-place single precision complex 3D-FFT using the DDR of the FPGA, computed together with the requests of the same size and direction submitted within the window of fftfpga_set_microbatch()
+ * \param  N    : unsigned integer size of FFT3d
+ * \param  inp  : float2 pointer to input data of size [N * N * N], read until the request completes
+ * \param  out  : float2 pointer to output data of size [N * N * N]
+ * \param  inv  : toggle to activate backward FFT
+ * \return handle to wait for using fftfpga_request_wait(), NULL if invalid
+ */
+fftfpga_request_t* fftfpgaf_c2c_3d_ddr_submit(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  if(inp == NULL || out == NULL || N == 0 || (N & (N-1)) != 0)
+    return NULL;
+
+  struct fftfpga_request *req = (struct fftfpga_request*)calloc(1, sizeof(struct fftfpga_request));
+  if(req == NULL)
+    return NULL;
+  req->N = N;
+  req->inv = inv;
+  req->inp = inp;
+  req->out = out;
+  completion_init(&req->done, 1);
+
+  pthread_mutex_lock(&mb.lock);
+  if(!dispatcher_start()){
+    pthread_mutex_unlock(&mb.lock);
+    completion_destroy(&req->done);
+    free(req);
+    return NULL;
+  }
+  req->submit_t = getTimeinMilliSec();
+  if(mb.tail != NULL)
+    mb.tail->next = req;
+  else
+    mb.head = req;
+  mb.tail = req;
+  pthread_cond_signal(&mb.queued);
+  pthread_mutex_unlock(&mb.lock);
+
+  return req;
+}
+
+/**
+ * \brief  wait for a submitted request, polling and then sleeping as set by fftfpga_set_wait_policy(), and release it
+ * \param  req : handle returned by fftfpgaf_c2c_3d_ddr_submit()
+ * \return fpga_t : share of the request in the time taken for data transfers and execution of its batch
+ */
+fpga_t fftfpga_request_wait(fftfpga_request_t *req){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false};
+  if(req == NULL)
+    return fft_time;
+
+  completion_wait(&req->done);
+  completion_destroy(&req->done);
+
+  fft_time = req->result;
+  free(req);
+  return fft_time;
+}
+
+/**
+ * \brief  compute the pending requests and stop the dispatcher, before the resources of the FPGA are released
+ */
+void microbatch_cleanup(){
+  pthread_mutex_lock(&mb.lock);
+  if(!mb.running){
+    pthread_mutex_unlock(&mb.lock);
+    return;
+  }
+  mb.stop = true;
+  pthread_cond_signal(&mb.queued);
+  pthread_mutex_unlock(&mb.lock);
+
+  pthread_join(mb.thread, NULL);
+  mb.running = false;
+
+  free(mb.stage_inp);
+  free(mb.stage_out);
+  mb.stage_inp = mb.stage_out = NULL;
+  mb.stage_pts = 0;
+}
@@ -0,0 +1,25 @@
+// Author: Arjun Ramaswami
+
+#ifndef MICROBATCH_H
+#define MICROBATCH_H
+
+#include "fftfpga/fftfpga.h"
+#include "completion.h"
+
+/**
+ * 3D transform waiting to be coalesced with others of the same size and direction
+ */
+struct fftfpga_request {
+  unsigned N;
+  bool inv;
+  const float2 *inp;
+  float2 *out;
+  double submit_t;              /**< milliseconds */
+  completion_t done;            /**< signalled by the dispatcher */
+  fpga_t result;
+  struct fftfpga_request *next; /**< queue of the dispatcher */
+};
+
+void microbatch_cleanup();
+
+#endif
@@ -0,0 +1,64 @@
+// Author: Arjun Ramaswami
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "parallel.h"
+
+// below this number of points, starting threads costs more than the work on them
+#define MIN_POINTS_PER_THREAD 65536
+
+/**
+ * Range of items [begin, end) of a thread
+ */
+typedef struct {
+  parallel_fn_t fn;
+  void *arg;
+  size_t begin, end;
+} parallel_work_t;
+
+static void* run_range(void *arg){
+  const parallel_work_t *work = (const parallel_work_t*)arg;
+  work->fn(work->arg, work->begin, work->end);
+  return NULL;
+}
+
+/**
+ * \brief  split a range of items among threads, one per MIN_POINTS_PER_THREAD points. The calling thread takes the first range and those of threads that failed to start.
+ * \param  fn        : called once per range
+ * \param  arg       : passed to fn
+ * \param  num_items : number of items of the range, the unit of the split
+ * \param  num_pts   : number of points covered by the items
+ * \param  threads   : maximum number of threads
+ */
+void parallel_range(parallel_fn_t fn, void *arg, const size_t num_items, const size_t num_pts, const unsigned threads){
+  size_t num_threads = num_pts / MIN_POINTS_PER_THREAD;
+  if(num_threads > threads)
+    num_threads = threads;
+  if(num_threads > num_items)
+    num_threads = num_items;
+  if(num_threads < 1)
+    num_threads = 1;
+
+  parallel_work_t work[num_threads];
+  pthread_t tid[num_threads];
+  bool started[num_threads];
+
+  for(size_t i = 0; i < num_threads; i++){
+    work[i].fn = fn;
+    work[i].arg = arg;
+    work[i].begin = (num_items * i) / num_threads;
+    work[i].end = (num_items * (i + 1)) / num_threads;
+    started[i] = (i > 0) && (pthread_create(&tid[i], NULL, run_range, &work[i]) == 0);
+  }
+
+  for(size_t i = 0; i < num_threads; i++){
+    if(!started[i])
+      run_range(&work[i]);
+  }
+
+  for(size_t i = 1; i < num_threads; i++){
+    if(started[i])
+      pthread_join(tid[i], NULL);
+  }
+}
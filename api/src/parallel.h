@@ -0,0 +1,15 @@
+// Author: Arjun Ramaswami
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/**
+ * Work on the items [begin, end) of a range, arg being shared by all threads
+ */
+typedef void (*parallel_fn_t)(void *arg, const size_t begin, const size_t end);
+
+void parallel_range(parallel_fn_t fn, void *arg, const size_t num_items, const size_t num_pts, const unsigned threads);
+
+#endif
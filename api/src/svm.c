@@ -1,52 +1,147 @@
 #define CL_VERSION_2_0
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include "CL/opencl.h"
+#include "fpga_state.h"
 #include "svm.h"
 #include "opencl_utils.h"
+#include "completion.h"
 
 /** 
  * @brief Check if device support svm 
  * @param device
+ * @param caps   : SVM capabilities of the device
  * @return true if supported and false if not
  */
-bool check_valid_svm_device(cl_device_id device){
-  cl_device_svm_capabilities caps = 0;
+bool check_valid_svm_device(cl_device_id device, cl_device_svm_capabilities *caps){
   cl_int status;
   size_t sz_return;
 
+  *caps = 0;
   status = clGetDeviceInfo(
     device,
     CL_DEVICE_SVM_CAPABILITIES,
     sizeof(cl_device_svm_capabilities),
-    &caps,
+    caps,
     &sz_return
   );
   checkError(status, "Failed to get device info");
  
-  if (caps && CL_DEVICE_SVM_COARSE_GRAIN_BUFFER){
-    printf(" -- Found Coarse Grained Buffer SVM capability\n");
+  if(*caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM){
+    printf(" -- Found Fine Grained System SVM capability%s\n", (*caps & CL_DEVICE_SVM_ATOMICS) ? " with atomics" : "");
     return true;
   }
-  else if(caps && CL_DEVICE_SVM_FINE_GRAIN_BUFFER){
-    fprintf(stderr, "Found CL_DEVICE_SVM_FINE_GRAIN_BUFFER. API support in progress\n");
+  else if(*caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER){
+    printf(" -- Found Fine Grained Buffer SVM capability%s\n", (*caps & CL_DEVICE_SVM_ATOMICS) ? " with atomics" : "");
     return true;
   }
-  else if((caps && CL_DEVICE_SVM_FINE_GRAIN_BUFFER) && (caps &&CL_DEVICE_SVM_ATOMICS)){
-    fprintf(stderr, "Found CL_DEVICE_SVM_FINE_GRAIN_BUFFER with support for CL_DEVICE_SVM_ATOMICS. API support in progress\n");
+  else if(*caps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER){
+    printf(" -- Found Coarse Grained Buffer SVM capability\n");
     return true;
   }
-  else if(caps && CL_DEVICE_SVM_FINE_GRAIN_SYSTEM){
-    fprintf(stderr, "Found CL_DEVICE_SVM_FINE_GRAIN_SYSTEM. API support in progress\n");
+  else{
+    fprintf(stderr, "No SVM Support found!\n");
     return false;
   }
-  else if((caps && CL_DEVICE_SVM_FINE_GRAIN_SYSTEM) && (caps &&CL_DEVICE_SVM_ATOMICS)){
-    fprintf(stderr, "Found CL_DEVICE_SVM_FINE_GRAIN_SYSTEM with support for CL_DEVICE_SVM_ATOMICS. API support in progress\n");
-    return false;
+}
+
+/**
+ * \brief  allocate an SVM buffer, fine grained if the device supports it
+ * \param  flags   : CL_MEM_READ_ONLY, CL_MEM_WRITE_ONLY or CL_MEM_READ_WRITE
+ * \param  num_pts : number of points
+ */
+float2* svm_alloc(cl_svm_mem_flags flags, const size_t num_pts){
+  if(svm_caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER)
+    flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+
+  return (float2 *)clSVMAlloc(context, flags, sizeof(float2) * num_pts, 0);
+}
+
+/**
+ * \brief  SVM pointer to the input of a kernel. Host memory itself with fine grained system SVM, else a copy in an SVM buffer
+ * \param  queue   : queue to map and unmap coarse grained buffers
+ * \param  inp     : host input
+ * \param  num_pts : number of points
+ * \return pointer to pass to clSetKernelArgSVMPointer, released using svm_release()
+ */
+float2* svm_input(cl_command_queue queue, const float2 *inp, const size_t num_pts){
+  if(svm_caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM)
+    return (float2*)inp;
+
+  float2 *svm = svm_alloc(CL_MEM_READ_ONLY, num_pts);
+  if(svm != NULL)
+    svm_write(queue, svm, inp, num_pts);
+  return svm;
+}
+
+/**
+ * \brief  SVM pointer to the output of a kernel. Host memory itself with fine grained system SVM, else an SVM buffer to be read using svm_read()
+ * \param  out     : host output
+ * \param  num_pts : number of points
+ * \return pointer to pass to clSetKernelArgSVMPointer, released using svm_release()
+ */
+float2* svm_output(float2 *out, const size_t num_pts){
+  if(svm_caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM)
+    return out;
+
+  return svm_alloc(CL_MEM_WRITE_ONLY, num_pts);
+}
+
+/**
+ * \brief  copy host memory into an SVM buffer, mapping it only if coarse grained
+ */
+void svm_write(cl_command_queue queue, float2 *svm, const float2 *host, const size_t num_pts){
+  cl_int status = 0;
+  const size_t num_bytes = sizeof(float2) * num_pts;
+  if(svm == host)
+    return;
+
+  if(svm_caps & (CL_DEVICE_SVM_FINE_GRAIN_BUFFER | CL_DEVICE_SVM_FINE_GRAIN_SYSTEM)){
+    memcpy(svm, host, num_bytes);
+    return;
   }
-  else{
-    fprintf(stderr, "No SVM Support found!");
-    return false;
+
+  status = clEnqueueSVMMap(queue, CL_FALSE, CL_MAP_WRITE, (void *)svm, num_bytes, 0, NULL, NULL);
+  checkError(status, "Failed to map input data");
+  status = wait_queue(queue);
+  checkError(status, "Failed to map input data");
+  memcpy(svm, host, num_bytes);
+  status = clEnqueueSVMUnmap(queue, (void *)svm, 0, NULL, NULL);
+  checkError(status, "Failed to unmap input data");
+  status = wait_queue(queue);
+  checkError(status, "Failed to finish SVM copy");
+}
+
+/**
+ * \brief  copy an SVM buffer into host memory, mapping it only if coarse grained
+ */
+void svm_read(cl_command_queue queue, float2 *host, float2 *svm, const size_t num_pts){
+  cl_int status = 0;
+  const size_t num_bytes = sizeof(float2) * num_pts;
+  if(svm == host)
+    return;
+
+  if(svm_caps & (CL_DEVICE_SVM_FINE_GRAIN_BUFFER | CL_DEVICE_SVM_FINE_GRAIN_SYSTEM)){
+    memcpy(host, svm, num_bytes);
+    return;
   }
-  return false;
-}
\ No newline at end of file
+
+  status = clEnqueueSVMMap(queue, CL_FALSE, CL_MAP_READ, (void *)svm, num_bytes, 0, NULL, NULL);
+  checkError(status, "Failed to map out data");
+  status = wait_queue(queue);
+  checkError(status, "Failed to map out data");
+  memcpy(host, svm, num_bytes);
+  status = clEnqueueSVMUnmap(queue, (void *)svm, 0, NULL, NULL);
+  checkError(status, "Failed to unmap out data");
+  status = wait_queue(queue);
+  checkError(status, "Failed to finish SVM copy");
+}
+
+/**
+ * \brief  free an SVM buffer returned by svm_input() or svm_output(), unless it is the host memory
+ */
+void svm_release(const float2 *host, float2 *svm){
+  if(svm != NULL && svm != host)
+    clSVMFree(context, svm);
+}
@@ -4,7 +4,20 @@
 #define SVM_H
 
 #include <stdbool.h>
+#include "fftfpga/fftfpga.h"
 
-bool check_valid_svm_device(cl_device_id device);
+bool check_valid_svm_device(cl_device_id device, cl_device_svm_capabilities *caps);
 
-#endif 
\ No newline at end of file
+float2* svm_alloc(cl_svm_mem_flags flags, const size_t num_pts);
+
+float2* svm_input(cl_command_queue queue, const float2 *inp, const size_t num_pts);
+
+float2* svm_output(float2 *out, const size_t num_pts);
+
+void svm_write(cl_command_queue queue, float2 *svm, const float2 *host, const size_t num_pts);
+
+void svm_read(cl_command_queue queue, float2 *host, float2 *svm, const size_t num_pts);
+
+void svm_release(const float2 *host, float2 *svm);
+
+#endif
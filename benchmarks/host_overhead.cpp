@@ -0,0 +1,224 @@
+//  Author: Arjun Ramaswami
+
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <benchmark/benchmark.h>
+
+extern "C" {
+  #include "fftfpga/fftfpga.h"
+  #include "fpga_state.h"
+  #include "mock_opencl.h"
+}
+
+/**
+ * \brief  report the number of calls to each OpenCL function per iteration
+ */
+static void count_calls(benchmark::State &state){
+  for(unsigned i = 0; i < mockcl_num_functions(); i++){
+    const char *name = mockcl_function_name(i);
+    const unsigned long calls = mockcl_calls(name);
+    if(calls > 0)
+      state.counters[name] = benchmark::Counter((double)calls, benchmark::Counter::kAvgIterations);
+  }
+  state.counters["cl_calls"] = benchmark::Counter((double)mockcl_total_calls(), benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * \brief  CPU time in microseconds consumed by all threads of the process, including those of the runtime
+ */
+static double process_cpu_us(){
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+/**
+ * \brief  time a library call on the mock device. The durations modelled by
+ *         the mock are not waited for, leaving the overhead of the host code.
+ */
+template <class F>
+static void host_overhead(benchmark::State &state, F fft){
+  const unsigned N = state.range(0);
+  const unsigned how_many = 2;
+  const size_t sz = sizeof(float2) * N * N * N * how_many;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+  if(inp == NULL || out == NULL){
+    state.SkipWithError("unable to allocate input and output");
+    free(inp);
+    free(out);
+    return;
+  }
+
+  for(size_t i = 0; i < sz / sizeof(float2); i++){
+    inp[i].x = (float)i;
+    inp[i].y = 0.0f;
+  }
+
+  mockcl_reset_calls();
+  const double cpu_us = process_cpu_us();
+  for(auto _ : state){
+    fpga_t fft_time = fft(N, inp, out, how_many);
+    if(!fft_time.valid){
+      state.SkipWithError("invalid execution");
+      break;
+    }
+  }
+  state.counters["host_cpu_us"] = benchmark::Counter(process_cpu_us() - cpu_us, benchmark::Counter::kAvgIterations);
+  count_calls(state);
+
+  free(inp);
+  free(out);
+}
+
+static void BM_queue_setup(benchmark::State &state){
+  mockcl_reset_calls();
+  for(auto _ : state){
+    queue_setup();
+    queue_cleanup();
+  }
+  count_calls(state);
+}
+
+/**
+ * \brief  latency and throughput of micro-batched 3D transforms submitted
+ *         by concurrent threads, waiting for the durations modelled by the
+ *         mock. The window in microseconds is the argument. The CPU time of
+ *         the process is charged to the requests of all threads.
+ */
+static void BM_microbatch(benchmark::State &state){
+  const unsigned N = 64;
+  const size_t num_pts = N * N * N;
+  static mockcl_config_t overhead_config;
+
+  if(state.thread_index() == 0){
+    mockcl_get_config(&overhead_config);
+    mockcl_config_t config = {5.0, 6.0, 10.0, 19.2, true};
+    mockcl_set_config(&config);
+    fftfpga_set_microbatch(state.range(0), state.threads());
+  }
+
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  const double cpu_us = process_cpu_us();
+  for(auto _ : state){
+    fpga_t fft_time = fftfpga_request_wait(fftfpgaf_c2c_3d_ddr_submit(N, inp, out, false));
+    if(!fft_time.valid){
+      state.SkipWithError("invalid execution");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if(state.thread_index() == 0)
+    state.counters["host_cpu_us"] = benchmark::Counter(process_cpu_us() - cpu_us, benchmark::Counter::kAvgIterations);
+  free(inp);
+  free(out);
+
+  if(state.thread_index() == 0){
+    fftfpga_set_microbatch(200, 16);
+    mockcl_set_config(&overhead_config);
+  }
+}
+
+/**
+ * \brief  latency and host CPU time of 3D transforms on a mock runtime
+ *         polling in its blocking calls, waiting by clFinish() or by
+ *         callbacks. The arguments are those of fftfpga_set_wait_policy().
+ */
+static void BM_wait_policy(benchmark::State &state){
+  const unsigned N = 64;
+  const size_t num_pts = N * N * N;
+  mockcl_config_t overhead_config;
+  mockcl_get_config(&overhead_config);
+  mockcl_config_t config = {5.0, 6.0, 10.0, 19.2, true, true};
+  mockcl_set_config(&config);
+  fftfpga_set_wait_policy(state.range(0) != 0, state.range(1));
+
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  const double cpu_us = process_cpu_us();
+  for(auto _ : state){
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, false);
+    if(!fft_time.valid){
+      state.SkipWithError("invalid execution");
+      break;
+    }
+  }
+  state.counters["host_cpu_us"] = benchmark::Counter(process_cpu_us() - cpu_us, benchmark::Counter::kAvgIterations);
+  free(inp);
+  free(out);
+
+  fftfpga_set_wait_policy(true, 20);
+  mockcl_set_config(&overhead_config);
+}
+
+#define REGISTER_API(name, call)                                      \
+  benchmark::RegisterBenchmark(name, [](benchmark::State &state){     \
+    host_overhead(state, [](const unsigned N, const float2 *inp, float2 *out, const unsigned how_many){ \
+      (void)how_many;                                                 \
+      return call;                                                    \
+    });                                                               \
+  })->Arg(16)->Arg(64)->Unit(benchmark::kMicrosecond)
+
+/**
+ * \brief  the bitstream given to fpga_initialize() is not read by the mock.
+ *         Library messages on stdout are discarded, results are printed to
+ *         stderr or written with --benchmark_out.
+ */
+int main(int argc, char **argv){
+  benchmark::Initialize(&argc, argv);
+  if(benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  mockcl_config_t config = {0.0, 0.0, 0.0, 0.0, false};
+  mockcl_set_config(&config);
+
+  char path[] = "/tmp/fftfpga_mock_XXXXXX";
+  int fd = mkstemp(path);
+  if(fd == -1 || write(fd, "mock", 4) != 4){
+    std::cerr << "Unable to create bitstream file for the mock device" << std::endl;
+    return 1;
+  }
+  close(fd);
+
+  if(freopen("/dev/null", "w", stdout) == NULL){
+    std::cerr << "Unable to discard library messages" << std::endl;
+  }
+
+  int isInit = fpga_initialize("mock", path, true);
+  unlink(path);
+  if(isInit != 0){
+    std::cerr << "FPGA initialization error" << std::endl;
+    return 1;
+  }
+
+  benchmark::RegisterBenchmark("queue_setup", BM_queue_setup)->Unit(benchmark::kMicrosecond);
+  benchmark::RegisterBenchmark("microbatch", BM_microbatch)->Arg(0)->Arg(100)->Arg(500)->Arg(2000)->Threads(8)->UseRealTime()->Unit(benchmark::kMicrosecond);
+  benchmark::RegisterBenchmark("wait_policy", BM_wait_policy)->Args({0, 0})->Args({1, 0})->Args({1, 20})->Args({1, 200})->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+  REGISTER_API("fftfpgaf_c2c_1d", fftfpgaf_c2c_1d(N, inp, out, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_1d_natural", fftfpgaf_c2c_1d_natural(N, inp, out, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_1d_svm", fftfpgaf_c2c_1d_svm(N, inp, out, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_2d_bram", fftfpgaf_c2c_2d_bram(N, inp, out, false, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_2d_bram_svm", fftfpgaf_c2c_2d_bram_svm(N, inp, out, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_2d_ddr", fftfpgaf_c2c_2d_ddr(N, inp, out, false));
+  REGISTER_API("fftfpgaf_c2c_3d_bram", fftfpgaf_c2c_3d_bram(N, inp, out, false, false));
+  REGISTER_API("fftfpgaf_c2c_3d_persistent", fftfpgaf_c2c_3d_persistent(N, inp, out, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_3d_ddr", fftfpgaf_c2c_3d_ddr(N, inp, out, false));
+  REGISTER_API("fftfpgaf_c2c_3d_ddr_transposed", fftfpgaf_c2c_3d_ddr_transposed(N, inp, out, false));
+  REGISTER_API("fftfpgaf_c2c_3d_ddr_batch", fftfpgaf_c2c_3d_ddr_batch(N, inp, out, false, false, how_many));
+  REGISTER_API("fftfpgaf_c2c_3d_ddr_svm", fftfpgaf_c2c_3d_ddr_svm(N, inp, out, false, false));
+  REGISTER_API("fftfpgaf_c2c_3d_ddr_svm_batch", fftfpgaf_c2c_3d_ddr_svm_batch(N, inp, out, false, how_many));
+
+  benchmark::ConsoleReporter reporter;
+  reporter.SetOutputStream(&std::cerr);
+  reporter.SetErrorStream(&std::cerr);
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+
+  fpga_final();
+  return 0;
+}
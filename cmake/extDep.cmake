@@ -30,3 +30,14 @@ FetchContent_Declare(
   GIT_TAG        release-1.10.0
 )
 FetchContent_MakeAvailable(googletest)
+
+message("-- Fetching Google Benchmark")
+## google benchmark - host overhead benchmarks
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+FetchContent_Declare(
+  googlebenchmark
+  GIT_REPOSITORY https://github.com/google/benchmark.git
+  GIT_TAG        v1.6.1
+)
+FetchContent_MakeAvailable(googlebenchmark)
@@ -29,6 +29,7 @@ function(gen_fft_targets)
     add_custom_command(OUTPUT ${EMU_BSTREAM}
       COMMAND ${IntelFPGAOpenCL_AOC} ${CL_SRC} ${CL_INCL_DIR} ${AOC_FLAGS} ${EMU_FLAGS} -o ${EMU_BSTREAM}
       MAIN_DEPENDENCY ${CL_SRC} 
+      DEPENDS ${FFT_CALLBACK_HEADER}
       VERBATIM
     )
     
@@ -42,6 +43,7 @@ function(gen_fft_targets)
     add_custom_command(OUTPUT ${REP_BSTREAM}
       COMMAND ${IntelFPGAOpenCL_AOC} ${CL_SRC} ${CL_INCL_DIR} ${AOC_FLAGS} ${REP_FLAGS} -board=${FPGA_BOARD_NAME} -o ${REP_BSTREAM}
       MAIN_DEPENDENCY ${CL_SRC}
+      DEPENDS ${FFT_CALLBACK_HEADER}
       VERBATIM
     )
     
@@ -55,6 +57,7 @@ function(gen_fft_targets)
     add_custom_command(OUTPUT ${PROF_BSTREAM}
       COMMAND ${IntelFPGAOpenCL_AOC} ${CL_SRC} ${CL_INCL_DIR} ${AOC_FLAGS} ${PROF_FLAGS} -board=${FPGA_BOARD_NAME} -o ${PROF_BSTREAM}
       MAIN_DEPENDENCY ${CL_SRC}
+      DEPENDS ${FFT_CALLBACK_HEADER}
     )
     
     add_custom_target(${kernel_fname}_profile
@@ -67,6 +70,7 @@ function(gen_fft_targets)
     add_custom_command(OUTPUT ${SYN_BSTREAM}
       COMMAND ${IntelFPGAOpenCL_AOC} ${CL_SRC} ${CL_INCL_DIR} ${AOC_FLAGS}   -board=${FPGA_BOARD_NAME}  -o ${SYN_BSTREAM}
       MAIN_DEPENDENCY ${CL_SRC}
+      DEPENDS ${FFT_CALLBACK_HEADER}
     )
     
     add_custom_target(${kernel_fname}_syn
@@ -0,0 +1,63 @@
+// Author: Arjun Ramaswami
+
+/**
+ * @file fftfpgad.h
+ * @brief Additions of the client library of the FPGA sharing daemon to the APIs of fftfpga.h
+ *
+ * Processes linking the client library instead of libfftfpga submit their transforms to the fftfpgad daemon, which owns the FPGA. fpga_initialize() connects to the daemon, ignoring its arguments, and fpga_final() disconnects. The single precision transforms of fftfpga.h supported by the client library forward to the daemon.
+ */
+
+#ifndef FFTFPGAD_H
+#define FFTFPGAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "fftfpga/fftfpga.h"
+
+/**
+ * Name of the shared memory segment of the daemon unless set by the FFTFPGAD_NAME environment variable
+ */
+#define FFTFPGAD_DEFAULT_NAME "/fftfpgad"
+
+/**
+ * Queue depth and latency statistics published by the daemon
+ */
+typedef struct {
+  unsigned clients;           /**< connected client processes */
+  unsigned queue_depth;       /**< jobs submitted and not yet started */
+  unsigned max_queue_depth;   /**< largest queue depth since the daemon started */
+  unsigned long jobs;         /**< completed jobs */
+  unsigned long batches;      /**< calls to the library, each computing one or more jobs */
+  double latency_sum_ms;      /**< sum of the latencies from submission to completion of the jobs */
+  double latency_max_ms;      /**< largest latency from submission to completion */
+  double exec_sum_ms;         /**< sum of the execution times reported by the library */
+} fftfpgad_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  allocate memory shared with the daemon. Transforms of data allocated this way are not copied between the client and the daemon
+ * @param  sz : size in bytes
+ * @return pointer to the memory or NULL if the client is not connected or the shared memory is exhausted
+ */
+extern void* fftfpgad_malloc(const size_t sz);
+
+/**
+ * @brief  release memory allocated using fftfpgad_malloc()
+ */
+extern void fftfpgad_free(void *ptr);
+
+/**
+ * @brief  read the statistics of the daemon
+ * @param  stats : filled with the current statistics
+ * @return true if connected to a daemon
+ */
+extern bool fftfpgad_get_stats(fftfpgad_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFTFPGAD_H
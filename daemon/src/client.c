@@ -0,0 +1,328 @@
+// Author: Arjun Ramaswami
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fftfpga/fftfpga.h"
+#include "fftfpgad/fftfpgad.h"
+#include "shm.h"
+
+// data segment of the client unless set by FFTFPGAD_POOL_MB
+#define DEFAULT_POOL_MB 256
+#define POOL_ALIGN 64
+
+// waits for the daemon are bounded to notice if it died
+#define DAEMON_WAIT_NS 1000000000ull
+
+/**
+ * Header of a block of the data segment, blocks following each other from its start
+ */
+typedef struct {
+  size_t size;        /**< bytes of the block including the header */
+  size_t used;
+  char pad[POOL_ALIGN - 2 * sizeof(size_t)];
+} block_t;
+
+static fftfpgad_shm_t *shm = NULL;
+static fftfpgad_client_t *conn = NULL;
+static unsigned generation = 0;
+
+static char *pool = NULL;
+static size_t pool_size = 0;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* pool_alloc(const size_t sz){
+  const size_t need = sizeof(block_t) + ((sz + POOL_ALIGN - 1) / POOL_ALIGN) * POOL_ALIGN;
+  void *ptr = NULL;
+  if(pool == NULL || sz == 0)
+    return NULL;
+
+  pthread_mutex_lock(&pool_lock);
+  for(size_t offset = 0; offset < pool_size; ){
+    block_t *block = (block_t*)(pool + offset);
+
+    // coalesce the free blocks following a free block
+    while(!block->used && offset + block->size < pool_size && !((block_t*)(pool + offset + block->size))->used)
+      block->size += ((block_t*)(pool + offset + block->size))->size;
+
+    if(!block->used && block->size >= need){
+      if(block->size - need >= 2 * sizeof(block_t)){
+        block_t *rest = (block_t*)(pool + offset + need);
+        rest->size = block->size - need;
+        rest->used = 0;
+        block->size = need;
+      }
+      block->used = 1;
+      ptr = (void*)(block + 1);
+      break;
+    }
+    offset += block->size;
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return ptr;
+}
+
+static bool in_pool(const void *ptr){
+  return pool != NULL && (const char*)ptr >= pool && (const char*)ptr < pool + pool_size;
+}
+
+static void pool_free(void *ptr){
+  if(!in_pool(ptr))
+    return;
+  pthread_mutex_lock(&pool_lock);
+  ((block_t*)ptr - 1)->used = 0;
+  pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * \brief  wait on a condition of the control segment for at most DAEMON_WAIT_NS, called with the lock held
+ * \return false if the daemon stopped or died
+ */
+static bool wait_daemon(pthread_cond_t *cond){
+  struct timespec deadline;
+  const uint64_t t = now_ns() + DAEMON_WAIT_NS;
+  deadline.tv_sec = t / 1000000000ull;
+  deadline.tv_nsec = t % 1000000000ull;
+  if(pthread_cond_timedwait(cond, &shm->lock, &deadline) == EOWNERDEAD)
+    pthread_mutex_consistent(&shm->lock);
+  return shm->running && pid_alive(shm->daemon_pid);
+}
+
+/**
+ * \brief  submit a job to the daemon and wait for its completion. Data outside the data segment is copied through it.
+ */
+static fpga_t submit(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false};
+  if(conn == NULL || inp == NULL || out == NULL || N == 0 || how_many == 0)
+    return fft_time;
+
+  size_t num_pts = (size_t)how_many * N;
+  for(unsigned d = 1; d < dim; d++)
+    num_pts *= N;
+  const size_t num_bytes = sizeof(float2) * num_pts;
+
+  // zero copy for data allocated using fftfpgad_malloc()
+  float2 *d_inp = in_pool(inp) ? (float2*)inp : (float2*)pool_alloc(num_bytes);
+  float2 *d_out = in_pool(out) ? out : (float2*)pool_alloc(num_bytes);
+  if(d_inp == NULL || d_out == NULL){
+    fprintf(stderr, "Error: fftfpgad shared memory exhausted, increase FFTFPGAD_POOL_MB\n");
+    if(d_inp != inp)
+      pool_free(d_inp);
+    if(d_out != out)
+      pool_free(d_out);
+    return fft_time;
+  }
+  if(d_inp != inp)
+    memcpy(d_inp, inp, num_bytes);
+
+  shm_lock(shm);
+  bool alive = shm->running;
+  while(alive && conn->jobs[conn->tail % FFTFPGAD_RING_SLOTS].state != JOB_FREE)
+    alive = wait_daemon(&shm->completed);
+
+  if(alive){
+    fftfpgad_job_t *job = &conn->jobs[conn->tail % FFTFPGAD_RING_SLOTS];
+    job->dim = dim;
+    job->N = N;
+    job->how_many = how_many;
+    job->inv = inv;
+    job->inp_offset = (size_t)((char*)d_inp - pool);
+    job->out_offset = (size_t)((char*)d_out - pool);
+    job->submit_ns = now_ns();
+    job->state = JOB_QUEUED;
+    conn->tail++;
+
+    shm->stats.queue_depth++;
+    if(shm->stats.queue_depth > shm->stats.max_queue_depth)
+      shm->stats.max_queue_depth = shm->stats.queue_depth;
+    pthread_cond_signal(&shm->submitted);
+
+    while(alive && job->state != JOB_DONE)
+      alive = wait_daemon(&shm->completed);
+    if(job->state == JOB_DONE)
+      fft_time = job->result;
+
+    // other threads of the process may wait for the slot
+    job->state = JOB_FREE;
+    pthread_cond_broadcast(&shm->completed);
+  }
+  shm_unlock(shm);
+
+  if(d_out != out && fft_time.valid)
+    memcpy(out, d_out, num_bytes);
+  if(d_inp != inp)
+    pool_free(d_inp);
+  if(d_out != out)
+    pool_free(d_out);
+
+  return fft_time;
+}
+
+/**
+ * \brief  create the data segment of this process
+ */
+static bool create_pool(char *name){
+  const char *env = getenv("FFTFPGAD_POOL_MB");
+  const size_t pool_mb = (env != NULL && atol(env) > 0) ? (size_t)atol(env) : DEFAULT_POOL_MB;
+
+  snprintf(name, FFTFPGAD_NAME_MAX, "%s.%d", shm_name(), (int)getpid());
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0)
+    return false;
+  if(ftruncate(fd, pool_mb << 20) != 0){
+    close(fd);
+    shm_unlink(name);
+    return false;
+  }
+  void *data = mmap(NULL, pool_mb << 20, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED){
+    shm_unlink(name);
+    return false;
+  }
+
+  pool = (char*)data;
+  pool_size = pool_mb << 20;
+  ((block_t*)pool)->size = pool_size;
+  ((block_t*)pool)->used = 0;
+  return true;
+}
+
+static void release_pool(const char *name){
+  if(pool != NULL)
+    munmap(pool, pool_size);
+  pool = NULL;
+  pool_size = 0;
+  shm_unlink(name);
+}
+
+/** 
+ * @brief Connect to the fftfpgad daemon, which owns the FPGA. The arguments are ignored, the bitstream being loaded by the daemon.
+ * @return 0 if successful 
+          -1 No daemon running
+          -3 No free connection or shared memory for this process
+ */
+int fpga_initialize(const char *platform_name, const char *path, const bool use_svm){
+  (void)platform_name;
+  (void)path;
+  (void)use_svm;
+  if(conn != NULL)
+    return 0;
+
+  int fd = shm_open(shm_name(), O_RDWR, 0);
+  if(fd < 0)
+    return -1;
+  shm = (fftfpgad_shm_t*)mmap(NULL, sizeof(fftfpgad_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(shm == MAP_FAILED || __atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != FFTFPGAD_MAGIC || !shm->running || !pid_alive(shm->daemon_pid)){
+    if(shm != MAP_FAILED)
+      munmap(shm, sizeof(fftfpgad_shm_t));
+    shm = NULL;
+    return -1;
+  }
+
+  char name[FFTFPGAD_NAME_MAX];
+  if(!create_pool(name)){
+    munmap(shm, sizeof(fftfpgad_shm_t));
+    shm = NULL;
+    return -3;
+  }
+
+  shm_lock(shm);
+  for(unsigned c = 0; c < FFTFPGAD_MAX_CLIENTS && conn == NULL; c++){
+    fftfpgad_client_t *client = &shm->clients[c];
+    if(client->pid != 0)
+      continue;
+
+    memset(client->jobs, 0, sizeof(client->jobs));
+    client->head = client->tail = 0;
+    snprintf(client->data_name, FFTFPGAD_NAME_MAX, "%s", name);
+    client->data_size = pool_size;
+    client->generation++;
+    client->pid = getpid();
+    generation = client->generation;
+    shm->stats.clients++;
+    conn = client;
+  }
+  shm_unlock(shm);
+
+  if(conn == NULL){
+    release_pool(name);
+    munmap(shm, sizeof(fftfpgad_shm_t));
+    shm = NULL;
+    return -3;
+  }
+  return 0;
+}
+
+/** 
+ * @brief Disconnect from the daemon
+ */
+void fpga_final(){
+  if(conn == NULL)
+    return;
+
+  char name[FFTFPGAD_NAME_MAX];
+  shm_lock(shm);
+  snprintf(name, FFTFPGAD_NAME_MAX, "%s", conn->data_name);
+  if(conn->pid == getpid() && conn->generation == generation){
+    conn->pid = 0;
+    shm->stats.clients--;
+  }
+  shm_unlock(shm);
+
+  release_pool(name);
+  munmap(shm, sizeof(fftfpgad_shm_t));
+  shm = NULL;
+  conn = NULL;
+}
+
+void* fftfpgaf_complex_malloc(const size_t sz){
+  void *ptr = NULL;
+  if(sz == 0 || posix_memalign(&ptr, POOL_ALIGN, sz) != 0)
+    return NULL;
+  return ptr;
+}
+
+void* fftfpgad_malloc(const size_t sz){
+  return pool_alloc(sz);
+}
+
+void fftfpgad_free(void *ptr){
+  pool_free(ptr);
+}
+
+bool fftfpgad_get_stats(fftfpgad_stats_t *stats){
+  if(conn == NULL || stats == NULL)
+    return false;
+  shm_lock(shm);
+  *stats = shm->stats;
+  shm_unlock(shm);
+  return true;
+}
+
+fpga_t fftfpgaf_c2c_1d(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch){
+  return submit(1, N, inp, out, inv, batch);
+}
+
+fpga_t fftfpgaf_c2c_2d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  return submit(2, N, inp, out, inv, 1);
+}
+
+fpga_t fftfpgaf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  return submit(3, N, inp, out, inv, 1);
+}
+
+fpga_t fftfpgaf_c2c_3d_ddr_batch(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool interleaving, const unsigned how_many){
+  (void)interleaving;
+  return submit(3, N, inp, out, inv, how_many);
+}
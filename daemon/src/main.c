@@ -0,0 +1,113 @@
+// Author: Arjun Ramaswami
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "fftfpga/fftfpga.h"
+#include "fftfpgad/fftfpgad.h"
+#include "shm.h"
+#include "server.h"
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig){
+  (void)sig;
+  stop = 1;
+}
+
+static void print_usage(){
+  printf("FPGA sharing daemon, computing the FFTs submitted by client processes through shared memory\n");
+  printf("Usage:\n  ./fftfpgad [OPTION...]\n\n");
+  printf("  -p, --path arg      Path to FPGA bitstream\n");
+  printf("  -e, --emulate       Toggle to enable emulation\n");
+  printf("  -l, --platform arg  Name of the OpenCL platform, overrides --emulate\n");
+  printf("  -s, --use_usm       Toggle to use Unified Shared Memory features for data transfers between host and device\n");
+  printf("  -q, --stats         Print the statistics of a running daemon and exit\n");
+  printf("  -h, --help          Print usage\n");
+  printf("\nThe shared memory segment is named by FFTFPGAD_NAME, %s by default. FFTFPGA_FALLBACK=1 computes the transforms the bitstream cannot on the host\n", FFTFPGAD_DEFAULT_NAME);
+}
+
+static int print_stats(){
+  int fd = shm_open(shm_name(), O_RDWR, 0);
+  fftfpgad_shm_t *shm = (fd < 0) ? MAP_FAILED : (fftfpgad_shm_t*)mmap(NULL, sizeof(fftfpgad_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(fd >= 0)
+    close(fd);
+  if(shm == MAP_FAILED || shm->magic != FFTFPGAD_MAGIC || !pid_alive(shm->daemon_pid)){
+    fprintf(stderr, "Error: no fftfpgad running for %s\n", shm_name());
+    if(shm != MAP_FAILED)
+      munmap(shm, sizeof(fftfpgad_shm_t));
+    return EXIT_FAILURE;
+  }
+
+  shm_lock(shm);
+  fftfpgad_stats_t stats = shm->stats;
+  shm_unlock(shm);
+  munmap(shm, sizeof(fftfpgad_shm_t));
+
+  printf("Clients            : %u\n", stats.clients);
+  printf("Queue depth        : %u (max %u)\n", stats.queue_depth, stats.max_queue_depth);
+  printf("Jobs               : %lu in %lu batches\n", stats.jobs, stats.batches);
+  printf("Latency            : %.3lf ms avg, %.3lf ms max\n", stats.jobs ? stats.latency_sum_ms / stats.jobs : 0.0, stats.latency_max_ms);
+  printf("Execution          : %.3lf ms\n", stats.exec_sum_ms);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv){
+  const char *path = NULL, *platform = NULL;
+  bool emulate = false, use_svm = false;
+
+  static struct option options[] = {
+    {"path", required_argument, NULL, 'p'},
+    {"emulate", no_argument, NULL, 'e'},
+    {"platform", required_argument, NULL, 'l'},
+    {"use_usm", no_argument, NULL, 's'},
+    {"stats", no_argument, NULL, 'q'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int opt;
+  while((opt = getopt_long(argc, argv, "p:el:sqh", options, NULL)) != -1){
+    switch(opt){
+      case 'p': path = optarg; break;
+      case 'e': emulate = true; break;
+      case 'l': platform = optarg; break;
+      case 's': use_svm = true; break;
+      case 'q': return print_stats();
+      case 'h': print_usage(); return EXIT_SUCCESS;
+      default: print_usage(); return EXIT_FAILURE;
+    }
+  }
+
+  if(path == NULL){
+    fprintf(stderr, "Error: path to the bitstream is missing\n");
+    print_usage();
+    return EXIT_FAILURE;
+  }
+  if(platform == NULL)
+    platform = emulate ? "Intel(R) FPGA Emulation Platform for OpenCL(TM)" : "Intel(R) FPGA SDK for OpenCL(TM)";
+
+  int isInit = fpga_initialize(platform, path, use_svm);
+  if(isInit != 0){
+    fprintf(stderr, "FPGA initialization error: %d\n", isInit);
+    return EXIT_FAILURE;
+  }
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_signal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  int ret = fftfpgad_serve(&stop);
+
+  fpga_final();
+  return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
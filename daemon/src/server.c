@@ -0,0 +1,428 @@
+// Author: Arjun Ramaswami
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fftfpga/fftfpga.h"
+#include "shm.h"
+#include "server.h"
+
+// wakeups of the daemon without submissions, to reap dead clients and stop
+#define IDLE_WAIT_NS 100000000ull
+
+/**
+ * Mapping of the data segment of a client in the daemon
+ */
+typedef struct {
+  unsigned generation;
+  char *data;
+  size_t size;
+} mapping_t;
+
+/**
+ * Job taken from the ring of a client
+ */
+typedef struct {
+  unsigned client;
+  unsigned slot;
+  unsigned generation;
+  fftfpgad_job_t job;
+  float2 *inp, *out;
+  bool grouped;
+} job_ref_t;
+
+static fftfpgad_shm_t *shm = NULL;
+static mapping_t mappings[FFTFPGAD_MAX_CLIENTS];
+static job_ref_t refs[FFTFPGAD_MAX_CLIENTS * FFTFPGAD_RING_SLOTS];
+
+// staging buffers of batched jobs
+static float2 *stage_inp = NULL, *stage_out = NULL;
+static size_t stage_pts = 0;
+
+static void unmap_client(const unsigned c){
+  if(mappings[c].data != NULL)
+    munmap(mappings[c].data, mappings[c].size);
+  mappings[c].data = NULL;
+  mappings[c].size = 0;
+}
+
+/**
+ * \brief  map the data segment of the current connection of a client if not already mapped
+ */
+static bool map_client(const unsigned c, const unsigned generation, const char *name, const size_t size){
+  if(mappings[c].data != NULL && mappings[c].generation == generation)
+    return true;
+  unmap_client(c);
+
+  int fd = shm_open(name, O_RDWR, 0);
+  if(fd < 0)
+    return false;
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+    return false;
+
+  mappings[c].generation = generation;
+  mappings[c].data = (char*)data;
+  mappings[c].size = size;
+  return true;
+}
+
+/**
+ * \brief  free the connections of clients that died, called with the lock held
+ */
+static void reap_clients(){
+  for(unsigned c = 0; c < FFTFPGAD_MAX_CLIENTS; c++){
+    fftfpgad_client_t *client = &shm->clients[c];
+    if(client->pid == 0 || pid_alive(client->pid))
+      continue;
+
+    fprintf(stderr, "-- fftfpgad: client %d died, releasing its connection\n", (int)client->pid);
+    for(unsigned s = 0; s < FFTFPGAD_RING_SLOTS; s++){
+      if(client->jobs[s].state == JOB_QUEUED)
+        shm->stats.queue_depth--;
+      client->jobs[s].state = JOB_FREE;
+    }
+    shm_unlink(client->data_name);
+    unmap_client(c);
+    client->pid = 0;
+    shm->stats.clients--;
+  }
+}
+
+/**
+ * \brief  take the queued jobs of all clients, called with the lock held
+ * \return number of jobs taken
+ */
+static unsigned take_jobs(){
+  unsigned num_jobs = 0;
+  for(unsigned c = 0; c < FFTFPGAD_MAX_CLIENTS; c++){
+    fftfpgad_client_t *client = &shm->clients[c];
+    if(client->pid == 0)
+      continue;
+
+    while(client->head != client->tail){
+      const unsigned slot = client->head % FFTFPGAD_RING_SLOTS;
+      fftfpgad_job_t *job = &client->jobs[slot];
+      if(job->state != JOB_QUEUED)
+        break;
+      job->state = JOB_RUNNING;
+      client->head++;
+      shm->stats.queue_depth--;
+
+      job_ref_t *ref = &refs[num_jobs++];
+      ref->client = c;
+      ref->slot = slot;
+      ref->generation = client->generation;
+      ref->job = *job;
+      ref->inp = ref->out = NULL;
+      ref->grouped = false;
+
+      // resolve the payload in the data segment of the client
+      const size_t num_bytes = sizeof(float2) * job->how_many * (size_t)job->N * (job->dim > 1 ? job->N : 1) * (job->dim > 2 ? job->N : 1);
+      if(map_client(c, client->generation, client->data_name, client->data_size) &&
+         job->inp_offset + num_bytes <= mappings[c].size && job->out_offset + num_bytes <= mappings[c].size){
+        ref->inp = (float2*)(mappings[c].data + job->inp_offset);
+        ref->out = (float2*)(mappings[c].data + job->out_offset);
+      }
+    }
+  }
+  return num_jobs;
+}
+
+static size_t job_pts(const fftfpgad_job_t *job){
+  size_t pts = job->N;
+  for(unsigned d = 1; d < job->dim; d++)
+    pts *= job->N;
+  return pts;
+}
+
+/**
+ * \brief  compute how_many transforms using the batched pipelines of the library
+ */
+static fpga_t transform(const unsigned dim, const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false};
+
+  switch(dim){
+    case 1:
+      return fftfpgaf_c2c_1d(N, inp, out, inv, how_many);
+    case 2:
+      // no batched 2D DDR pipeline
+      fft_time.valid = true;
+      for(unsigned i = 0; i < how_many; i++){
+        fpga_t t = fftfpgaf_c2c_2d_ddr(N, &inp[(size_t)i * N * N], &out[(size_t)i * N * N], inv);
+        fft_time.pcie_write_t += t.pcie_write_t;
+        fft_time.pcie_read_t += t.pcie_read_t;
+        fft_time.exec_t += t.exec_t;
+        fft_time.valid = fft_time.valid && t.valid;
+        fft_time.backend = t.backend;
+      }
+      return fft_time;
+    case 3:
+      if(how_many == 1)
+        return fftfpgaf_c2c_3d_ddr(N, inp, out, inv);
+      return fftfpgaf_c2c_3d_ddr_batch(N, inp, out, inv, false, how_many);
+    default:
+      return fft_time;
+  }
+}
+
+static bool stage_reserve(const size_t num_pts){
+  if(num_pts <= stage_pts)
+    return true;
+  free(stage_inp);
+  free(stage_out);
+  stage_inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  stage_out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  stage_pts = (stage_inp != NULL && stage_out != NULL) ? num_pts : 0;
+  return stage_pts != 0;
+}
+
+/**
+ * \brief  compute the jobs of the same dimension, size and direction as job `first` in one call to the library. Several 3D jobs are transferred from and to the memory of their clients, the inputs of other jobs are gathered into the staging buffers
+ * \param  exec_ms : incremented by the execution time of the call
+ * \return number of calls to the library
+ */
+static unsigned run_group(const unsigned first, const unsigned num_jobs, double *exec_ms){
+  const fftfpgad_job_t *key = &refs[first].job;
+  unsigned members[FFTFPGAD_MAX_CLIENTS * FFTFPGAD_RING_SLOTS];
+  unsigned num_members = 0, how_many = 0;
+
+  for(unsigned j = first; j < num_jobs; j++){
+    job_ref_t *ref = &refs[j];
+    if(ref->grouped || ref->job.dim != key->dim || ref->job.N != key->N || ref->job.inv != key->inv)
+      continue;
+    ref->grouped = true;
+    ref->job.result = (fpga_t){0.0, 0.0, 0.0, 0.0, 0.0, false};
+    if(ref->inp == NULL)
+      continue;
+    members[num_members++] = j;
+    how_many += ref->job.how_many;
+  }
+  if(num_members == 0)
+    return 0;
+
+  const size_t pts = job_pts(key);
+  fpga_t fft_time;
+
+  // a single job is computed on the shared memory of the client
+  if(num_members == 1){
+    job_ref_t *ref = &refs[members[0]];
+    ref->job.result = transform(key->dim, key->N, ref->inp, ref->out, key->inv, ref->job.how_many);
+    *exec_ms += ref->job.result.exec_t;
+    return 1;
+  }
+
+  // 3D jobs are written to the FPGA from and read back to the shared memory
+  // of their clients, other jobs are gathered into the staging buffers
+  const bool staged = (key->dim != 3);
+  if(staged){
+    if(!stage_reserve(pts * how_many))
+      return 0;
+
+    size_t offset = 0;
+    for(unsigned m = 0; m < num_members; m++){
+      job_ref_t *ref = &refs[members[m]];
+      memcpy(&stage_inp[offset], ref->inp, sizeof(float2) * pts * ref->job.how_many);
+      offset += pts * ref->job.how_many;
+    }
+
+    fft_time = transform(key->dim, key->N, stage_inp, stage_out, key->inv, how_many);
+  }
+  else{
+    const float2 **inp = (const float2**)malloc(sizeof(float2*) * how_many);
+    float2 **out = (float2**)malloc(sizeof(float2*) * how_many);
+    if(inp == NULL || out == NULL){
+      free(inp);
+      free(out);
+      return 0;
+    }
+
+    unsigned t = 0;
+    for(unsigned m = 0; m < num_members; m++){
+      job_ref_t *ref = &refs[members[m]];
+      for(unsigned i = 0; i < ref->job.how_many; i++, t++){
+        inp[t] = &ref->inp[i * pts];
+        out[t] = &ref->out[i * pts];
+      }
+    }
+
+    fft_time = fftfpgaf_c2c_3d_ddr_batch_gather(key->N, inp, out, key->inv, how_many);
+    free(inp);
+    free(out);
+  }
+
+  // every job is charged its share of the batch
+  size_t offset = 0;
+  for(unsigned m = 0; m < num_members; m++){
+    job_ref_t *ref = &refs[members[m]];
+    const double share = (double)ref->job.how_many / how_many;
+    if(staged)
+      memcpy(ref->out, &stage_out[offset], sizeof(float2) * pts * ref->job.how_many);
+    offset += pts * ref->job.how_many;
+
+    ref->job.result = fft_time;
+    ref->job.result.pcie_write_t *= share;
+    ref->job.result.pcie_read_t *= share;
+    ref->job.result.exec_t *= share;
+    ref->job.result.svm_copyin_t *= share;
+    ref->job.result.svm_copyout_t *= share;
+  }
+  *exec_ms += fft_time.exec_t;
+  return 1;
+}
+
+/**
+ * \brief  complete the jobs taken, called with the lock held
+ */
+static void complete_jobs(const unsigned num_jobs, const unsigned batches, const double exec_ms){
+  const uint64_t now = now_ns();
+
+  for(unsigned j = 0; j < num_jobs; j++){
+    const job_ref_t *ref = &refs[j];
+    fftfpgad_client_t *client = &shm->clients[ref->client];
+    const double latency_ms = (double)(now - ref->job.submit_ns) * 1e-6;
+
+    shm->stats.jobs++;
+    shm->stats.latency_sum_ms += latency_ms;
+    if(latency_ms > shm->stats.latency_max_ms)
+      shm->stats.latency_max_ms = latency_ms;
+
+    // the client disconnected in the meantime
+    if(client->pid == 0 || client->generation != ref->generation)
+      continue;
+
+    fftfpgad_job_t *job = &client->jobs[ref->slot];
+    if(job->state == JOB_RUNNING){
+      job->result = ref->job.result;
+      job->state = JOB_DONE;
+    }
+  }
+  shm->stats.batches += batches;
+  shm->stats.exec_sum_ms += exec_ms;
+  pthread_cond_broadcast(&shm->completed);
+}
+
+/**
+ * \brief  create the control segment
+ */
+static fftfpgad_shm_t* create_shm(const char *name){
+  // a segment left by a daemon that died
+  int fd = shm_open(name, O_RDWR, 0);
+  if(fd >= 0){
+    fftfpgad_shm_t *old = (fftfpgad_shm_t*)mmap(NULL, sizeof(fftfpgad_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(old != MAP_FAILED){
+      const bool alive = (old->magic == FFTFPGAD_MAGIC && pid_alive(old->daemon_pid));
+      munmap(old, sizeof(fftfpgad_shm_t));
+      if(alive){
+        fprintf(stderr, "Error: fftfpgad already running for %s\n", name);
+        return NULL;
+      }
+    }
+    shm_unlink(name);
+  }
+
+  fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0)
+    return NULL;
+  if(ftruncate(fd, sizeof(fftfpgad_shm_t)) != 0){
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  fftfpgad_shm_t *seg = (fftfpgad_shm_t*)mmap(NULL, sizeof(fftfpgad_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(seg == MAP_FAILED){
+    shm_unlink(name);
+    return NULL;
+  }
+
+  memset(seg, 0, sizeof(fftfpgad_shm_t));
+  if(!shm_init_sync(seg)){
+    munmap(seg, sizeof(fftfpgad_shm_t));
+    shm_unlink(name);
+    return NULL;
+  }
+  seg->daemon_pid = getpid();
+  seg->running = true;
+  __atomic_store_n(&seg->magic, FFTFPGAD_MAGIC, __ATOMIC_RELEASE);
+  return seg;
+}
+
+/**
+ * \brief  serve the jobs of clients until stop is set, the FPGA being initialized by the caller. Jobs queued by all clients while the previous ones were computed are grouped by dimension, size and direction, each group being computed by one call to the batched pipelines of the library.
+ * \param  stop : set asynchronously, for example by a signal handler
+ * \return 0 if successful, -1 if the control segment could not be created
+ */
+int fftfpgad_serve(volatile sig_atomic_t *stop){
+  const char *name = shm_name();
+  shm = create_shm(name);
+  if(shm == NULL){
+    fprintf(stderr, "Error: failed to create shared memory %s\n", name);
+    return -1;
+  }
+  printf("-- fftfpgad: serving on %s\n", name);
+
+  shm_lock(shm);
+  while(!*stop){
+    reap_clients();
+
+    const unsigned num_jobs = take_jobs();
+    if(num_jobs == 0){
+      struct timespec deadline;
+      const uint64_t t = now_ns() + IDLE_WAIT_NS;
+      deadline.tv_sec = t / 1000000000ull;
+      deadline.tv_nsec = t % 1000000000ull;
+      if(pthread_cond_timedwait(&shm->submitted, &shm->lock, &deadline) == EOWNERDEAD)
+        pthread_mutex_consistent(&shm->lock);
+      continue;
+    }
+    shm_unlock(shm);
+
+    unsigned batches = 0;
+    double exec_ms = 0.0;
+    for(unsigned j = 0; j < num_jobs; j++){
+      if(!refs[j].grouped)
+        batches += run_group(j, num_jobs, &exec_ms);
+    }
+
+    shm_lock(shm);
+    complete_jobs(num_jobs, batches, exec_ms);
+  }
+
+  // fail the jobs still queued and wake their clients
+  shm->running = false;
+  for(unsigned c = 0; c < FFTFPGAD_MAX_CLIENTS; c++){
+    for(unsigned s = 0; s < FFTFPGAD_RING_SLOTS; s++){
+      fftfpgad_job_t *job = &shm->clients[c].jobs[s];
+      if(job->state == JOB_QUEUED || job->state == JOB_RUNNING){
+        job->result = (fpga_t){0.0, 0.0, 0.0, 0.0, 0.0, false};
+        job->state = JOB_DONE;
+      }
+    }
+  }
+  pthread_cond_broadcast(&shm->completed);
+  shm_unlock(shm);
+
+  for(unsigned c = 0; c < FFTFPGAD_MAX_CLIENTS; c++)
+    unmap_client(c);
+  free(stage_inp);
+  free(stage_out);
+  stage_inp = stage_out = NULL;
+  stage_pts = 0;
+
+  munmap(shm, sizeof(fftfpgad_shm_t));
+  shm = NULL;
+  shm_unlink(name);
+  printf("-- fftfpgad: stopped\n");
+  return 0;
+}
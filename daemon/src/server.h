@@ -0,0 +1,10 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFTFPGAD_SERVER_H
+#define FFTFPGAD_SERVER_H
+
+#include <signal.h>
+
+int fftfpgad_serve(volatile sig_atomic_t *stop);
+
+#endif
@@ -0,0 +1,63 @@
+// Author: Arjun Ramaswami
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include "shm.h"
+
+/**
+ * \brief  name of the control segment, FFTFPGAD_NAME or FFTFPGAD_DEFAULT_NAME
+ */
+const char* shm_name(){
+  const char *name = getenv("FFTFPGAD_NAME");
+  return (name != NULL && strlen(name) > 0) ? name : FFTFPGAD_DEFAULT_NAME;
+}
+
+/**
+ * \brief  lock the control segment, recovering the lock of a process that died holding it
+ */
+void shm_lock(fftfpgad_shm_t *shm){
+  if(pthread_mutex_lock(&shm->lock) == EOWNERDEAD)
+    pthread_mutex_consistent(&shm->lock);
+}
+
+void shm_unlock(fftfpgad_shm_t *shm){
+  pthread_mutex_unlock(&shm->lock);
+}
+
+/**
+ * \brief  initialize the mutex and condition variables of a new control segment to be shared between processes
+ */
+bool shm_init_sync(fftfpgad_shm_t *shm){
+  pthread_mutexattr_t mattr;
+  pthread_condattr_t cattr;
+  bool ok = true;
+
+  pthread_mutexattr_init(&mattr);
+  pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+  ok = ok && (pthread_mutex_init(&shm->lock, &mattr) == 0);
+  pthread_mutexattr_destroy(&mattr);
+
+  pthread_condattr_init(&cattr);
+  pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+  pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+  ok = ok && (pthread_cond_init(&shm->submitted, &cattr) == 0);
+  ok = ok && (pthread_cond_init(&shm->completed, &cattr) == 0);
+  pthread_condattr_destroy(&cattr);
+
+  return ok;
+}
+
+uint64_t now_ns(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+bool pid_alive(const pid_t pid){
+  return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
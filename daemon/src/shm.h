@@ -0,0 +1,77 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFTFPGAD_SHM_H
+#define FFTFPGAD_SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "fftfpgad/fftfpgad.h"
+
+#define FFTFPGAD_MAGIC 0x46465444u
+#define FFTFPGAD_MAX_CLIENTS 64
+#define FFTFPGAD_RING_SLOTS 8
+#define FFTFPGAD_NAME_MAX 64
+
+typedef enum {
+  JOB_FREE = 0,
+  JOB_QUEUED,
+  JOB_RUNNING,
+  JOB_DONE
+} job_state_t;
+
+/**
+ * Transform submitted by a client, its data being in the shared memory of the client
+ */
+typedef struct {
+  job_state_t state;
+  unsigned dim;
+  unsigned N;
+  unsigned how_many;
+  bool inv;
+  size_t inp_offset;        /**< offsets in the data segment of the client */
+  size_t out_offset;
+  uint64_t submit_ns;
+  fpga_t result;
+} fftfpgad_job_t;
+
+/**
+ * Connection of a client process: a ring of jobs, appended at the tail by the client and started from the head by the daemon
+ */
+typedef struct {
+  pid_t pid;                /**< 0 if the connection is free */
+  unsigned generation;      /**< incremented for every connection, to detect reused entries */
+  char data_name[FFTFPGAD_NAME_MAX];
+  size_t data_size;
+  unsigned head, tail;
+  fftfpgad_job_t jobs[FFTFPGAD_RING_SLOTS];
+} fftfpgad_client_t;
+
+/**
+ * Control segment created by the daemon, guarded by a robust process shared mutex
+ */
+typedef struct {
+  uint32_t magic;
+  pid_t daemon_pid;
+  bool running;
+  pthread_mutex_t lock;
+  pthread_cond_t submitted; /**< signalled by clients */
+  pthread_cond_t completed; /**< broadcast by the daemon */
+  fftfpgad_stats_t stats;
+  fftfpgad_client_t clients[FFTFPGAD_MAX_CLIENTS];
+} fftfpgad_shm_t;
+
+const char* shm_name();
+
+void shm_lock(fftfpgad_shm_t *shm);
+
+void shm_unlock(fftfpgad_shm_t *shm);
+
+bool shm_init_sync(fftfpgad_shm_t *shm);
+
+uint64_t now_ns();
+
+bool pid_alive(const pid_t pid);
+
+#endif
@@ -41,6 +41,8 @@ int main(int argc, char* argv[]){
         case 1: {
           if(config.use_usm)
             runtime[i] = fftfpgaf_c2c_1d_svm(num, inp, out, inv, config.batch);
+          else if(config.natural)
+            runtime[i] = fftfpgaf_c2c_1d_natural(num, inp, out, inv, config.batch);
           else
             runtime[i] = fftfpgaf_c2c_1d(num, inp, out, inv, config.batch);
           break;
@@ -57,6 +59,8 @@ int main(int argc, char* argv[]){
         case 3:{
           if(config.use_bram)
             runtime[i] = fftfpgaf_c2c_3d_bram(num, inp, out, inv, burst);
+          else if(config.hybrid)
+            runtime[i] = fftfpgaf_c2c_3d_ddr_batch_hybrid(num, inp, out, inv, burst, config.batch);
           else if(!config.use_bram && (!config.use_usm) && (config.batch > 1))
             runtime[i] = fftfpgaf_c2c_3d_ddr_batch(num, inp, out, inv, burst, config.batch);
           else if(config.use_usm){
@@ -86,6 +90,7 @@ int main(int argc, char* argv[]){
   catch(const char* msg){
     cerr << msg << endl;
     fpga_final();
+    verify_cleanup();
     delete inp;
     delete out;
     return EXIT_FAILURE;
@@ -93,6 +98,7 @@ int main(int argc, char* argv[]){
 
   // destroy fpga state
   fpga_final();
+  verify_cleanup();
 
   perf_measures(config, runtime);
 
@@ -1,22 +1,11 @@
 #include <iostream>
 #include <math.h>
-#include <fftw3.h>
 #include "cxxopts.hpp"
 #include "helper.hpp"
 #include "fftfpga/fftfpga.h"
 
 using namespace std;
 
-unsigned bit_reversed(unsigned x, const unsigned bits) {
-  unsigned y = 0;
-  for (unsigned i = 0; i < bits; i++) {
-    y <<= 1;
-    y |= x & 1;
-    x >>= 1;
-  }
-  return y;
-}
-
 /**
  * \brief  create random single precision complex floating point values  
  * \param  inp : pointer to float2 data of size N 
@@ -54,6 +43,8 @@ void parse_args(int argc, char* argv[], CONFIG &config){
       ("m, use_bram", "Toggle to use BRAM instead of DDR for 3D Transpose  ", cxxopts::value<bool>()->default_value("false") )
       ("s, use_usm", "Toggle to use Unified Shared Memory features for data transfers between host and device", cxxopts::value<bool>()->default_value("false") )
       ("e, emulate", "Toggle to enable emulation ", cxxopts::value<bool>()->default_value("false") )
+      ("r, hybrid", "Toggle to split batched 3D FFTs between the FPGA and FFTW on the host", cxxopts::value<bool>()->default_value("false") )
+      ("o, natural", "Toggle to output 1D FFTs in natural instead of bit reversed order", cxxopts::value<bool>()->default_value("false") )
       ("h,help", "Print usage");
     auto opt = options.parse(argc, argv);
 
@@ -73,6 +64,8 @@ void parse_args(int argc, char* argv[], CONFIG &config){
     config.use_bram = opt["use_bram"].as<bool>();
     config.emulate = opt["emulate"].as<bool>();
     config.use_usm = opt["use_usm"].as<bool>();
+    config.hybrid = opt["hybrid"].as<bool>();
+    config.natural = opt["natural"].as<bool>();
 
     if(opt.count("path")){
       config.path = opt["path"].as<string>();
@@ -101,101 +94,28 @@ void print_config(const CONFIG config){
   printf("Burst Interleaving : %s \n", config.burst ? "Yes":"No");
   printf("Emulation          : %s \n", config.emulate ? "Yes":"No");
   printf("USM Feature        : %s \n", config.use_usm ? "Yes":"No");
+  printf("Hybrid CPU/FPGA    : %s \n", config.hybrid ? "Yes":"No");
+  if(config.dim == 1)
+    printf("Output Order       : %s \n", config.natural ? "Natural":"Bit Reversed");
   printf("--------------------------------------------\n\n");
 }
 
 /**
  * \brief Verify by comparing FFT computed in FPGA with FFTW 
- * \param verify: float2 pointer for fftw cpu computation
+ * \param verify: float2 pointer to the input of the FPGA computation
  * \param fpga_out: float2 pointer output from FPGA computation to verify 
  * \param config: struct of program state 
  * \return true if verification passed
  */
-bool verify_fftwf(const float2 *verify, float2 *fpgaout, const CONFIG config){
-
-  unsigned sz = pow(config.num, config.dim);
-  unsigned total_sz = config.batch * sz;
-
-  fftwf_complex *fftw_data = fftwf_alloc_complex(total_sz);
-
-  for(size_t i = 0; i < total_sz; i++){
-    fftw_data[i][0] = verify[i].x;
-    fftw_data[i][1] = verify[i].y;
-  }
+bool verify_fftwf(const float2 *verify, const float2 *fpgaout, const CONFIG config){
 
-  int *n = (int*)calloc(config.dim , sizeof(int));
-  for(unsigned i = 0; i < config.dim; i++){
-    n[i] = config.num;
-  }
-  int idist = sz, odist = sz;
-  int istride = 1, ostride = 1; // contiguous in memory
-
-  fftwf_plan plan;
-  if(config.inv){
-    plan = fftwf_plan_many_dft(config.dim, n, config.batch, &fftw_data[0], NULL, istride, idist, &fftw_data[0], NULL, ostride, odist, FFTW_BACKWARD, FFTW_ESTIMATE);
-  }
-  else{
-    plan = fftwf_plan_many_dft(config.dim, n, config.batch, &fftw_data[0], NULL, istride, idist, &fftw_data[0], NULL, ostride, odist, FFTW_FORWARD, FFTW_ESTIMATE);
-  }
-
-  fftwf_execute(plan);
-
-  if(config.dim == 1){
-    unsigned log_dim = log2(config.num);
-    float2 *tmp = new float2[total_sz]();
-
-    for(unsigned j = 0; j < config.batch; j++){
-      for(unsigned i = 0; i < config.num; i++){
-        unsigned index = (j*config.num) + i;
-        unsigned bit_rev = (j*config.num) + bit_reversed(i, log_dim);
-        
-        tmp[index].x = fpgaout[bit_rev].x;
-        tmp[index].y = fpgaout[bit_rev].y;
-      }
-    }
-    for(unsigned i = 0; i < total_sz; i++ ){
-      fpgaout[i].x = tmp[i].x;
-      fpgaout[i].y = tmp[i].y;
-    }
-
-    delete tmp;
-  }
-
-  // Verification using SNR
-  float mag_sum = 0, noise_sum = 0, magnitude, noise;
-  for (size_t i = 0; i < total_sz; i++) {
-    magnitude = fftw_data[i][0] * fftw_data[i][0] + \
-                      fftw_data[i][1] * fftw_data[i][1];
-    noise = (fftw_data[i][0] - fpgaout[i].x) \
-        * (fftw_data[i][0] - fpgaout[i].x) + 
-        (fftw_data[i][1] - fpgaout[i].y) * (fftw_data[i][1] - fpgaout[i].y);
-
-    mag_sum += magnitude;
-    noise_sum += noise;
-  }
-
-#ifndef NDEBUG
-  printf("\nFFTW and FFTFPGA results comparison: \n");
-  for(unsigned i = 0; i < total_sz; i++){
-    printf("%u : fpga - (%e %e) cpu - (%e %e)\n", i, fpgaout[i].x, fpgaout[i].y, fftw_data[i][0], fftw_data[i][1]);
-  }
-  printf("\n\n");
-#endif            
-
-  float db = 10 * log(mag_sum / noise_sum) / log(10.0);
-  
-  fftwf_free(fftw_data);
-  free(n);
-
-  fftwf_destroy_plan(plan);
+  VERIFY_STATS stats = compare_fftwf(verify, fpgaout, config.num, config.dim, config.batch, config.inv, config.natural);
 
   // if SNR greater than 120, verification passes
-  if(db > 120)
-    return true;
-  else{
-    printf("\tSignal to noise ratio on output sample: %f --> %s\n\n", db, "FAILED");
-    return false;
-  }
+  bool passed = (stats.snr > 120);
+  printf("\tSNR: %f dB, max abs error: %e, max rel error: %e --> %s\n", stats.snr, stats.max_abs_err, stats.max_rel_err, passed ? "PASSED" : "FAILED");
+
+  return passed;
 }
 
 /**
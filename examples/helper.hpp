@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include "fftfpga/fftfpga.h"
+#include "verify.hpp"
 
 struct CONFIG{
   unsigned num; 
@@ -16,6 +17,8 @@ struct CONFIG{
   bool use_bram;
   bool emulate;
   bool use_usm;
+  bool hybrid;
+  bool natural;
 };
 
 void parse_args(int argc, char* argv[], CONFIG &config);
@@ -26,7 +29,7 @@ double getTimeinMilliSec();
 
 void create_data(float2 *inp, const unsigned num);
 
-bool verify_fftwf(const float2 *verify, float2 *fpgaout, const CONFIG config);
+bool verify_fftwf(const float2 *verify, const float2 *fpgaout, const CONFIG config);
 
 void perf_measures(const CONFIG config, fpga_t *runtime);
 
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#include "verify.hpp"
+
+using namespace std;
+
+/**
+ * FFTW reference of the last input compared, ordered as the FPGA output
+ */
+struct REFERENCE{
+  unsigned num = 0;
+  unsigned dim = 0;
+  unsigned batch = 0;
+  bool inv = false;
+  bool natural = false;          // 1D output in natural instead of bit reversed order
+  size_t total_sz = 0;
+  vector<float2> inp;            // copy of the input the reference is computed from
+  fftwf_complex *data = NULL;    // in-place transformed reference
+  fftwf_plan plan = NULL;
+};
+
+static REFERENCE cached;
+
+static unsigned bit_reversed(unsigned x, const unsigned bits) {
+  unsigned y = 0;
+  for (unsigned i = 0; i < bits; i++) {
+    y <<= 1;
+    y |= x & 1;
+    x >>= 1;
+  }
+  return y;
+}
+
+/**
+ * \brief  free the cached plan and reference
+ */
+void verify_cleanup(){
+  if(cached.plan != NULL)
+    fftwf_destroy_plan(cached.plan);
+  fftwf_free(cached.data);
+
+  cached.plan = NULL;
+  cached.data = NULL;
+  cached.total_sz = 0;
+  cached.num = cached.dim = cached.batch = 0;
+  vector<float2>().swap(cached.inp);
+}
+
+/**
+ * \brief  create a multithreaded plan, reused as long as the configuration does not change
+ * \return true if successful
+ */
+static bool plan_reference(const unsigned num, const unsigned dim, const unsigned batch, const bool inv, const bool natural){
+
+  if(cached.plan != NULL && cached.num == num && cached.dim == dim && cached.batch == batch && cached.inv == inv && cached.natural == natural)
+    return true;
+
+  verify_cleanup();
+
+  static bool threads_init = false;
+  if(!threads_init){
+    threads_init = (fftwf_init_threads() != 0);
+  }
+  unsigned threads = thread::hardware_concurrency();
+  fftwf_plan_with_nthreads(threads > 0 ? threads : 1);
+
+  const size_t sz = (size_t)pow(num, dim);
+  cached.total_sz = sz * batch;
+  cached.data = fftwf_alloc_complex(cached.total_sz);
+  if(cached.data == NULL){
+    verify_cleanup();
+    return false;
+  }
+
+  int n[3] = {(int)num, (int)num, (int)num};
+  int idist = sz, odist = sz;
+  int istride = 1, ostride = 1; // contiguous in memory
+
+  // FFTW_ESTIMATE does not overwrite the buffer while planning
+  cached.plan = fftwf_plan_many_dft(dim, n, batch, cached.data, NULL, istride, idist, cached.data, NULL, ostride, odist, inv ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE);
+  if(cached.plan == NULL){
+    verify_cleanup();
+    return false;
+  }
+
+  cached.num = num;
+  cached.dim = dim;
+  cached.batch = batch;
+  cached.inv = inv;
+  cached.natural = natural;
+  return true;
+}
+
+/**
+ * \brief  transform the input unless the reference was computed from identical input
+ */
+static void compute_reference(const float2 *inp){
+
+  if(cached.inp.size() == cached.total_sz && memcmp(cached.inp.data(), inp, cached.total_sz * sizeof(float2)) == 0)
+    return;
+
+  cached.inp.assign(inp, inp + cached.total_sz);
+  memcpy(cached.data, inp, cached.total_sz * sizeof(float2));
+  fftwf_execute(cached.plan);
+
+  // 1D FFTs on the FPGA output points in bit reversed order, an involution applied by swapping pairs
+  if(cached.dim == 1 && !cached.natural){
+    const unsigned log_dim = log2(cached.num);
+    for(unsigned j = 0; j < cached.batch; j++){
+      fftwf_complex *batch_data = &cached.data[(size_t)j * cached.num];
+      for(unsigned i = 0; i < cached.num; i++){
+        unsigned bit_rev = bit_reversed(i, log_dim);
+        if(i < bit_rev){
+          float re = batch_data[i][0], im = batch_data[i][1];
+          batch_data[i][0] = batch_data[bit_rev][0];
+          batch_data[i][1] = batch_data[bit_rev][1];
+          batch_data[bit_rev][0] = re;
+          batch_data[bit_rev][1] = im;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * \brief  compare the output of an FFT with FFTW. The plan and the reference
+ *         are cached across calls, recomputing the reference only if the input
+ *         changed.
+ * \param  inp   : input to the FFT of size [batch * num^dim]
+ * \param  out   : output of the FFT to verify, in the order of the FPGA output
+ * \param  num   : number of points along each dimension
+ * \param  dim   : number of dimensions 1, 2 or 3
+ * \param  batch : number of transforms
+ * \param  inv   : toggle for backward FFT
+ * \param  natural : 1D output in natural order, as by fftfpgaf_c2c_1d_natural()
+ * \return snr of 0 if the reference could not be computed, infinity if out matches exactly
+ */
+VERIFY_STATS compare_fftwf(const float2 *inp, const float2 *out, const unsigned num, const unsigned dim, const unsigned batch, const bool inv, const bool natural){
+
+  VERIFY_STATS stats = {0.0, 0.0, 0.0};
+
+  if(inp == NULL || out == NULL || dim < 1 || dim > 3 || batch == 0)
+    return stats;
+
+  if(!plan_reference(num, dim, batch, inv, natural))
+    return stats;
+
+  compute_reference(inp);
+
+  const fftwf_complex *verify = cached.data;
+  const long total_sz = cached.total_sz;
+
+  // accumulated in double precision to not lose the noise against the signal
+  double mag_sum = 0.0, noise_sum = 0.0, max_noise = 0.0, max_mag = 0.0;
+#pragma omp parallel for simd reduction(+:mag_sum, noise_sum) reduction(max:max_noise, max_mag)
+  for(long i = 0; i < total_sz; i++){
+    double re = verify[i][0], im = verify[i][1];
+    double re_err = re - out[i].x, im_err = im - out[i].y;
+
+    double magnitude = re * re + im * im;
+    double noise = re_err * re_err + im_err * im_err;
+
+    mag_sum += magnitude;
+    noise_sum += noise;
+    max_mag = magnitude > max_mag ? magnitude : max_mag;
+    max_noise = noise > max_noise ? noise : max_noise;
+  }
+
+#ifndef NDEBUG
+  printf("\nFFTW and FFTFPGA results comparison: \n");
+  for(long i = 0; i < total_sz; i++){
+    printf("%ld : fpga - (%e %e) cpu - (%e %e)\n", i, out[i].x, out[i].y, verify[i][0], verify[i][1]);
+  }
+  printf("\n\n");
+#endif
+
+  stats.snr = (noise_sum > 0.0) ? 10.0 * log10(mag_sum / noise_sum) : INFINITY;
+  stats.max_abs_err = sqrt(max_noise);
+  stats.max_rel_err = (max_mag > 0.0) ? sqrt(max_noise / max_mag) : stats.max_abs_err;
+
+  return stats;
+}
@@ -0,0 +1,19 @@
+#ifndef VERIFY_HPP
+#define VERIFY_HPP
+
+#include "fftfpga/fftfpga.h"
+
+/**
+ * Comparison of an FPGA output with the FFTW reference
+ */
+struct VERIFY_STATS{
+  double snr;         // signal to noise ratio in dB
+  double max_abs_err; // largest magnitude of the difference of a point
+  double max_rel_err; // max_abs_err relative to the largest magnitude of the reference
+};
+
+VERIFY_STATS compare_fftwf(const float2 *inp, const float2 *out, const unsigned num, const unsigned dim, const unsigned batch, const bool inv, const bool natural = false);
+
+void verify_cleanup();
+
+#endif // VERIFY_HPP
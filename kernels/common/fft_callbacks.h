@@ -0,0 +1,24 @@
+// Author: Arjun Ramaswami
+
+// Default load and store callbacks of fft3d_ddr, which leave the data
+// unmodified. A header defining the same functions can be selected using
+// FFT_CALLBACK_HEADER.
+//
+// index : position of the point in the input or output of size N * N * N
+// value : point read from the input or to be written to the output
+// data  : buffer set using fftfpgaf_set_callback_data(), NULL if not set
+
+#ifndef FFT_CALLBACKS_H
+#define FFT_CALLBACKS_H
+
+// applied by fetch to each point read from global memory
+inline float2 load_cb(const unsigned index, const float2 value, __global const float2 * restrict data){
+  return value;
+}
+
+// applied by store to each point before it is written to global memory
+inline float2 store_cb(const unsigned index, const float2 value, __global const float2 * restrict data){
+  return value;
+}
+
+#endif // FFT_CALLBACKS_H
@@ -66,6 +66,14 @@
 // Need some depth to our channels to accommodate their bursty filling.
 channel float2 chanin[8] __attribute__((depth(CONT_FACTOR*8)));
 
+#ifdef NATURAL_ORDER
+#include "../matrixTranspose/diagonal_bitrev.cl"
+
+channel float2 chanout[8];
+#endif
+
+// defined by diagonal_bitrev.cl for the natural order
+#ifndef NATURAL_ORDER
 uint bit_reversed(uint x, uint bits) {
   uint y = 0;
   #pragma unroll 
@@ -77,6 +85,7 @@ uint bit_reversed(uint x, uint bits) {
   y &= ((1 << bits) - 1);
   return y;
 }
+#endif
 
 // fetch N points as follows:
 // - each thread will load 8 consecutive values
@@ -180,8 +189,13 @@ void fetch(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) v
  * 'inverse' toggles between the direct and the inverse transform
  */
 
+#ifdef NATURAL_ORDER
+kernel 
+void fft1d(int count, int inverse) {
+#else
 kernel 
 void fft1d(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict dest, int count, int inverse) {
+#endif
 
   /* The FFT engine requires a sliding window array for data reordering; data 
    * stored in this array is carried across loop iterations and shifted by one 
@@ -236,9 +250,73 @@ void fft1d(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) v
      */
 
     if (i >= N / 8 - 1) {
+#ifdef NATURAL_ORDER
+      write_channel_intel(chanout[0], data.i0);
+      write_channel_intel(chanout[1], data.i1);
+      write_channel_intel(chanout[2], data.i2);
+      write_channel_intel(chanout[3], data.i3);
+      write_channel_intel(chanout[4], data.i4);
+      write_channel_intel(chanout[5], data.i5);
+      write_channel_intel(chanout[6], data.i6);
+      write_channel_intel(chanout[7], data.i7);
+#else
       int base = 8 * (i - (N / 8 - 1));
  
       // These consecutive accesses will be coalesced by the compiler
+      dest[base] = data.i0;
+      dest[base + 1] = data.i1;
+      dest[base + 2] = data.i2;
+      dest[base + 3] = data.i3;
+      dest[base + 4] = data.i4;
+      dest[base + 5] = data.i5;
+      dest[base + 6] = data.i6;
+      dest[base + 7] = data.i7;
+#endif
+    }
+  }
+}
+
+#ifdef NATURAL_ORDER
+/* Reorders the bit reversed output of the FFT engine using a double buffer
+ * of N points: bitreverse_fetch reads row r of the previous transform as the
+ * 8 consecutive points starting at bit_reversed(r) * 8, which are stored as a
+ * single burst. The buffers add a latency of N / 8 cycles per batch.
+ */
+kernel 
+void store(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) float2 * restrict dest, int count) {
+  const unsigned STEPS = N / POINTS;
+  bool is_bitrevA = false;
+
+  float2 __attribute__((memory, numbanks(8))) buf[2][N];
+
+  // additional iterations to drain the buffers
+  for(unsigned step = 0; step < (count + 1) * STEPS; step++){
+    float2x8 data;
+    if (step < count * STEPS) {
+      data.i0 = read_channel_intel(chanout[0]);
+      data.i1 = read_channel_intel(chanout[1]);
+      data.i2 = read_channel_intel(chanout[2]);
+      data.i3 = read_channel_intel(chanout[3]);
+      data.i4 = read_channel_intel(chanout[4]);
+      data.i5 = read_channel_intel(chanout[5]);
+      data.i6 = read_channel_intel(chanout[6]);
+      data.i7 = read_channel_intel(chanout[7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 = 
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+
+    is_bitrevA = ( (step & (STEPS - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0] : buf[1], 
+      is_bitrevA ? buf[1] : buf[0], 
+      step);
+
+    if (step >= STEPS) {
+      unsigned row = step - STEPS;
+      unsigned base = (row / STEPS) * N + bit_reversed(row & (STEPS - 1), LOGN - LOGPOINTS) * POINTS;
+
       dest[base] = data.i0;
       dest[base + 1] = data.i1;
       dest[base + 2] = data.i2;
@@ -250,4 +328,5 @@ void fft1d(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) v
     }
   }
 }
+#endif
 
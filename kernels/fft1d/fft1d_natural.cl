@@ -0,0 +1,7 @@
+// Author: Arjun Ramaswami
+
+// 1D FFT storing its output in natural order, reordered on chip by the
+// store kernel instead of being written in bit reversed order by fft1d
+#define NATURAL_ORDER
+
+#include "fft1d.cl"
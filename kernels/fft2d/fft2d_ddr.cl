@@ -91,6 +91,18 @@ channel float2 chanin5 __attribute__((depth(0)));
 channel float2 chanin6 __attribute__((depth(0)));
 channel float2 chanin7 __attribute__((depth(0)));
 
+#ifdef FOUR_STEP
+channel float2 chantw0 __attribute__((depth(0)));
+channel float2 chantw1 __attribute__((depth(0)));
+channel float2 chantw2 __attribute__((depth(0)));
+channel float2 chantw3 __attribute__((depth(0)));
+
+channel float2 chantw4 __attribute__((depth(0)));
+channel float2 chantw5 __attribute__((depth(0)));
+channel float2 chantw6 __attribute__((depth(0)));
+channel float2 chantw7 __attribute__((depth(0)));
+#endif
+
 // This utility function bit-reverses an integer 'x' of width 'bits'.
 
 int bit_reversed(int x, int bits) {
@@ -130,6 +142,19 @@ int mangle_bits(int x) {
    return (x & ~mask) | a95 | a1410;
 }
 
+#ifdef FOUR_STEP
+/* Offset of the group of 8 consecutive columns starting at 'col' within a
+ * matrix row. The tiled layout places the groups of a row 8 * N points apart
+ * instead of 8. With rows 8 points apart, a group of N rows then is a tile of
+ * 8 * N consecutive points, which the out-of-chip 3D FFT uses to fetch the
+ * pencils along z in a single burst per plane.
+ */
+
+int tiled_column(int col, int tiled) {
+  return tiled ? (col << LOGN) : col;
+}
+#endif
+
 /* This kernel reads the matrix data and provides 8 parallel streams to the 
  * FFT engine. Each workgroup reads 8 matrix rows to local memory. Once this 
  * data has been buffered, the workgroup produces 8 streams from strided 
@@ -137,13 +162,39 @@ int mangle_bits(int x) {
  */
 
 __attribute__((reqd_work_group_size((1 << LOGN), 1, 1)))
+#ifdef FOUR_STEP
+kernel void fetch(global float2 * restrict src, int mangle, int transposed, int offset, int stride, int tiled) {
+#else
 kernel void fetch(global float2 * restrict src, int mangle) {
+#endif
 
   // Local memory for storing 8 rows
   local float2 buf[8 * N];
 
   float2x8 data;
 
+#ifdef FOUR_STEP
+  /* The matrix starts at 'offset' in 'src' and its rows are 'stride' points
+   * apart, which allows to read the planes and the pencils of a 3D grid.
+   * In the 'tiled' layout, the groups of 8 columns of a row are 8 * N points
+   * apart instead of 8, see tiled_column().
+   *
+   * Reading the transposed matrix, each work-item fetches 8 consecutive
+   * points of one matrix row, i.e. one point of 8 consecutive columns, which
+   * are buffered as the rows to be transformed.
+   */
+  if (transposed) {
+    int r = get_local_id(0);
+    int c = get_group_id(0) << LOGPOINTS;
+
+    #pragma unroll
+    for (int k = 0; k < POINTS; k++) {
+      buf[k * N + r] = src[offset + r * stride + tiled_column(c, tiled) + k];
+    }
+  }
+  else {
+#endif
+
   // Each read fetches 8 matrix points
   int x = get_global_id(0) << LOGPOINTS;
 
@@ -169,6 +220,10 @@ kernel void fetch(global float2 * restrict src, int mangle) {
     where_global = where;
   }
 
+#ifdef FOUR_STEP
+  where_global = offset + (where_global >> LOGN) * stride + tiled_column(where_global & (N - 1), tiled);
+#endif
+
   buf[(where & ((1 << (LOGN + LOGPOINTS)) - 1))] = src[where_global];
   //printf("fetch - FPGA: where - %d : where_global - %d : Value - (%lf %lf)\n", where, where_global, buf[where].x, buf[where].y);
   buf[(where & ((1 << (LOGN + LOGPOINTS)) - 1)) + 1] = src[where_global + 1];
@@ -179,6 +234,9 @@ kernel void fetch(global float2 * restrict src, int mangle) {
   buf[(where & ((1 << (LOGN + LOGPOINTS)) - 1)) + 5] = src[where_global + 5];
   buf[(where & ((1 << (LOGN + LOGPOINTS)) - 1)) + 6] = src[where_global + 6];
   buf[(where & ((1 << (LOGN + LOGPOINTS)) - 1)) + 7] = src[where_global + 7];
+#ifdef FOUR_STEP
+  }
+#endif
 
   barrier(CLK_LOCAL_MEM_FENCE);
 
@@ -247,6 +305,65 @@ kernel void fft2d(int inverse) {
   }
 }
 
+#ifdef FOUR_STEP
+/* Twiddle factor exp(-2 pi i * index / (N * N)) of the four-step 1D FFT of
+ * N * N points, or its conjugate for the inverse transform. The index is
+ * below N * N, hence exactly representable by a float for N <= 4096.
+ */
+
+float2 twiddle_factor(int index, int inverse) {
+  float x = (float)index * (2.0f / ((float)N * (float)N));
+  float s = sinpi(x);
+  float c = cospi(x);
+  return inverse ? (float2)(c, s) : (float2)(c, -s);
+}
+
+float2 complex_mult(float2 a, float2 b) {
+  return (float2)(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+/* This single work-item task multiplies the FFT results of the first pass of
+ * the four-step 1D FFT with the twiddle factors of their row and frequency.
+ * The FFT engine outputs the 8 rows of a block one after another, each in bit
+ * reversed order. The results are forwarded unchanged if 'enable' is 0, as
+ * in the second pass and in the passes of the out-of-chip 3D FFT.
+ */
+
+kernel void twiddle(int enable, int inverse) {
+  for (unsigned i = 0; i < N * (N / POINTS); i++) {
+    float2 data[POINTS];
+    data[0] = read_channel_intel(chan0);
+    data[1] = read_channel_intel(chan1);
+    data[2] = read_channel_intel(chan2);
+    data[3] = read_channel_intel(chan3);
+    data[4] = read_channel_intel(chan4);
+    data[5] = read_channel_intel(chan5);
+    data[6] = read_channel_intel(chan6);
+    data[7] = read_channel_intel(chan7);
+
+    if (enable) {
+      int block = i >> LOGN;
+      #pragma unroll
+      for (int k = 0; k < POINTS; k++) {
+        int where = ((i & (N - 1)) << LOGPOINTS) + k;
+        int row = (block << LOGPOINTS) + (where >> LOGN);
+        int freq = bit_reversed(where & (N - 1), LOGN);
+        data[k] = complex_mult(data[k], twiddle_factor(row * freq, inverse));
+      }
+    }
+
+    write_channel_intel(chantw0, data[0]);
+    write_channel_intel(chantw1, data[1]);
+    write_channel_intel(chantw2, data[2]);
+    write_channel_intel(chantw3, data[3]);
+    write_channel_intel(chantw4, data[4]);
+    write_channel_intel(chantw5, data[5]);
+    write_channel_intel(chantw6, data[6]);
+    write_channel_intel(chantw7, data[7]);
+  }
+}
+#endif
+
 /* This kernel receives the FFT results, buffers 8 rows and then writes the
  * results transposed in memory. Because 8 rows are buffered, 8 consecutive
  * columns can be written at a time on each transposed row. This provides some
@@ -256,8 +373,22 @@ kernel void fft2d(int inverse) {
  */
 
 __attribute__((reqd_work_group_size((1 << LOGN), 1, 1)))
+#ifdef FOUR_STEP
+kernel void transpose(global float2 * restrict dest, int mangle, int offset, int stride, int tiled) {
+#else
 kernel void transpose(global float2 * restrict dest, int mangle) {
+#endif
   local float2 buf[POINTS * N];
+#ifdef FOUR_STEP
+  buf[8 * get_local_id(0)] = read_channel_intel(chantw0);
+  buf[8 * get_local_id(0) + 1] = read_channel_intel(chantw1);
+  buf[8 * get_local_id(0) + 2] = read_channel_intel(chantw2);
+  buf[8 * get_local_id(0) + 3] = read_channel_intel(chantw3);
+  buf[8 * get_local_id(0) + 4] = read_channel_intel(chantw4);
+  buf[8 * get_local_id(0) + 5] = read_channel_intel(chantw5);
+  buf[8 * get_local_id(0) + 6] = read_channel_intel(chantw6);
+  buf[8 * get_local_id(0) + 7] = read_channel_intel(chantw7);
+#else
   buf[8 * get_local_id(0)] = read_channel_intel(chan0);
   buf[8 * get_local_id(0) + 1] = read_channel_intel(chan1);
   buf[8 * get_local_id(0) + 2] = read_channel_intel(chan2);
@@ -266,6 +397,7 @@ kernel void transpose(global float2 * restrict dest, int mangle) {
   buf[8 * get_local_id(0) + 5] = read_channel_intel(chan5);
   buf[8 * get_local_id(0) + 6] = read_channel_intel(chan6);
   buf[8 * get_local_id(0) + 7] = read_channel_intel(chan7);
+#endif
  
   barrier(CLK_LOCAL_MEM_FENCE);
   int colt = get_local_id(0);
@@ -273,6 +405,9 @@ kernel void transpose(global float2 * restrict dest, int mangle) {
   int i = get_global_id(0) >> LOGN;
   int where = colt * N + i * POINTS;
   if (mangle) where = mangle_bits(where);
+#ifdef FOUR_STEP
+  where = offset + (where >> LOGN) * stride + tiled_column(where & (N - 1), tiled);
+#endif
   dest[where] = buf[revcolt];
   //printf(" transpose FPGA: where_global - %d : Value - (%lf %lf)\n", where, dest[where].x, dest[where].y);
   dest[where + 1] = buf[N + revcolt];
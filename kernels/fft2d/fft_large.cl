@@ -0,0 +1,10 @@
+// Author: Arjun Ramaswami
+
+// Transforms larger than the on-chip buffers using the 2D engine on data in
+// DDR: the 1D FFT of N * N points using the four-step decomposition, where the
+// first pass reads the input transposed and multiplies the twiddle factors
+// before the transposed write, and the 3D FFT of N * N * N points by passes
+// over its planes and pencils
+#define FOUR_STEP
+
+#include "fft2d_ddr.cl"
@@ -4,6 +4,15 @@
 #include "../common/fft_8.cl" 
 #include "../matrixTranspose/diagonal_bitrev.cl"
 
+// the convolution and the gradient transform their own output, the
+// transposed variant reorders it, the sphere and pruned variants pack it and
+// the split variant separates its parts, which excludes user callbacks
+#if defined(CONV3D) || defined(TRANSPOSED) || defined(SPHERE) || defined(PRUNED) || defined(GRADIENT) || defined(SPLIT)
+#include "../common/fft_callbacks.h"
+#else
+#include FFT_CALLBACK_HEADER
+#endif
+
 #pragma OPENCL EXTENSION cl_intel_channels : enable
 
 channel float2 chaninfft3da[POINTS]; 
@@ -18,8 +27,27 @@ channel float2 chaninStore[POINTS];
 #define RD_GLOBALMEM 1
 #define BATCH 2
 
+#ifdef TILED
+// address in the cube of transpose3D of the point at index z * N * N + y * N + x
+// in fft3d_ddr_tiled.cl, y and z being swapped such that the yz-plane read
+// for each y is contiguous
+inline unsigned tiled_index(const unsigned index){
+  unsigned zdim = index >> (LOGN + LOGN);
+  unsigned ydim = (index >> LOGN) & (N - 1);
+  unsigned xdim = index & (N - 1);
+
+  return (((ydim << LOGN) + zdim) << LOGN) + xdim;
+}
+#endif
+
+// replaced by the fetch scattering packed coefficients in fft3d_ddr_sphere.cl,
+// the fetch padding a subcube with zeros in fft3d_ddr_pruned.cl, the fetch
+// differentiating the spectrum in fft3d_ddr_gradient.cl and the fetch of
+// split real and imaginary parts in fft3d_ddr_split.cl
+#if !defined(SPHERE) && !defined(PRUNED) && !defined(GRADIENT) && !defined(SPLIT)
 // Kernel that fetches data from global memory 
-kernel void fetch(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict src) {
+kernel void fetch(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict src,
+  __global __attribute__((buffer_location(DDR_BUFFER_LOCATION))) const float2 * restrict load_data) {
   unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
   bool is_bitrevA = false;
 
@@ -32,14 +60,14 @@ kernel void fetch(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATI
 
     float2x8 data;
     if (step < (N * DEPTH)) {
-      data.i0 = src[where + 0];
-      data.i1 = src[where + 1];
-      data.i2 = src[where + 2];
-      data.i3 = src[where + 3];
-      data.i4 = src[where + 4];
-      data.i5 = src[where + 5];
-      data.i6 = src[where + 6];
-      data.i7 = src[where + 7];
+      data.i0 = load_cb(where + 0, src[where + 0], load_data);
+      data.i1 = load_cb(where + 1, src[where + 1], load_data);
+      data.i2 = load_cb(where + 2, src[where + 2], load_data);
+      data.i3 = load_cb(where + 3, src[where + 3], load_data);
+      data.i4 = load_cb(where + 4, src[where + 4], load_data);
+      data.i5 = load_cb(where + 5, src[where + 5], load_data);
+      data.i6 = load_cb(where + 6, src[where + 6], load_data);
+      data.i7 = load_cb(where + 7, src[where + 7], load_data);
     } else {
       data.i0 = data.i1 = data.i2 = data.i3 = 
                 data.i4 = data.i5 = data.i6 = data.i7 = 0;
@@ -65,6 +93,7 @@ kernel void fetch(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATI
     }
   }
 }
+#endif
 
 kernel void fft3da(int inverse) {
 
@@ -238,7 +267,9 @@ kernel void transpose3D(
   bool is_bufA = false, is_bitrevA = false;
   bool is_bufB = false, is_bitrevB = false;
 
+#ifndef TRANSPOSED
   float2 buf_wr[2][DEPTH][POINTS];
+#endif
   float2 buf_rd[2][DEPTH][POINTS];
 
   //float2 __attribute__((memory, numbanks(8))) bitrev_in[2][N];
@@ -278,6 +309,13 @@ kernel void transpose3D(
         is_bitrevA ? bitrev_in[1] : bitrev_in[0], 
         row);
 
+#ifdef TRANSPOSED
+      // written in the order of the channel, which is read back transposed
+      // by the same pattern, leaving the output in x-y-z order
+      data_out = data;
+      if (step >= 0 && step < (N * DEPTH)) {
+        unsigned index = step * 8;
+#else
       writeBuf(data,
         is_bufA ? buf_wr[0] : buf_wr[1],
         step, 0);
@@ -287,7 +325,12 @@ kernel void transpose3D(
         step);
 
       if (step >= (DEPTH)) {
+#ifdef TILED
+        unsigned index = tiled_index((step - DEPTH) * 8);
+#else
         unsigned index = (step - DEPTH) * 8;
+#endif
+#endif
 
         dest[index + 0] = data_out.i0;
         dest[index + 1] = data_out.i1;
@@ -315,7 +358,11 @@ kernel void transpose3D(
       // increment by 1 every N*N*N / 8 steps
       unsigned batch_index = (step_rd >> (LOGN + LOGN + LOGN - LOGPOINTS));
 
+#ifdef TILED
+      unsigned index_wr = (batch_index * N * N * N) + tiled_index((zdim * N * N) + (ydim * N) + xdim);
+#else
       unsigned index_wr = (batch_index * N * N * N) + (zdim * N * N) + (ydim * N) + xdim; 
+#endif
 
       //float2x8 data, data_out;
       if (step < ((N * DEPTH)  - initial_delay)) {
@@ -415,7 +462,14 @@ kernel void fft3dc(int inverse) {
   }
 }
 
-kernel void store(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict dest) {
+// replaced by the store of the convolution in fft3d_ddr_conv.cl, the
+// store without reordering in fft3d_ddr_transposed.cl, the store gathering
+// the sphere in fft3d_ddr_sphere.cl, the store cropping a subcube in
+// fft3d_ddr_pruned.cl and the store of split real and imaginary parts in
+// fft3d_ddr_split.cl
+#if !defined(CONV3D) && !defined(TRANSPOSED) && !defined(SPHERE) && !defined(PRUNED) && !defined(SPLIT)
+kernel void store(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict dest,
+  __global __attribute__((buffer_location(DDR_BUFFER_LOCATION))) const float2 * restrict store_data) {
 
   const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
   bool is_bufA = false, is_bitrevA = false;
@@ -484,14 +538,15 @@ kernel void store(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATI
 
       unsigned index = (batch_index * N * N * N) + (zdim * N * N) + (ydim * N) + xdim; 
 
-      dest[index + 0] = data_out.i0;
-      dest[index + 1] = data_out.i1;
-      dest[index + 2] = data_out.i2;
-      dest[index + 3] = data_out.i3;
-      dest[index + 4] = data_out.i4;
-      dest[index + 5] = data_out.i5;
-      dest[index + 6] = data_out.i6;
-      dest[index + 7] = data_out.i7;
+      dest[index + 0] = store_cb(index + 0, data_out.i0, store_data);
+      dest[index + 1] = store_cb(index + 1, data_out.i1, store_data);
+      dest[index + 2] = store_cb(index + 2, data_out.i2, store_data);
+      dest[index + 3] = store_cb(index + 3, data_out.i3, store_data);
+      dest[index + 4] = store_cb(index + 4, data_out.i4, store_data);
+      dest[index + 5] = store_cb(index + 5, data_out.i5, store_data);
+      dest[index + 6] = store_cb(index + 6, data_out.i6, store_data);
+      dest[index + 7] = store_cb(index + 7, data_out.i7, store_data);
     }
   }
 }
+#endif
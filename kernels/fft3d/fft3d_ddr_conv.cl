@@ -0,0 +1,102 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose, whose store multiplies the transform
+// with a filter resident in global memory to compute convolutions on the FPGA
+
+#define CONV3D
+#include "fft3d_ddr.cl"
+
+float2 complex_mult(float2 a, float2 b){
+  float2 res;
+  res.x = (a.x * b.x) - (a.y * b.y);
+  res.y = (a.x * b.y) + (a.y * b.x);
+  return res;
+}
+
+// multiply is 1 for the forward transform, whose output stays on the device
+kernel void store_conv(
+  __global __attribute__((buffer_location(DDR_BUFFER_LOCATION))) float2 * restrict dest,
+  __global __attribute__((buffer_location(DDR_BUFFER_LOCATION))) const float2 * restrict filter,
+  const int multiply) {
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bufA = false, is_bitrevA = false;
+
+  float2 buf[2][DEPTH][POINTS];
+  float2 bitrev_in[2][N];
+  
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data.i0 = read_channel_intel(chaninStore[0]);
+      data.i1 = read_channel_intel(chaninStore[1]);
+      data.i2 = read_channel_intel(chaninStore[2]);
+      data.i3 = read_channel_intel(chaninStore[3]);
+      data.i4 = read_channel_intel(chaninStore[4]);
+      data.i5 = read_channel_intel(chaninStore[5]);
+      data.i6 = read_channel_intel(chaninStore[6]);
+      data.i7 = read_channel_intel(chaninStore[7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 = 
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+    // Swap buffers every N*N/8 iterations 
+    // starting from the additional delay of N/8 iterations
+    is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1], 
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0], 
+      row);
+
+    writeBuf(data,
+      is_bufA ? buf[0] : buf[1],
+      step, 0);
+
+    data_out = readBuf_store(
+      is_bufA ? buf[1] : buf[0], 
+      step);
+
+    if (step >= (DEPTH)) {
+      unsigned start_index = (step - DEPTH);
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned zdim = (start_index >> (LOGN - LOGPOINTS)) & (N - 1); 
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (start_index >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // incremenet by 8 until N / 8
+      unsigned xdim = (start_index * 8) & ( N - 1);
+
+      unsigned index = (zdim * N * N) + (ydim * N) + xdim; 
+
+      // the filter is in the same natural order as the transform
+      if (multiply) {
+        data_out.i0 = complex_mult(data_out.i0, filter[index + 0]);
+        data_out.i1 = complex_mult(data_out.i1, filter[index + 1]);
+        data_out.i2 = complex_mult(data_out.i2, filter[index + 2]);
+        data_out.i3 = complex_mult(data_out.i3, filter[index + 3]);
+        data_out.i4 = complex_mult(data_out.i4, filter[index + 4]);
+        data_out.i5 = complex_mult(data_out.i5, filter[index + 5]);
+        data_out.i6 = complex_mult(data_out.i6, filter[index + 6]);
+        data_out.i7 = complex_mult(data_out.i7, filter[index + 7]);
+      }
+
+      dest[index + 0] = data_out.i0;
+      dest[index + 1] = data_out.i1;
+      dest[index + 2] = data_out.i2;
+      dest[index + 3] = data_out.i3;
+      dest[index + 4] = data_out.i4;
+      dest[index + 5] = data_out.i5;
+      dest[index + 6] = data_out.i6;
+      dest[index + 7] = data_out.i7;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose, whose fetch multiplies the spectrum
+// in natural order with i * scale * k of a component of the wave vector, to
+// compute the components of a spectral gradient with backward transforms of
+// a spectrum resident in global memory
+
+#define GRADIENT
+#include "fft3d_ddr.cl"
+
+// point at index of the spectrum multiplied with i * scale * k of the
+// component, 0 for x, 1 for y and 2 for z. The Nyquist frequency has no sign
+// and is dropped.
+inline float2 derivative(const float2 value, const unsigned index, const int component, const float scale){
+  unsigned freq = (index >> (component * LOGN)) & (N - 1);
+  float k = (freq < (N / 2)) ? (float)freq : (freq == (N / 2)) ? 0.0f : (float)((int)freq - N);
+
+  float2 res;
+  res.x = -value.y * scale * k;
+  res.y = value.x * scale * k;
+  return res;
+}
+
+// component is negative for the forward transform, which is not multiplied
+kernel void fetch_gradient(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict src,
+  const int component, const float scale) {
+  unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 __attribute__((memory, numbanks(8))) buf[2][N];
+
+  // additional iterations to fill the buffers
+  for(unsigned step = 0; step < (N * DEPTH) + delay; step++){
+
+    unsigned where = (step & ((N * DEPTH) - 1)) * 8;
+
+    float2x8 data;
+    if (step < (N * DEPTH)) {
+      data.i0 = src[where + 0];
+      data.i1 = src[where + 1];
+      data.i2 = src[where + 2];
+      data.i3 = src[where + 3];
+      data.i4 = src[where + 4];
+      data.i5 = src[where + 5];
+      data.i6 = src[where + 6];
+      data.i7 = src[where + 7];
+
+      if (component >= 0) {
+        data.i0 = derivative(data.i0, where + 0, component, scale);
+        data.i1 = derivative(data.i1, where + 1, component, scale);
+        data.i2 = derivative(data.i2, where + 2, component, scale);
+        data.i3 = derivative(data.i3, where + 3, component, scale);
+        data.i4 = derivative(data.i4, where + 4, component, scale);
+        data.i5 = derivative(data.i5, where + 5, component, scale);
+        data.i6 = derivative(data.i6, where + 6, component, scale);
+        data.i7 = derivative(data.i7, where + 7, component, scale);
+      }
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0] : buf[1],
+      is_bitrevA ? buf[1] : buf[0],
+      row);
+
+    if (step >= delay) {
+      write_channel_intel(chaninfft3da[0], data.i0);
+      write_channel_intel(chaninfft3da[1], data.i1);
+      write_channel_intel(chaninfft3da[2], data.i2);
+      write_channel_intel(chaninfft3da[3], data.i3);
+      write_channel_intel(chaninfft3da[4], data.i4);
+      write_channel_intel(chaninfft3da[5], data.i5);
+      write_channel_intel(chaninfft3da[6], data.i6);
+      write_channel_intel(chaninfft3da[7], data.i7);
+    }
+  }
+}
@@ -0,0 +1,146 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose, pruned for inputs that are zero
+// outside of a subcube and outputs of which only a subcube is required.
+// fetch reads the subcube [0, m_in)^3 of the input, packed as an m_in^3
+// cube, and synthesizes the zeros around it without accessing memory. store
+// writes only the subcube [0, m_out)^3 of the output, packed as an m_out^3
+// cube.
+
+#define PRUNED
+#include "fft3d_ddr.cl"
+
+// point (z, y, x) of the cube, zero outside of the input subcube
+inline float2 load_pruned(__global volatile float2 * restrict src, const unsigned m, const unsigned z, const unsigned y, const unsigned x){
+  return (z < m && y < m && x < m) ? src[(z * m + y) * m + x] : (float2)(0.0f, 0.0f);
+}
+
+// point (z, y, x) of the cube, dropped outside of the output subcube
+inline void store_pruned_pt(__global volatile float2 * restrict dest, const unsigned m, const unsigned z, const unsigned y, const unsigned x, const float2 value){
+  if (z < m && y < m && x < m)
+    dest[(z * m + y) * m + x] = value;
+}
+
+// m_in is N for dense inputs
+kernel void fetch_pruned(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict src,
+  const unsigned m_in) {
+  unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 __attribute__((memory, numbanks(8))) buf[2][N];
+
+  // additional iterations to fill the buffers
+  for(unsigned step = 0; step < (N * DEPTH) + delay; step++){
+
+    unsigned where = (step & ((N * DEPTH) - 1)) * 8;
+    unsigned xdim = where & (N - 1);
+    unsigned ydim = (where >> LOGN) & (N - 1);
+    unsigned zdim = (where >> (LOGN + LOGN)) & (N - 1);
+
+    float2x8 data;
+    if (step < (N * DEPTH)) {
+      data.i0 = load_pruned(src, m_in, zdim, ydim, xdim + 0);
+      data.i1 = load_pruned(src, m_in, zdim, ydim, xdim + 1);
+      data.i2 = load_pruned(src, m_in, zdim, ydim, xdim + 2);
+      data.i3 = load_pruned(src, m_in, zdim, ydim, xdim + 3);
+      data.i4 = load_pruned(src, m_in, zdim, ydim, xdim + 4);
+      data.i5 = load_pruned(src, m_in, zdim, ydim, xdim + 5);
+      data.i6 = load_pruned(src, m_in, zdim, ydim, xdim + 6);
+      data.i7 = load_pruned(src, m_in, zdim, ydim, xdim + 7);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0] : buf[1],
+      is_bitrevA ? buf[1] : buf[0],
+      row);
+
+    if (step >= delay) {
+      write_channel_intel(chaninfft3da[0], data.i0);
+      write_channel_intel(chaninfft3da[1], data.i1);
+      write_channel_intel(chaninfft3da[2], data.i2);
+      write_channel_intel(chaninfft3da[3], data.i3);
+      write_channel_intel(chaninfft3da[4], data.i4);
+      write_channel_intel(chaninfft3da[5], data.i5);
+      write_channel_intel(chaninfft3da[6], data.i6);
+      write_channel_intel(chaninfft3da[7], data.i7);
+    }
+  }
+}
+
+// m_out is N for dense outputs
+kernel void store_pruned(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict dest,
+  const unsigned m_out) {
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bufA = false, is_bitrevA = false;
+
+  float2 buf[2][DEPTH][POINTS];
+  float2 bitrev_in[2][N];
+
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data.i0 = read_channel_intel(chaninStore[0]);
+      data.i1 = read_channel_intel(chaninStore[1]);
+      data.i2 = read_channel_intel(chaninStore[2]);
+      data.i3 = read_channel_intel(chaninStore[3]);
+      data.i4 = read_channel_intel(chaninStore[4]);
+      data.i5 = read_channel_intel(chaninStore[5]);
+      data.i6 = read_channel_intel(chaninStore[6]);
+      data.i7 = read_channel_intel(chaninStore[7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+    // Swap buffers every N*N/8 iterations
+    // starting from the additional delay of N/8 iterations
+    is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    writeBuf(data,
+      is_bufA ? buf[0] : buf[1],
+      step, 0);
+
+    data_out = readBuf_store(
+      is_bufA ? buf[1] : buf[0],
+      step);
+
+    if (step >= (DEPTH)) {
+      unsigned start_index = (step - DEPTH);
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned zdim = (start_index >> (LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (start_index >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // incremenet by 8 until N / 8
+      unsigned xdim = (start_index * 8) & ( N - 1);
+
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 0, data_out.i0);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 1, data_out.i1);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 2, data_out.i2);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 3, data_out.i3);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 4, data_out.i4);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 5, data_out.i5);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 6, data_out.i6);
+      store_pruned_pt(dest, m_out, zdim, ydim, xdim + 7, data_out.i7);
+    }
+  }
+}
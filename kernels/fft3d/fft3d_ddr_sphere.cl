@@ -0,0 +1,156 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose, whose fetch scatters coefficients
+// packed inside a cutoff sphere into the cube and whose store gathers the
+// sphere from the cube. The slot map, resident in global memory, holds for
+// each point of the cube in natural order the position of its coefficient in
+// the packed array, or -1 if the point lies outside of the sphere.
+
+#define SPHERE
+#include "fft3d_ddr.cl"
+
+// point of the cube read by fetch, zero outside of the sphere if scattering
+inline float2 load_sphere(__global volatile float2 * restrict src, __global const int * restrict slot, const unsigned index, const int sphere){
+  if (!sphere)
+    return src[index];
+
+  int where = slot[index];
+  return (where >= 0) ? src[where] : (float2)(0.0f, 0.0f);
+}
+
+// point of the cube written by store, dropped outside of the sphere if gathering
+inline void store_sphere_pt(__global volatile float2 * restrict dest, __global const int * restrict slot, const unsigned index, const float2 value, const int sphere){
+  if (!sphere) {
+    dest[index] = value;
+    return;
+  }
+
+  int where = slot[index];
+  if (where >= 0)
+    dest[where] = value;
+}
+
+// sphere is 1 if src holds the packed coefficients, 0 for a dense cube
+kernel void fetch_sphere(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict src,
+  __global __attribute__((buffer_location(DDR_BUFFER_LOCATION))) const int * restrict slot,
+  const int sphere) {
+  unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 __attribute__((memory, numbanks(8))) buf[2][N];
+
+  // additional iterations to fill the buffers
+  for(unsigned step = 0; step < (N * DEPTH) + delay; step++){
+
+    unsigned where = (step & ((N * DEPTH) - 1)) * 8;
+
+    float2x8 data;
+    if (step < (N * DEPTH)) {
+      data.i0 = load_sphere(src, slot, where + 0, sphere);
+      data.i1 = load_sphere(src, slot, where + 1, sphere);
+      data.i2 = load_sphere(src, slot, where + 2, sphere);
+      data.i3 = load_sphere(src, slot, where + 3, sphere);
+      data.i4 = load_sphere(src, slot, where + 4, sphere);
+      data.i5 = load_sphere(src, slot, where + 5, sphere);
+      data.i6 = load_sphere(src, slot, where + 6, sphere);
+      data.i7 = load_sphere(src, slot, where + 7, sphere);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0] : buf[1],
+      is_bitrevA ? buf[1] : buf[0],
+      row);
+
+    if (step >= delay) {
+      write_channel_intel(chaninfft3da[0], data.i0);
+      write_channel_intel(chaninfft3da[1], data.i1);
+      write_channel_intel(chaninfft3da[2], data.i2);
+      write_channel_intel(chaninfft3da[3], data.i3);
+      write_channel_intel(chaninfft3da[4], data.i4);
+      write_channel_intel(chaninfft3da[5], data.i5);
+      write_channel_intel(chaninfft3da[6], data.i6);
+      write_channel_intel(chaninfft3da[7], data.i7);
+    }
+  }
+}
+
+// sphere is 1 if dest receives the packed coefficients, 0 for a dense cube
+kernel void store_sphere(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict dest,
+  __global __attribute__((buffer_location(DDR_BUFFER_LOCATION))) const int * restrict slot,
+  const int sphere) {
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bufA = false, is_bitrevA = false;
+
+  float2 buf[2][DEPTH][POINTS];
+  float2 bitrev_in[2][N];
+
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data.i0 = read_channel_intel(chaninStore[0]);
+      data.i1 = read_channel_intel(chaninStore[1]);
+      data.i2 = read_channel_intel(chaninStore[2]);
+      data.i3 = read_channel_intel(chaninStore[3]);
+      data.i4 = read_channel_intel(chaninStore[4]);
+      data.i5 = read_channel_intel(chaninStore[5]);
+      data.i6 = read_channel_intel(chaninStore[6]);
+      data.i7 = read_channel_intel(chaninStore[7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+    // Swap buffers every N*N/8 iterations
+    // starting from the additional delay of N/8 iterations
+    is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    writeBuf(data,
+      is_bufA ? buf[0] : buf[1],
+      step, 0);
+
+    data_out = readBuf_store(
+      is_bufA ? buf[1] : buf[0],
+      step);
+
+    if (step >= (DEPTH)) {
+      unsigned start_index = (step - DEPTH);
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned zdim = (start_index >> (LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (start_index >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // incremenet by 8 until N / 8
+      unsigned xdim = (start_index * 8) & ( N - 1);
+
+      unsigned index = (zdim * N * N) + (ydim * N) + xdim;
+
+      store_sphere_pt(dest, slot, index + 0, data_out.i0, sphere);
+      store_sphere_pt(dest, slot, index + 1, data_out.i1, sphere);
+      store_sphere_pt(dest, slot, index + 2, data_out.i2, sphere);
+      store_sphere_pt(dest, slot, index + 3, data_out.i3, sphere);
+      store_sphere_pt(dest, slot, index + 4, data_out.i4, sphere);
+      store_sphere_pt(dest, slot, index + 5, data_out.i5, sphere);
+      store_sphere_pt(dest, slot, index + 6, data_out.i6, sphere);
+      store_sphere_pt(dest, slot, index + 7, data_out.i7, sphere);
+    }
+  }
+}
@@ -0,0 +1,138 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose on split complex data, whose real
+// and imaginary parts are in separate buffers. fetch reads both parts and
+// store writes both, each from its own bank, in place of interleaved points.
+
+#define SPLIT
+#include "fft3d_ddr.cl"
+
+kernel void fetch_split(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float * restrict src_re,
+  __global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float * restrict src_im) {
+  unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 __attribute__((memory, numbanks(8))) buf[2][N];
+
+  // additional iterations to fill the buffers
+  for(unsigned step = 0; step < (N * DEPTH) + delay; step++){
+
+    unsigned where = (step & ((N * DEPTH) - 1)) * 8;
+
+    float2x8 data;
+    if (step < (N * DEPTH)) {
+      data.i0 = (float2)(src_re[where + 0], src_im[where + 0]);
+      data.i1 = (float2)(src_re[where + 1], src_im[where + 1]);
+      data.i2 = (float2)(src_re[where + 2], src_im[where + 2]);
+      data.i3 = (float2)(src_re[where + 3], src_im[where + 3]);
+      data.i4 = (float2)(src_re[where + 4], src_im[where + 4]);
+      data.i5 = (float2)(src_re[where + 5], src_im[where + 5]);
+      data.i6 = (float2)(src_re[where + 6], src_im[where + 6]);
+      data.i7 = (float2)(src_re[where + 7], src_im[where + 7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0] : buf[1],
+      is_bitrevA ? buf[1] : buf[0],
+      row);
+
+    if (step >= delay) {
+      write_channel_intel(chaninfft3da[0], data.i0);
+      write_channel_intel(chaninfft3da[1], data.i1);
+      write_channel_intel(chaninfft3da[2], data.i2);
+      write_channel_intel(chaninfft3da[3], data.i3);
+      write_channel_intel(chaninfft3da[4], data.i4);
+      write_channel_intel(chaninfft3da[5], data.i5);
+      write_channel_intel(chaninfft3da[6], data.i6);
+      write_channel_intel(chaninfft3da[7], data.i7);
+    }
+  }
+}
+
+kernel void store_split(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float * restrict dest_re,
+  __global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float * restrict dest_im) {
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bufA = false, is_bitrevA = false;
+
+  float2 buf[2][DEPTH][POINTS];
+  float2 bitrev_in[2][N];
+
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data.i0 = read_channel_intel(chaninStore[0]);
+      data.i1 = read_channel_intel(chaninStore[1]);
+      data.i2 = read_channel_intel(chaninStore[2]);
+      data.i3 = read_channel_intel(chaninStore[3]);
+      data.i4 = read_channel_intel(chaninStore[4]);
+      data.i5 = read_channel_intel(chaninStore[5]);
+      data.i6 = read_channel_intel(chaninStore[6]);
+      data.i7 = read_channel_intel(chaninStore[7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+    // Swap buffers every N*N/8 iterations
+    // starting from the additional delay of N/8 iterations
+    is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    writeBuf(data,
+      is_bufA ? buf[0] : buf[1],
+      step, 0);
+
+    data_out = readBuf_store(
+      is_bufA ? buf[1] : buf[0],
+      step);
+
+    if (step >= (DEPTH)) {
+      unsigned start_index = (step - DEPTH);
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned zdim = (start_index >> (LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (start_index >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // incremenet by 8 until N / 8
+      unsigned xdim = (start_index * 8) & ( N - 1);
+
+      unsigned index = (zdim * N * N) + (ydim * N) + xdim;
+
+      dest_re[index + 0] = data_out.i0.x;
+      dest_re[index + 1] = data_out.i1.x;
+      dest_re[index + 2] = data_out.i2.x;
+      dest_re[index + 3] = data_out.i3.x;
+      dest_re[index + 4] = data_out.i4.x;
+      dest_re[index + 5] = data_out.i5.x;
+      dest_re[index + 6] = data_out.i6.x;
+      dest_re[index + 7] = data_out.i7.x;
+
+      dest_im[index + 0] = data_out.i0.y;
+      dest_im[index + 1] = data_out.i1.y;
+      dest_im[index + 2] = data_out.i2.y;
+      dest_im[index + 3] = data_out.i3.y;
+      dest_im[index + 4] = data_out.i4.y;
+      dest_im[index + 5] = data_out.i5.y;
+      dest_im[index + 6] = data_out.i6.y;
+      dest_im[index + 7] = data_out.i7.y;
+    }
+  }
+}
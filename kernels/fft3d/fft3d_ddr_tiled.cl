@@ -0,0 +1,10 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose, whose cube in the DDR is stored with
+// y and z swapped. The read of transpose3D, iterating over z for each y, is a
+// single burst over the cube instead of bursts of N points, while the write,
+// iterating over y for each z, issues bursts of N points instead of a
+// contiguous plane. The output is identical to fft3d_ddr.cl.
+
+#define TILED
+#include "fft3d_ddr.cl"
@@ -0,0 +1,62 @@
+// Author: Arjun Ramaswami
+
+// 3D FFT using the DDR for 3D Transpose, whose output is left transposed in
+// x-y-z order instead of being reordered on chip. transpose3D writes to the
+// DDR without reordering, and store writes the output of fft3dc as it
+// arrives. Both on chip buffers of N * N points are removed. Transforming the
+// transposed output returns to the natural order, such that forward and
+// backward transforms of a round trip use the same bitstream.
+
+#define TRANSPOSED
+#include "fft3d_ddr.cl"
+
+kernel void store_transposed(__global __attribute__((buffer_location(SVM_HOST_BUFFER_LOCATION))) volatile float2 * restrict dest) {
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 bitrev_in[2][N];
+
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the bitrev buffer
+  for(int step = -initial_delay; step < (N * DEPTH); step++){
+
+    float2x8 data;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data.i0 = read_channel_intel(chaninStore[0]);
+      data.i1 = read_channel_intel(chaninStore[1]);
+      data.i2 = read_channel_intel(chaninStore[2]);
+      data.i3 = read_channel_intel(chaninStore[3]);
+      data.i4 = read_channel_intel(chaninStore[4]);
+      data.i5 = read_channel_intel(chaninStore[5]);
+      data.i6 = read_channel_intel(chaninStore[6]);
+      data.i7 = read_channel_intel(chaninStore[7]);
+    } else {
+      data.i0 = data.i1 = data.i2 = data.i3 =
+                data.i4 = data.i5 = data.i6 = data.i7 = 0;
+    }
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    // rows along z in x-y-z order
+    if (step >= 0) {
+      unsigned index = step * 8;
+
+      dest[index + 0] = data.i0;
+      dest[index + 1] = data.i1;
+      dest[index + 2] = data.i2;
+      dest[index + 3] = data.i3;
+      dest[index + 4] = data.i4;
+      dest[index + 5] = data.i5;
+      dest[index + 6] = data.i6;
+      dest[index + 7] = data.i7;
+    }
+  }
+}
@@ -0,0 +1,543 @@
+// Author: Arjun Ramaswami
+
+#include "fft_config.h"
+#include "../common/fft_8.cl" 
+#include "../matrixTranspose/diagonal_bitrev.cl"
+
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+/* Persistent variant of fft3d_bram: the FFT engines and the transposes are
+ * autorun kernels looping over transforms, so that only fetch_persistent and
+ * store_persistent are launched per request. fetch_persistent sends the
+ * direction of each transform to the engines ahead of its points.
+ */
+
+channel float2 chaninfft3da[POINTS];
+channel float2 chaninfft3db[POINTS];
+channel float2 chaninfft3dc[POINTS];
+
+channel float2 chaninTranspose[POINTS];
+channel float2 chaninTranspose3D[POINTS];
+
+channel float2 chaninTranStore[POINTS];
+
+channel int chaninva __attribute__((depth(4)));
+channel int chaninvb __attribute__((depth(4)));
+channel int chaninvc __attribute__((depth(4)));
+
+// Kernel that fetches how_many transforms from global memory, launched per request
+kernel void fetch_persistent(global volatile float2 * restrict src, const int inverse, const unsigned how_many) {
+  for(unsigned k = 0; k < how_many; k++){
+    const unsigned offset = k * N * N * N;
+
+    // the engines read the direction before the points of the transform
+    write_channel_intel(chaninva, inverse);
+    write_channel_intel(chaninvb, inverse);
+    write_channel_intel(chaninvc, inverse);
+
+    unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
+    bool is_bitrevA = false;
+
+    float2 __attribute__((memory, numbanks(8))) buf[2][N];
+  
+    // additional iterations to fill the buffers
+    for(unsigned step = 0; step < (N * DEPTH) + delay; step++){
+
+      unsigned where = (step & ((N * DEPTH) - 1)) * 8; 
+
+      float2x8 data;
+      if (step < (N * DEPTH)) {
+        data.i0 = src[offset + where + 0];
+        data.i1 = src[offset + where + 1];
+        data.i2 = src[offset + where + 2];
+        data.i3 = src[offset + where + 3];
+        data.i4 = src[offset + where + 4];
+        data.i5 = src[offset + where + 5];
+        data.i6 = src[offset + where + 6];
+        data.i7 = src[offset + where + 7];
+      } else {
+        data.i0 = data.i1 = data.i2 = data.i3 = 
+                  data.i4 = data.i5 = data.i6 = data.i7 = 0;
+      }
+
+      is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+      unsigned row = step & (DEPTH - 1);
+      data = bitreverse_fetch(data,
+        is_bitrevA ? buf[0] : buf[1], 
+        is_bitrevA ? buf[1] : buf[0], 
+        row);
+
+      if (step >= delay) {
+        write_channel_intel(chaninfft3da[0], data.i0);
+        write_channel_intel(chaninfft3da[1], data.i1);
+        write_channel_intel(chaninfft3da[2], data.i2);
+        write_channel_intel(chaninfft3da[3], data.i3);
+        write_channel_intel(chaninfft3da[4], data.i4);
+        write_channel_intel(chaninfft3da[5], data.i5);
+        write_channel_intel(chaninfft3da[6], data.i6);
+        write_channel_intel(chaninfft3da[7], data.i7);
+      }
+    }
+  }
+}
+
+/* This single work-item task wraps the FFT engine
+ * 'inverse' read from the control channel toggles between the direct and
+ * the inverse transform
+ */
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+kernel void fft3da() {
+  /* The FFT engine requires a sliding window for data reordering; data stored
+   * in this array is carried across loop iterations and shifted by 1 element
+   * every iteration; all loop dependencies derived from the uses of this 
+   * array are simple transfers between adjacent array elements
+   */
+
+  float2 fft_delay_elements[N + POINTS * (LOGN - 2)];
+
+  while(1){
+    // direction of the next transform, sent by fetch_persistent
+    const int inverse = read_channel_intel(chaninva);
+
+    #pragma loop_coalesce
+    for(unsigned j = 0; j < N; j++){
+      for (unsigned i = 0; i < N * (N / POINTS) + N / POINTS - 1; i++) {
+        float2x8 data;
+
+        if (i < N * (N / POINTS)) {
+          data.i0 = read_channel_intel(chaninfft3da[0]);
+          data.i1 = read_channel_intel(chaninfft3da[1]);
+          data.i2 = read_channel_intel(chaninfft3da[2]);
+          data.i3 = read_channel_intel(chaninfft3da[3]);
+          data.i4 = read_channel_intel(chaninfft3da[4]);
+          data.i5 = read_channel_intel(chaninfft3da[5]);
+          data.i6 = read_channel_intel(chaninfft3da[6]);
+          data.i7 = read_channel_intel(chaninfft3da[7]);
+        } 
+        else {
+          data.i0 = data.i1 = data.i2 = data.i3 = 
+                    data.i4 = data.i5 = data.i6 = data.i7 = 0;
+        }
+
+        data = fft_step(data, i % (N / POINTS), fft_delay_elements, inverse, LOGN);
+
+        // Write result to channels
+        if (i >= N / POINTS - 1) {
+          write_channel_intel(chaninTranspose[0], data.i0);
+          write_channel_intel(chaninTranspose[1], data.i1);
+          write_channel_intel(chaninTranspose[2], data.i2);
+          write_channel_intel(chaninTranspose[3], data.i3);
+          write_channel_intel(chaninTranspose[4], data.i4);
+          write_channel_intel(chaninTranspose[5], data.i5);
+          write_channel_intel(chaninTranspose[6], data.i6);
+          write_channel_intel(chaninTranspose[7], data.i7);
+        }
+      }
+    }
+  }
+}
+
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+kernel void transpose2d() {
+  while(1){
+    const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+    bool is_bufA = false, is_bitrevA = false;
+
+    float2 buf[2][DEPTH][POINTS];
+    //float2 bitrev_in[2][N], bitrev_out[2][N];
+    //float2 __attribute__((memory, numbanks(8))) bitrev_in[2][N];
+    float2 bitrev_in[2][N];
+    float2 __attribute__((memory, numbanks(8))) bitrev_out[2][N];
+  
+    int initial_delay = DELAY + DELAY; // for each of the bitrev buffer
+
+    // additional iterations to fill the buffers
+    for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+      float2x8 data, data_out;
+      if (step < ((N * DEPTH) - initial_delay)) {
+        data.i0 = read_channel_intel(chaninTranspose[0]);
+        data.i1 = read_channel_intel(chaninTranspose[1]);
+        data.i2 = read_channel_intel(chaninTranspose[2]);
+        data.i3 = read_channel_intel(chaninTranspose[3]);
+        data.i4 = read_channel_intel(chaninTranspose[4]);
+        data.i5 = read_channel_intel(chaninTranspose[5]);
+        data.i6 = read_channel_intel(chaninTranspose[6]);
+        data.i7 = read_channel_intel(chaninTranspose[7]);
+      } else {
+        data.i0 = data.i1 = data.i2 = data.i3 = 
+                  data.i4 = data.i5 = data.i6 = data.i7 = 0;
+      }
+
+      // Swap buffers every N*N/8 iterations 
+      // starting from the additional delay of N/8 iterations
+      is_bufA = (( (step + DELAY) & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+      // Swap bitrev buffers every N/8 iterations
+      is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+      unsigned row = step & (DEPTH - 1);
+      data = bitreverse_in(data,
+        is_bitrevA ? bitrev_in[0] : bitrev_in[1], 
+        is_bitrevA ? bitrev_in[1] : bitrev_in[0], 
+        row);
+
+      writeBuf(data,
+        is_bufA ? buf[0] : buf[1],
+        step, DELAY);
+
+      data_out = readBuf(
+        is_bufA ? buf[1] : buf[0], 
+        step);
+
+      unsigned start_row = (step + DELAY) & (DEPTH -1);
+      data_out = bitreverse_out(
+        is_bitrevA ? bitrev_out[0] : bitrev_out[1],
+        is_bitrevA ? bitrev_out[1] : bitrev_out[0],
+        data_out, start_row);
+
+
+      if (step >= (DEPTH)) {
+        write_channel_intel(chaninfft3db[0], data_out.i0);
+        write_channel_intel(chaninfft3db[1], data_out.i1);
+        write_channel_intel(chaninfft3db[2], data_out.i2);
+        write_channel_intel(chaninfft3db[3], data_out.i3);
+        write_channel_intel(chaninfft3db[4], data_out.i4);
+        write_channel_intel(chaninfft3db[5], data_out.i5);
+        write_channel_intel(chaninfft3db[6], data_out.i6);
+        write_channel_intel(chaninfft3db[7], data_out.i7);
+      }
+    }
+  }
+}
+
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+kernel void fft3db() {
+  /* The FFT engine requires a sliding window for data reordering; data stored
+   * in this array is carried across loop iterations and shifted by 1 element
+   * every iteration; all loop dependencies derived from the uses of this 
+   * array are simple transfers between adjacent array elements
+   */
+
+  float2 fft_delay_elements[N + POINTS * (LOGN - 2)];
+
+  while(1){
+    // direction of the next transform, sent by fetch_persistent
+    const int inverse = read_channel_intel(chaninvb);
+
+    #pragma loop_coalesce
+    for(unsigned j = 0; j < N; j++){
+      for (unsigned i = 0; i < N * (N / POINTS) + N / POINTS - 1; i++) {
+        float2x8 data;
+
+        if (i < N * (N / POINTS)) {
+          data.i0 = read_channel_intel(chaninfft3db[0]);
+          data.i1 = read_channel_intel(chaninfft3db[1]);
+          data.i2 = read_channel_intel(chaninfft3db[2]);
+          data.i3 = read_channel_intel(chaninfft3db[3]);
+          data.i4 = read_channel_intel(chaninfft3db[4]);
+          data.i5 = read_channel_intel(chaninfft3db[5]);
+          data.i6 = read_channel_intel(chaninfft3db[6]);
+          data.i7 = read_channel_intel(chaninfft3db[7]);
+        } else {
+          data.i0 = data.i1 = data.i2 = data.i3 = 
+                    data.i4 = data.i5 = data.i6 = data.i7 = 0;
+        }
+
+        data = fft_step(data, i % (N / POINTS), fft_delay_elements, inverse, LOGN);
+
+        if (i >= N / POINTS - 1) {
+          write_channel_intel(chaninTranspose3D[0], data.i0);
+          write_channel_intel(chaninTranspose3D[1], data.i1);
+          write_channel_intel(chaninTranspose3D[2], data.i2);
+          write_channel_intel(chaninTranspose3D[3], data.i3);
+          write_channel_intel(chaninTranspose3D[4], data.i4);
+          write_channel_intel(chaninTranspose3D[5], data.i5);
+          write_channel_intel(chaninTranspose3D[6], data.i6);
+          write_channel_intel(chaninTranspose3D[7], data.i7);
+        }
+      }
+    }
+  }
+}
+
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+kernel void transpose3D() {
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+
+  float2 buf[2][DEPTH][POINTS];
+  local float2 buf3D[N * N * N];
+  float2 bitrev_in[2][N];
+
+  while(1){
+    bool is_bufA = false, is_bitrevA = false;
+
+    int initial_delay = DELAY; // for each of the bitrev buffer
+    // additional iterations to fill the buffers
+    for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+      float2x8 data, data_out;
+      if (step < ((N * DEPTH) - initial_delay)) {
+        data.i0 = read_channel_intel(chaninTranspose3D[0]);
+        data.i1 = read_channel_intel(chaninTranspose3D[1]);
+        data.i2 = read_channel_intel(chaninTranspose3D[2]);
+        data.i3 = read_channel_intel(chaninTranspose3D[3]);
+        data.i4 = read_channel_intel(chaninTranspose3D[4]);
+        data.i5 = read_channel_intel(chaninTranspose3D[5]);
+        data.i6 = read_channel_intel(chaninTranspose3D[6]);
+        data.i7 = read_channel_intel(chaninTranspose3D[7]);
+      } else {
+        data.i0 = data.i1 = data.i2 = data.i3 = 
+                  data.i4 = data.i5 = data.i6 = data.i7 = 0;
+      }
+      // Swap buffers every N*N/8 iterations 
+      // starting from the additional delay of N/8 iterations
+      is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+      // Swap bitrev buffers every N/8 iterations
+      is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+      unsigned row = step & (DEPTH - 1);
+      data = bitreverse_in(data,
+        is_bitrevA ? bitrev_in[0] : bitrev_in[1], 
+        is_bitrevA ? bitrev_in[1] : bitrev_in[0], 
+        row);
+
+      writeBuf(data,
+        is_bufA ? buf[0] : buf[1],
+        step, 0);
+
+      data_out = readBuf_store(
+        is_bufA ? buf[1] : buf[0], 
+        step);
+
+      if (step >= (DEPTH)) {
+        unsigned index = (step - DEPTH) * 8;
+
+        buf3D[index + 0] = data_out.i0;
+        buf3D[index + 1] = data_out.i1;
+        buf3D[index + 2] = data_out.i2;
+        buf3D[index + 3] = data_out.i3;
+        buf3D[index + 4] = data_out.i4;
+        buf3D[index + 5] = data_out.i5;
+        buf3D[index + 6] = data_out.i6;
+        buf3D[index + 7] = data_out.i7;
+      }
+    }
+
+    is_bufA = false;
+    is_bitrevA = false;
+  
+    float2 __attribute__((memory, numbanks(8))) bitrev_out[2][N];
+  
+    // additional iterations to fill the buffers
+    for(unsigned step = 0; step < (N * DEPTH) + DEPTH + DELAY; step++){
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned start_index = step + DELAY;
+      unsigned zdim = (step >> (LOGN - LOGPOINTS)) & (N - 1); 
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (step >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment by 8 until N / 8
+      unsigned xdim = (step * 8) & (N - 1);
+
+      // increment by 1 every N*N*N / 8 steps
+      unsigned batch_index = (step >> (LOGN + LOGN + LOGN - LOGPOINTS));
+
+      unsigned index = (batch_index * N * N * N) + (zdim * N * N) + (ydim * N) + xdim; 
+
+      float2x8 data, data_out;
+      if (step < (N * DEPTH)) {
+        data.i0 = buf3D[index + 0];
+        data.i1 = buf3D[index + 1];
+        data.i2 = buf3D[index + 2];
+        data.i3 = buf3D[index + 3];
+        data.i4 = buf3D[index + 4];
+        data.i5 = buf3D[index + 5];
+        data.i6 = buf3D[index + 6];
+        data.i7 = buf3D[index + 7];
+      } else {
+        data.i0 = data.i1 = data.i2 = data.i3 = 
+                  data.i4 = data.i5 = data.i6 = data.i7 = 0;
+      }
+  
+      is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+      // Swap bitrev buffers every N/8 iterations
+      is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+      writeBuf(data,
+        is_bufA ? buf[0] : buf[1],
+        step, 0);
+
+      data_out = readBuf_fetch(
+        is_bufA ? buf[1] : buf[0], 
+        step, 0);
+
+      unsigned start_row = step & (DEPTH -1);
+      data_out = bitreverse_out(
+        is_bitrevA ? bitrev_out[0] : bitrev_out[1],
+        is_bitrevA ? bitrev_out[1] : bitrev_out[0],
+        data_out, start_row);
+
+      if (step >= (DEPTH + DELAY)) {
+
+        write_channel_intel(chaninfft3dc[0], data_out.i0);
+        write_channel_intel(chaninfft3dc[1], data_out.i1);
+        write_channel_intel(chaninfft3dc[2], data_out.i2);
+        write_channel_intel(chaninfft3dc[3], data_out.i3);
+        write_channel_intel(chaninfft3dc[4], data_out.i4);
+        write_channel_intel(chaninfft3dc[5], data_out.i5);
+        write_channel_intel(chaninfft3dc[6], data_out.i6);
+        write_channel_intel(chaninfft3dc[7], data_out.i7);
+      }
+    }
+  }
+}
+
+/*
+ * Input and output data in bit-reversed format
+ */
+__attribute__((max_global_work_dim(0)))
+__attribute__((autorun))
+kernel void fft3dc() {
+  /* The FFT engine requires a sliding window for data reordering; data stored
+   * in this array is carried across loop iterations and shifted by 1 element
+   * every iteration; all loop dependencies derived from the uses of this 
+   * array are simple transfers between adjacent array elements
+   */
+
+  float2 fft_delay_elements[N + POINTS * (LOGN - 2)];
+
+  while(1){
+    // direction of the next transform, sent by fetch_persistent
+    const int inverse = read_channel_intel(chaninvc);
+
+    #pragma loop_coalesce
+    for(unsigned j = 0; j < N; j++){
+
+      for (unsigned i = 0; i < N * (N / POINTS) + N / POINTS - 1; i++) {
+        float2x8 data;
+
+        if (i < N * (N / POINTS)) {
+          data.i0 = read_channel_intel(chaninfft3dc[0]);
+          data.i1 = read_channel_intel(chaninfft3dc[1]);
+          data.i2 = read_channel_intel(chaninfft3dc[2]);
+          data.i3 = read_channel_intel(chaninfft3dc[3]);
+          data.i4 = read_channel_intel(chaninfft3dc[4]);
+          data.i5 = read_channel_intel(chaninfft3dc[5]);
+          data.i6 = read_channel_intel(chaninfft3dc[6]);
+          data.i7 = read_channel_intel(chaninfft3dc[7]);
+        } else {
+          data.i0 = data.i1 = data.i2 = data.i3 = 
+                    data.i4 = data.i5 = data.i6 = data.i7 = 0;
+        }
+
+        // Perform one FFT step
+        data = fft_step(data, i % (N / POINTS), fft_delay_elements, inverse, LOGN);
+
+        // Write result to channels
+        if (i >= N / POINTS - 1) {
+          write_channel_intel(chaninTranStore[0], data.i0);
+          write_channel_intel(chaninTranStore[1], data.i1);
+          write_channel_intel(chaninTranStore[2], data.i2);
+          write_channel_intel(chaninTranStore[3], data.i3);
+          write_channel_intel(chaninTranStore[4], data.i4);
+          write_channel_intel(chaninTranStore[5], data.i5);
+          write_channel_intel(chaninTranStore[6], data.i6);
+          write_channel_intel(chaninTranStore[7], data.i7);
+        }
+      }
+    }
+  }
+}
+
+kernel void store_persistent(global float2 * restrict dest, const unsigned how_many) {
+  for(unsigned k = 0; k < how_many; k++){
+    const unsigned offset = k * N * N * N;
+
+    const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+    bool is_bufA = false, is_bitrevA = false;
+
+    float2 buf[2][DEPTH][POINTS];
+    float2 bitrev_in[2][N];
+    //float2 __attribute__((memory, numbanks(8))) bitrev_in[2][N];
+  
+    int initial_delay = DELAY; // for each of the bitrev buffer
+    // additional iterations to fill the buffers
+    for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+      float2x8 data, data_out;
+      if (step < ((N * DEPTH) - initial_delay)) {
+        data.i0 = read_channel_intel(chaninTranStore[0]);
+        data.i1 = read_channel_intel(chaninTranStore[1]);
+        data.i2 = read_channel_intel(chaninTranStore[2]);
+        data.i3 = read_channel_intel(chaninTranStore[3]);
+        data.i4 = read_channel_intel(chaninTranStore[4]);
+        data.i5 = read_channel_intel(chaninTranStore[5]);
+        data.i6 = read_channel_intel(chaninTranStore[6]);
+        data.i7 = read_channel_intel(chaninTranStore[7]);
+      } else {
+        data.i0 = data.i1 = data.i2 = data.i3 = 
+                  data.i4 = data.i5 = data.i6 = data.i7 = 0;
+      }
+      // Swap buffers every N*N/8 iterations 
+      // starting from the additional delay of N/8 iterations
+      is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+      // Swap bitrev buffers every N/8 iterations
+      is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+      unsigned row = step & (DEPTH - 1);
+      data = bitreverse_in(data,
+        is_bitrevA ? bitrev_in[0] : bitrev_in[1], 
+        is_bitrevA ? bitrev_in[1] : bitrev_in[0], 
+        row);
+
+      writeBuf(data,
+        is_bufA ? buf[0] : buf[1],
+        step, 0);
+
+      data_out = readBuf_store(
+        is_bufA ? buf[1] : buf[0], 
+        step);
+
+      if (step >= (DEPTH)) {
+        unsigned start_index = (step - DEPTH);
+        // increment z by 1 every N/8 steps until (N*N/ 8)
+        unsigned zdim = (start_index >> (LOGN - LOGPOINTS)) & (N - 1); 
+
+        // increment y by 1 every N*N/8 points until N
+        unsigned ydim = (start_index >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+        // incremenet by 8 until N / 8
+        unsigned xdim = (start_index * 8) & ( N - 1);
+        //unsigned index = (step - DEPTH) * 8;
+
+        // increment by N*N*N
+        unsigned cube = LOGN + LOGN + LOGN - LOGPOINTS;
+
+        // increment by 1 every N*N*N / 8 steps
+        unsigned batch_index = (start_index >> cube);
+        //unsigned batch_index = 0;
+
+        unsigned index = (batch_index * N * N * N) + (zdim * N * N) + (ydim * N) + xdim; 
+
+        dest[offset + index + 0] = data_out.i0;
+        dest[offset + index + 1] = data_out.i1;
+        dest[offset + index + 2] = data_out.i2;
+        dest[offset + index + 3] = data_out.i3;
+        dest[offset + index + 4] = data_out.i4;
+        dest[offset + index + 5] = data_out.i5;
+        dest[offset + index + 6] = data_out.i6;
+        dest[offset + index + 7] = data_out.i7;
+      }
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,196 @@
+// Author: Arjun Ramaswami
+
+/**
+ * @file fftmodel.h
+ * @brief Host-only software model of the FFT kernel pipeline, bit accurate to the FPGA bitstreams
+ */
+
+#ifndef FFTMODEL_H
+#define FFTMODEL_H
+
+#include <stdbool.h>
+#include "fftfpga/fftfpga.h"
+
+/**
+ * Kernels modelled in the 3D FFT pipeline using the DDR for 3D Transpose, the 1D FFT and the 2D engine of fft_large sharing fetch, transpose and store
+ */
+typedef enum {
+  FFTMODEL_FETCH = 0,
+  FFTMODEL_FFT3DA,
+  FFTMODEL_TRANSPOSE,
+  FFTMODEL_FFT3DB,
+  FFTMODEL_TRANSPOSE3D_WR,
+  FFTMODEL_TRANSPOSE3D_RD,
+  FFTMODEL_FFT3DC,
+  FFTMODEL_STORE,
+  FFTMODEL_FFT1D,
+  FFTMODEL_FFT2D,
+  FFTMODEL_TWIDDLE,
+  FFTMODEL_NUM_KERNELS
+} fftmodel_kernel_t;
+
+/**
+ * Activity of a modelled kernel, summed over all transforms of the last call
+ */
+typedef struct {
+  unsigned long iterations; /**< loop iterations, each one clock cycle at II = 1 */
+  unsigned long stalls;     /**< times the kernel blocked on an empty input or a full output channel */
+  unsigned long bursts;     /**< runs of consecutive addresses accessed in global memory, each one burst of the load or store unit */
+} fftmodel_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  set the depth of the channels between the modelled kernels, in iterations of 8 points. Shallow channels stall the kernels more often, exposing the scheduling of the pipeline.
+ * @param  depth : channel depth, 0 resets to the default of 4096
+ */
+extern void fftmodel_set_channel_depth(const unsigned depth);
+
+/**
+ * @brief  compute out-of-place single precision complex 3D-FFTs on the host by modelling the kernels of the bitstream using the DDR for 3D Transpose, each kernel running on a separate thread. The output is bitwise identical to the FPGA.
+ * @param  N        : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  inp      : float2 pointer to input data of size [N * N * N * how_many]
+ * @param  out      : float2 pointer to output data of size [N * N * N * how_many]
+ * @param  inv      : toggle to activate backward FFT
+ * @param  how_many : number of batched computations
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
+
+/**
+ * @brief  model the bitstream of fftfpgaf_c2c_3d_ddr_transposed(), whose output is transposed to x-y-z order, out[(x * N + y) * N + z] being point (z, y, x) of the transform
+ * @param  N        : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  inp      : float2 pointer to input data of size [N * N * N * how_many]
+ * @param  out      : float2 pointer to output data of size [N * N * N * how_many]
+ * @param  inv      : toggle to activate backward FFT
+ * @param  how_many : number of batched computations
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_ddr_transposed(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
+
+/**
+ * @brief  model the bitstream fft3d_ddr_tiled, storing the cube of transpose3D in the DDR with y and z swapped, with the same output as fftmodelf_c2c_3d_ddr()
+ * @param  N        : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  inp      : float2 pointer to input data of size [N * N * N * how_many]
+ * @param  out      : float2 pointer to output data of size [N * N * N * how_many]
+ * @param  inv      : toggle to activate backward FFT
+ * @param  how_many : number of batched computations
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_ddr_tiled(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many);
+
+/**
+ * @brief  model the bitstream fft3d_ddr_sphere of fftfpgaf_c2c_3d_sphere_to_grid(), whose fetch scatters coefficients packed inside a sphere into the cube
+ * @param  N      : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  map    : index (z * N + y) * N + x in the cube of each packed coefficient, all distinct, as given to fftfpgaf_sphere_set_map()
+ * @param  num    : number of packed coefficients
+ * @param  packed : float2 pointer to the packed coefficients of size [num]
+ * @param  grid   : float2 pointer to output data of size [N * N * N]
+ * @param  inv    : toggle to activate backward FFT
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_sphere_to_grid(const unsigned N, const unsigned *map, const size_t num, const float2 *packed, float2 *grid, const bool inv);
+
+/**
+ * @brief  model the bitstream fft3d_ddr_sphere of fftfpgaf_c2c_3d_grid_to_sphere(), whose store gathers the coefficients inside a sphere from the cube
+ * @param  N      : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  map    : index (z * N + y) * N + x in the cube of each packed coefficient, all distinct, as given to fftfpgaf_sphere_set_map()
+ * @param  num    : number of packed coefficients
+ * @param  grid   : float2 pointer to input data of size [N * N * N]
+ * @param  packed : float2 pointer to the packed coefficients of size [num]
+ * @param  inv    : toggle to activate backward FFT
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_grid_to_sphere(const unsigned N, const unsigned *map, const size_t num, const float2 *grid, float2 *packed, const bool inv);
+
+/**
+ * @brief  model the bitstream fft3d_ddr_pruned of fftfpgaf_c2c_3d_ddr_pruned(), whose fetch zero pads the input subcube and store crops the output subcube
+ * @param  N     : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  m_in  : unsigned integer size of the input subcube, at most N
+ * @param  m_out : unsigned integer size of the output subcube, at most N
+ * @param  inp   : float2 pointer to the input subcube of size [m_in * m_in * m_in]
+ * @param  out   : float2 pointer to the output subcube of size [m_out * m_out * m_out]
+ * @param  inv   : toggle to activate backward FFT
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_ddr_pruned(const unsigned N, const unsigned m_in, const unsigned m_out, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  model the bitstream fft3d_ddr_split of fftfpgaf_c2c_3d_ddr_split(), whose fetch and store access the real and imaginary parts in separate arrays
+ * @param  N      : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  inp_re : float pointer to the real parts of the input of size [N * N * N]
+ * @param  inp_im : float pointer to the imaginary parts of the input of size [N * N * N]
+ * @param  out_re : float pointer to the real parts of the output of size [N * N * N]
+ * @param  out_im : float pointer to the imaginary parts of the output of size [N * N * N]
+ * @param  inv    : toggle to activate backward FFT
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_ddr_split(const unsigned N, const float *inp_re, const float *inp_im, float *out_re, float *out_im, const bool inv);
+
+/**
+ * @brief  model the bitstream fft3d_ddr_gradient of fftfpgaf_gradient3d(), whose fetch multiplies the spectrum with i * scale * k of a component of the wave vector
+ * @param  N      : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  inp    : float2 pointer to the field of size [N * N * N]
+ * @param  grad_x : float2 pointer to the derivative along x of size [N * N * N], x being the fastest dimension
+ * @param  grad_y : float2 pointer to the derivative along y of size [N * N * N]
+ * @param  grad_z : float2 pointer to the derivative along z of size [N * N * N]
+ * @param  scale  : factor of the wave numbers, as for fftfpgaf_gradient3d()
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model of the four transforms
+ */
+extern fpga_t fftmodelf_gradient3d(const unsigned N, const float2 *inp, float2 *grad_x, float2 *grad_y, float2 *grad_z, const float scale);
+
+/**
+ * @brief  model the bitstream of fftfpgaf_c2c_1d(), whose output is in bit reversed order within each transform
+ * @param  N     : unsigned integer size of FFT1d, a power of 2 between 64 and 512
+ * @param  inp   : float2 pointer to input data of size [N * batch]
+ * @param  out   : float2 pointer to output data of size [N * batch]
+ * @param  inv   : toggle to activate backward FFT
+ * @param  batch : number of transforms
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_1d(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch);
+
+/**
+ * @brief  model the bitstream fft1d_natural of fftfpgaf_c2c_1d_natural(), whose store kernel reorders the output to natural order
+ * @param  N     : unsigned integer size of FFT1d, a power of 2 between 64 and 512
+ * @param  inp   : float2 pointer to input data of size [N * batch]
+ * @param  out   : float2 pointer to output data of size [N * batch]
+ * @param  inv   : toggle to activate backward FFT
+ * @param  batch : number of transforms
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_1d_natural(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch);
+
+/**
+ * @brief  model the two passes of the fft_large bitstream computing a 1D FFT of fftfpgaf_c2c_1d_large(). The 2D engine is bit accurate, the twiddle factors are rounded from double precision instead of using sinpi and cospi of the device.
+ * @param  N   : unsigned integer size of FFT1d, the square of a power of 2 between 16 and 512
+ * @param  inp : float2 pointer to input data of size N
+ * @param  out : float2 pointer to output data of size N in natural order
+ * @param  inv : toggle to activate backward FFT
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_1d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  model the bitstream fft_large of fftfpgaf_c2c_3d_large(), computing the 3D FFT by three passes of its 2D engine over each plane of the grid. The output is bitwise identical to fftmodelf_c2c_3d_ddr().
+ * @param  N   : unsigned integer denoting the size of FFT3d, a power of 2 between 16 and 512
+ * @param  inp : float2 pointer to input data of size [N * N * N]
+ * @param  out : float2 pointer to output data of size [N * N * N]
+ * @param  inv : toggle to activate backward FFT
+ * @return fpga_t : exec_t being the time in milliseconds taken by the model
+ */
+extern fpga_t fftmodelf_c2c_3d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv);
+
+/**
+ * @brief  activity of each kernel during the last call to the model
+ * @param  stats : array of FFTMODEL_NUM_KERNELS entries, indexed by fftmodel_kernel_t
+ */
+extern void fftmodel_get_stats(fftmodel_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFTMODEL_CHANNEL_HPP
+#define FFTMODEL_CHANNEL_HPP
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+namespace fftmodel {
+
+/**
+ * Bounded FIFO between two kernels, modelling an Intel channel with a single
+ * writer and a single reader. Elements are handed over in blocks to keep the
+ * synchronization off the per iteration path, the writer has to flush the last
+ * partial block before it completes.
+ */
+template <typename T>
+class Channel {
+public:
+  Channel(const size_t depth, const size_t block)
+    : block_(block), capacity_((depth + block - 1) / block), rd_pos_(0), wr_stalls_(0), rd_stalls_(0) {
+    wr_block_.reserve(block_);
+  }
+
+  void write(const T &value){
+    wr_block_.push_back(value);
+    if(wr_block_.size() == block_)
+      flush();
+  }
+
+  void flush(){
+    if(wr_block_.empty())
+      return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(blocks_.size() >= capacity_){
+      wr_stalls_++;
+      not_full_.wait(lock, [this]{ return blocks_.size() < capacity_; });
+    }
+    blocks_.push_back(std::move(wr_block_));
+    lock.unlock();
+    not_empty_.notify_one();
+
+    wr_block_ = std::vector<T>();
+    wr_block_.reserve(block_);
+  }
+
+  T read(){
+    if(rd_pos_ == rd_block_.size()){
+      std::unique_lock<std::mutex> lock(mutex_);
+      if(blocks_.empty()){
+        rd_stalls_++;
+        not_empty_.wait(lock, [this]{ return !blocks_.empty(); });
+      }
+      rd_block_ = std::move(blocks_.front());
+      blocks_.pop_front();
+      lock.unlock();
+      not_full_.notify_one();
+      rd_pos_ = 0;
+    }
+    return rd_block_[rd_pos_++];
+  }
+
+  // times the writer found the channel full
+  unsigned long write_stalls() const { return wr_stalls_; }
+  // times the reader found the channel empty
+  unsigned long read_stalls() const { return rd_stalls_; }
+
+private:
+  const size_t block_;
+  const size_t capacity_;  // in blocks
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_, not_full_;
+  std::deque<std::vector<T>> blocks_;
+
+  std::vector<T> wr_block_;  // owned by the writer
+  std::vector<T> rd_block_;  // owned by the reader
+  size_t rd_pos_;
+
+  unsigned long wr_stalls_, rd_stalls_;
+};
+
+} // namespace fftmodel
+
+#endif
@@ -0,0 +1,36 @@
+// Author: Arjun Ramaswami
+
+// Definitions required to compile the helper functions of the OpenCL kernels
+// as C++. Include after all other headers, the kernel code then follows
+// within a namespace.
+
+#ifndef FFTMODEL_CL_SHIM_HPP
+#define FFTMODEL_CL_SHIM_HPP
+
+#include <cmath>
+#include "fftfpga/fftfpga.h"
+
+// OpenCL vector arithmetic used by the FFT engine, element wise and in the
+// same order as the device
+inline float2 operator+(const float2 a, const float2 b){
+  float2 res;
+  res.x = a.x + b.x;
+  res.y = a.y + b.y;
+  return res;
+}
+
+inline float2 operator-(const float2 a, const float2 b){
+  float2 res;
+  res.x = a.x - b.x;
+  res.y = a.y - b.y;
+  return res;
+}
+
+// constant address space holds the twiddle tables
+#define constant const
+
+#ifndef M_PI_F
+#define M_PI_F 3.14159274101257324219f
+#endif
+
+#endif
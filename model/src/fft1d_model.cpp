@@ -0,0 +1,250 @@
+// Author: Arjun Ramaswami
+
+// Model of the kernels in kernels/fft1d/fft1d.cl and of its variant
+// fft1d_natural.cl, selected at runtime. Compiled once per supported size,
+// FFTMODEL_LOGN and FFTMODEL_NS being set by the build.
+//
+// fetch is an NDRange kernel whose work-items of a group all load before
+// any of them writes to the channels, fft1d and store are tasks. The kernels
+// are therefore modelled one after the other on the whole batch, which
+// preserves the order of the data in the channels and thereby the floating
+// point operations of the FPGA.
+
+#include <cstddef>
+#include <vector>
+
+#include "fftmodel/fftmodel.h"
+#include "fft1d_model.hpp"
+#include "cl_shim.hpp"
+
+#ifndef FFTMODEL_LOGN
+#error "FFTMODEL_LOGN is required"
+#endif
+
+// same parameters as kernels/common/fft_config.h
+#define LOGPOINTS 3
+#define POINTS 8
+
+#define LOGN FFTMODEL_LOGN
+#define N (1 << LOGN)
+
+// required by diagonal_bitrev.cl, unused by the 1D kernels
+#define DEPTH (1 << (LOGN + LOGN - LOGPOINTS))
+
+// same as fft1d.cl, which requires LOGN >= 2 * LOGPOINTS
+#define LOG_CONT_FACTOR_LIMIT1 (LOGN - (2 * (LOGPOINTS)))
+#define LOG_CONT_FACTOR_LIMIT2 (((LOG_CONT_FACTOR_LIMIT1) >= 0) ? (LOG_CONT_FACTOR_LIMIT1) : 0)
+#define LOG_CONT_FACTOR        (((LOG_CONT_FACTOR_LIMIT2) <= 6) ? (LOG_CONT_FACTOR_LIMIT1) : 6)
+
+#if LOG_CONT_FACTOR_LIMIT1 >= 0
+
+#define CONT_FACTOR            (1 << LOG_CONT_FACTOR)
+
+namespace fftmodel {
+namespace FFTMODEL_NS {
+
+using std::cos;
+using std::sin;
+
+// internal linkage, the helpers of the kernels are also compiled into
+// fft3d_model.cpp, which uses the ones not needed here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+namespace {
+#include "common/fft_8.cl"
+#include "matrixTranspose/diagonal_bitrev.cl"
+}
+#pragma GCC diagnostic pop
+
+#undef constant
+
+typedef std::vector<float2x8> stream_t;
+
+static float2x8 zero_data(){
+  float2x8 data;
+  data.i0.x = data.i0.y = data.i1.x = data.i1.y = 0.0f;
+  data.i2.x = data.i2.y = data.i3.x = data.i3.y = 0.0f;
+  data.i4.x = data.i4.y = data.i5.x = data.i5.y = 0.0f;
+  data.i6.x = data.i6.y = data.i7.x = data.i7.y = 0.0f;
+  return data;
+}
+
+// a burst of global memory accesses starts at 8 points not following the
+// previous ones of the kernel, next being the index expected to continue
+static void count_burst(const unsigned index, unsigned &next, fftmodel_stats_t &stats){
+  if(index != next)
+    stats.bursts++;
+  next = index + 8;
+}
+
+#define A_START 0
+#define A_END   (LOG_CONT_FACTOR + LOGPOINTS - 1)
+
+#define B_START (A_END + 1)
+#define B_END   (B_START + LOGPOINTS - 1)
+
+#define C_START (B_END + 1)
+#define C_END   (LOGN - 1)
+
+#define D_START (C_END + 1)
+#define D_END   31
+
+#define A_LEN   (A_END - A_START + 1)
+#define B_LEN   (B_END - B_START + 1)
+#define C_LEN   (C_END - C_START + 1)
+#define D_LEN   (D_END - D_START + 1)
+#define EXTRACT(id,start,len) ((id >> start) & ((1 << len) - 1))
+
+// uint permute_gid(gid) of fft1d.cl
+static unsigned permute_gid(unsigned gid){
+  unsigned result = 0;
+
+  unsigned A = EXTRACT(gid, A_START, A_LEN);
+  unsigned B = EXTRACT(gid, B_START, B_LEN);
+  unsigned C = EXTRACT(gid, C_START, C_LEN);
+  unsigned D = EXTRACT(gid, D_START, D_LEN);
+
+  // swap B and C
+  unsigned new_c_start = A_END + 1;
+  unsigned new_b_start = new_c_start + C_LEN;
+  result = (D << D_START) | (B << new_b_start) | (C << new_c_start) | (A << A_START);
+  return result;
+}
+
+// kernel void fetch(src), launched with a global size of count * N / 8
+// work-items in groups of CONT_FACTOR * POINTS
+static void fetch(const float2 *src, const unsigned count, stream_t &chanin, fftmodel_stats_t &stats){
+  const unsigned BUF_SIZE = 1 << (LOG_CONT_FACTOR + LOGPOINTS + LOGPOINTS);
+  const unsigned GROUP_SIZE = CONT_FACTOR * POINTS;
+
+  std::vector<float2> buf(BUF_SIZE);
+  unsigned next = ~0u;
+
+  for(unsigned group = 0; group < count * (N / 8) / GROUP_SIZE; group++){
+    // all work-items load before the barrier
+    for(unsigned lid = 0; lid < GROUP_SIZE; lid++){
+      unsigned global_addr = permute_gid((group * GROUP_SIZE + lid) << LOGPOINTS);
+      unsigned local_addr = lid << LOGPOINTS;
+      count_burst(global_addr, next, stats);
+
+      for (unsigned k = 0; k < POINTS; k++) {
+        buf[local_addr + k] = src[global_addr + k];
+      }
+      stats.iterations++;
+    }
+
+    for(unsigned lid = 0; lid < GROUP_SIZE; lid++){
+      float2 data[POINTS];
+      for (unsigned k = 0; k < POINTS; k++) {
+        unsigned buf_addr = bit_reversed(k, 3) * CONT_FACTOR * POINTS + lid;
+        data[k] = buf[buf_addr];
+      }
+
+      float2x8 out;
+      out.i0 = data[0]; out.i1 = data[1]; out.i2 = data[2]; out.i3 = data[3];
+      out.i4 = data[4]; out.i5 = data[5]; out.i6 = data[6]; out.i7 = data[7];
+      chanin.push_back(out);
+    }
+  }
+}
+
+// kernel void fft1d(dest, count, inverse), writing to chanout instead of
+// dest if natural_order
+static void fft1d(float2 *dest, const unsigned count, const int inverse, const bool natural_order, const stream_t &chanin, stream_t &chanout, fftmodel_stats_t &stats){
+
+  std::vector<float2> fft_delay_elements(N + 8 * (LOGN - 2));
+  unsigned next = ~0u;
+
+  for (unsigned i = 0; i < count * (N / 8) + N / 8 - 1; i++) {
+    float2x8 data;
+    if (i < count * (N / 8)) {
+      data = chanin[i];
+    } else {
+      data = zero_data();
+    }
+
+    data = fft_step(data, i % (N / 8), fft_delay_elements.data(), inverse, LOGN);
+
+    if (i >= N / 8 - 1) {
+      if(natural_order){
+        chanout.push_back(data);
+      }
+      else{
+        unsigned base = 8 * (i - (N / 8 - 1));
+        count_burst(base, next, stats);
+
+        dest[base] = data.i0;
+        dest[base + 1] = data.i1;
+        dest[base + 2] = data.i2;
+        dest[base + 3] = data.i3;
+        dest[base + 4] = data.i4;
+        dest[base + 5] = data.i5;
+        dest[base + 6] = data.i6;
+        dest[base + 7] = data.i7;
+      }
+    }
+    stats.iterations++;
+  }
+}
+
+// kernel void store(dest, count) of fft1d_natural.cl
+static void store(float2 *dest, const unsigned count, const stream_t &chanout, fftmodel_stats_t &stats){
+  const unsigned STEPS = N / POINTS;
+  bool is_bitrevA = false;
+
+  std::vector<float2> buf[2] = {std::vector<float2>(N), std::vector<float2>(N)};
+  unsigned next = ~0u;
+
+  // additional iterations to drain the buffers
+  for(unsigned step = 0; step < (count + 1) * STEPS; step++){
+    float2x8 data;
+    if (step < count * STEPS) {
+      data = chanout[step];
+    } else {
+      data = zero_data();
+    }
+
+    is_bitrevA = ( (step & (STEPS - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0].data() : buf[1].data(),
+      is_bitrevA ? buf[1].data() : buf[0].data(),
+      step);
+
+    if (step >= STEPS) {
+      unsigned row = step - STEPS;
+      unsigned base = (row / STEPS) * N + bit_reversed(row & (STEPS - 1), LOGN - LOGPOINTS) * POINTS;
+      count_burst(base, next, stats);
+
+      dest[base] = data.i0;
+      dest[base + 1] = data.i1;
+      dest[base + 2] = data.i2;
+      dest[base + 3] = data.i3;
+      dest[base + 4] = data.i4;
+      dest[base + 5] = data.i5;
+      dest[base + 6] = data.i6;
+      dest[base + 7] = data.i7;
+    }
+    stats.iterations++;
+  }
+}
+
+/**
+ * \brief  launch the kernels as fftfpgaf_c2c_1d and fftfpgaf_c2c_1d_natural do
+ */
+void fft1d(const float2 *src, float2 *dest, const bool inverse, const bool natural_order, const unsigned count, fftmodel_stats_t *stats){
+  stream_t chanin, chanout;
+  chanin.reserve((size_t)count * (N / 8));
+  if(natural_order)
+    chanout.reserve((size_t)count * (N / 8));
+
+  fetch(src, count, chanin, stats[FFTMODEL_FETCH]);
+  fft1d(dest, count, (int)inverse, natural_order, chanin, chanout, stats[FFTMODEL_FFT1D]);
+  if(natural_order)
+    store(dest, count, chanout, stats[FFTMODEL_STORE]);
+}
+
+} // namespace FFTMODEL_NS
+} // namespace fftmodel
+
+#endif
@@ -0,0 +1,34 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFTMODEL_FFT1D_MODEL_HPP
+#define FFTMODEL_FFT1D_MODEL_HPP
+
+#include "fftmodel/fftmodel.h"
+
+namespace fftmodel {
+
+/**
+ * \brief  model a batch of 1D FFTs through the kernels of fft1d.cl
+ * \param  src     : input of N * count points
+ * \param  dest    : output of N * count points
+ * \param  inverse : toggle to activate backward FFT
+ * \param  natural_order : model fft1d_natural.cl, whose store kernel reorders the output on chip
+ * \param  count   : number of transforms
+ * \param  stats   : FFTMODEL_NUM_KERNELS entries incremented by the activity of each kernel
+ */
+typedef void (*fft1d_fn)(const float2 *src, float2 *dest, const bool inverse, const bool natural_order, const unsigned count, fftmodel_stats_t *stats);
+
+// fetch of fft1d.cl requires N >= 64, see LOG_CONT_FACTOR
+#define FFTMODEL_DECLARE(logn) \
+  namespace log##logn { void fft1d(const float2 *src, float2 *dest, const bool inverse, const bool natural_order, const unsigned count, fftmodel_stats_t *stats); }
+
+FFTMODEL_DECLARE(6)
+FFTMODEL_DECLARE(7)
+FFTMODEL_DECLARE(8)
+FFTMODEL_DECLARE(9)
+
+#undef FFTMODEL_DECLARE
+
+} // namespace fftmodel
+
+#endif
@@ -0,0 +1,242 @@
+// Author: Arjun Ramaswami
+
+// Model of the kernels in kernels/fft2d/fft2d_ddr.cl compiled with FOUR_STEP
+// for the fft_large bitstream, one pass of the 2D engine over an N x N matrix
+// in global memory. Compiled once per supported size, FFTMODEL_LOGN and
+// FFTMODEL_NS being set by the build.
+//
+// fetch and transpose are NDRange kernels whose work-groups buffer 8 rows
+// before any of their work-items accesses the channels or the global memory,
+// fft2d and twiddle are tasks. The kernels are therefore modelled one after
+// the other on the whole pass, which preserves the order of the data in the
+// channels. The engine is bit accurate, the twiddle factors are computed in
+// double precision and rounded, whereas the device uses its own sinpi and
+// cospi.
+
+#include <cstddef>
+#include <vector>
+
+#include "fftmodel/fftmodel.h"
+#include "fft2d_model.hpp"
+#include "cl_shim.hpp"
+
+#ifndef FFTMODEL_LOGN
+#error "FFTMODEL_LOGN is required"
+#endif
+
+// same parameters as kernels/common/fft_config.h
+#define LOGPOINTS 3
+#define POINTS 8
+
+#define LOGN FFTMODEL_LOGN
+#define N (1 << LOGN)
+
+namespace fftmodel {
+namespace FFTMODEL_NS {
+
+using std::cos;
+using std::sin;
+
+// internal linkage, the engine is also compiled into the other models
+namespace {
+#include "common/fft_8.cl"
+}
+
+#undef constant
+
+typedef std::vector<float2x8> stream_t;
+
+static float2x8 zero_data(){
+  float2x8 data;
+  data.i0.x = data.i0.y = data.i1.x = data.i1.y = 0.0f;
+  data.i2.x = data.i2.y = data.i3.x = data.i3.y = 0.0f;
+  data.i4.x = data.i4.y = data.i5.x = data.i5.y = 0.0f;
+  data.i6.x = data.i6.y = data.i7.x = data.i7.y = 0.0f;
+  return data;
+}
+
+// a burst of global memory accesses starts at 8 points not following the
+// previous ones of the kernel, next being the index expected to continue
+static void count_burst(const unsigned index, unsigned &next, fftmodel_stats_t &stats){
+  if(index != next)
+    stats.bursts++;
+  next = index + 8;
+}
+
+// int bit_reversed(x, bits) of fft2d_ddr.cl
+static int bit_reversed(int x, int bits) {
+  int y = 0;
+  for (int i = 0; i < bits; i++) {
+    y <<= 1;
+    y |= x & 1;
+    x >>= 1;
+  }
+  return y;
+}
+
+// float2 twiddle_factor(index, inverse) of fft2d_ddr.cl, sinpi and cospi
+// being evaluated in double precision
+static float2 twiddle_factor(int index, int inverse) {
+  float x = (float)index * (2.0f / ((float)N * (float)N));
+  float s = (float)std::sin(M_PI * (double)x);
+  float c = (float)std::cos(M_PI * (double)x);
+
+  float2 res;
+  res.x = c;
+  res.y = inverse ? s : -s;
+  return res;
+}
+
+static void to_points(const float2x8 &data, float2 *points){
+  points[0] = data.i0; points[1] = data.i1; points[2] = data.i2; points[3] = data.i3;
+  points[4] = data.i4; points[5] = data.i5; points[6] = data.i6; points[7] = data.i7;
+}
+
+// int tiled_column(col, tiled) of fft2d_ddr.cl
+static unsigned tiled_column(unsigned col, bool tiled) {
+  return tiled ? (col << LOGN) : col;
+}
+
+static float2 complex_mult(float2 a, float2 b) {
+  float2 res;
+  res.x = a.x * b.x - a.y * b.y;
+  res.y = a.x * b.y + a.y * b.x;
+  return res;
+}
+
+// kernel void fetch(src, mangle = 0, transposed, offset, stride, tiled),
+// launched with N * N / 8 work-items in groups of N
+static void fetch(const float2 *src, const bool transposed, const unsigned offset, const unsigned stride, const bool tiled, stream_t &chanin, fftmodel_stats_t &stats){
+  std::vector<float2> buf(8 * N);
+  unsigned next = ~0u;
+
+  for(unsigned group = 0; group < N / POINTS; group++){
+    // all work-items load before the barrier
+    for(unsigned lid = 0; lid < N; lid++){
+      if(transposed){
+        unsigned r = lid;
+        unsigned c = group << LOGPOINTS;
+        count_burst(offset + r * stride + tiled_column(c, tiled), next, stats);
+
+        for (unsigned k = 0; k < POINTS; k++) {
+          buf[k * N + r] = src[offset + r * stride + tiled_column(c, tiled) + k];
+        }
+      }
+      else{
+        unsigned where = (group * N + lid) << LOGPOINTS;
+        unsigned where_global = offset + (where >> LOGN) * stride + tiled_column(where & (N - 1), tiled);
+        count_burst(where_global, next, stats);
+
+        for (unsigned k = 0; k < POINTS; k++) {
+          buf[(where & ((1 << (LOGN + LOGPOINTS)) - 1)) + k] = src[where_global + k];
+        }
+      }
+      stats.iterations++;
+    }
+
+    for(unsigned lid = 0; lid < N; lid++){
+      unsigned row = lid >> (LOGN - LOGPOINTS);
+      unsigned col = lid & (N / POINTS - 1);
+
+      float2x8 data;
+      data.i0 = buf[row * N + col];
+      data.i1 = buf[row * N + 4 * N / 8 + col];
+      data.i2 = buf[row * N + 2 * N / 8 + col];
+      data.i3 = buf[row * N + 6 * N / 8 + col];
+      data.i4 = buf[row * N + N / 8 + col];
+      data.i5 = buf[row * N + 5 * N / 8 + col];
+      data.i6 = buf[row * N + 3 * N / 8 + col];
+      data.i7 = buf[row * N + 7 * N / 8 + col];
+      chanin.push_back(data);
+    }
+  }
+}
+
+// kernel void fft2d(inverse)
+static void fft2d(const int inverse, const stream_t &chanin, stream_t &chanout, fftmodel_stats_t &stats){
+  std::vector<float2> fft_delay_elements(N + POINTS * (LOGN - 2));
+
+  for (unsigned i = 0; i < N * (N / POINTS) + N / POINTS - 1; i++) {
+    float2x8 data;
+
+    if (i < N * (N / POINTS)) {
+      data = chanin[i];
+    } else {
+      data = zero_data();
+    }
+
+    data = fft_step(data, i % (N / POINTS), fft_delay_elements.data(), inverse, LOGN);
+
+    if (i >= N / POINTS - 1) {
+      chanout.push_back(data);
+    }
+    stats.iterations++;
+  }
+}
+
+// kernel void twiddle(enable, inverse), applied in place to the channel
+static void twiddle(const bool enable, const int inverse, stream_t &chan, fftmodel_stats_t &stats){
+  for (unsigned i = 0; i < N * (N / POINTS); i++) {
+    float2 data[POINTS];
+    to_points(chan[i], data);
+
+    if (enable) {
+      int block = i >> LOGN;
+      for (int k = 0; k < POINTS; k++) {
+        int where = ((i & (N - 1)) << LOGPOINTS) + k;
+        int row = (block << LOGPOINTS) + (where >> LOGN);
+        int freq = bit_reversed(where & (N - 1), LOGN);
+        data[k] = complex_mult(data[k], twiddle_factor(row * freq, inverse));
+      }
+    }
+
+    chan[i].i0 = data[0]; chan[i].i1 = data[1]; chan[i].i2 = data[2]; chan[i].i3 = data[3];
+    chan[i].i4 = data[4]; chan[i].i5 = data[5]; chan[i].i6 = data[6]; chan[i].i7 = data[7];
+    stats.iterations++;
+  }
+}
+
+// kernel void transpose(dest, mangle = 0, offset, stride, tiled), launched
+// with N * N / 8 work-items in groups of N
+static void transpose(float2 *dest, const unsigned offset, const unsigned stride, const bool tiled, const stream_t &chantw, fftmodel_stats_t &stats){
+  std::vector<float2> buf(POINTS * N);
+  unsigned next = ~0u;
+
+  for(unsigned group = 0; group < N / POINTS; group++){
+    // all work-items read the channel before the barrier
+    for(unsigned lid = 0; lid < N; lid++){
+      to_points(chantw[group * N + lid], &buf[8 * lid]);
+    }
+
+    for(unsigned lid = 0; lid < N; lid++){
+      int colt = lid;
+      int revcolt = bit_reversed(colt, LOGN);
+      int i = group;
+      unsigned where = colt * N + i * POINTS;
+      where = offset + (where >> LOGN) * stride + tiled_column(where & (N - 1), tiled);
+      count_burst(where, next, stats);
+
+      for (unsigned k = 0; k < POINTS; k++) {
+        dest[where + k] = buf[k * N + revcolt];
+      }
+      stats.iterations++;
+    }
+  }
+}
+
+/**
+ * \brief  launch the kernels as a pass of fftfpgaf_c2c_1d_large and fftfpgaf_c2c_3d_large does
+ */
+void fft2d_pass(const float2 *src, const matrix_t &src_matrix, float2 *dest, const matrix_t &dest_matrix, const bool transposed, const bool enable_twiddle, const bool inverse, fftmodel_stats_t *stats){
+  stream_t chanin, chanout;
+  chanin.reserve(N * (N / POINTS));
+  chanout.reserve(N * (N / POINTS));
+
+  fetch(src, transposed, src_matrix.offset, src_matrix.stride, src_matrix.tiled, chanin, stats[FFTMODEL_FETCH]);
+  fft2d((int)inverse, chanin, chanout, stats[FFTMODEL_FFT2D]);
+  twiddle(enable_twiddle, (int)inverse, chanout, stats[FFTMODEL_TWIDDLE]);
+  transpose(dest, dest_matrix.offset, dest_matrix.stride, dest_matrix.tiled, chanout, stats[FFTMODEL_TRANSPOSE]);
+}
+
+} // namespace FFTMODEL_NS
+} // namespace fftmodel
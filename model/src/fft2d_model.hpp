@@ -0,0 +1,46 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFTMODEL_FFT2D_MODEL_HPP
+#define FFTMODEL_FFT2D_MODEL_HPP
+
+#include "fftmodel/fftmodel.h"
+
+namespace fftmodel {
+
+/**
+ * Matrix of a pass in global memory, as given by the arguments of fetch and transpose
+ */
+struct matrix_t {
+  unsigned offset;  /**< index of the first point of the matrix */
+  unsigned stride;  /**< number of points between consecutive rows */
+  bool tiled;       /**< groups of 8 columns of a row are 8 * N points apart, see tiled_column() of fft2d_ddr.cl */
+};
+
+/**
+ * \brief  model a pass of the 2D engine of the fft_large bitstream over an N x N matrix, transforming its rows and writing them transposed
+ * \param  src        : buffer read by fetch
+ * \param  src_matrix : layout of the matrix in src
+ * \param  dest       : buffer written by transpose
+ * \param  dest_matrix : layout of the transposed matrix in dest
+ * \param  transposed : toggle to transform the columns of the matrix instead of its rows
+ * \param  enable_twiddle : toggle to multiply the twiddle factors of the four-step 1D FFT
+ * \param  inverse    : toggle to activate backward FFT
+ * \param  stats      : FFTMODEL_NUM_KERNELS entries incremented by the activity of each kernel
+ */
+typedef void (*fft2d_pass_fn)(const float2 *src, const matrix_t &src_matrix, float2 *dest, const matrix_t &dest_matrix, const bool transposed, const bool enable_twiddle, const bool inverse, fftmodel_stats_t *stats);
+
+#define FFTMODEL_DECLARE(logn) \
+  namespace log##logn { void fft2d_pass(const float2 *src, const matrix_t &src_matrix, float2 *dest, const matrix_t &dest_matrix, const bool transposed, const bool enable_twiddle, const bool inverse, fftmodel_stats_t *stats); }
+
+FFTMODEL_DECLARE(4)
+FFTMODEL_DECLARE(5)
+FFTMODEL_DECLARE(6)
+FFTMODEL_DECLARE(7)
+FFTMODEL_DECLARE(8)
+FFTMODEL_DECLARE(9)
+
+#undef FFTMODEL_DECLARE
+
+} // namespace fftmodel
+
+#endif
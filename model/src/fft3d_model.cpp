@@ -0,0 +1,539 @@
+// Author: Arjun Ramaswami
+
+// Model of the kernels in kernels/fft3d/fft3d_ddr.cl and of its variants
+// fft3d_ddr_transposed.cl and fft3d_ddr_tiled.cl, selected at runtime. The
+// variants that only replace the accesses of fetch and store to the global
+// memory are modelled by an access_t. Compiled once per supported size,
+// FFTMODEL_LOGN and FFTMODEL_NS being set by the build.
+//
+// The helper functions of the kernels (fft_step, bitreverse_fetch, writeBuf,
+// readBuf_store, ...) are included unmodified. The kernel loops below mirror
+// the device code statement by statement, including the additional iterations
+// to fill and drain the buffers, such that the floating point operations are
+// applied in the same order as on the FPGA. Each Intel channel of 8 points is
+// modelled as a single channel of float2x8.
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#include "fftmodel/fftmodel.h"
+#include "fft3d_model.hpp"
+#include "channel.hpp"
+#include "cl_shim.hpp"
+
+#ifndef FFTMODEL_LOGN
+#error "FFTMODEL_LOGN is required"
+#endif
+
+// same parameters as kernels/common/fft_config.h
+#define LOGPOINTS 3
+#define POINTS 8
+
+#define LOGN FFTMODEL_LOGN
+#define N (1 << LOGN)
+
+#define DEPTH (1 << (LOGN + LOGN - LOGPOINTS))
+
+#define WR_GLOBALMEM 0
+#define RD_GLOBALMEM 1
+#define BATCH 2
+
+// iterations of 8 points handed over at once between kernel threads
+#define CHANNEL_BLOCK 64
+
+namespace fftmodel {
+namespace FFTMODEL_NS {
+
+using std::cos;
+using std::sin;
+
+#include "common/fft_8.cl"
+#include "matrixTranspose/diagonal_bitrev.cl"
+
+#undef constant
+
+typedef Channel<float2x8> channel_t;
+
+static float2x8 zero_data(){
+  float2x8 data;
+  data.i0.x = data.i0.y = data.i1.x = data.i1.y = 0.0f;
+  data.i2.x = data.i2.y = data.i3.x = data.i3.y = 0.0f;
+  data.i4.x = data.i4.y = data.i5.x = data.i5.y = 0.0f;
+  data.i6.x = data.i6.y = data.i7.x = data.i7.y = 0.0f;
+  return data;
+}
+
+// inline unsigned tiled_index(index) of fft3d_ddr.cl compiled with TILED
+static unsigned tiled_index(const unsigned index){
+  unsigned zdim = index >> (LOGN + LOGN);
+  unsigned ydim = (index >> LOGN) & (N - 1);
+  unsigned xdim = index & (N - 1);
+
+  return (((ydim << LOGN) + zdim) << LOGN) + xdim;
+}
+
+// a burst of global memory accesses starts at 8 points not following the
+// previous ones of the kernel, next being the index expected to continue
+static void count_burst(const unsigned index, unsigned &next, fftmodel_stats_t &stats){
+  if(index != next)
+    stats.bursts++;
+  next = index + 8;
+}
+
+// point index of the cube read by fetch and written by store, through the
+// accesses of a variant of the kernels if given
+static float2 load_point(const float2 *src, const access_t *access, const unsigned index){
+  return access ? access->load(index) : src[index];
+}
+
+static void store_point(float2 *dest, const access_t *access, const unsigned index, const float2 &value){
+  if(access)
+    access->store(index, value);
+  else
+    dest[index] = value;
+}
+
+// kernel void fetch(src)
+static void fetch(const float2 *src, const access_t *access, channel_t &chanout, fftmodel_stats_t &stats){
+  unsigned delay = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 buf[2][N] = {};
+  unsigned next = ~0u;
+
+  // additional iterations to fill the buffers
+  for(unsigned step = 0; step < (N * DEPTH) + delay; step++){
+
+    unsigned where = (step & ((N * DEPTH) - 1)) * 8;
+
+    float2x8 data;
+    if (step < (N * DEPTH)) {
+      count_burst(where, next, stats);
+      data.i0 = load_point(src, access, where + 0);
+      data.i1 = load_point(src, access, where + 1);
+      data.i2 = load_point(src, access, where + 2);
+      data.i3 = load_point(src, access, where + 3);
+      data.i4 = load_point(src, access, where + 4);
+      data.i5 = load_point(src, access, where + 5);
+      data.i6 = load_point(src, access, where + 6);
+      data.i7 = load_point(src, access, where + 7);
+    } else {
+      data = zero_data();
+    }
+
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_fetch(data,
+      is_bitrevA ? buf[0] : buf[1],
+      is_bitrevA ? buf[1] : buf[0],
+      row);
+
+    if (step >= delay) {
+      chanout.write(data);
+    }
+    stats.iterations++;
+  }
+  chanout.flush();
+}
+
+// kernel void fft3da(inverse), fft3db(inverse), fft3dc(inverse)
+static void fft3d(const int inverse, channel_t &chanin, channel_t &chanout, fftmodel_stats_t &stats){
+
+  float2 fft_delay_elements[N + POINTS * (LOGN - 2)] = {};
+
+  for(unsigned j = 0; j < N; j++){
+    for (unsigned i = 0; i < N * (N / POINTS) + N / POINTS - 1; i++) {
+      float2x8 data;
+
+      if (i < N * (N / POINTS)) {
+        data = chanin.read();
+      }
+      else {
+        data = zero_data();
+      }
+
+      data = fft_step(data, i % (N / POINTS), fft_delay_elements, inverse, LOGN);
+
+      if (i >= N / POINTS - 1) {
+        chanout.write(data);
+      }
+      stats.iterations++;
+    }
+  }
+  chanout.flush();
+}
+
+// kernel void transpose()
+static void transpose(channel_t &chanin, channel_t &chanout, fftmodel_stats_t &stats){
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bufA = false, is_bitrevA = false;
+
+  std::unique_ptr<float2[][DEPTH][POINTS]> buf(new float2[2][DEPTH][POINTS]());
+  float2 bitrev_in[2][N] = {};
+  float2 bitrev_out[2][N] = {};
+
+  int initial_delay = DELAY + DELAY; // for each of the bitrev buffer
+
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data = chanin.read();
+    } else {
+      data = zero_data();
+    }
+
+    // Swap buffers every N*N/8 iterations
+    // starting from the additional delay of N/8 iterations
+    is_bufA = (( (step + DELAY) & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    writeBuf(data,
+      is_bufA ? buf[0] : buf[1],
+      step, DELAY);
+
+    data_out = readBuf(
+      is_bufA ? buf[1] : buf[0],
+      step);
+
+    unsigned start_row = (step + DELAY) & (DEPTH -1);
+    data_out = bitreverse_out(
+      is_bitrevA ? bitrev_out[0] : bitrev_out[1],
+      is_bitrevA ? bitrev_out[1] : bitrev_out[0],
+      data_out, start_row);
+
+    if (step >= (DEPTH)) {
+      chanout.write(data_out);
+    }
+    stats.iterations++;
+  }
+  chanout.flush();
+}
+
+// kernel void transpose3D(src, dest, mode), a single launch. transposed
+// models the kernel compiled with TRANSPOSED, tiled with TILED.
+static void transpose3D(const float2 *src, float2 *dest, const int mode, const bool transposed, const bool tiled, channel_t &chanin, channel_t &chanout, fftmodel_stats_t &stats){
+
+  const int initial_delay = (1 << (LOGN - LOGPOINTS)); // N / 8 for the bitrev buffers
+  bool is_bufA = false, is_bitrevA = false;
+  bool is_bufB = false, is_bitrevB = false;
+
+  std::unique_ptr<float2[][DEPTH][POINTS]> buf_wr(new float2[2][DEPTH][POINTS]());
+  std::unique_ptr<float2[][DEPTH][POINTS]> buf_rd(new float2[2][DEPTH][POINTS]());
+
+  float2 bitrev_in[2][N] = {};
+  float2 bitrev_out[2][N] = {};
+  unsigned next = ~0u;
+
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    float2x8 data_wr, data_wr_out;
+    if(mode == WR_GLOBALMEM || mode == BATCH){
+      if (step < ((N * DEPTH) - initial_delay)) {
+        data = chanin.read();
+      } else {
+        data = zero_data();
+      }
+
+      // Swap buffers every N*N/8 iterations
+      // starting from the additional delay of N/8 iterations
+      is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+      // Swap bitrev buffers every N/8 iterations
+      is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+      unsigned row = step & (DEPTH - 1);
+      data = bitreverse_in(data,
+        is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+        is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+        row);
+
+      if(transposed){
+        data_out = data;
+        if (step >= 0 && step < (N * DEPTH)) {
+          unsigned index = step * 8;
+          count_burst(index, next, stats);
+
+          dest[index + 0] = data_out.i0;
+          dest[index + 1] = data_out.i1;
+          dest[index + 2] = data_out.i2;
+          dest[index + 3] = data_out.i3;
+          dest[index + 4] = data_out.i4;
+          dest[index + 5] = data_out.i5;
+          dest[index + 6] = data_out.i6;
+          dest[index + 7] = data_out.i7;
+        }
+      }
+      else{
+        writeBuf(data,
+          is_bufA ? buf_wr[0] : buf_wr[1],
+          step, 0);
+
+        data_out = readBuf_store(
+          is_bufA ? buf_wr[1] : buf_wr[0],
+          step);
+
+        if (step >= (DEPTH)) {
+          unsigned index = tiled ? tiled_index((step - DEPTH) * 8) : (step - DEPTH) * 8;
+          count_burst(index, next, stats);
+
+          dest[index + 0] = data_out.i0;
+          dest[index + 1] = data_out.i1;
+          dest[index + 2] = data_out.i2;
+          dest[index + 3] = data_out.i3;
+          dest[index + 4] = data_out.i4;
+          dest[index + 5] = data_out.i5;
+          dest[index + 6] = data_out.i6;
+          dest[index + 7] = data_out.i7;
+        }
+      }
+    } // condition for writing to global memory
+    if(mode == RD_GLOBALMEM || mode == BATCH){
+
+      unsigned step_rd = step + initial_delay;
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned zdim = (step_rd >> (LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (step_rd >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment by 8 until N / 8
+      unsigned xdim = (step_rd * 8) & (N - 1);
+
+      // increment by 1 every N*N*N / 8 steps
+      unsigned batch_index = (step_rd >> (LOGN + LOGN + LOGN - LOGPOINTS));
+
+      unsigned index_wr = tiled ? (batch_index * N * N * N) + tiled_index((zdim * N * N) + (ydim * N) + xdim)
+                                : (batch_index * N * N * N) + (zdim * N * N) + (ydim * N) + xdim;
+
+      if (step < ((N * DEPTH)  - initial_delay)) {
+        count_burst(index_wr, next, stats);
+        data_wr.i0 = src[index_wr + 0];
+        data_wr.i1 = src[index_wr + 1];
+        data_wr.i2 = src[index_wr + 2];
+        data_wr.i3 = src[index_wr + 3];
+        data_wr.i4 = src[index_wr + 4];
+        data_wr.i5 = src[index_wr + 5];
+        data_wr.i6 = src[index_wr + 6];
+        data_wr.i7 = src[index_wr + 7];
+      } else {
+        data_wr = zero_data();
+      }
+
+      is_bufB = (( step_rd & (DEPTH - 1)) == 0) ? !is_bufB: is_bufB;
+
+      // Swap bitrev buffers every N/8 iterations
+      is_bitrevB = ( (step_rd & ((N / 8) - 1)) == 0) ? !is_bitrevB: is_bitrevB;
+
+      writeBuf(data_wr,
+        is_bufB ? buf_rd[0] : buf_rd[1],
+        step_rd, 0);
+
+      data_wr_out = readBuf_fetch(
+        is_bufB ? buf_rd[1] : buf_rd[0],
+        step_rd, 0);
+
+      unsigned start_row = step_rd & (DEPTH -1);
+      data_wr_out = bitreverse_out(
+        is_bitrevB ? bitrev_out[0] : bitrev_out[1],
+        is_bitrevB ? bitrev_out[1] : bitrev_out[0],
+        data_wr_out, start_row);
+
+      if (step_rd >= (DEPTH + initial_delay)) {
+        chanout.write(data_wr_out);
+      }
+    } // condition for reading from global memory
+    stats.iterations++;
+  }
+  chanout.flush();
+}
+
+// kernel void store(dest)
+static void store(float2 *dest, const access_t *access, channel_t &chanin, fftmodel_stats_t &stats){
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bufA = false, is_bitrevA = false;
+
+  std::unique_ptr<float2[][DEPTH][POINTS]> buf(new float2[2][DEPTH][POINTS]());
+  float2 bitrev_in[2][N] = {};
+  unsigned next = ~0u;
+
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the buffers
+  for(int step = -initial_delay; step < ((N * DEPTH) + DEPTH); step++){
+
+    float2x8 data, data_out;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data = chanin.read();
+    } else {
+      data = zero_data();
+    }
+    // Swap buffers every N*N/8 iterations
+    // starting from the additional delay of N/8 iterations
+    is_bufA = (( step & (DEPTH - 1)) == 0) ? !is_bufA: is_bufA;
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    writeBuf(data,
+      is_bufA ? buf[0] : buf[1],
+      step, 0);
+
+    data_out = readBuf_store(
+      is_bufA ? buf[1] : buf[0],
+      step);
+
+    if (step >= (DEPTH)) {
+      unsigned start_index = (step - DEPTH);
+      // increment z by 1 every N/8 steps until (N*N/ 8)
+      unsigned zdim = (start_index >> (LOGN - LOGPOINTS)) & (N - 1);
+
+      // increment y by 1 every N*N/8 points until N
+      unsigned ydim = (start_index >> (LOGN + LOGN - LOGPOINTS)) & (N - 1);
+
+      // incremenet by 8 until N / 8
+      unsigned xdim = (start_index * 8) & ( N - 1);
+
+      // increment by N*N*N
+      unsigned cube = LOGN + LOGN + LOGN - LOGPOINTS;
+
+      // increment by 1 every N*N*N / 8 steps
+      unsigned batch_index = (start_index >> cube);
+
+      unsigned index = (batch_index * N * N * N) + (zdim * N * N) + (ydim * N) + xdim;
+      count_burst(index, next, stats);
+
+      store_point(dest, access, index + 0, data_out.i0);
+      store_point(dest, access, index + 1, data_out.i1);
+      store_point(dest, access, index + 2, data_out.i2);
+      store_point(dest, access, index + 3, data_out.i3);
+      store_point(dest, access, index + 4, data_out.i4);
+      store_point(dest, access, index + 5, data_out.i5);
+      store_point(dest, access, index + 6, data_out.i6);
+      store_point(dest, access, index + 7, data_out.i7);
+    }
+    stats.iterations++;
+  }
+}
+
+// kernel void store_transposed(dest) of fft3d_ddr_transposed.cl
+static void store_transposed(float2 *dest, channel_t &chanin, fftmodel_stats_t &stats){
+
+  const int DELAY = (1 << (LOGN - LOGPOINTS)); // N / 8
+  bool is_bitrevA = false;
+
+  float2 bitrev_in[2][N] = {};
+  unsigned next = ~0u;
+
+  int initial_delay = DELAY; // for each of the bitrev buffer
+  // additional iterations to fill the bitrev buffer
+  for(int step = -initial_delay; step < (N * DEPTH); step++){
+
+    float2x8 data;
+    if (step < ((N * DEPTH) - initial_delay)) {
+      data = chanin.read();
+    } else {
+      data = zero_data();
+    }
+
+    // Swap bitrev buffers every N/8 iterations
+    is_bitrevA = ( (step & ((N / 8) - 1)) == 0) ? !is_bitrevA: is_bitrevA;
+
+    unsigned row = step & (DEPTH - 1);
+    data = bitreverse_in(data,
+      is_bitrevA ? bitrev_in[0] : bitrev_in[1],
+      is_bitrevA ? bitrev_in[1] : bitrev_in[0],
+      row);
+
+    // rows along z in x-y-z order
+    if (step >= 0) {
+      unsigned index = step * 8;
+      count_burst(index, next, stats);
+
+      dest[index + 0] = data.i0;
+      dest[index + 1] = data.i1;
+      dest[index + 2] = data.i2;
+      dest[index + 3] = data.i3;
+      dest[index + 4] = data.i4;
+      dest[index + 5] = data.i5;
+      dest[index + 6] = data.i6;
+      dest[index + 7] = data.i7;
+    }
+    stats.iterations++;
+  }
+}
+
+/**
+ * \brief  launch the kernels as fftfpgaf_c2c_3d_ddr does, with transpose3D
+ *         enqueued twice on the same queue to write to and then read from DDR
+ */
+void fft3d_ddr(const float2 *src, float2 *dest, const access_t *access, float2 *ddr, const bool inverse, const bool transposed, const bool tiled, const size_t depth, fftmodel_stats_t *stats){
+
+  const size_t block = (depth < CHANNEL_BLOCK) ? depth : CHANNEL_BLOCK;
+  channel_t chaninfft3da(depth, block), chaninTranspose(depth, block);
+  channel_t chaninfft3db(depth, block), chaninTranspose3D(depth, block);
+  channel_t chaninfft3dc(depth, block), chaninStore(depth, block);
+
+  fftmodel_stats_t local[FFTMODEL_NUM_KERNELS] = {};
+  const int inverse_int = (int)inverse;
+
+  std::thread kernels[] = {
+    std::thread(fetch, src, access, std::ref(chaninfft3da), std::ref(local[FFTMODEL_FETCH])),
+    std::thread(fft3d, inverse_int, std::ref(chaninfft3da), std::ref(chaninTranspose), std::ref(local[FFTMODEL_FFT3DA])),
+    std::thread(transpose, std::ref(chaninTranspose), std::ref(chaninfft3db), std::ref(local[FFTMODEL_TRANSPOSE])),
+    std::thread(fft3d, inverse_int, std::ref(chaninfft3db), std::ref(chaninTranspose3D), std::ref(local[FFTMODEL_FFT3DB])),
+    std::thread([&]{
+      transpose3D(ddr, ddr, WR_GLOBALMEM, transposed, tiled, chaninTranspose3D, chaninfft3dc, local[FFTMODEL_TRANSPOSE3D_WR]);
+      transpose3D(ddr, ddr, RD_GLOBALMEM, transposed, tiled, chaninTranspose3D, chaninfft3dc, local[FFTMODEL_TRANSPOSE3D_RD]);
+    }),
+    std::thread(fft3d, inverse_int, std::ref(chaninfft3dc), std::ref(chaninStore), std::ref(local[FFTMODEL_FFT3DC])),
+    std::thread([&]{
+      if(transposed)
+        store_transposed(dest, chaninStore, local[FFTMODEL_STORE]);
+      else
+        store(dest, access, chaninStore, local[FFTMODEL_STORE]);
+    })
+  };
+
+  for(std::thread &kernel : kernels){
+    kernel.join();
+  }
+
+  // stalls of a kernel are on its input and output channels
+  local[FFTMODEL_FETCH].stalls += chaninfft3da.write_stalls();
+  local[FFTMODEL_FFT3DA].stalls += chaninfft3da.read_stalls() + chaninTranspose.write_stalls();
+  local[FFTMODEL_TRANSPOSE].stalls += chaninTranspose.read_stalls() + chaninfft3db.write_stalls();
+  local[FFTMODEL_FFT3DB].stalls += chaninfft3db.read_stalls() + chaninTranspose3D.write_stalls();
+  local[FFTMODEL_TRANSPOSE3D_WR].stalls += chaninTranspose3D.read_stalls();
+  local[FFTMODEL_TRANSPOSE3D_RD].stalls += chaninfft3dc.write_stalls();
+  local[FFTMODEL_FFT3DC].stalls += chaninfft3dc.read_stalls() + chaninStore.write_stalls();
+  local[FFTMODEL_STORE].stalls += chaninStore.read_stalls();
+
+  for(unsigned i = 0; i < FFTMODEL_NUM_KERNELS; i++){
+    stats[i].iterations += local[i].iterations;
+    stats[i].stalls += local[i].stalls;
+    stats[i].bursts += local[i].bursts;
+  }
+}
+
+} // namespace FFTMODEL_NS
+} // namespace fftmodel
@@ -0,0 +1,50 @@
+// Author: Arjun Ramaswami
+
+#ifndef FFTMODEL_FFT3D_MODEL_HPP
+#define FFTMODEL_FFT3D_MODEL_HPP
+
+#include <cstddef>
+#include <functional>
+#include "fftmodel/fftmodel.h"
+
+namespace fftmodel {
+
+/**
+ * Global memory accesses of the fetch and store kernels of a variant of
+ * fft3d_ddr.cl, by index of the point in the cube in natural order
+ */
+struct access_t {
+  std::function<float2(unsigned)> load;                 /**< point read by fetch */
+  std::function<void(unsigned, const float2 &)> store;  /**< point written by store */
+};
+
+/**
+ * \brief  model one 3D FFT through the kernels of fft3d_ddr.cl, each kernel running on its own thread
+ * \param  src     : input of N^3 points
+ * \param  dest    : output of N^3 points
+ * \param  access  : accesses of fetch and store replacing src and dest, NULL for those of fft3d_ddr.cl
+ * \param  ddr     : scratch of N^3 points, modelling the DDR buffer used by transpose3D
+ * \param  inverse : toggle to activate backward FFT
+ * \param  transposed : model fft3d_ddr_transposed.cl, leaving the output in x-y-z order
+ * \param  tiled   : model fft3d_ddr_tiled.cl, storing the cube of transpose3D with y and z swapped
+ * \param  depth   : depth of the channels, in iterations of 8 points
+ * \param  stats   : FFTMODEL_NUM_KERNELS entries incremented by the activity of each kernel
+ */
+typedef void (*fft3d_ddr_fn)(const float2 *src, float2 *dest, const access_t *access, float2 *ddr, const bool inverse, const bool transposed, const bool tiled, const size_t depth, fftmodel_stats_t *stats);
+
+// kernels are compiled for a fixed size, one instance per supported log2 size
+#define FFTMODEL_DECLARE(logn) \
+  namespace log##logn { void fft3d_ddr(const float2 *src, float2 *dest, const access_t *access, float2 *ddr, const bool inverse, const bool transposed, const bool tiled, const size_t depth, fftmodel_stats_t *stats); }
+
+FFTMODEL_DECLARE(4)
+FFTMODEL_DECLARE(5)
+FFTMODEL_DECLARE(6)
+FFTMODEL_DECLARE(7)
+FFTMODEL_DECLARE(8)
+FFTMODEL_DECLARE(9)
+
+#undef FFTMODEL_DECLARE
+
+} // namespace fftmodel
+
+#endif
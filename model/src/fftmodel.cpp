@@ -0,0 +1,477 @@
+// Author: Arjun Ramaswami
+
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <new>
+#include <system_error>
+
+#include "fftmodel/fftmodel.h"
+#include "fft3d_model.hpp"
+#include "fft1d_model.hpp"
+#include "fft2d_model.hpp"
+
+// threads taken by the kernels of a single pipeline
+#define KERNELS_PER_PIPELINE 7
+
+#define DEFAULT_CHANNEL_DEPTH 4096
+
+static std::atomic<unsigned> channel_depth(DEFAULT_CHANNEL_DEPTH);
+
+static std::mutex stats_lock;
+static fftmodel_stats_t last_stats[FFTMODEL_NUM_KERNELS];
+
+static fftmodel::fft3d_ddr_fn find_fft3d_ddr(const unsigned N){
+  switch(N){
+    case 16:  return fftmodel::log4::fft3d_ddr;
+    case 32:  return fftmodel::log5::fft3d_ddr;
+    case 64:  return fftmodel::log6::fft3d_ddr;
+    case 128: return fftmodel::log7::fft3d_ddr;
+    case 256: return fftmodel::log8::fft3d_ddr;
+    case 512: return fftmodel::log9::fft3d_ddr;
+    default:  return NULL;
+  }
+}
+
+static fftmodel::fft1d_fn find_fft1d(const unsigned N){
+  switch(N){
+    case 64:  return fftmodel::log6::fft1d;
+    case 128: return fftmodel::log7::fft1d;
+    case 256: return fftmodel::log8::fft1d;
+    case 512: return fftmodel::log9::fft1d;
+    default:  return NULL;
+  }
+}
+
+static fftmodel::fft2d_pass_fn find_fft2d_pass(const unsigned N){
+  switch(N){
+    case 16:  return fftmodel::log4::fft2d_pass;
+    case 32:  return fftmodel::log5::fft2d_pass;
+    case 64:  return fftmodel::log6::fft2d_pass;
+    case 128: return fftmodel::log7::fft2d_pass;
+    case 256: return fftmodel::log8::fft2d_pass;
+    case 512: return fftmodel::log9::fft2d_pass;
+    default:  return NULL;
+  }
+}
+
+void fftmodel_set_channel_depth(const unsigned depth){
+  channel_depth = (depth == 0) ? DEFAULT_CHANNEL_DEPTH : depth;
+}
+
+void fftmodel_get_stats(fftmodel_stats_t *stats){
+  if(stats == NULL)
+    return;
+
+  std::lock_guard<std::mutex> lock(stats_lock);
+  for(unsigned i = 0; i < FFTMODEL_NUM_KERNELS; i++){
+    stats[i] = last_stats[i];
+  }
+}
+
+static void set_last_stats(const std::vector<fftmodel_stats_t> &stats){
+  std::lock_guard<std::mutex> lock(stats_lock);
+  for(unsigned i = 0; i < FFTMODEL_NUM_KERNELS; i++){
+    last_stats[i] = stats[i];
+  }
+}
+
+/**
+ * \brief  batches are modelled as independent launches of the bitstream. As
+ *         many are run concurrently as the host has threads for their kernels.
+ */
+static fpga_t model_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool transposed, const bool tiled, const unsigned how_many){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  fftmodel::fft3d_ddr_fn fft3d_ddr = find_fft3d_ddr(N);
+  if(inp == NULL || out == NULL || fft3d_ddr == NULL || how_many == 0){
+    return fft_time;
+  }
+
+  const size_t num_pts = (size_t)N * N * N;
+  const size_t depth = channel_depth;
+
+  unsigned cores = std::thread::hardware_concurrency();
+  unsigned num_pipelines = (cores > KERNELS_PER_PIPELINE) ? cores / KERNELS_PER_PIPELINE : 1;
+  if(num_pipelines > how_many)
+    num_pipelines = how_many;
+
+  std::vector<std::vector<fftmodel_stats_t>> stats(num_pipelines, std::vector<fftmodel_stats_t>(FFTMODEL_NUM_KERNELS));
+  std::atomic<unsigned> next_batch(0);
+  std::atomic<bool> failed(false);
+
+  auto start = std::chrono::steady_clock::now();
+
+  auto pipeline = [&](const unsigned id){
+    try{
+      // global memory buffer used by transpose3D
+      std::vector<float2> ddr(num_pts);
+      for(unsigned b = next_batch++; b < how_many; b = next_batch++){
+        fft3d_ddr(&inp[b * num_pts], &out[b * num_pts], NULL, ddr.data(), inv, transposed, tiled, depth, stats[id].data());
+      }
+    }
+    catch(const std::bad_alloc &){
+      failed = true;
+    }
+  };
+
+  std::vector<std::thread> pipelines;
+  try{
+    for(unsigned i = 1; i < num_pipelines; i++){
+      pipelines.emplace_back(pipeline, i);
+    }
+  }
+  catch(const std::system_error &){
+    // fewer pipelines, the remaining batches are picked up by the others
+  }
+  pipeline(0);
+
+  for(std::thread &p : pipelines){
+    p.join();
+  }
+
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  fft_time.exec_t = elapsed.count();
+  fft_time.valid = !failed;
+
+  std::lock_guard<std::mutex> lock(stats_lock);
+  for(unsigned i = 0; i < FFTMODEL_NUM_KERNELS; i++){
+    last_stats[i].iterations = 0;
+    last_stats[i].stalls = 0;
+    last_stats[i].bursts = 0;
+    for(unsigned p = 0; p < num_pipelines; p++){
+      last_stats[i].iterations += stats[p][i].iterations;
+      last_stats[i].stalls += stats[p][i].stalls;
+      last_stats[i].bursts += stats[p][i].bursts;
+    }
+  }
+
+  return fft_time;
+}
+
+fpga_t fftmodelf_c2c_3d_ddr(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  return model_3d_ddr(N, inp, out, inv, false, false, how_many);
+}
+
+fpga_t fftmodelf_c2c_3d_ddr_transposed(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  return model_3d_ddr(N, inp, out, inv, true, false, how_many);
+}
+
+fpga_t fftmodelf_c2c_3d_ddr_tiled(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned how_many){
+  return model_3d_ddr(N, inp, out, inv, false, true, how_many);
+}
+
+/**
+ * \brief  transforms through a variant of fft3d_ddr.cl replacing the accesses
+ *         of fetch and store, one launch per pass after the other
+ */
+static fpga_t model_3d_access(const unsigned N, const fftmodel::access_t *access, const bool *inv, const unsigned passes){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  fftmodel::fft3d_ddr_fn fft3d_ddr = find_fft3d_ddr(N);
+  if(fft3d_ddr == NULL){
+    return fft_time;
+  }
+
+  std::vector<fftmodel_stats_t> stats(FFTMODEL_NUM_KERNELS);
+
+  auto start = std::chrono::steady_clock::now();
+  try{
+    std::vector<float2> ddr((size_t)N * N * N);
+    for(unsigned pass = 0; pass < passes; pass++){
+      fft3d_ddr(NULL, NULL, &access[pass], ddr.data(), inv[pass], false, false, channel_depth, stats.data());
+    }
+    fft_time.valid = true;
+  }
+  catch(const std::bad_alloc &){
+    fft_time.valid = false;
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  fft_time.exec_t = elapsed.count();
+
+  set_last_stats(stats);
+  return fft_time;
+}
+
+/**
+ * \brief  slot map of the cube as fftfpgaf_sphere_set_map() uploads it, empty if the map is invalid
+ */
+static std::vector<int> sphere_slots(const unsigned N, const unsigned *map, const size_t num){
+  const size_t num_pts = (size_t)N * N * N;
+  if(map == NULL || num == 0 || num > num_pts)
+    return std::vector<int>();
+
+  std::vector<int> slot(num_pts, -1);
+  for(size_t i = 0; i < num; i++){
+    if(map[i] >= num_pts || slot[map[i]] != -1)
+      return std::vector<int>();
+    slot[map[i]] = (int)i;
+  }
+  return slot;
+}
+
+/**
+ * \brief  model fft3d_ddr_sphere.cl, inline float2 load_sphere() and inline
+ *         void store_sphere_pt() mirrored by the accesses
+ */
+static fpga_t model_3d_sphere(const unsigned N, const unsigned *map, const size_t num, const float2 *inp, float2 *out, const bool inv, const bool scatter){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  if(inp == NULL || out == NULL || find_fft3d_ddr(N) == NULL){
+    return fft_time;
+  }
+  const std::vector<int> slot = sphere_slots(N, map, num);
+  if(slot.empty()){
+    return fft_time;
+  }
+
+  fftmodel::access_t access;
+  access.load = [&](unsigned index){
+    if (!scatter)
+      return inp[index];
+
+    int where = slot[index];
+    return (where >= 0) ? inp[where] : float2{0.0f, 0.0f};
+  };
+  access.store = [&](unsigned index, const float2 &value){
+    if (scatter) {
+      out[index] = value;
+      return;
+    }
+
+    int where = slot[index];
+    if (where >= 0)
+      out[where] = value;
+  };
+
+  return model_3d_access(N, &access, &inv, 1);
+}
+
+fpga_t fftmodelf_c2c_3d_sphere_to_grid(const unsigned N, const unsigned *map, const size_t num, const float2 *packed, float2 *grid, const bool inv){
+  return model_3d_sphere(N, map, num, packed, grid, inv, true);
+}
+
+fpga_t fftmodelf_c2c_3d_grid_to_sphere(const unsigned N, const unsigned *map, const size_t num, const float2 *grid, float2 *packed, const bool inv){
+  return model_3d_sphere(N, map, num, grid, packed, inv, false);
+}
+
+/**
+ * \brief  model fft3d_ddr_pruned.cl, inline float2 load_pruned() and inline
+ *         void store_pruned_pt() mirrored by the accesses
+ */
+fpga_t fftmodelf_c2c_3d_ddr_pruned(const unsigned N, const unsigned m_in, const unsigned m_out, const float2 *inp, float2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  if(inp == NULL || out == NULL || find_fft3d_ddr(N) == NULL){
+    return fft_time;
+  }
+  if(m_in == 0 || m_in > N || m_out == 0 || m_out > N){
+    return fft_time;
+  }
+
+  fftmodel::access_t access;
+  access.load = [&](unsigned index){
+    unsigned z = index / (N * N), y = (index / N) % N, x = index % N;
+    return (z < m_in && y < m_in && x < m_in) ? inp[(z * m_in + y) * m_in + x] : float2{0.0f, 0.0f};
+  };
+  access.store = [&](unsigned index, const float2 &value){
+    unsigned z = index / (N * N), y = (index / N) % N, x = index % N;
+    if (z < m_out && y < m_out && x < m_out)
+      out[(z * m_out + y) * m_out + x] = value;
+  };
+
+  return model_3d_access(N, &access, &inv, 1);
+}
+
+/**
+ * \brief  model fft3d_ddr_split.cl, whose fetch and store access the real and
+ *         imaginary parts in separate arrays
+ */
+fpga_t fftmodelf_c2c_3d_ddr_split(const unsigned N, const float *inp_re, const float *inp_im, float *out_re, float *out_im, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  if(inp_re == NULL || inp_im == NULL || out_re == NULL || out_im == NULL || find_fft3d_ddr(N) == NULL){
+    return fft_time;
+  }
+
+  fftmodel::access_t access;
+  access.load = [&](unsigned index){
+    return float2{inp_re[index], inp_im[index]};
+  };
+  access.store = [&](unsigned index, const float2 &value){
+    out_re[index] = value.x;
+    out_im[index] = value.y;
+  };
+
+  return model_3d_access(N, &access, &inv, 1);
+}
+
+/**
+ * \brief  model fft3d_ddr_gradient.cl, the forward transform of the field
+ *         followed by a backward transform per component whose fetch applies
+ *         inline float2 derivative() to the spectrum
+ */
+fpga_t fftmodelf_gradient3d(const unsigned N, const float2 *inp, float2 *grad_x, float2 *grad_y, float2 *grad_z, const float scale){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  if(inp == NULL || grad_x == NULL || grad_y == NULL || grad_z == NULL || find_fft3d_ddr(N) == NULL){
+    return fft_time;
+  }
+
+  float2 *grad[3] = {grad_x, grad_y, grad_z};
+  std::vector<float2> spectrum;
+  try{
+    spectrum.resize((size_t)N * N * N);
+  }
+  catch(const std::bad_alloc &){
+    return fft_time;
+  }
+
+  fftmodel::access_t access[4];
+  const bool inv[4] = {false, true, true, true};
+
+  access[0].load = [&](unsigned index){ return inp[index]; };
+  access[0].store = [&](unsigned index, const float2 &value){ spectrum[index] = value; };
+
+  for(int component = 0; component < 3; component++){
+    // N^component, the stride of the dimension of the component
+    const unsigned stride = (component == 0) ? 1 : (component == 1) ? N : N * N;
+
+    access[component + 1].load = [&, component, stride](unsigned index){
+      const float2 value = spectrum[index];
+      unsigned freq = (index / stride) & (N - 1);
+      float k = (freq < (N / 2)) ? (float)freq : (freq == (N / 2)) ? 0.0f : (float)((int)freq - (int)N);
+
+      float2 res;
+      res.x = -value.y * scale * k;
+      res.y = value.x * scale * k;
+      return res;
+    };
+    access[component + 1].store = [&, component](unsigned index, const float2 &value){ grad[component][index] = value; };
+  }
+
+  return model_3d_access(N, access, inv, 4);
+}
+
+/**
+ * \brief  the batch is modelled as a single launch of the bitstream, as
+ *         fft1d_exec() does with count = batch
+ */
+static fpga_t model_1d(const unsigned N, const float2 *inp, float2 *out, const bool inv, const bool natural_order, const unsigned batch){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  fftmodel::fft1d_fn fft1d = find_fft1d(N);
+  if(inp == NULL || out == NULL || fft1d == NULL || batch == 0){
+    return fft_time;
+  }
+
+  std::vector<fftmodel_stats_t> stats(FFTMODEL_NUM_KERNELS);
+
+  auto start = std::chrono::steady_clock::now();
+  try{
+    fft1d(inp, out, inv, natural_order, batch, stats.data());
+    fft_time.valid = true;
+  }
+  catch(const std::bad_alloc &){
+    fft_time.valid = false;
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  fft_time.exec_t = elapsed.count();
+
+  set_last_stats(stats);
+  return fft_time;
+}
+
+fpga_t fftmodelf_c2c_1d(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch){
+  return model_1d(N, inp, out, inv, false, batch);
+}
+
+fpga_t fftmodelf_c2c_1d_natural(const unsigned N, const float2 *inp, float2 *out, const bool inv, const unsigned batch){
+  return model_1d(N, inp, out, inv, true, batch);
+}
+
+/**
+ * \brief  the first pass transforms the columns of the n x n matrix and
+ *         multiplies the twiddle factors, the second transforms its rows
+ */
+fpga_t fftmodelf_c2c_1d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  unsigned n = 1;
+  while((size_t)n * n < N)
+    n <<= 1;
+
+  fftmodel::fft2d_pass_fn fft2d_pass = find_fft2d_pass(n);
+  if(inp == NULL || out == NULL || (size_t)n * n != N || fft2d_pass == NULL){
+    return fft_time;
+  }
+
+  std::vector<fftmodel_stats_t> stats(FFTMODEL_NUM_KERNELS);
+
+  auto start = std::chrono::steady_clock::now();
+  try{
+    // intermediate result in the DDR
+    std::vector<float2> tmp(N);
+    const fftmodel::matrix_t matrix = {0, n, false};
+    fft2d_pass(inp, matrix, tmp.data(), matrix, true, true, inv, stats.data());
+    fft2d_pass(tmp.data(), matrix, out, matrix, false, false, inv, stats.data());
+    fft_time.valid = true;
+  }
+  catch(const std::bad_alloc &){
+    fft_time.valid = false;
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  fft_time.exec_t = elapsed.count();
+
+  set_last_stats(stats);
+  return fft_time;
+}
+
+/**
+ * \brief  the three stages of fftfpgaf_c2c_3d_large, each launching a pass
+ *         per plane. The second stage writes the tiled layout read by the
+ *         transposed fetch of the third.
+ */
+fpga_t fftmodelf_c2c_3d_large(const unsigned N, const float2 *inp, float2 *out, const bool inv){
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0.0, 0.0, false, FFTFPGA_BACKEND_MODEL};
+
+  fftmodel::fft2d_pass_fn fft2d_pass = find_fft2d_pass(N);
+  if(inp == NULL || out == NULL || fft2d_pass == NULL){
+    return fft_time;
+  }
+
+  const unsigned plane = N * N;
+  std::vector<fftmodel_stats_t> stats(FFTMODEL_NUM_KERNELS);
+
+  auto start = std::chrono::steady_clock::now();
+  try{
+    // the input buffer is overwritten by the 2D FFTs of the planes, out is
+    // the intermediate buffer that the output is read from
+    std::vector<float2> data(inp, inp + (size_t)plane * N);
+
+    for(unsigned i = 0; i < N; i++){
+      const fftmodel::matrix_t src = {i * plane, N, false}, dest = {i * plane, N, false};
+      fft2d_pass(data.data(), src, out, dest, false, false, inv, stats.data());
+    }
+    for(unsigned i = 0; i < N; i++){
+      const fftmodel::matrix_t src = {i * plane, N, false}, dest = {i * 8, plane, true};
+      fft2d_pass(out, src, data.data(), dest, false, false, inv, stats.data());
+    }
+    for(unsigned i = 0; i < N; i++){
+      const fftmodel::matrix_t src = {i * plane, 8, true}, dest = {i * N, plane, false};
+      fft2d_pass(data.data(), src, out, dest, true, false, inv, stats.data());
+    }
+    fft_time.valid = true;
+  }
+  catch(const std::bad_alloc &){
+    fft_time.valid = false;
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  fft_time.exec_t = elapsed.count();
+
+  set_last_stats(stats);
+  return fft_time;
+}
@@ -0,0 +1,171 @@
+//  Author: Arjun Ramaswami
+
+#include "gtest/gtest.h"  // finds this because gtest is linked
+#include <cmath>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern "C" {
+  #include "fftfpga/fftfpga.h"
+  #include "fftfpgad/fftfpgad.h"
+}
+
+/**
+ * \brief  start the daemon on a segment private to the test, on the mock device or on the emulator
+ * \param  bitstream : emulation bitstream, NULL to use the mock device computing on the host
+ */
+static pid_t start_daemon(const std::string &name, const char *bitstream){
+  setenv("FFTFPGAD_NAME", name.c_str(), 1);
+
+  pid_t pid = fork();
+  if(pid == 0){
+    if(bitstream == NULL){
+      char path[] = "/tmp/fftfpgad_mock_XXXXXX";
+      int fd = mkstemp(path);
+      if(fd < 0 || write(fd, "mock", 4) != 4)
+        _exit(EXIT_FAILURE);
+      close(fd);
+      setenv("LD_PRELOAD", MOCKOPENCL_LIB, 1);
+      setenv("FFTFPGA_FALLBACK", "1", 1);
+      execl(FFTFPGAD_BIN, FFTFPGAD_BIN, "-l", "mock", "-p", path, (char*)NULL);
+    }
+    else{
+      execl(FFTFPGAD_BIN, FFTFPGAD_BIN, "-e", "-p", bitstream, (char*)NULL);
+    }
+    _exit(EXIT_FAILURE);
+  }
+
+  // wait for the control segment
+  for(unsigned i = 0; i < 200; i++){
+    if(fpga_initialize(NULL, NULL, false) == 0){
+      fpga_final();
+      break;
+    }
+    usleep(50000);
+  }
+  return pid;
+}
+
+static void stop_daemon(const pid_t pid){
+  kill(pid, SIGTERM);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+/**
+ * \brief  3D FFTs of impulses, whose transforms are constant, computed by a client process
+ * \return number of wrong results
+ */
+static unsigned client_transforms(const unsigned N, const unsigned iter){
+  const size_t num_pts = (size_t)N * N * N;
+  unsigned errors = 0;
+
+  if(fpga_initialize(NULL, NULL, false) != 0)
+    return iter;
+
+  // alternate between copied and zero copy data
+  std::vector<float2> inp_heap(num_pts), out_heap(num_pts);
+  float2 *inp_shared = (float2*)fftfpgad_malloc(sizeof(float2) * num_pts);
+  float2 *out_shared = (float2*)fftfpgad_malloc(sizeof(float2) * num_pts);
+  if(inp_shared == NULL || out_shared == NULL)
+    return iter;
+
+  for(unsigned i = 0; i < iter; i++){
+    float2 *inp = (i % 2) ? inp_shared : inp_heap.data();
+    float2 *out = (i % 2) ? out_shared : out_heap.data();
+    for(size_t j = 0; j < num_pts; j++){
+      inp[j].x = (j == 0) ? (float)(i + 1) : 0.0f;
+      inp[j].y = 0.0f;
+    }
+
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, false);
+    bool correct = fft_time.valid;
+    for(size_t j = 0; j < num_pts && correct; j++)
+      correct = std::fabs(out[j].x - (float)(i + 1)) < 1e-3 && std::fabs(out[j].y) < 1e-3;
+    errors += correct ? 0 : 1;
+  }
+
+  fftfpgad_free(inp_shared);
+  fftfpgad_free(out_shared);
+  fpga_final();
+  return errors;
+}
+
+/**
+ * \brief  several client processes submitting to the daemon concurrently
+ */
+static void shared_by_processes(const char *bitstream, const unsigned N){
+  const unsigned num_clients = 4, iter = 6;
+  const std::string name = "/fftfpgad_test_" + std::to_string(getpid());
+  pid_t daemon = start_daemon(name, bitstream);
+  ASSERT_GT(daemon, 0);
+
+  std::vector<pid_t> clients;
+  for(unsigned c = 0; c < num_clients; c++){
+    pid_t pid = fork();
+    if(pid == 0)
+      _exit(client_transforms(N, iter) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    clients.push_back(pid);
+  }
+  for(pid_t pid : clients){
+    int status = 0;
+    waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+  }
+
+  // statistics published by the daemon
+  ASSERT_EQ(fpga_initialize(NULL, NULL, false), 0);
+  fftfpgad_stats_t stats;
+  ASSERT_TRUE(fftfpgad_get_stats(&stats));
+  EXPECT_EQ(stats.clients, 1u);
+  EXPECT_EQ(stats.queue_depth, 0u);
+  EXPECT_GE(stats.max_queue_depth, 1u);
+  EXPECT_EQ(stats.jobs, num_clients * iter);
+  EXPECT_GE(stats.batches, 1u);
+  EXPECT_LE(stats.batches, stats.jobs);
+  EXPECT_GE(stats.latency_max_ms, 0.0);
+  fpga_final();
+
+  stop_daemon(daemon);
+
+  // no daemon any more
+  EXPECT_EQ(fpga_initialize(NULL, NULL, false), -1);
+  unsetenv("FFTFPGAD_NAME");
+}
+
+/**
+ * \brief fpga_initialize() of the client without a daemon
+ */
+TEST(fftfpgadTest, NoDaemon){
+  setenv("FFTFPGAD_NAME", "/fftfpgad_test_none", 1);
+  std::vector<float2> inp(8), out(8);
+
+  EXPECT_EQ(fpga_initialize(NULL, NULL, false), -1);
+  EXPECT_EQ(fftfpgaf_c2c_1d(8, inp.data(), out.data(), false, 1).valid, 0);
+  EXPECT_EQ(fftfpgad_malloc(64), nullptr);
+
+  fftfpgad_stats_t stats;
+  EXPECT_FALSE(fftfpgad_get_stats(&stats));
+  unsetenv("FFTFPGAD_NAME");
+}
+
+/**
+ * \brief client processes sharing the mock device, which computes on the host
+ */
+TEST(fftfpgadTest, SharedByProcessesMock){
+  shared_by_processes(NULL, 16);
+}
+
+/**
+ * \brief client processes sharing the emulator
+ */
+TEST(fftfpgadTest, SharedByProcessesEmulation){
+  shared_by_processes("p520_hpc_sg280l/emulation/fft3d_ddr_64_nointer/fft3d_ddr.aocx", 64);
+}
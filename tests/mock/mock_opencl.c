@@ -0,0 +1,1070 @@
+// Author: Arjun Ramaswami
+
+// Mock of the OpenCL calls used by the host code, exporting the same symbols
+// as the OpenCL library. Linked ahead of the OpenCL library, or preloaded
+// using LD_PRELOAD, it replaces the device: data transfers are copies in host
+// memory, kernels are not executed and the profiling events report durations
+// derived from a configurable model on a virtual timeline per queue.
+//
+// Kernels connected by channels run concurrently and complete together. The
+// mock groups all kernels enqueued between two synchronizations of the host
+// into a pipeline, which completes with the last of its kernels.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#define CL_VERSION_2_0
+#include "CL/opencl.h"
+
+#include "mock_opencl.h"
+
+#define MOCKCL_MAX_ARGS 16
+
+#define MOCKCL_PLATFORM_NAME "Intel(R) FPGA Emulation Platform for OpenCL(TM) (mock)"
+#define MOCKCL_VENDOR "mock"
+#define MOCKCL_VERSION "OpenCL 2.0 mock"
+#define MOCKCL_DEVICE_NAME "mock FPGA device"
+
+// functions implemented, each with a call counter
+#define MOCKCL_FUNCTIONS(F) \
+  F(clGetPlatformIDs) F(clGetPlatformInfo) F(clGetDeviceIDs) F(clGetDeviceInfo) \
+  F(clCreateContext) F(clReleaseContext) \
+  F(clCreateCommandQueue) F(clReleaseCommandQueue) \
+  F(clCreateBuffer) F(clCreateSubBuffer) F(clReleaseMemObject) F(clGetMemObjectInfo) \
+  F(clCreateProgramWithBinary) F(clBuildProgram) F(clGetProgramInfo) F(clGetProgramBuildInfo) F(clReleaseProgram) \
+  F(clCreateKernel) F(clReleaseKernel) F(clGetKernelInfo) F(clSetKernelArg) F(clSetKernelArgSVMPointer) F(clSetKernelExecInfo) \
+  F(clEnqueueTask) F(clEnqueueNDRangeKernel) \
+  F(clEnqueueWriteBuffer) F(clEnqueueReadBuffer) F(clEnqueueCopyBuffer) F(clEnqueueFillBuffer) \
+  F(clEnqueueMapBuffer) F(clEnqueueUnmapMemObject) \
+  F(clEnqueueMarkerWithWaitList) F(clEnqueueBarrierWithWaitList) \
+  F(clFinish) F(clFlush) F(clWaitForEvents) \
+  F(clRetainEvent) F(clReleaseEvent) F(clGetEventInfo) F(clSetEventCallback) F(clGetEventProfilingInfo) \
+  F(clSVMAlloc) F(clSVMFree) F(clEnqueueSVMMap) F(clEnqueueSVMUnmap) F(clEnqueueSVMMemcpy)
+
+#define MOCKCL_ENUM(fn) FN_##fn,
+#define MOCKCL_NAME(fn) #fn,
+
+enum { MOCKCL_FUNCTIONS(MOCKCL_ENUM) MOCKCL_NUM_FUNCTIONS };
+static const char *function_names[] = { MOCKCL_FUNCTIONS(MOCKCL_NAME) };
+static atomic_ulong calls[MOCKCL_NUM_FUNCTIONS];
+
+// events created and not yet released
+static atomic_ulong live_events;
+
+#define COUNT(fn) atomic_fetch_add_explicit(&calls[FN_##fn], 1, memory_order_relaxed)
+
+struct _cl_platform_id { int id; };
+struct _cl_device_id { int id; };
+struct _cl_context { int id; };
+struct _cl_program { int id; };
+
+/**
+ * Kernels enqueued since the last synchronization of the host
+ */
+typedef struct {
+  unsigned refs;
+  cl_ulong end;         /**< completion of the last kernel */
+} pipeline_t;
+
+struct _cl_command_queue {
+  cl_ulong busy_until;  /**< virtual time in ns when the last command completes */
+  pipeline_t *pipeline; /**< pipeline of the last kernel enqueued, if any */
+};
+
+struct _cl_mem {
+  size_t size;
+  char *data;
+  bool owner;           /**< data allocated by the mock */
+};
+
+struct _cl_kernel {
+  size_t arg_bytes[MOCKCL_MAX_ARGS];  /**< size of the buffers passed as arguments, 0 for scalars */
+  unsigned num_args;                  /**< arguments of the signature, MOCKCL_MAX_ARGS if unknown */
+  bool arg_set[MOCKCL_MAX_ARGS];      /**< arguments set since the kernel was created */
+};
+
+struct _cl_event {
+  atomic_uint refs;
+  cl_ulong queued, start, end;
+  pipeline_t *pipeline; /**< pipeline of a kernel, NULL for other commands */
+};
+
+static struct _cl_platform_id mock_platform = {0};
+static struct _cl_device_id mock_device = {0};
+
+static mockcl_config_t config = {5.0, 6.0, 10.0, 19.2, false, false};
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+static cl_device_svm_capabilities svm_capabilities = CL_DEVICE_SVM_COARSE_GRAIN_BUFFER;
+
+// guards the configuration, the queue timelines, the pipelines and the registry of buffers
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pipeline_t *current_pipeline = NULL;
+
+/**
+ * Registry of buffers and SVM allocations, used to find the size of the
+ * buffers passed as kernel arguments
+ */
+typedef struct {
+  const void *key;
+  size_t size;
+} allocation_t;
+
+static allocation_t *allocations = NULL;
+static size_t num_allocations = 0, max_allocations = 0;
+
+static double env_double(const char *name, const double def){
+  const char *env = getenv(name);
+  return (env != NULL && strlen(env) > 0) ? atof(env) : def;
+}
+
+static void init_config(){
+  config.pcie_latency_us = env_double("MOCKCL_PCIE_LATENCY_US", config.pcie_latency_us);
+  config.pcie_gbps = env_double("MOCKCL_PCIE_GBPS", config.pcie_gbps);
+  config.kernel_latency_us = env_double("MOCKCL_KERNEL_LATENCY_US", config.kernel_latency_us);
+  config.kernel_gbps = env_double("MOCKCL_KERNEL_GBPS", config.kernel_gbps);
+  config.realtime = env_double("MOCKCL_REALTIME", 0.0) != 0.0;
+  config.spin = env_double("MOCKCL_SPIN", 0.0) != 0.0;
+}
+
+void mockcl_set_config(const mockcl_config_t *cfg){
+  pthread_once(&config_once, init_config);
+  if(cfg == NULL)
+    return;
+  pthread_mutex_lock(&mock_lock);
+  config = *cfg;
+  pthread_mutex_unlock(&mock_lock);
+}
+
+void mockcl_get_config(mockcl_config_t *cfg){
+  pthread_once(&config_once, init_config);
+  if(cfg == NULL)
+    return;
+  pthread_mutex_lock(&mock_lock);
+  *cfg = config;
+  pthread_mutex_unlock(&mock_lock);
+}
+
+unsigned long mockcl_calls(const char *name){
+  if(name == NULL)
+    return 0;
+  for(unsigned i = 0; i < MOCKCL_NUM_FUNCTIONS; i++){
+    if(strcmp(name, function_names[i]) == 0)
+      return atomic_load(&calls[i]);
+  }
+  return 0;
+}
+
+unsigned long mockcl_total_calls(){
+  unsigned long total = 0;
+  for(unsigned i = 0; i < MOCKCL_NUM_FUNCTIONS; i++){
+    total += atomic_load(&calls[i]);
+  }
+  return total;
+}
+
+unsigned mockcl_num_functions(){
+  return MOCKCL_NUM_FUNCTIONS;
+}
+
+const char* mockcl_function_name(const unsigned i){
+  return (i < MOCKCL_NUM_FUNCTIONS) ? function_names[i] : NULL;
+}
+
+unsigned long mockcl_live_events(){
+  return atomic_load(&live_events);
+}
+
+void mockcl_reset_calls(){
+  for(unsigned i = 0; i < MOCKCL_NUM_FUNCTIONS; i++){
+    atomic_store(&calls[i], 0);
+  }
+}
+
+static cl_ulong now_ns(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (cl_ulong)ts.tv_sec * 1000000000UL + (cl_ulong)ts.tv_nsec;
+}
+
+// block the host until the virtual time t, if modelled in real time, polling if the runtime spins
+static void wait_until(const cl_ulong t, const bool may_spin){
+  pthread_mutex_lock(&mock_lock);
+  const bool realtime = config.realtime;
+  const bool spin = may_spin && config.spin;
+  pthread_mutex_unlock(&mock_lock);
+
+  if(!realtime)
+    return;
+  if(spin){
+    while(now_ns() < t)
+      ;
+    return;
+  }
+  for(cl_ulong now = now_ns(); now < t; now = now_ns()){
+    struct timespec ts = {(time_t)((t - now) / 1000000000UL), (long)((t - now) % 1000000000UL)};
+    nanosleep(&ts, NULL);
+  }
+}
+
+// duration in ns of a transfer over PCIe, GB/s being bytes per ns
+static double transfer_ns(const size_t bytes){
+  return (config.pcie_latency_us * 1e3) + (config.pcie_gbps > 0.0 ? (double)bytes / config.pcie_gbps : 0.0);
+}
+
+static double kernel_ns(const size_t bytes){
+  return (config.kernel_latency_us * 1e3) + (config.kernel_gbps > 0.0 ? (double)bytes / config.kernel_gbps : 0.0);
+}
+
+static void track(const void *key, const size_t size){
+  pthread_mutex_lock(&mock_lock);
+  if(num_allocations == max_allocations){
+    size_t max = (max_allocations == 0) ? 64 : 2 * max_allocations;
+    allocation_t *tmp = (allocation_t*)realloc(allocations, max * sizeof(allocation_t));
+    if(tmp == NULL){
+      pthread_mutex_unlock(&mock_lock);
+      return;
+    }
+    allocations = tmp;
+    max_allocations = max;
+  }
+  allocations[num_allocations].key = key;
+  allocations[num_allocations].size = size;
+  num_allocations++;
+  pthread_mutex_unlock(&mock_lock);
+}
+
+static void untrack(const void *key){
+  pthread_mutex_lock(&mock_lock);
+  for(size_t i = 0; i < num_allocations; i++){
+    if(allocations[i].key == key){
+      allocations[i] = allocations[--num_allocations];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&mock_lock);
+}
+
+// size of a tracked buffer, 0 if the key is not a buffer
+static size_t tracked_size(const void *key){
+  size_t size = 0;
+  pthread_mutex_lock(&mock_lock);
+  for(size_t i = 0; i < num_allocations; i++){
+    if(allocations[i].key == key){
+      size = allocations[i].size;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&mock_lock);
+  return size;
+}
+
+// the following require mock_lock to be held
+
+static pipeline_t* retain_pipeline(pipeline_t *pipeline){
+  if(pipeline != NULL)
+    pipeline->refs++;
+  return pipeline;
+}
+
+static void release_pipeline(pipeline_t *pipeline){
+  if(pipeline != NULL && --pipeline->refs == 0)
+    free(pipeline);
+}
+
+// the host synchronized, subsequent kernels form a new pipeline
+static void close_pipeline(){
+  release_pipeline(current_pipeline);
+  current_pipeline = NULL;
+}
+
+static cl_ulong event_end(const cl_event event){
+  if(event->pipeline != NULL && event->pipeline->end > event->end)
+    return event->pipeline->end;
+  return event->end;
+}
+
+static cl_ulong queue_end(const cl_command_queue queue){
+  if(queue->pipeline != NULL && queue->pipeline->end > queue->busy_until)
+    return queue->pipeline->end;
+  return queue->busy_until;
+}
+
+// the host waits for a command, which ends the current pipeline
+static void synchronize(const cl_ulong t){
+  pthread_mutex_lock(&mock_lock);
+  close_pipeline();
+  pthread_mutex_unlock(&mock_lock);
+  wait_until(t, true);
+}
+
+/**
+ * \brief  schedule a command on the virtual timeline of the queue, after the
+ *         previous command of the queue and the events waited for
+ * \param  duration_ns : function of the model computing the duration in ns
+ * \param  bytes       : argument of the duration function
+ * \param  is_kernel   : kernels are added to the current pipeline
+ * \param  blocking    : block the host until completion
+ * \return CL_SUCCESS or error
+ */
+static cl_int enqueue(cl_command_queue queue, double (*duration_ns)(const size_t), const size_t bytes, cl_uint num_events, const cl_event *wait_list, cl_event *event, const bool is_kernel, const bool blocking){
+  if(queue == NULL)
+    return CL_INVALID_COMMAND_QUEUE;
+  if((num_events > 0 && wait_list == NULL) || (num_events == 0 && wait_list != NULL))
+    return CL_INVALID_EVENT_WAIT_LIST;
+
+  pthread_once(&config_once, init_config);
+
+  cl_event ev = NULL;
+  if(event != NULL){
+    ev = (cl_event)malloc(sizeof(struct _cl_event));
+    if(ev == NULL)
+      return CL_OUT_OF_HOST_MEMORY;
+    atomic_init(&ev->refs, 1);
+    atomic_fetch_add(&live_events, 1);
+  }
+
+  const cl_ulong queued = now_ns();
+
+  pthread_mutex_lock(&mock_lock);
+  cl_ulong start = queue_end(queue);
+  if(start < queued)
+    start = queued;
+  for(cl_uint i = 0; i < num_events; i++){
+    if(wait_list[i] != NULL && event_end(wait_list[i]) > start)
+      start = event_end(wait_list[i]);
+  }
+  const cl_ulong end = start + (cl_ulong)duration_ns(bytes);
+  queue->busy_until = end;
+
+  pipeline_t *pipeline = NULL;
+  if(is_kernel){
+    if(current_pipeline == NULL){
+      current_pipeline = (pipeline_t*)calloc(1, sizeof(pipeline_t));
+      retain_pipeline(current_pipeline);
+    }
+    pipeline = current_pipeline;
+    if(pipeline != NULL && pipeline->end < end)
+      pipeline->end = end;
+  }
+  release_pipeline(queue->pipeline);
+  queue->pipeline = retain_pipeline(pipeline);
+
+  if(ev != NULL){
+    ev->queued = queued;
+    ev->start = start;
+    ev->end = end;
+    ev->pipeline = retain_pipeline(pipeline);
+    *event = ev;
+  }
+  pthread_mutex_unlock(&mock_lock);
+
+  if(blocking)
+    synchronize(end);
+  return CL_SUCCESS;
+}
+
+static cl_int get_info(const void *value, const size_t value_size, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  if(param_value != NULL){
+    if(param_value_size < value_size)
+      return CL_INVALID_VALUE;
+    memcpy(param_value, value, value_size);
+  }
+  if(param_value_size_ret != NULL)
+    *param_value_size_ret = value_size;
+  return CL_SUCCESS;
+}
+
+static void set_status(cl_int *errcode_ret, const cl_int status){
+  if(errcode_ret != NULL)
+    *errcode_ret = status;
+}
+
+/* Platform and device */
+
+CL_API_ENTRY cl_int CL_API_CALL clGetPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms){
+  COUNT(clGetPlatformIDs);
+  if((num_entries == 0 && platforms != NULL) || (platforms == NULL && num_platforms == NULL))
+    return CL_INVALID_VALUE;
+  if(platforms != NULL)
+    platforms[0] = &mock_platform;
+  if(num_platforms != NULL)
+    *num_platforms = 1;
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetPlatformInfo(cl_platform_id platform, cl_platform_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetPlatformInfo);
+  if(platform != &mock_platform)
+    return CL_INVALID_PLATFORM;
+
+  switch(param_name){
+    case CL_PLATFORM_NAME:
+      return get_info(MOCKCL_PLATFORM_NAME, sizeof(MOCKCL_PLATFORM_NAME), param_value_size, param_value, param_value_size_ret);
+    case CL_PLATFORM_VENDOR:
+      return get_info(MOCKCL_VENDOR, sizeof(MOCKCL_VENDOR), param_value_size, param_value, param_value_size_ret);
+    case CL_PLATFORM_VERSION:
+      return get_info(MOCKCL_VERSION, sizeof(MOCKCL_VERSION), param_value_size, param_value, param_value_size_ret);
+    default:
+      return CL_INVALID_VALUE;
+  }
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id *devices, cl_uint *num_devices){
+  COUNT(clGetDeviceIDs);
+  if(platform != &mock_platform)
+    return CL_INVALID_PLATFORM;
+  if((num_entries == 0 && devices != NULL) || (devices == NULL && num_devices == NULL))
+    return CL_INVALID_VALUE;
+  if(devices != NULL)
+    devices[0] = &mock_device;
+  if(num_devices != NULL)
+    *num_devices = 1;
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(cl_device_id device, cl_device_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetDeviceInfo);
+  if(device != &mock_device)
+    return CL_INVALID_DEVICE;
+
+  switch(param_name){
+    case CL_DEVICE_NAME:
+      return get_info(MOCKCL_DEVICE_NAME, sizeof(MOCKCL_DEVICE_NAME), param_value_size, param_value, param_value_size_ret);
+    case CL_DEVICE_SVM_CAPABILITIES: {
+      cl_device_svm_capabilities caps = svm_capabilities;
+      return get_info(&caps, sizeof(caps), param_value_size, param_value, param_value_size_ret);
+    }
+    default:
+      return CL_INVALID_VALUE;
+  }
+}
+
+/* Context and command queue */
+
+CL_API_ENTRY cl_context CL_API_CALL clCreateContext(const cl_context_properties *properties, cl_uint num_devices, const cl_device_id *devices, void (CL_CALLBACK *pfn_notify)(const char *, const void *, size_t, void *), void *user_data, cl_int *errcode_ret){
+  COUNT(clCreateContext);
+  if(num_devices == 0 || devices == NULL){
+    set_status(errcode_ret, CL_INVALID_VALUE);
+    return NULL;
+  }
+  cl_context ctx = (cl_context)calloc(1, sizeof(struct _cl_context));
+  set_status(errcode_ret, (ctx != NULL) ? CL_SUCCESS : CL_OUT_OF_HOST_MEMORY);
+  return ctx;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseContext(cl_context ctx){
+  COUNT(clReleaseContext);
+  if(ctx == NULL)
+    return CL_INVALID_CONTEXT;
+  free(ctx);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueue(cl_context ctx, cl_device_id device, cl_command_queue_properties properties, cl_int *errcode_ret){
+  COUNT(clCreateCommandQueue);
+  if(ctx == NULL){
+    set_status(errcode_ret, CL_INVALID_CONTEXT);
+    return NULL;
+  }
+  cl_command_queue queue = (cl_command_queue)calloc(1, sizeof(struct _cl_command_queue));
+  set_status(errcode_ret, (queue != NULL) ? CL_SUCCESS : CL_OUT_OF_HOST_MEMORY);
+  return queue;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseCommandQueue(cl_command_queue queue){
+  COUNT(clReleaseCommandQueue);
+  if(queue == NULL)
+    return CL_INVALID_COMMAND_QUEUE;
+  pthread_mutex_lock(&mock_lock);
+  release_pipeline(queue->pipeline);
+  pthread_mutex_unlock(&mock_lock);
+  free(queue);
+  return CL_SUCCESS;
+}
+
+/* Memory objects */
+
+CL_API_ENTRY cl_mem CL_API_CALL clCreateBuffer(cl_context ctx, cl_mem_flags flags, size_t size, void *host_ptr, cl_int *errcode_ret){
+  COUNT(clCreateBuffer);
+  if(ctx == NULL){
+    set_status(errcode_ret, CL_INVALID_CONTEXT);
+    return NULL;
+  }
+  if(size == 0){
+    set_status(errcode_ret, CL_INVALID_BUFFER_SIZE);
+    return NULL;
+  }
+
+  cl_mem mem = (cl_mem)malloc(sizeof(struct _cl_mem));
+  if(mem == NULL){
+    set_status(errcode_ret, CL_OUT_OF_HOST_MEMORY);
+    return NULL;
+  }
+  mem->size = size;
+  mem->owner = !(flags & CL_MEM_USE_HOST_PTR);
+  mem->data = mem->owner ? (char*)malloc(size) : (char*)host_ptr;
+  if(mem->data == NULL){
+    free(mem);
+    set_status(errcode_ret, CL_OUT_OF_HOST_MEMORY);
+    return NULL;
+  }
+  if((flags & CL_MEM_COPY_HOST_PTR) && host_ptr != NULL)
+    memcpy(mem->data, host_ptr, size);
+
+  track(mem, size);
+  set_status(errcode_ret, CL_SUCCESS);
+  return mem;
+}
+
+CL_API_ENTRY cl_mem CL_API_CALL clCreateSubBuffer(cl_mem buffer, cl_mem_flags flags, cl_buffer_create_type create_type, const void *create_info, cl_int *errcode_ret){
+  COUNT(clCreateSubBuffer);
+  const cl_buffer_region *region = (const cl_buffer_region*)create_info;
+  if(buffer == NULL){
+    set_status(errcode_ret, CL_INVALID_MEM_OBJECT);
+    return NULL;
+  }
+  if(create_type != CL_BUFFER_CREATE_TYPE_REGION || region == NULL || region->size == 0 || region->origin + region->size > buffer->size){
+    set_status(errcode_ret, CL_INVALID_VALUE);
+    return NULL;
+  }
+
+  cl_mem mem = (cl_mem)malloc(sizeof(struct _cl_mem));
+  if(mem == NULL){
+    set_status(errcode_ret, CL_OUT_OF_HOST_MEMORY);
+    return NULL;
+  }
+  mem->size = region->size;
+  mem->data = buffer->data + region->origin;
+  mem->owner = false;
+
+  track(mem, mem->size);
+  set_status(errcode_ret, CL_SUCCESS);
+  return mem;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseMemObject(cl_mem mem){
+  COUNT(clReleaseMemObject);
+  if(mem == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  untrack(mem);
+  if(mem->owner)
+    free(mem->data);
+  free(mem);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetMemObjectInfo(cl_mem mem, cl_mem_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetMemObjectInfo);
+  if(mem == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  if(param_name != CL_MEM_SIZE)
+    return CL_INVALID_VALUE;
+  return get_info(&mem->size, sizeof(size_t), param_value_size, param_value, param_value_size_ret);
+}
+
+/* Program and kernels */
+
+CL_API_ENTRY cl_program CL_API_CALL clCreateProgramWithBinary(cl_context ctx, cl_uint num_devices, const cl_device_id *device_list, const size_t *lengths, const unsigned char **binaries, cl_int *binary_status, cl_int *errcode_ret){
+  COUNT(clCreateProgramWithBinary);
+  if(ctx == NULL){
+    set_status(errcode_ret, CL_INVALID_CONTEXT);
+    return NULL;
+  }
+  if(num_devices == 0 || device_list == NULL || lengths == NULL || binaries == NULL){
+    set_status(errcode_ret, CL_INVALID_VALUE);
+    return NULL;
+  }
+
+  cl_program prog = (cl_program)calloc(1, sizeof(struct _cl_program));
+  if(binary_status != NULL){
+    for(cl_uint i = 0; i < num_devices; i++)
+      binary_status[i] = CL_SUCCESS;
+  }
+  set_status(errcode_ret, (prog != NULL) ? CL_SUCCESS : CL_OUT_OF_HOST_MEMORY);
+  return prog;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clBuildProgram(cl_program prog, cl_uint num_devices, const cl_device_id *device_list, const char *options, void (CL_CALLBACK *pfn_notify)(cl_program, void *), void *user_data){
+  COUNT(clBuildProgram);
+  return (prog != NULL) ? CL_SUCCESS : CL_INVALID_PROGRAM;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetProgramBuildInfo(cl_program prog, cl_device_id device, cl_program_build_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetProgramBuildInfo);
+  if(prog == NULL)
+    return CL_INVALID_PROGRAM;
+  if(param_name != CL_PROGRAM_BUILD_LOG)
+    return CL_INVALID_VALUE;
+  return get_info("", 1, param_value_size, param_value, param_value_size_ret);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseProgram(cl_program prog){
+  COUNT(clReleaseProgram);
+  if(prog == NULL)
+    return CL_INVALID_PROGRAM;
+  free(prog);
+  return CL_SUCCESS;
+}
+
+// every kernel name is available in the mock program
+// kernels found in programs, any if NULL
+static const char **kernel_names = NULL;
+
+void mockcl_set_kernels(const char **names){
+  kernel_names = names;
+}
+
+void mockcl_set_svm_capabilities(const unsigned long caps){
+  svm_capabilities = caps;
+}
+
+// signatures of the kernels found in programs, none if NULL
+static const mockcl_kernel_args_t *kernel_args = NULL;
+
+void mockcl_set_kernel_args(const mockcl_kernel_args_t *kernels){
+  kernel_args = kernels;
+}
+
+static unsigned kernel_num_args(const char *kernel_name){
+  for(unsigned i = 0; kernel_args != NULL && kernel_args[i].name != NULL; i++){
+    if(strcmp(kernel_args[i].name, kernel_name) == 0)
+      return kernel_args[i].num_args;
+  }
+  return MOCKCL_MAX_ARGS;
+}
+
+static bool kernel_found(const char *kernel_name){
+  if(kernel_names == NULL)
+    return true;
+  for(unsigned i = 0; kernel_names[i] != NULL; i++){
+    if(strcmp(kernel_names[i], kernel_name) == 0)
+      return true;
+  }
+  return false;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetProgramInfo(cl_program prog, cl_program_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetProgramInfo);
+  if(prog == NULL)
+    return CL_INVALID_PROGRAM;
+  // a program finding any kernel has no list of names to report
+  if(param_name != CL_PROGRAM_KERNEL_NAMES || kernel_names == NULL)
+    return CL_INVALID_VALUE;
+
+  char names[1024] = "";
+  for(unsigned i = 0; kernel_names[i] != NULL; i++){
+    if(i > 0)
+      strncat(names, ";", sizeof(names) - strlen(names) - 1);
+    strncat(names, kernel_names[i], sizeof(names) - strlen(names) - 1);
+  }
+  return get_info(names, strlen(names) + 1, param_value_size, param_value, param_value_size_ret);
+}
+
+CL_API_ENTRY cl_kernel CL_API_CALL clCreateKernel(cl_program prog, const char *kernel_name, cl_int *errcode_ret){
+  COUNT(clCreateKernel);
+  if(prog == NULL){
+    set_status(errcode_ret, CL_INVALID_PROGRAM);
+    return NULL;
+  }
+  if(kernel_name == NULL){
+    set_status(errcode_ret, CL_INVALID_VALUE);
+    return NULL;
+  }
+  if(!kernel_found(kernel_name)){
+    set_status(errcode_ret, CL_INVALID_KERNEL_NAME);
+    return NULL;
+  }
+  cl_kernel kernel = (cl_kernel)calloc(1, sizeof(struct _cl_kernel));
+  if(kernel != NULL)
+    kernel->num_args = kernel_num_args(kernel_name);
+  set_status(errcode_ret, (kernel != NULL) ? CL_SUCCESS : CL_OUT_OF_HOST_MEMORY);
+  return kernel;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseKernel(cl_kernel kernel){
+  COUNT(clReleaseKernel);
+  if(kernel == NULL)
+    return CL_INVALID_KERNEL;
+  free(kernel);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetKernelInfo(cl_kernel kernel, cl_kernel_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetKernelInfo);
+  if(kernel == NULL)
+    return CL_INVALID_KERNEL;
+  if(param_name != CL_KERNEL_NUM_ARGS)
+    return CL_INVALID_VALUE;
+  cl_uint num_args = kernel->num_args;
+  return get_info(&num_args, sizeof(cl_uint), param_value_size, param_value, param_value_size_ret);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clSetKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value){
+  COUNT(clSetKernelArg);
+  if(kernel == NULL)
+    return CL_INVALID_KERNEL;
+  if(arg_index >= kernel->num_args)
+    return CL_INVALID_ARG_INDEX;
+
+  // a buffer argument is passed as the value of its handle
+  size_t bytes = 0;
+  if(arg_size == sizeof(cl_mem) && arg_value != NULL){
+    cl_mem mem;
+    memcpy(&mem, arg_value, sizeof(cl_mem));
+    bytes = tracked_size(mem);
+  }
+  kernel->arg_bytes[arg_index] = bytes;
+  kernel->arg_set[arg_index] = true;
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clSetKernelArgSVMPointer(cl_kernel kernel, cl_uint arg_index, const void *arg_value){
+  COUNT(clSetKernelArgSVMPointer);
+  if(kernel == NULL)
+    return CL_INVALID_KERNEL;
+  if(arg_index >= kernel->num_args)
+    return CL_INVALID_ARG_INDEX;
+  kernel->arg_bytes[arg_index] = tracked_size(arg_value);
+  kernel->arg_set[arg_index] = true;
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clSetKernelExecInfo(cl_kernel kernel, cl_kernel_exec_info param_name, size_t param_value_size, const void *param_value){
+  COUNT(clSetKernelExecInfo);
+  return (kernel != NULL) ? CL_SUCCESS : CL_INVALID_KERNEL;
+}
+
+// kernels stream the largest buffer they are passed through global memory
+static size_t kernel_bytes(const cl_kernel kernel){
+  size_t bytes = 0;
+  for(unsigned i = 0; i < MOCKCL_MAX_ARGS; i++){
+    if(kernel->arg_bytes[i] > bytes)
+      bytes = kernel->arg_bytes[i];
+  }
+  return bytes;
+}
+
+// kernels of a known signature require all of its arguments
+static bool kernel_args_set(const cl_kernel kernel){
+  if(kernel->num_args == MOCKCL_MAX_ARGS)
+    return true;
+  for(unsigned i = 0; i < kernel->num_args; i++){
+    if(!kernel->arg_set[i])
+      return false;
+  }
+  return true;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueTask(cl_command_queue queue, cl_kernel kernel, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueTask);
+  if(kernel == NULL)
+    return CL_INVALID_KERNEL;
+  if(!kernel_args_set(kernel))
+    return CL_INVALID_KERNEL_ARGS;
+  return enqueue(queue, kernel_ns, kernel_bytes(kernel), num_events_in_wait_list, event_wait_list, event, true, false);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueNDRangeKernel(cl_command_queue queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *local_work_size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueNDRangeKernel);
+  if(kernel == NULL)
+    return CL_INVALID_KERNEL;
+  if(work_dim == 0 || global_work_size == NULL)
+    return CL_INVALID_VALUE;
+  if(!kernel_args_set(kernel))
+    return CL_INVALID_KERNEL_ARGS;
+  return enqueue(queue, kernel_ns, kernel_bytes(kernel), num_events_in_wait_list, event_wait_list, event, true, false);
+}
+
+/* Data transfers, copied when enqueued */
+
+static double no_duration_ns(const size_t bytes){
+  return 0.0;
+}
+
+static double latency_ns(const size_t bytes){
+  return config.pcie_latency_us * 1e3;
+}
+
+static double device_copy_ns(const size_t bytes){
+  return (config.kernel_gbps > 0.0) ? (double)bytes / config.kernel_gbps : 0.0;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueWriteBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size, const void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueWriteBuffer);
+  if(buffer == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  if(ptr == NULL || offset + size > buffer->size)
+    return CL_INVALID_VALUE;
+  memcpy(buffer->data + offset, ptr, size);
+  return enqueue(queue, transfer_ns, size, num_events_in_wait_list, event_wait_list, event, false, blocking_write);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueReadBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size, void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueReadBuffer);
+  if(buffer == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  if(ptr == NULL || offset + size > buffer->size)
+    return CL_INVALID_VALUE;
+  memcpy(ptr, buffer->data + offset, size);
+  return enqueue(queue, transfer_ns, size, num_events_in_wait_list, event_wait_list, event, false, blocking_read);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueCopyBuffer(cl_command_queue queue, cl_mem src_buffer, cl_mem dst_buffer, size_t src_offset, size_t dst_offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueCopyBuffer);
+  if(src_buffer == NULL || dst_buffer == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  if(src_offset + size > src_buffer->size || dst_offset + size > dst_buffer->size)
+    return CL_INVALID_VALUE;
+  memmove(dst_buffer->data + dst_offset, src_buffer->data + src_offset, size);
+  return enqueue(queue, device_copy_ns, size, num_events_in_wait_list, event_wait_list, event, false, false);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueFillBuffer(cl_command_queue queue, cl_mem buffer, const void *pattern, size_t pattern_size, size_t offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueFillBuffer);
+  if(buffer == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  if(pattern == NULL || pattern_size == 0 || (offset % pattern_size) != 0 || (size % pattern_size) != 0 || offset + size > buffer->size)
+    return CL_INVALID_VALUE;
+  for(size_t i = 0; i < size; i += pattern_size){
+    memcpy(buffer->data + offset + i, pattern, pattern_size);
+  }
+  return enqueue(queue, device_copy_ns, size, num_events_in_wait_list, event_wait_list, event, false, false);
+}
+
+CL_API_ENTRY void* CL_API_CALL clEnqueueMapBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_map, cl_map_flags map_flags, size_t offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event, cl_int *errcode_ret){
+  COUNT(clEnqueueMapBuffer);
+  if(buffer == NULL){
+    set_status(errcode_ret, CL_INVALID_MEM_OBJECT);
+    return NULL;
+  }
+  if(offset + size > buffer->size){
+    set_status(errcode_ret, CL_INVALID_VALUE);
+    return NULL;
+  }
+  cl_int status = enqueue(queue, transfer_ns, size, num_events_in_wait_list, event_wait_list, event, false, blocking_map);
+  set_status(errcode_ret, status);
+  return (status == CL_SUCCESS) ? buffer->data + offset : NULL;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueUnmapMemObject(cl_command_queue queue, cl_mem memobj, void *mapped_ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueUnmapMemObject);
+  if(memobj == NULL)
+    return CL_INVALID_MEM_OBJECT;
+  return enqueue(queue, latency_ns, 0, num_events_in_wait_list, event_wait_list, event, false, false);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueMarkerWithWaitList(cl_command_queue queue, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueMarkerWithWaitList);
+  return enqueue(queue, no_duration_ns, 0, num_events_in_wait_list, event_wait_list, event, false, false);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueBarrierWithWaitList(cl_command_queue queue, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueBarrierWithWaitList);
+  return enqueue(queue, no_duration_ns, 0, num_events_in_wait_list, event_wait_list, event, false, false);
+}
+
+/* Synchronization and events */
+
+CL_API_ENTRY cl_int CL_API_CALL clFinish(cl_command_queue queue){
+  COUNT(clFinish);
+  if(queue == NULL)
+    return CL_INVALID_COMMAND_QUEUE;
+  pthread_mutex_lock(&mock_lock);
+  const cl_ulong end = queue_end(queue);
+  pthread_mutex_unlock(&mock_lock);
+  synchronize(end);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clFlush(cl_command_queue queue){
+  COUNT(clFlush);
+  return (queue != NULL) ? CL_SUCCESS : CL_INVALID_COMMAND_QUEUE;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clWaitForEvents(cl_uint num_events, const cl_event *event_list){
+  COUNT(clWaitForEvents);
+  if(num_events == 0 || event_list == NULL)
+    return CL_INVALID_VALUE;
+
+  cl_ulong end = 0;
+  pthread_mutex_lock(&mock_lock);
+  for(cl_uint i = 0; i < num_events; i++){
+    if(event_list[i] == NULL){
+      pthread_mutex_unlock(&mock_lock);
+      return CL_INVALID_EVENT;
+    }
+    if(event_end(event_list[i]) > end)
+      end = event_end(event_list[i]);
+  }
+  pthread_mutex_unlock(&mock_lock);
+  synchronize(end);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clRetainEvent(cl_event event){
+  COUNT(clRetainEvent);
+  if(event == NULL)
+    return CL_INVALID_EVENT;
+  atomic_fetch_add(&event->refs, 1);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clReleaseEvent(cl_event event){
+  COUNT(clReleaseEvent);
+  if(event == NULL)
+    return CL_INVALID_EVENT;
+  if(atomic_fetch_sub(&event->refs, 1) == 1){
+    pthread_mutex_lock(&mock_lock);
+    release_pipeline(event->pipeline);
+    pthread_mutex_unlock(&mock_lock);
+    free(event);
+    atomic_fetch_sub(&live_events, 1);
+  }
+  return CL_SUCCESS;
+}
+
+static cl_ulong completion(const cl_event event){
+  pthread_mutex_lock(&mock_lock);
+  const cl_ulong end = event_end(event);
+  pthread_mutex_unlock(&mock_lock);
+  return end;
+}
+
+static bool is_complete(const cl_event event){
+  pthread_mutex_lock(&mock_lock);
+  const bool realtime = config.realtime;
+  const cl_ulong end = event_end(event);
+  pthread_mutex_unlock(&mock_lock);
+  return !realtime || now_ns() >= end;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetEventInfo(cl_event event, cl_event_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetEventInfo);
+  if(event == NULL)
+    return CL_INVALID_EVENT;
+  if(param_name != CL_EVENT_COMMAND_EXECUTION_STATUS)
+    return CL_INVALID_VALUE;
+
+  cl_int status = is_complete(event) ? CL_COMPLETE : CL_RUNNING;
+  return get_info(&status, sizeof(cl_int), param_value_size, param_value, param_value_size_ret);
+}
+
+typedef struct {
+  cl_event event;
+  void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *);
+  void *user_data;
+} callback_t;
+
+static void* run_callback(void *arg){
+  callback_t *cb = (callback_t*)arg;
+  // the runtime thread sleeps on an interrupt, the host synchronizes in the callback
+  wait_until(completion(cb->event), false);
+  pthread_mutex_lock(&mock_lock);
+  close_pipeline();
+  pthread_mutex_unlock(&mock_lock);
+  cb->pfn_notify(cb->event, CL_COMPLETE, cb->user_data);
+  clReleaseEvent(cb->event);
+  free(cb);
+  return NULL;
+}
+
+// callbacks are called from a separate thread, once the command completed
+CL_API_ENTRY cl_int CL_API_CALL clSetEventCallback(cl_event event, cl_int command_exec_callback_type, void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *), void *user_data){
+  COUNT(clSetEventCallback);
+  if(event == NULL)
+    return CL_INVALID_EVENT;
+  if(pfn_notify == NULL || command_exec_callback_type != CL_COMPLETE)
+    return CL_INVALID_VALUE;
+
+  callback_t *cb = (callback_t*)malloc(sizeof(callback_t));
+  if(cb == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+  cb->event = event;
+  cb->pfn_notify = pfn_notify;
+  cb->user_data = user_data;
+  atomic_fetch_add(&event->refs, 1);
+
+  pthread_t thread;
+  if(pthread_create(&thread, NULL, run_callback, cb) != 0){
+    atomic_fetch_sub(&event->refs, 1);
+    free(cb);
+    return CL_OUT_OF_HOST_MEMORY;
+  }
+  pthread_detach(thread);
+  return CL_SUCCESS;
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clGetEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret){
+  COUNT(clGetEventProfilingInfo);
+  if(event == NULL)
+    return CL_INVALID_EVENT;
+
+  cl_ulong value;
+  switch(param_name){
+    case CL_PROFILING_COMMAND_QUEUED:
+    case CL_PROFILING_COMMAND_SUBMIT:
+      value = event->queued;
+      break;
+    case CL_PROFILING_COMMAND_START:
+      value = event->start;
+      break;
+    case CL_PROFILING_COMMAND_END:
+      value = completion(event);
+      break;
+    default:
+      return CL_INVALID_VALUE;
+  }
+  if(!is_complete(event))
+    return CL_PROFILING_INFO_NOT_AVAILABLE;
+  return get_info(&value, sizeof(cl_ulong), param_value_size, param_value, param_value_size_ret);
+}
+
+/* Shared virtual memory, in host memory */
+
+CL_API_ENTRY void* CL_API_CALL clSVMAlloc(cl_context ctx, cl_svm_mem_flags flags, size_t size, cl_uint alignment){
+  COUNT(clSVMAlloc);
+  if(ctx == NULL || size == 0)
+    return NULL;
+
+  void *ptr = NULL;
+  if(posix_memalign(&ptr, (alignment >= sizeof(void*)) ? alignment : 64, size) != 0)
+    return NULL;
+  track(ptr, size);
+  return ptr;
+}
+
+CL_API_ENTRY void CL_API_CALL clSVMFree(cl_context ctx, void *svm_pointer){
+  COUNT(clSVMFree);
+  if(svm_pointer == NULL)
+    return;
+  untrack(svm_pointer);
+  free(svm_pointer);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMap(cl_command_queue queue, cl_bool blocking_map, cl_map_flags flags, void *svm_ptr, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueSVMMap);
+  if(svm_ptr == NULL || size == 0)
+    return CL_INVALID_VALUE;
+  return enqueue(queue, latency_ns, 0, num_events_in_wait_list, event_wait_list, event, false, blocking_map);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMUnmap(cl_command_queue queue, void *svm_ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueSVMUnmap);
+  if(svm_ptr == NULL)
+    return CL_INVALID_VALUE;
+  return enqueue(queue, latency_ns, 0, num_events_in_wait_list, event_wait_list, event, false, false);
+}
+
+CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMemcpy(cl_command_queue queue, cl_bool blocking_copy, void *dst_ptr, const void *src_ptr, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event){
+  COUNT(clEnqueueSVMMemcpy);
+  if(dst_ptr == NULL || src_ptr == NULL)
+    return CL_INVALID_VALUE;
+  memmove(dst_ptr, src_ptr, size);
+  return enqueue(queue, transfer_ns, size, num_events_in_wait_list, event_wait_list, event, false, blocking_copy);
+}
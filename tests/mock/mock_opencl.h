@@ -0,0 +1,104 @@
+// Author: Arjun Ramaswami
+
+/**
+ * @file mock_opencl.h
+ * @brief Configuration and call counters of the mock OpenCL library, which implements the OpenCL calls used by the host code without a device
+ */
+
+#ifndef MOCK_OPENCL_H
+#define MOCK_OPENCL_H
+
+#include <stdbool.h>
+
+/**
+ * Model of the durations reported by the profiling events of the mock device
+ */
+typedef struct {
+  double pcie_latency_us;   /**< latency of each transfer between host and device */
+  double pcie_gbps;         /**< bandwidth of transfers between host and device in GB/s */
+  double kernel_latency_us; /**< duration of each kernel launch independent of its data */
+  double kernel_gbps;       /**< global memory bandwidth in GB/s, applied to the largest buffer passed to a kernel */
+  bool realtime;            /**< block the host until the modelled completion of a command */
+  bool spin;                /**< blocking calls poll for the completion, as some runtimes do, instead of sleeping */
+} mockcl_config_t;
+
+/**
+ * Number of arguments of a kernel of the mock program
+ */
+typedef struct {
+  const char *name;         /**< name of the kernel */
+  unsigned num_args;        /**< arguments to set before the kernel is enqueued */
+} mockcl_kernel_args_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  set the model of the mock device. The initial configuration is read from the environment variables MOCKCL_PCIE_LATENCY_US, MOCKCL_PCIE_GBPS, MOCKCL_KERNEL_LATENCY_US, MOCKCL_KERNEL_GBPS, MOCKCL_REALTIME and MOCKCL_SPIN
+ * @param  config : model to use for subsequent commands
+ */
+extern void mockcl_set_config(const mockcl_config_t *config);
+
+/**
+ * @brief  current model of the mock device
+ */
+extern void mockcl_get_config(mockcl_config_t *config);
+
+/**
+ * @brief  restrict the kernels found in programs of the mock device, for example to model bitstreams lacking a kernel
+ * @param  names : NULL terminated list of kernel names, kept by reference, or NULL to find any kernel
+ */
+extern void mockcl_set_kernels(const char **names);
+
+/**
+ * @brief  set the signatures of the kernels of the mock program. Enqueueing a listed kernel with an argument left unset fails with CL_INVALID_KERNEL_ARGS, as on a device. Kernels not listed accept any argument.
+ * @param  kernels : list terminated by {NULL, 0}, kept by reference, or NULL for no signatures
+ */
+extern void mockcl_set_kernel_args(const mockcl_kernel_args_t *kernels);
+
+/**
+ * @brief  set the SVM capabilities reported by the mock device, CL_DEVICE_SVM_COARSE_GRAIN_BUFFER initially
+ * @param  caps : bitfield of CL_DEVICE_SVM_* flags
+ */
+extern void mockcl_set_svm_capabilities(const unsigned long caps);
+
+/**
+ * @brief  number of calls to an OpenCL function since the last reset
+ * @param  name : name of the function, for example "clSetKernelArg"
+ * @return number of calls, 0 if the function is not implemented by the mock
+ */
+extern unsigned long mockcl_calls(const char *name);
+
+/**
+ * @brief  sum of calls to all OpenCL functions since the last reset
+ */
+extern unsigned long mockcl_total_calls();
+
+/**
+ * @brief  number of OpenCL functions implemented by the mock
+ */
+extern unsigned mockcl_num_functions();
+
+/**
+ * @brief  name of an OpenCL function implemented by the mock
+ * @param  i : index between 0 and mockcl_num_functions() - 1
+ * @return name or NULL if out of range
+ */
+extern const char* mockcl_function_name(const unsigned i);
+
+/**
+ * @brief  number of events created by the mock and not yet released, to find leaks
+ */
+extern unsigned long mockcl_live_events();
+
+/**
+ * @brief  reset all call counters
+ */
+extern void mockcl_reset_calls();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
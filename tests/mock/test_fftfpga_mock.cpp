@@ -0,0 +1,978 @@
+//  Author: Arjun Ramaswami
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+extern "C" {
+  #define CL_VERSION_2_0
+  #include "CL/opencl.h"
+  #include "fftfpga/fftfpga.h"
+  #include "mock_opencl.h"
+}
+
+/**
+ * \brief  initialize the library on the mock device, using an empty file as bitstream
+ */
+static void mock_initialize(const bool use_svm = false){
+  char path[] = "/tmp/fftfpga_mock_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(write(fd, "mock", 4), 4);
+  close(fd);
+
+  ASSERT_EQ(fpga_initialize("mock", path, use_svm), 0);
+  unlink(path);
+}
+
+// signatures of the kernels of fft3d_ddr.cl and fft3d_ddr_batch.cl, whose
+// fetch and store have no callback data
+static const mockcl_kernel_args_t fft3d_ddr_args[] = {
+  {"fetch", 2}, {"fft3da", 1}, {"transpose", 0}, {"fft3db", 1},
+  {"transpose3D", 3}, {"fft3dc", 1}, {"store", 2}, {NULL, 0}
+};
+static const mockcl_kernel_args_t fft3d_ddr_batch_args[] = {
+  {"fetch", 1}, {"fft3da", 1}, {"transpose", 0}, {"fft3db", 1},
+  {"transpose3D", 3}, {"fft3dc", 1}, {"store", 1}, {NULL, 0}
+};
+
+/**
+ * \brief every OpenCL object created by fftfpgaf_c2c_3d_ddr() is released
+ */
+TEST(fftMockTest, ControlPathDDR){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  mock_initialize();
+  mockcl_set_kernel_args(fft3d_ddr_args);
+  mockcl_reset_calls();
+
+  fpga_t fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, false);
+  EXPECT_EQ(fft_time.valid, 1);
+
+  // 7 kernels, transpose3D being enqueued twice
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 7);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 8);
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+
+  mockcl_set_kernel_args(NULL);
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief double precision transforms transfer single precision chunks, converted while the previous chunk is transferred
+ */
+TEST(fftMockTest, ControlPathDouble){
+  const unsigned N = 128;
+  const size_t num_pts = N * N * N;
+  // two chunks of the cube, three of the batch of 1D transforms
+  const unsigned N1 = 64, batch = 2 * ((1 << 20) / N1) + 1;
+  double2 *inp = (double2*)fftfpga_complex_malloc(sizeof(double2) * num_pts);
+  double2 *out = (double2*)fftfpga_complex_malloc(sizeof(double2) * num_pts);
+
+  mock_initialize();
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpga_c2c_3d_ddr(N, inp, out, false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+  EXPECT_GT(fft_time.pcie_write_t, 0.0);
+  EXPECT_GT(fft_time.pcie_read_t, 0.0);
+
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 8);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  // the staging buffer is pinned
+  EXPECT_EQ(mockcl_calls("clEnqueueMapBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueUnmapMemObject"), 1);
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpga_c2c_1d(N1, inp, out, false, batch).valid, 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 3);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 3);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpga_c2c_2d_ddr(N1, inp, out, false).valid, 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief profiling events report the durations of the model
+ */
+TEST(fftMockTest, ModelledDurations){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  mockcl_config_t saved, config;
+  mockcl_get_config(&saved);
+
+  // 1 ms latency per transfer, 1 ms per kernel pipeline
+  config.pcie_latency_us = 1000.0;
+  config.pcie_gbps = 0.0;
+  config.kernel_latency_us = 1000.0;
+  config.kernel_gbps = 0.0;
+  config.realtime = false;
+  mockcl_set_config(&config);
+
+  mock_initialize();
+
+  fpga_t fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_NEAR(fft_time.pcie_write_t, 1.0, 1e-6);
+  EXPECT_NEAR(fft_time.pcie_read_t, 1.0, 1e-6);
+
+  // the kernels run concurrently, the second launch of transpose3D follows the first on its queue
+  EXPECT_GE(fft_time.exec_t, 1.0);
+  EXPECT_LT(fft_time.exec_t, 100.0);
+
+  fpga_final();
+  mockcl_set_config(&saved);
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpgaf_conv3d() transfers the input and output once, the filter staying resident
+ */
+TEST(fftMockTest, ControlPathConv){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *filter = (float2*)fftfpgaf_complex_malloc(sz);
+
+  mock_initialize();
+
+  // convolution requires a filter of the same size
+  EXPECT_EQ(fftfpgaf_conv3d(N, inp, out).valid, 0);
+  EXPECT_EQ(fftfpgaf_conv3d_set_kernel(N, filter).valid, 1);
+  EXPECT_EQ(fftfpgaf_conv3d(2 * N, inp, out).valid, 0);
+
+  const mockcl_kernel_args_t conv_args[] = {
+    {"fetch", 2}, {"fft3da", 1}, {"transpose", 0}, {"fft3db", 1},
+    {"transpose3D", 3}, {"fft3dc", 1}, {"store_conv", 3}, {NULL, 0}
+  };
+  mockcl_set_kernel_args(conv_args);
+
+  mockcl_reset_calls();
+  const unsigned long live_events = mockcl_live_events();
+  for(unsigned i = 0; i < 2; i++){
+    fpga_t fft_time = fftfpgaf_conv3d(N, inp, out);
+    EXPECT_EQ(fft_time.valid, 1);
+  }
+
+  // forward and backward transform enqueue 8 kernels each
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 32);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+
+  EXPECT_EQ(mockcl_live_events(), live_events);
+  mockcl_set_kernel_args(NULL);
+
+  // the filter is released with the FPGA resources
+  mockcl_reset_calls();
+  fpga_final();
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 1);
+
+  free(inp);
+  free(out);
+  free(filter);
+}
+
+/**
+ * \brief fftfpgaf_gradient3d() transfers the field once and reads back the three components
+ */
+TEST(fftMockTest, ControlPathGradient){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *grad[3];
+  for(unsigned c = 0; c < 3; c++){
+    grad[c] = (float2*)fftfpgaf_complex_malloc(sz);
+  }
+
+  const char *gradient_kernels[] = {"fetch_gradient", "fft3da", "transpose", "fft3db", "transpose3D", "fft3dc", "store", NULL};
+  mockcl_set_kernels(gradient_kernels);
+  mock_initialize();
+
+  EXPECT_EQ(fftfpgaf_gradient3d(N, inp, grad[0], NULL, grad[2], 1.0f).valid, 0);
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpgaf_gradient3d(N, inp, grad[0], grad[1], grad[2], 1.0f);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+
+  // forward and 3 backward transforms enqueue 8 kernels each
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 7);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 4 * 8);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 3);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  mockcl_set_kernels(NULL);
+  fpga_final();
+  free(inp);
+  for(unsigned c = 0; c < 3; c++){
+    free(grad[c]);
+  }
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_transposed() launches store_transposed of its bitstream in place of store
+ */
+TEST(fftMockTest, ControlPathTransposed){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  const char *transposed_kernels[] = {"fetch", "fft3da", "transpose", "fft3db", "transpose3D", "fft3dc", "store_transposed", NULL};
+  mockcl_set_kernels(transposed_kernels);
+  mock_initialize();
+
+  mockcl_reset_calls();
+  for(int inv = 0; inv <= 1; inv++){
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr_transposed(N, inp, out, inv);
+    EXPECT_EQ(fft_time.valid, 1);
+    EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+  }
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 2 * 7);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2 * 8);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+
+  mockcl_set_kernels(NULL);
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief the fallback reads the kernels of the bitstream once at initialization instead of probing them per transform
+ */
+TEST(fftMockTest, FallbackKernelProbe){
+  const unsigned N = 32;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  const char *fft1d_kernels[] = {"fetch", "fft1d", NULL};
+  mockcl_set_kernels(fft1d_kernels);
+  mockcl_reset_calls();
+  mock_initialize();
+  EXPECT_EQ(mockcl_calls("clGetProgramInfo"), 2);
+
+  fftfpga_set_fallback(true, 0, 0);
+  mockcl_reset_calls();
+  for(int i = 0; i < 3; i++){
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, false);
+    EXPECT_EQ(fft_time.valid, 1);
+    EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_CPU);
+  }
+  EXPECT_EQ(mockcl_calls("clGetProgramInfo"), 0);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 0);
+
+  fftfpga_set_fallback(false, 0, 0);
+  mockcl_set_kernels(NULL);
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_split() transfers the real and imaginary parts in separate buffers
+ */
+TEST(fftMockTest, ControlPathSplit){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float> re(num_pts), im(num_pts);
+
+  const char *split_kernels[] = {"fetch_split", "fft3da", "transpose", "fft3db", "transpose3D", "fft3dc", "store_split", NULL};
+  mockcl_set_kernels(split_kernels);
+  mock_initialize();
+
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_split(N, re.data(), NULL, re.data(), im.data(), false).valid, 0);
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpgaf_c2c_3d_ddr_split(N, re.data(), im.data(), re.data(), im.data(), false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 7);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 8);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  mockcl_set_kernels(NULL);
+  fpga_final();
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_pruned() launches the pruned fetch and store, transferring only the subcubes
+ */
+TEST(fftMockTest, ControlPathPruned){
+  const unsigned N = 16, M = N / 2;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  const char *pruned_kernels[] = {"fetch_pruned", "fft3da", "transpose", "fft3db", "transpose3D", "fft3dc", "store_pruned", NULL};
+  mockcl_set_kernels(pruned_kernels);
+  mock_initialize();
+
+  // subcubes larger than the cube
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, N + 1, M, inp, out, false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, M, 0, inp, out, false).valid, 0);
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, M, M, inp, out, false).valid, 1);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, N, M, inp, out, true).valid, 1);
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 2 * 7);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2 * 8);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  mockcl_set_kernels(NULL);
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief the slot map of the sphere stays on the device, each transform transferring the cube in one direction only
+ */
+TEST(fftMockTest, ControlPathSphere){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  float2 *grid = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  float2 *packed = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  std::vector<unsigned> map;
+  for(unsigned i = 0; i < num_pts; i += 2){
+    map.push_back(i);
+  }
+
+  const char *sphere_kernels[] = {"fetch_sphere", "fft3da", "transpose", "fft3db", "transpose3D", "fft3dc", "store_sphere", NULL};
+  mockcl_set_kernels(sphere_kernels);
+  mock_initialize();
+
+  // transforms require a map of the same size without repeated indices
+  EXPECT_EQ(fftfpgaf_c2c_3d_sphere_to_grid(N, packed, grid, true).valid, 0);
+  map.push_back(0);
+  EXPECT_EQ(fftfpgaf_sphere_set_map(N, map.data(), map.size()).valid, 0);
+  map.pop_back();
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpgaf_sphere_set_map(N, map.data(), map.size());
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), 1);
+  EXPECT_EQ(fftfpgaf_c2c_3d_sphere_to_grid(2 * N, packed, grid, true).valid, 0);
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_sphere_to_grid(N, packed, grid, true).valid, 1);
+  EXPECT_EQ(fftfpgaf_c2c_3d_grid_to_sphere(N, grid, packed, false).valid, 1);
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 2 * 7);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2 * 8);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  // the slot map is released with the FPGA resources
+  mockcl_reset_calls();
+  mockcl_set_kernels(NULL);
+  fpga_final();
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 1);
+
+  free(grid);
+  free(packed);
+}
+
+/**
+ * \brief the persistent bitstream launches only fetch and store per call, reusing its kernels, queues and buffers until fpga_final()
+ */
+TEST(fftMockTest, ControlPathPersistent){
+  const unsigned N = 16, how_many = 2;
+  const size_t sz = sizeof(float2) * N * N * N * how_many;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  const char *persistent_kernels[] = {"fetch_persistent", "store_persistent", NULL};
+  mockcl_set_kernels(persistent_kernels);
+  mock_initialize();
+
+  EXPECT_EQ(fftfpgaf_c2c_3d_persistent(N, inp, out, false, 0).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_persistent(N, NULL, out, false, 1).valid, 0);
+
+  mockcl_reset_calls();
+  for(unsigned i = 0; i < 3; i++){
+    fpga_t fft_time = fftfpgaf_c2c_3d_persistent(N, inp, out, i & 1, (i == 0) ? 1 : how_many);
+    EXPECT_EQ(fft_time.valid, 1);
+    EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+    EXPECT_GT(fft_time.exec_t, 0.0);
+  }
+
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2 * 3);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), 2);
+  // buffers grow once to the larger batch
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), 4);
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 2);
+  EXPECT_EQ(mockcl_calls("clReleaseKernel"), 0);
+
+  fpga_final();
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+
+  mockcl_set_kernels(NULL);
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief callback data is uploaded once, passed to fetch and store and released by fpga_final()
+ */
+TEST(fftMockTest, ControlPathCallback){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *cb_data = (float2*)fftfpgaf_complex_malloc(sz);
+
+  // requires an initialized device
+  EXPECT_EQ(fftfpgaf_set_callback_data(N, cb_data, cb_data).valid, 0);
+
+  mock_initialize();
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_set_callback_data(N, NULL, cb_data).valid, 1);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 1);
+
+  mockcl_set_kernel_args(fft3d_ddr_args);
+  mockcl_reset_calls();
+  for(unsigned i = 0; i < 2; i++){
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, false);
+    EXPECT_EQ(fft_time.valid, 1);
+  }
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  // fetch and store of a bitstream without callbacks are not passed the data
+  mockcl_set_kernel_args(fft3d_ddr_batch_args);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr(N, inp, out, false).valid, 1);
+  mockcl_set_kernel_args(fft3d_ddr_args);
+
+  // a transform of another size runs without the data, which is kept
+  float2 *large = (float2*)fftfpgaf_complex_malloc(8 * sz);
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr(2 * N, large, large, false).valid, 1);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  free(large);
+
+  // replacing the data releases the previous buffer
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_set_callback_data(N, cb_data, cb_data).valid, 1);
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 1);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), 2);
+
+  mockcl_set_kernel_args(NULL);
+  mockcl_reset_calls();
+  fpga_final();
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 2);
+
+  free(inp);
+  free(out);
+  free(cb_data);
+}
+
+/**
+ * \brief chained transforms on device buffers transfer the data once in each direction
+ */
+TEST(fftMockTest, ChainedBuffers){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * num_pts);
+
+  mock_initialize();
+
+  EXPECT_TRUE(fftfpga_buffer_create(0) == NULL);
+  fftfpga_buffer_t *field = fftfpga_buffer_create(num_pts);
+  fftfpga_buffer_t *spectrum = fftfpga_buffer_create(num_pts);
+  ASSERT_TRUE(field != NULL);
+  ASSERT_TRUE(spectrum != NULL);
+  EXPECT_EQ(fftfpga_buffer_size(field), num_pts);
+
+  // buffers smaller than the transform
+  fftfpga_buffer_t *small = fftfpga_buffer_create(num_pts / 2);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, field, small, false).valid, 0);
+  fftfpga_buffer_free(small);
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpga_buffer_write(field, inp).valid, 1);
+  for(unsigned i = 0; i < 3; i++){
+    EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, field, spectrum, false).valid, 1);
+    EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, spectrum, field, true).valid, 1);
+  }
+  // in-place
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, field, field, false).valid, 1);
+  EXPECT_EQ(fftfpga_buffer_read(field, out).valid, 1);
+
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 7 * 8);
+  // only the transpose buffer of each transform is created
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), 7);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  fftfpga_buffer_free(spectrum);
+
+  // the remaining buffer is released with the FPGA resources, its handle afterwards
+  mockcl_reset_calls();
+  fpga_final();
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 1);
+  EXPECT_EQ(fftfpga_buffer_read(field, out).valid, 0);
+  fftfpga_buffer_free(field);
+  EXPECT_EQ(mockcl_calls("clReleaseMemObject"), 1);
+
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpgaf_c2c_1d_natural() reorders on chip if the bitstream has a store kernel, else reads in chunks
+ */
+TEST(fftMockTest, ControlPathNaturalOrder){
+  const unsigned N = 64;
+  // three chunks read while reordering
+  const unsigned batch = 2 * ((1 << 18) / N) + 1;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * N * batch);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * N * batch);
+
+  mock_initialize();
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_1d_natural(N, inp, out, false, batch).valid, 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 1);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+
+  // the kernels of the bitstream are read when it is loaded
+  const char *fft1d_kernels[] = {"fetch", "fft1d", NULL};
+  mockcl_set_kernels(fft1d_kernels);
+  fpga_final();
+  mock_initialize();
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpgaf_c2c_1d_natural(N, inp, out, false, batch);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_GT(fft_time.pcie_read_t, 0.0);
+  // store is looked up in the cached names instead of being created
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 2);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), 3);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+
+  mockcl_set_kernels(NULL);
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpgaf_c2c_1d_large() runs two passes of the 2D engine with the twiddle stage in between
+ */
+TEST(fftMockTest, ControlPathLarge1D){
+  const unsigned n = 16, N = n * n;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * N);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sizeof(float2) * N);
+
+  mock_initialize();
+
+  // not the square of a power of 2
+  EXPECT_EQ(fftfpgaf_c2c_1d_large(2 * N, inp, out, false).valid, 0);
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpgaf_c2c_1d_large(N, inp, out, false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 4);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 4);
+  EXPECT_EQ(mockcl_calls("clEnqueueNDRangeKernel"), 4);
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_large() runs a pass of the 2D engine per plane of each stage
+ */
+TEST(fftMockTest, ControlPath3DLarge){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+  float2 *inp = (float2*)fftfpgaf_complex_malloc(sz);
+  float2 *out = (float2*)fftfpgaf_complex_malloc(sz);
+
+  mock_initialize();
+  mockcl_reset_calls();
+
+  fpga_t fft_time = fftfpgaf_c2c_3d_large(N, inp, out, false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+
+  // fft2d and twiddle, fetch and transpose for each of the N planes of the 3 stages
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), 4);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2 * 3 * N);
+  EXPECT_EQ(mockcl_calls("clEnqueueNDRangeKernel"), 2 * 3 * N);
+
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+
+  fpga_final();
+  free(inp);
+  free(out);
+}
+
+struct stream_state {
+  size_t length;
+  std::vector<size_t> consumed;
+};
+
+static bool produce_count(float2 *slot, const size_t k, void *user_data){
+  stream_state *state = (stream_state*)user_data;
+  slot[0].x = (float)k;
+  return k < state->length;
+}
+
+static void consume_count(const float2 *slot, const size_t k, void *user_data){
+  ((stream_state*)user_data)->consumed.push_back(k);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_stream() transfers each transform of the stream once, consuming the outputs in order
+ */
+TEST(fftMockTest, ControlPathStream){
+  const unsigned N = 16;
+
+  mock_initialize();
+
+  for(size_t length : {0, 1, 5}){
+    stream_state state = {length, {}};
+    mockcl_reset_calls();
+
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr_stream(N, false, produce_count, consume_count, &state);
+    EXPECT_EQ(fft_time.valid, 1);
+    EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+
+    ASSERT_EQ(state.consumed.size(), length);
+    for(size_t k = 0; k < length; k++){
+      EXPECT_EQ(state.consumed[k], k);
+    }
+    EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), length);
+    EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), length);
+
+    // 4 device buffers, the transpose buffer and 2 mapped host slots,
+    // with the kernels created once, whatever the length of the stream
+    EXPECT_EQ(mockcl_calls("clCreateBuffer"), 7);
+    EXPECT_EQ(mockcl_calls("clCreateKernel"), 7);
+    EXPECT_EQ(mockcl_calls("clEnqueueMapBuffer"), 2);
+    EXPECT_EQ(mockcl_calls("clEnqueueMapBuffer"), mockcl_calls("clEnqueueUnmapMemObject"));
+    EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+    EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+    EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+  }
+
+  // no callbacks
+  stream_state state = {1, {}};
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_stream(N, false, NULL, consume_count, &state).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_stream(N, false, produce_count, NULL, &state).valid, 0);
+
+  fpga_final();
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_svm_batch() allocates a bounded ring of SVM buffers whatever the batch
+ */
+TEST(fftMockTest, ControlPathSVMBatch){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+
+  mock_initialize(true);
+  mockcl_set_kernel_args(fft3d_ddr_args);
+
+  for(unsigned how_many : {1, 2, 5}){
+    std::vector<float2> inp(num_pts * how_many), out(num_pts * how_many);
+    mockcl_reset_calls();
+
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr_svm_batch(N, inp.data(), out.data(), false, how_many);
+    EXPECT_EQ(fft_time.valid, 1);
+
+    // 2 input and 2 output buffers, each element copied in and out once
+    EXPECT_EQ(mockcl_calls("clSVMAlloc"), 4);
+    EXPECT_EQ(mockcl_calls("clSVMAlloc"), mockcl_calls("clSVMFree"));
+    EXPECT_EQ(mockcl_calls("clEnqueueSVMMap"), 2 * how_many);
+    EXPECT_EQ(mockcl_calls("clEnqueueSVMMap"), mockcl_calls("clEnqueueSVMUnmap"));
+
+    EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+    EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+    EXPECT_EQ(mockcl_calls("clCreateCommandQueue"), mockcl_calls("clReleaseCommandQueue"));
+  }
+
+  mockcl_set_kernel_args(NULL);
+  fpga_final();
+}
+
+/**
+ * \brief SVM transforms and batches map and unmap only coarse grained buffers, and use the host memory itself with fine grained system SVM
+ */
+TEST(fftMockTest, SVMCapabilities){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(num_pts), out(num_pts);
+
+  // no SVM
+  mockcl_set_svm_capabilities(0);
+  char path[] = "/tmp/fftfpga_mock_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  close(fd);
+  EXPECT_EQ(fpga_initialize("mock", path, true), -5);
+  unlink(path);
+  fpga_final();
+
+  const unsigned how_many = 3;
+  std::vector<float2> inp_batch(num_pts * how_many), out_batch(num_pts * how_many);
+
+  // allocations and maps of a single transform and of a batch
+  struct { unsigned long caps; unsigned long allocs, maps, batch_allocs, batch_maps; } levels[] = {
+    {CL_DEVICE_SVM_COARSE_GRAIN_BUFFER, 2, 2, 4, 2 * how_many},
+    {CL_DEVICE_SVM_COARSE_GRAIN_BUFFER | CL_DEVICE_SVM_FINE_GRAIN_BUFFER, 2, 0, 4, 0},
+    {CL_DEVICE_SVM_COARSE_GRAIN_BUFFER | CL_DEVICE_SVM_FINE_GRAIN_BUFFER | CL_DEVICE_SVM_FINE_GRAIN_SYSTEM, 0, 0, 0, 0}
+  };
+  mockcl_set_kernel_args(fft3d_ddr_args);
+  for(auto level : levels){
+    mockcl_set_svm_capabilities(level.caps);
+    mock_initialize(true);
+    mockcl_reset_calls();
+
+    fpga_t fft_time = fftfpgaf_c2c_3d_ddr_svm(N, inp.data(), out.data(), false, false);
+    EXPECT_EQ(fft_time.valid, 1);
+    EXPECT_EQ(mockcl_calls("clSVMAlloc"), level.allocs);
+    EXPECT_EQ(mockcl_calls("clSVMAlloc"), mockcl_calls("clSVMFree"));
+    EXPECT_EQ(mockcl_calls("clEnqueueSVMMap"), level.maps);
+    EXPECT_EQ(mockcl_calls("clEnqueueSVMMap"), mockcl_calls("clEnqueueSVMUnmap"));
+
+    mockcl_reset_calls();
+    fft_time = fftfpgaf_c2c_3d_ddr_svm_batch(N, inp_batch.data(), out_batch.data(), false, how_many);
+    EXPECT_EQ(fft_time.valid, 1);
+    EXPECT_EQ(mockcl_calls("clSVMAlloc"), level.batch_allocs);
+    EXPECT_EQ(mockcl_calls("clSVMAlloc"), mockcl_calls("clSVMFree"));
+    EXPECT_EQ(mockcl_calls("clEnqueueSVMMap"), level.batch_maps);
+    EXPECT_EQ(mockcl_calls("clEnqueueSVMMap"), mockcl_calls("clEnqueueSVMUnmap"));
+
+    fpga_final();
+  }
+
+  mockcl_set_kernel_args(NULL);
+  mockcl_set_svm_capabilities(CL_DEVICE_SVM_COARSE_GRAIN_BUFFER);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_batch_gather() transfers each transform from and to its own array
+ */
+TEST(fftMockTest, ControlPathBatchGather){
+  const unsigned N = 16, how_many = 3;
+  const size_t num_pts = N * N * N;
+  std::vector<std::vector<float2>> inp(how_many, std::vector<float2>(num_pts)), out(how_many, std::vector<float2>(num_pts));
+  std::vector<const float2*> inp_list;
+  std::vector<float2*> out_list;
+  for(unsigned i = 0; i < how_many; i++){
+    inp_list.push_back(inp[i].data());
+    out_list.push_back(out[i].data());
+  }
+
+  mock_initialize();
+
+  mockcl_reset_calls();
+  fpga_t fft_time = fftfpgaf_c2c_3d_ddr_batch_gather(N, inp_list.data(), out_list.data(), false, how_many);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_FPGA);
+  EXPECT_EQ(mockcl_calls("clEnqueueWriteBuffer"), how_many);
+  EXPECT_EQ(mockcl_calls("clEnqueueReadBuffer"), how_many);
+
+  // same kernels as the batch of contiguous transforms
+  const unsigned long tasks = mockcl_calls("clEnqueueTask");
+  std::vector<float2> inp_batch(num_pts * how_many), out_batch(num_pts * how_many);
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_batch(N, inp_batch.data(), out_batch.data(), false, false, how_many).valid, 1);
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), tasks);
+
+  // no arrays
+  out_list[1] = NULL;
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_batch_gather(N, inp_list.data(), out_list.data(), false, how_many).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_batch_gather(N, NULL, out_list.data(), false, how_many).valid, 0);
+
+  fpga_final();
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_submit() coalesces requests of the same size and direction into one batched transform
+ */
+TEST(fftMockTest, ControlPathMicrobatch){
+  const unsigned N = 16, how_many = 4;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(num_pts * how_many), out(num_pts * how_many);
+
+  mock_initialize();
+
+  // kernels enqueued by batches of 2 and 4 transforms
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_batch(N, inp.data(), out.data(), false, false, 2).valid, 1);
+  const unsigned long tasks_2 = mockcl_calls("clEnqueueTask");
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_batch(N, inp.data(), out.data(), false, false, how_many).valid, 1);
+  const unsigned long tasks_4 = mockcl_calls("clEnqueueTask");
+
+  // a full batch is computed without waiting for the window
+  fftfpga_set_microbatch(100000000, how_many);
+  mockcl_reset_calls();
+  std::vector<fftfpga_request_t*> reqs;
+  for(unsigned i = 0; i < how_many; i++)
+    reqs.push_back(fftfpgaf_c2c_3d_ddr_submit(N, &inp[i * num_pts], &out[i * num_pts], false));
+  for(fftfpga_request_t *req : reqs){
+    ASSERT_NE(req, nullptr);
+    EXPECT_EQ(fftfpga_request_wait(req).valid, 1);
+  }
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), tasks_4);
+
+  // directions are batched separately once the window expires
+  fftfpga_set_microbatch(100000, 16);
+  mockcl_reset_calls();
+  reqs.clear();
+  for(unsigned i = 0; i < how_many; i++)
+    reqs.push_back(fftfpgaf_c2c_3d_ddr_submit(N, &inp[i * num_pts], &out[i * num_pts], (i % 2) == 1));
+  for(fftfpga_request_t *req : reqs){
+    EXPECT_EQ(fftfpga_request_wait(req).valid, 1);
+  }
+  EXPECT_EQ(mockcl_calls("clEnqueueTask"), 2 * tasks_2);
+  EXPECT_EQ(mockcl_calls("clCreateBuffer"), mockcl_calls("clReleaseMemObject"));
+  EXPECT_EQ(mockcl_calls("clCreateKernel"), mockcl_calls("clReleaseKernel"));
+
+  // invalid requests
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_submit(N - 1, inp.data(), out.data(), false), nullptr);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_submit(N, NULL, out.data(), false), nullptr);
+  EXPECT_EQ(fftfpga_request_wait(NULL).valid, 0);
+
+  // pending requests are computed by fpga_final()
+  fftfpga_set_microbatch(100000000, 16);
+  fftfpga_request_t *req = fftfpgaf_c2c_3d_ddr_submit(N, inp.data(), out.data(), false);
+  fpga_final();
+  EXPECT_EQ(fftfpga_request_wait(req).valid, 1);
+
+  fftfpga_set_microbatch(200, 16);
+}
+
+static double clock_ms(const clockid_t clock){
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/**
+ * \brief the library waits for callbacks of markers instead of clFinish(), sleeping while a runtime spinning in blocking calls would consume a host core
+ */
+TEST(fftMockTest, WaitPolicy){
+  const unsigned N = 64, iter = 4;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(num_pts), out(num_pts);
+
+  mock_initialize();
+
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr(N, inp.data(), out.data(), false).valid, 1);
+  EXPECT_EQ(mockcl_calls("clFinish"), 0ul);
+  EXPECT_EQ(mockcl_calls("clWaitForEvents"), 0ul);
+  EXPECT_GT(mockcl_calls("clSetEventCallback"), 0ul);
+  EXPECT_GE(mockcl_calls("clEnqueueMarkerWithWaitList"), mockcl_calls("clSetEventCallback"));
+
+  fftfpga_set_wait_policy(false, 0);
+  mockcl_reset_calls();
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr(N, inp.data(), out.data(), false).valid, 1);
+  EXPECT_GT(mockcl_calls("clFinish"), 0ul);
+  EXPECT_EQ(mockcl_calls("clSetEventCallback"), 0ul);
+
+  // 2 ms per transfer spent polling by the runtime
+  mockcl_config_t saved;
+  mockcl_get_config(&saved);
+  mockcl_config_t config = {2000.0, 6.0, 10.0, 19.2, true, true};
+  mockcl_set_config(&config);
+
+  double cpu_ms = clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+  for(unsigned i = 0; i < iter; i++)
+    EXPECT_EQ(fftfpgaf_c2c_3d_ddr(N, inp.data(), out.data(), false).valid, 1);
+  const double finish_cpu_ms = clock_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu_ms;
+
+  fftfpga_set_wait_policy(true, 0);
+  cpu_ms = clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+  double wall_ms = clock_ms(CLOCK_MONOTONIC);
+  fpga_t fft_time;
+  for(unsigned i = 0; i < iter; i++){
+    fft_time = fftfpgaf_c2c_3d_ddr(N, inp.data(), out.data(), false);
+    EXPECT_EQ(fft_time.valid, 1);
+  }
+  const double callback_cpu_ms = clock_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu_ms;
+  wall_ms = clock_ms(CLOCK_MONOTONIC) - wall_ms;
+
+  EXPECT_GE(wall_ms, iter * (fft_time.pcie_write_t + fft_time.pcie_read_t));
+  EXPECT_LT(callback_cpu_ms, 0.5 * finish_cpu_ms);
+
+  // requests of the asynchronous API are waited for alike
+  fftfpga_set_microbatch(0, 1);
+  EXPECT_EQ(fftfpga_request_wait(fftfpgaf_c2c_3d_ddr_submit(N, inp.data(), out.data(), false)).valid, 1);
+  fftfpga_set_microbatch(200, 16);
+
+  fftfpga_set_wait_policy(true, 20);
+  mockcl_set_config(&saved);
+  fpga_final();
+}
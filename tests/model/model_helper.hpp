@@ -0,0 +1,35 @@
+//  Author: Arjun Ramaswami
+
+#ifndef MODEL_HELPER_HPP
+#define MODEL_HELPER_HPP
+
+#include <math.h>
+#include <stddef.h>
+#include "fftfpga/fftfpga.h"
+
+/**
+ * \brief  signal to noise ratio in dB of the output with respect to the reference
+ */
+static inline double snr(const float2 *out, const float2 *ref, const size_t num_pts){
+  double noise = 0.0, signal = 0.0;
+  for(size_t i = 0; i < num_pts; i++){
+    double re = (double)out[i].x - ref[i].x, im = (double)out[i].y - ref[i].y;
+    noise += re * re + im * im;
+    signal += (double)ref[i].x * ref[i].x + (double)ref[i].y * ref[i].y;
+  }
+  return 10.0 * log10(signal / noise);
+}
+
+/**
+ * \brief  bit reversal of the lower bits of x
+ */
+static inline unsigned reversed(unsigned x, const unsigned bits){
+  unsigned y = 0;
+  for(unsigned i = 0; i < bits; i++){
+    y = (y << 1) | (x & 1);
+    x >>= 1;
+  }
+  return y;
+}
+
+#endif // MODEL_HELPER_HPP
@@ -0,0 +1,153 @@
+//  Author: Arjun Ramaswami
+
+#include <vector>
+#include <string.h>
+#include <fftw3.h>
+#include "gtest/gtest.h"
+
+extern "C" {
+  #include "fftmodel/fftmodel.h"
+}
+#include "model_helper.hpp"
+
+/**
+ * \brief  create deterministic random input and compute the reference using FFTW, in natural order
+ */
+static void reference_1d(const unsigned N, float2 *inp, float2 *ref, const bool inv, const unsigned batch){
+  srand(N);
+  for(size_t i = 0; i < (size_t)N * batch; i++){
+    inp[i].x = (float)rand() / (float)RAND_MAX;
+    inp[i].y = (float)rand() / (float)RAND_MAX;
+  }
+
+  int n[1] = {(int)N};
+  fftwf_plan plan = fftwf_plan_many_dft(1, n, batch, (fftwf_complex*)inp, NULL, 1, N, (fftwf_complex*)ref, NULL, 1, N, inv ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE);
+  fftwf_execute(plan);
+  fftwf_destroy_plan(plan);
+}
+
+/**
+ * \brief fftmodelf_c2c_1d() and fftmodelf_c2c_1d_natural()
+ */
+TEST(fft1dModelTest, InputValidity){
+  const unsigned N = 64;
+  std::vector<float2> test(N);
+
+  // null ptr inputs
+  EXPECT_EQ(fftmodelf_c2c_1d(N, NULL, test.data(), false, 1).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_1d_natural(N, test.data(), NULL, false, 1).valid, 0);
+
+  // sizes smaller than the fetch kernel supports
+  EXPECT_EQ(fftmodelf_c2c_1d(32, test.data(), test.data(), false, 1).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_1d_natural(N - 1, test.data(), test.data(), false, 1).valid, 0);
+
+  // if batch is 0
+  EXPECT_EQ(fftmodelf_c2c_1d_natural(N, test.data(), test.data(), false, 0).valid, 0);
+}
+
+/**
+ * \brief fftmodelf_c2c_1d() against FFTW in bit reversed order, forward and backward
+ */
+TEST(fft1dModelTest, Correctness){
+  const unsigned batch = 3;
+  for(unsigned log_n = 6; log_n <= 9; log_n++){
+    const unsigned N = 1 << log_n;
+    std::vector<float2> inp(N * batch), ref(N * batch), out(N * batch), bitrev(N * batch);
+
+    for(bool inv : {false, true}){
+      reference_1d(N, inp.data(), ref.data(), inv, batch);
+
+      fpga_t fft_time = fftmodelf_c2c_1d(N, inp.data(), out.data(), inv, batch);
+      ASSERT_EQ(fft_time.valid, 1);
+      EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+
+      for(unsigned b = 0; b < batch; b++){
+        for(unsigned i = 0; i < N; i++){
+          bitrev[b * N + reversed(i, log_n)] = ref[b * N + i];
+        }
+      }
+      EXPECT_GT(snr(out.data(), bitrev.data(), N * batch), 120.0) << "N = " << N << ", inverse = " << inv;
+    }
+  }
+}
+
+/**
+ * \brief fftmodelf_c2c_1d_natural() reorders the output of fftmodelf_c2c_1d() without changing it, storing a burst per transform
+ */
+TEST(fft1dModelTest, NaturalOrder){
+  const unsigned batch = 3;
+  for(unsigned log_n = 6; log_n <= 9; log_n++){
+    const unsigned N = 1 << log_n;
+    std::vector<float2> inp(N * batch), ref(N * batch), out(N * batch), out_bitrev(N * batch);
+    reference_1d(N, inp.data(), ref.data(), false, batch);
+
+    fftmodel_stats_t stats[FFTMODEL_NUM_KERNELS];
+
+    ASSERT_EQ(fftmodelf_c2c_1d(N, inp.data(), out_bitrev.data(), false, batch).valid, 1);
+    fftmodel_get_stats(stats);
+    EXPECT_EQ(stats[FFTMODEL_FFT1D].bursts, 1ul) << "N = " << N;
+    EXPECT_EQ(stats[FFTMODEL_STORE].iterations, 0ul) << "N = " << N;
+
+    ASSERT_EQ(fftmodelf_c2c_1d_natural(N, inp.data(), out.data(), false, batch).valid, 1);
+    fftmodel_get_stats(stats);
+
+    // rows of 8 points are stored in bit reversed order, only the last row of
+    // a transform continuing with the first row of the next
+    EXPECT_EQ(stats[FFTMODEL_STORE].bursts, (unsigned long)(batch * N / 8 - (batch - 1))) << "N = " << N;
+    EXPECT_EQ(stats[FFTMODEL_STORE].iterations, (unsigned long)((batch + 1) * N / 8)) << "N = " << N;
+
+    for(unsigned b = 0; b < batch; b++){
+      for(unsigned i = 0; i < N; i++){
+        EXPECT_EQ(memcmp(&out[b * N + reversed(i, log_n)], &out_bitrev[b * N + i], sizeof(float2)), 0) << "N = " << N << ", b = " << b << ", i = " << i;
+      }
+    }
+    EXPECT_GT(snr(out.data(), ref.data(), N * batch), 120.0) << "N = " << N;
+  }
+}
+
+/**
+ * \brief fftmodelf_c2c_1d_large() against FFTW in natural order, forward and backward
+ */
+TEST(fft1dModelTest, Large){
+  for(unsigned n : {16u, 32u, 64u}){
+    const unsigned N = n * n;
+    std::vector<float2> inp(N), ref(N), out(N);
+
+    // null ptr inputs and sizes not being the square of a supported engine
+    EXPECT_EQ(fftmodelf_c2c_1d_large(N, NULL, out.data(), false).valid, 0);
+    EXPECT_EQ(fftmodelf_c2c_1d_large(N / 2, inp.data(), out.data(), false).valid, 0);
+
+    for(bool inv : {false, true}){
+      reference_1d(N, inp.data(), ref.data(), inv, 1);
+
+      fpga_t fft_time = fftmodelf_c2c_1d_large(N, inp.data(), out.data(), inv);
+      ASSERT_EQ(fft_time.valid, 1);
+      EXPECT_GT(snr(out.data(), ref.data(), N), 120.0) << "N = " << N << ", inverse = " << inv;
+    }
+  }
+}
+
+/**
+ * \brief addresses of fetch and transpose in the two passes of fftmodelf_c2c_1d_large()
+ */
+TEST(fft1dModelTest, LargeBursts){
+  const unsigned n = 64, N = n * n;
+  std::vector<float2> inp(N), ref(N), out(N);
+  reference_1d(N, inp.data(), ref.data(), false, 1);
+
+  ASSERT_EQ(fftmodelf_c2c_1d_large(N, inp.data(), out.data(), false).valid, 1);
+
+  fftmodel_stats_t stats[FFTMODEL_NUM_KERNELS];
+  fftmodel_get_stats(stats);
+
+  // the columns fetched by the first pass are n points apart, the second
+  // pass reads its input in order
+  EXPECT_EQ(stats[FFTMODEL_FETCH].bursts, (unsigned long)(n * n / 8 + 1));
+
+  // both passes write 8 points to each of the n transposed rows per group
+  EXPECT_EQ(stats[FFTMODEL_TRANSPOSE].bursts, (unsigned long)(2 * n * n / 8));
+
+  // the engine drains n / 8 - 1 iterations per pass, the twiddle stage none
+  EXPECT_EQ(stats[FFTMODEL_FFT2D].iterations, (unsigned long)(2 * (n * n / 8 + n / 8 - 1)));
+  EXPECT_EQ(stats[FFTMODEL_TWIDDLE].iterations, (unsigned long)(2 * n * n / 8));
+}
@@ -0,0 +1,442 @@
+//  Author: Arjun Ramaswami
+
+#include <iostream>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <fftw3.h>
+#include "gtest/gtest.h"
+
+extern "C" {
+  #include "fftmodel/fftmodel.h"
+}
+#include "model_helper.hpp"
+
+/**
+ * \brief  create deterministic random input and compute the reference using FFTW
+ */
+static void reference_3d(const unsigned N, float2 *inp, float2 *ref, const bool inv, const unsigned how_many){
+  const size_t num_pts = (size_t)N * N * N * how_many;
+  srand(N);
+  for(size_t i = 0; i < num_pts; i++){
+    inp[i].x = (float)rand() / (float)RAND_MAX;
+    inp[i].y = (float)rand() / (float)RAND_MAX;
+  }
+
+  int n[3] = {(int)N, (int)N, (int)N};
+  int dist = N * N * N;
+  fftwf_plan plan = fftwf_plan_many_dft(3, n, how_many, (fftwf_complex*)inp, NULL, 1, dist, (fftwf_complex*)ref, NULL, 1, dist, inv ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE);
+  fftwf_execute(plan);
+  fftwf_destroy_plan(plan);
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_ddr()
+ */
+TEST(fft3dModelTest, InputValidity){
+  const unsigned N = 16;
+  const size_t sz = sizeof(float2) * N * N * N;
+
+  float2 *test = (float2*)malloc(sz);
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+
+  // null inp ptr input
+  fft_time = fftmodelf_c2c_3d_ddr(N, NULL, test, 0, 1);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // null out ptr input
+  fft_time = fftmodelf_c2c_3d_ddr(N, test, NULL, 0, 1);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // if N not a power of 2
+  fft_time = fftmodelf_c2c_3d_ddr(63, test, test, 0, 1);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // if N not supported by the kernels
+  fft_time = fftmodelf_c2c_3d_ddr(8, test, test, 0, 1);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // if how_many is 0
+  fft_time = fftmodelf_c2c_3d_ddr(N, test, test, 0, 0);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  free(test);
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_ddr() against FFTW, forward and backward
+ */
+TEST(fft3dModelTest, CorrectnessDDR){
+  const unsigned how_many = 2;
+
+  for(unsigned N = 16; N <= 32; N *= 2){
+    for(int inv = 0; inv <= 1; inv++){
+      const size_t num_pts = (size_t)N * N * N * how_many;
+      float2 *inp = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+      float2 *ref = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+      float2 *out = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+
+      reference_3d(N, inp, ref, inv, how_many);
+
+      fpga_t fft_time = fftmodelf_c2c_3d_ddr(N, inp, out, inv, how_many);
+      EXPECT_EQ(fft_time.valid, 1);
+      EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+      EXPECT_GT(snr(out, ref, num_pts), 120.0) << "N = " << N << ", inverse = " << inv;
+
+      fftwf_free(inp);
+      fftwf_free(ref);
+      fftwf_free(out);
+    }
+  }
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_ddr_transposed() leaves the transform in x-y-z order, and transforming it back returns to the natural order
+ */
+TEST(fft3dModelTest, TransposedRoundTrip){
+  const unsigned N = 16;
+  const size_t num_pts = (size_t)N * N * N;
+  float2 *inp = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *ref = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *transposed = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *back = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+
+  reference_3d(N, inp, ref, false, 1);
+
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, inp, out, false, 1).valid, 1);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_transposed(N, inp, transposed, false, 1).valid, 1);
+
+  // same operations in the same order, only stored in another order
+  size_t mismatches = 0;
+  for(unsigned z = 0; z < N; z++){
+    for(unsigned y = 0; y < N; y++){
+      for(unsigned x = 0; x < N; x++){
+        float2 a = transposed[(x * N + y) * N + z], b = out[(z * N + y) * N + x];
+        if(memcmp(&a, &b, sizeof(float2)) != 0)
+          mismatches++;
+      }
+    }
+  }
+  EXPECT_EQ(mismatches, 0);
+
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_transposed(N, transposed, back, true, 1).valid, 1);
+  for(size_t i = 0; i < num_pts; i++){
+    back[i].x /= num_pts;
+    back[i].y /= num_pts;
+  }
+  EXPECT_GT(snr(back, inp, num_pts), 120.0);
+
+  fftwf_free(inp);
+  fftwf_free(ref);
+  fftwf_free(out);
+  fftwf_free(transposed);
+  fftwf_free(back);
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_ddr_tiled() computes the same output, reading the cube of transpose3D in a single burst
+ */
+TEST(fft3dModelTest, TiledLayout){
+  const unsigned N = 32;
+  const size_t num_pts = (size_t)N * N * N;
+  float2 *inp = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *ref = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *out_tiled = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+
+  reference_3d(N, inp, ref, false, 1);
+
+  fftmodel_stats_t stats[FFTMODEL_NUM_KERNELS], stats_tiled[FFTMODEL_NUM_KERNELS];
+
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, inp, out, false, 1).valid, 1);
+  fftmodel_get_stats(stats);
+
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_tiled(N, inp, out_tiled, false, 1).valid, 1);
+  fftmodel_get_stats(stats_tiled);
+
+  EXPECT_EQ(memcmp(out, out_tiled, sizeof(float2) * num_pts), 0);
+
+  // the write of a plane is contiguous, the read bursts over a row of N points
+  EXPECT_EQ(stats[FFTMODEL_TRANSPOSE3D_WR].bursts, 1);
+  EXPECT_EQ(stats[FFTMODEL_TRANSPOSE3D_RD].bursts, N * N);
+
+  // tiled, the read is contiguous and the write bursts over a row
+  EXPECT_EQ(stats_tiled[FFTMODEL_TRANSPOSE3D_WR].bursts, N * N);
+  EXPECT_EQ(stats_tiled[FFTMODEL_TRANSPOSE3D_RD].bursts, 1);
+
+  EXPECT_EQ(stats[FFTMODEL_FETCH].bursts, stats_tiled[FFTMODEL_FETCH].bursts);
+  EXPECT_EQ(stats[FFTMODEL_STORE].bursts, stats_tiled[FFTMODEL_STORE].bursts);
+
+  fftwf_free(inp);
+  fftwf_free(ref);
+  fftwf_free(out);
+  fftwf_free(out_tiled);
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_large() computes the same output as fftmodelf_c2c_3d_ddr(), the engines transforming the same rows
+ */
+TEST(fft3dModelTest, Large){
+  for(unsigned N : {16u, 32u}){
+    const size_t num_pts = (size_t)N * N * N;
+    float2 *inp = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+    float2 *ref = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+    float2 *out = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+    float2 *out_large = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+
+    // null ptr inputs and sizes not supported by the engine
+    EXPECT_EQ(fftmodelf_c2c_3d_large(N, NULL, out_large, false).valid, 0);
+    EXPECT_EQ(fftmodelf_c2c_3d_large(N - 1, inp, out_large, false).valid, 0);
+
+    for(bool inv : {false, true}){
+      reference_3d(N, inp, ref, inv, 1);
+
+      EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, inp, out, inv, 1).valid, 1);
+      fpga_t fft_time = fftmodelf_c2c_3d_large(N, inp, out_large, inv);
+      EXPECT_EQ(fft_time.valid, 1);
+      EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+
+      EXPECT_EQ(memcmp(out, out_large, sizeof(float2) * num_pts), 0) << "N = " << N << ", inverse = " << inv;
+    }
+
+    fftwf_free(inp);
+    fftwf_free(ref);
+    fftwf_free(out);
+    fftwf_free(out_large);
+  }
+}
+
+/**
+ * \brief bursts of the passes of fftmodelf_c2c_3d_large(), the z pass fetching the tiles written by the y pass
+ */
+TEST(fft3dModelTest, LargeBursts){
+  const unsigned N = 32;
+  const size_t num_pts = (size_t)N * N * N;
+  float2 *inp = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *ref = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+
+  reference_3d(N, inp, ref, false, 1);
+  EXPECT_EQ(fftmodelf_c2c_3d_large(N, inp, out, false).valid, 1);
+
+  fftmodel_stats_t stats[FFTMODEL_NUM_KERNELS];
+  fftmodel_get_stats(stats);
+
+  // every fetch of the 3 stages reads its plane in a single burst
+  EXPECT_EQ(stats[FFTMODEL_FETCH].bursts, 3 * N);
+
+  // every transpose writes 8 points to each of the N rows of its work-groups
+  EXPECT_EQ(stats[FFTMODEL_TRANSPOSE].bursts, 3 * N * (N * N / 8));
+
+  EXPECT_EQ(stats[FFTMODEL_FFT2D].iterations, 3 * N * (N * N / 8 + N / 8 - 1));
+
+  fftwf_free(inp);
+  fftwf_free(ref);
+  fftwf_free(out);
+}
+
+/**
+ * \brief fftmodel_set_channel_depth() changes the schedule but not the results
+ */
+TEST(fft3dModelTest, ChannelDepth){
+  const unsigned N = 16;
+  const size_t num_pts = (size_t)N * N * N;
+  float2 *inp = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *ref = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+  float2 *out_shallow = (float2*)fftwf_malloc(sizeof(float2) * num_pts);
+
+  reference_3d(N, inp, ref, false, 1);
+
+  fftmodel_stats_t stats[FFTMODEL_NUM_KERNELS], stats_shallow[FFTMODEL_NUM_KERNELS];
+
+  fftmodel_set_channel_depth(0);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, inp, out, false, 1).valid, 1);
+  fftmodel_get_stats(stats);
+
+  fftmodel_set_channel_depth(1);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, inp, out_shallow, false, 1).valid, 1);
+  fftmodel_get_stats(stats_shallow);
+  fftmodel_set_channel_depth(0);
+
+  EXPECT_EQ(memcmp(out, out_shallow, sizeof(float2) * num_pts), 0);
+
+  // every kernel of the pipeline iterates over N^3 / 8 points and the additional iterations to fill its buffers
+  for(unsigned i = 0; i <= FFTMODEL_STORE; i++){
+    EXPECT_GE(stats[i].iterations, num_pts / 8);
+    EXPECT_EQ(stats[i].iterations, stats_shallow[i].iterations);
+  }
+
+  fftwf_free(inp);
+  fftwf_free(ref);
+  fftwf_free(out);
+  fftwf_free(out_shallow);
+}
+
+/**
+ * \brief  coefficients of a sphere of radius N / 4 around the origin of the periodic cube
+ */
+static std::vector<unsigned> sphere_map(const unsigned N){
+  std::vector<unsigned> map;
+  for(unsigned z = 0; z < N; z++){
+    for(unsigned y = 0; y < N; y++){
+      for(unsigned x = 0; x < N; x++){
+        int dz = (z < N / 2) ? z : z - N, dy = (y < N / 2) ? y : y - N, dx = (x < N / 2) ? x : x - N;
+        if(dz * dz + dy * dy + dx * dx <= (int)(N * N / 16))
+          map.push_back((z * N + y) * N + x);
+      }
+    }
+  }
+  return map;
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_sphere_to_grid() and fftmodelf_c2c_3d_grid_to_sphere() address the coefficients of the map as the dense cube does
+ */
+TEST(fft3dModelTest, SphereAccess){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<unsigned> map = sphere_map(N);
+  const size_t num = map.size();
+
+  std::vector<float2> packed(num), packed_out(num), cube(num_pts), grid(num_pts), ref(num_pts);
+  for(size_t i = 0; i < num; i++){
+    packed[i].x = (float)(i % 7);
+    packed[i].y = (float)(i % 5);
+    cube[map[i]] = packed[i];
+  }
+
+  // invalid sizes, maps and pointers
+  EXPECT_EQ(fftmodelf_c2c_3d_sphere_to_grid(N - 1, map.data(), num, packed.data(), grid.data(), true).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_sphere_to_grid(N, NULL, num, packed.data(), grid.data(), true).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_sphere_to_grid(N, map.data(), num, NULL, grid.data(), true).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_grid_to_sphere(N, map.data(), num, grid.data(), NULL, false).valid, 0);
+
+  std::vector<unsigned> repeated(map);
+  repeated[1] = repeated[0];
+  EXPECT_EQ(fftmodelf_c2c_3d_sphere_to_grid(N, repeated.data(), num, packed.data(), grid.data(), true).valid, 0);
+
+  std::vector<unsigned> outside(map);
+  outside[0] = num_pts;
+  EXPECT_EQ(fftmodelf_c2c_3d_sphere_to_grid(N, outside.data(), num, packed.data(), grid.data(), true).valid, 0);
+
+  // scattering in fetch equals the transform of the scattered cube
+  fpga_t fft_time = fftmodelf_c2c_3d_sphere_to_grid(N, map.data(), num, packed.data(), grid.data(), true);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, cube.data(), ref.data(), true, 1).valid, 1);
+  EXPECT_EQ(memcmp(grid.data(), ref.data(), sizeof(float2) * num_pts), 0);
+
+  // gathering in store equals picking the coefficients of the dense transform
+  EXPECT_EQ(fftmodelf_c2c_3d_grid_to_sphere(N, map.data(), num, grid.data(), packed_out.data(), false).valid, 1);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, grid.data(), ref.data(), false, 1).valid, 1);
+  for(size_t i = 0; i < num; i++){
+    EXPECT_EQ(packed_out[i].x, ref[map[i]].x);
+    EXPECT_EQ(packed_out[i].y, ref[map[i]].y);
+  }
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_ddr_pruned() pads the input subcube and crops the output subcube as the dense cube does
+ */
+TEST(fft3dModelTest, PrunedAccess){
+  const unsigned N = 16, m_in = N / 2, m_out = N / 4;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(m_in * m_in * m_in), out(m_out * m_out * m_out), padded(num_pts), ref(num_pts);
+  for(unsigned z = 0; z < m_in; z++){
+    for(unsigned y = 0; y < m_in; y++){
+      for(unsigned x = 0; x < m_in; x++){
+        unsigned i = (z * m_in + y) * m_in + x;
+        inp[i].x = (float)(i % 7);
+        inp[i].y = (float)(i % 5);
+        padded[(z * N + y) * N + x] = inp[i];
+      }
+    }
+  }
+
+  // invalid sizes and pointers
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_pruned(N, N + 1, m_out, inp.data(), out.data(), false).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_pruned(N, m_in, 0, inp.data(), out.data(), false).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_pruned(N - 1, m_in, m_out, inp.data(), out.data(), false).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_pruned(N, m_in, m_out, NULL, out.data(), false).valid, 0);
+
+  fpga_t fft_time = fftmodelf_c2c_3d_ddr_pruned(N, m_in, m_out, inp.data(), out.data(), false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, padded.data(), ref.data(), false, 1).valid, 1);
+
+  for(unsigned z = 0; z < m_out; z++){
+    for(unsigned y = 0; y < m_out; y++){
+      for(unsigned x = 0; x < m_out; x++){
+        EXPECT_EQ(out[(z * m_out + y) * m_out + x].x, ref[(z * N + y) * N + x].x);
+        EXPECT_EQ(out[(z * m_out + y) * m_out + x].y, ref[(z * N + y) * N + x].y);
+      }
+    }
+  }
+}
+
+/**
+ * \brief fftmodelf_gradient3d() differentiates a periodic field, the Nyquist frequency being dropped
+ */
+TEST(fft3dModelTest, Gradient){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  const double w = 2.0 * M_PI / N;
+  std::vector<float2> inp(num_pts), grad_x(num_pts), grad_y(num_pts), grad_z(num_pts);
+  for(unsigned z = 0; z < N; z++){
+    for(unsigned y = 0; y < N; y++){
+      for(unsigned x = 0; x < N; x++){
+        inp[(z * N + y) * N + x].x = (float)(sin(w * x) + cos(2 * w * y) + sin(3 * w * z) + cos(M_PI * x));
+        inp[(z * N + y) * N + x].y = 0.0f;
+      }
+    }
+  }
+
+  EXPECT_EQ(fftmodelf_gradient3d(N, NULL, grad_x.data(), grad_y.data(), grad_z.data(), 1.0f).valid, 0);
+  EXPECT_EQ(fftmodelf_gradient3d(N - 1, inp.data(), grad_x.data(), grad_y.data(), grad_z.data(), 1.0f).valid, 0);
+
+  // box of length N, normalizing the backward transforms
+  fpga_t fft_time = fftmodelf_gradient3d(N, inp.data(), grad_x.data(), grad_y.data(), grad_z.data(), (float)(w / num_pts));
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+
+  for(unsigned z = 0; z < N; z++){
+    for(unsigned y = 0; y < N; y++){
+      for(unsigned x = 0; x < N; x++){
+        const size_t i = (z * N + y) * N + x;
+        EXPECT_NEAR(grad_x[i].x, w * cos(w * x), 1e-4);
+        EXPECT_NEAR(grad_y[i].x, -2 * w * sin(2 * w * y), 1e-4);
+        EXPECT_NEAR(grad_z[i].x, 3 * w * cos(3 * w * z), 1e-4);
+        EXPECT_NEAR(grad_x[i].y, 0.0, 1e-4);
+      }
+    }
+  }
+}
+
+/**
+ * \brief fftmodelf_c2c_3d_ddr_split() computes the transform of the interleaved parts
+ */
+TEST(fft3dModelTest, SplitAccess){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float> re(num_pts), im(num_pts), out_re(num_pts), out_im(num_pts);
+  std::vector<float2> inp(num_pts), ref(num_pts);
+  for(unsigned i = 0; i < num_pts; i++){
+    re[i] = inp[i].x = (float)(i % 11);
+    im[i] = inp[i].y = (float)(i % 3);
+  }
+
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_split(N, re.data(), im.data(), NULL, out_im.data(), false).valid, 0);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr_split(N - 1, re.data(), im.data(), out_re.data(), out_im.data(), false).valid, 0);
+
+  fpga_t fft_time = fftmodelf_c2c_3d_ddr_split(N, re.data(), im.data(), out_re.data(), out_im.data(), false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_MODEL);
+  EXPECT_EQ(fftmodelf_c2c_3d_ddr(N, inp.data(), ref.data(), false, 1).valid, 1);
+
+  for(unsigned i = 0; i < num_pts; i++){
+    EXPECT_EQ(out_re[i], ref[i].x);
+    EXPECT_EQ(out_im[i], ref[i].y);
+  }
+}
@@ -2,11 +2,14 @@
 
 #include "gtest/gtest.h"  // finds this because gtest is linked
 #include <iostream>
+#include <vector>
 #include <fftw3.h>
 
 extern "C" {
   #include "CL/opencl.h"
   #include "fftfpga/fftfpga.h"
+  #include "bitrev.h"
+  #include "convert.h"
 }
 #include "helper.hpp"
 
@@ -67,4 +70,98 @@ TEST(fft1dFPGATest, InputValiditySVM){
   free(test);
 
   fpga_final();
-}
\ No newline at end of file
+}
+
+static unsigned reversed(unsigned x, const unsigned bits){
+  unsigned y = 0;
+  for(unsigned i = 0; i < bits; i++){
+    y = (y << 1) | (x & 1);
+    x >>= 1;
+  }
+  return y;
+}
+
+/**
+ * \brief bitrev_permute() for sizes with and without complete tiles
+ */
+TEST(fft1dFPGATest, BitReversePermutation){
+  const unsigned how_many = 3;
+  for(unsigned log_n = 0; log_n <= 16; log_n++){
+    const unsigned N = 1u << log_n;
+    std::vector<float2> inp(N * how_many), out(N * how_many);
+    for(unsigned i = 0; i < N * how_many; i++){
+      inp[i].x = (float)i;
+      inp[i].y = -(float)i;
+    }
+
+    bitrev_permute(out.data(), inp.data(), N, how_many, 4);
+
+    for(unsigned b = 0; b < how_many; b++){
+      for(unsigned i = 0; i < N; i++){
+        EXPECT_EQ(out[b * N + reversed(i, log_n)].x, inp[b * N + i].x) << "N = " << N;
+        EXPECT_EQ(out[b * N + reversed(i, log_n)].y, inp[b * N + i].y) << "N = " << N;
+      }
+    }
+  }
+}
+
+/**
+ * \brief convert_narrow() and convert_widen() round as the scalar conversions, for sizes with and without complete vectors
+ */
+TEST(fft1dFPGATest, PrecisionConversion){
+  for(size_t num_pts : {1, 3, 4, 7, 4099, 3 * 65536 + 5}){
+    std::vector<double2> inp(num_pts), wide(num_pts);
+    std::vector<float2> narrow(num_pts);
+    for(size_t i = 0; i < num_pts; i++){
+      inp[i].x = 1.0 / (double)(i + 3);
+      inp[i].y = -(double)i * 1e-3;
+    }
+
+    convert_narrow(narrow.data(), inp.data(), num_pts, 4);
+    convert_widen(wide.data(), narrow.data(), num_pts, 4);
+
+    for(size_t i = 0; i < num_pts; i++){
+      EXPECT_EQ(narrow[i].x, (float)inp[i].x) << "num_pts = " << num_pts;
+      EXPECT_EQ(narrow[i].y, (float)inp[i].y) << "num_pts = " << num_pts;
+      EXPECT_EQ(wide[i].x, (double)narrow[i].x) << "num_pts = " << num_pts;
+      EXPECT_EQ(wide[i].y, (double)narrow[i].y) << "num_pts = " << num_pts;
+    }
+  }
+}
+
+/**
+ * \brief fftfpgaf_c2c_1d_natural(), the reordering is modelled in tests/model
+ */
+TEST(fft1dFPGATest, NaturalOrderValidity){
+  const unsigned N = 1024, batch = 2;
+  std::vector<float2> inp(N * batch), out(N * batch);
+
+  // null ptr inputs and sizes smaller than the engine
+  EXPECT_EQ(fftfpgaf_c2c_1d_natural(N, NULL, out.data(), false, batch).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_1d_natural(4, inp.data(), out.data(), false, batch).valid, 0);
+}
+
+/**
+ * \brief fftfpga_c2c_1d(), the chunked conversions are tested by PrecisionConversion and in tests/mock
+ */
+TEST(fft1dFPGATest, DoubleValidity){
+  const unsigned N = 1024, batch = 3;
+  std::vector<double2> inp(N * batch), out(N * batch);
+
+  // null ptr inputs, empty batches and N not a power of 2
+  EXPECT_EQ(fftfpga_c2c_1d(N, NULL, out.data(), false, batch).valid, 0);
+  EXPECT_EQ(fftfpga_c2c_1d(N, inp.data(), out.data(), false, 0).valid, 0);
+  EXPECT_EQ(fftfpga_c2c_1d(N - 1, inp.data(), out.data(), false, batch).valid, 0);
+}
+
+/**
+ * \brief fftfpgaf_c2c_1d_large(), the passes of the 2D engine are modelled in tests/model
+ */
+TEST(fft1dFPGATest, LargeValidity){
+  const unsigned N = 4096;
+  std::vector<float2> inp(N), out(N);
+
+  // null ptr inputs and sizes not being the square of a power of 2
+  EXPECT_EQ(fftfpgaf_c2c_1d_large(N, NULL, out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_1d_large(N / 2, inp.data(), out.data(), false).valid, 0);
+}
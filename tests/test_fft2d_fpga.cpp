@@ -1,6 +1,7 @@
 //  Author: Arjun Ramaswami
 
 #include <iostream>
+#include <vector>
 #include "gtest/gtest.h" 
 #include <math.h>
 #include <fftw3.h>
@@ -59,4 +60,33 @@ TEST(fft2dFPGATest, InputValidityDDR){
   EXPECT_EQ(fft_time.valid, 0);
 
   free(test);
-}
\ No newline at end of file
+}
+
+/**
+ * \brief fftfpga_c2c_2d_ddr() on the host computes the single precision transform of the double precision data
+ */
+TEST(fft2dFPGATest, DoubleOnHost){
+  const unsigned N = 64;
+  std::vector<double2> inp(N * N), out(N * N);
+  std::vector<float2> inp_f(N * N), ref(N * N);
+  for(unsigned i = 0; i < N * N; i++){
+    inp_f[i].x = (float)(inp[i].x = (double)(i % 7));
+    inp_f[i].y = (float)(inp[i].y = -(double)(i % 5));
+  }
+
+  EXPECT_EQ(fftfpga_c2c_2d_ddr(N, inp.data(), NULL, false).valid, 0);
+
+  fftfpga_set_fallback(true, 0, 0);
+
+  fpga_t fft_time = fftfpga_c2c_2d_ddr(N, inp.data(), out.data(), false);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_CPU);
+  EXPECT_EQ(fftfpgaf_c2c_2d_ddr(N, inp_f.data(), ref.data(), false).valid, 1);
+
+  for(unsigned i = 0; i < N * N; i++){
+    EXPECT_FLOAT_EQ((float)out[i].x, ref[i].x);
+    EXPECT_FLOAT_EQ((float)out[i].y, ref[i].y);
+  }
+
+  fftfpga_set_fallback(false, 0, 32768);
+}
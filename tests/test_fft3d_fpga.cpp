@@ -1,6 +1,9 @@
 //  Author: Arjun Ramaswami
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 #include "gtest/gtest.h" 
 #include <fftw3.h>
 #include "helper.hpp"
@@ -92,3 +95,261 @@ TEST(fft3dFPGATest, InputValidityDDRSVMBatch){
 
   free(test);
 }
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_batch_hybrid()
+ */
+TEST(fft3dFPGATest, InputValidityDDRBatchHybrid){
+  const unsigned N = 64;
+  const size_t sz = sizeof(float2) * N * N * N * 2;
+
+  float2 *test = (float2*)malloc(sz);
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+
+  // null inp ptr input
+  fft_time = fftfpgaf_c2c_3d_ddr_batch_hybrid(64, NULL, test, 0, 0, 2);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // null out ptr input
+  fft_time = fftfpgaf_c2c_3d_ddr_batch_hybrid(64, test, NULL, 0, 0, 2);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // if N not a power of 2
+  fft_time = fftfpgaf_c2c_3d_ddr_batch_hybrid(63, test, test, 0, 0, 2);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // howmany is 0 
+  fft_time = fftfpgaf_c2c_3d_ddr_batch_hybrid(64, test, test, 0, 0, 0);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  free(test);
+}
+
+/**
+ * \brief fftfpga_set_fallback()
+ */
+TEST(fft3dFPGATest, FallbackToHost){
+  const unsigned N = 63;
+  const size_t sz = sizeof(float2) * N * N * N;
+
+  float2 *inp = (float2*)malloc(sz);
+  float2 *out = (float2*)malloc(sz);
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+  for(unsigned i = 0; i < N * N * N; i++){
+    inp[i].x = 1.0f;
+    inp[i].y = 0.0f;
+  }
+
+  fftfpga_set_fallback(true, 0, 0);
+
+  // null ptr inputs remain invalid
+  fft_time = fftfpgaf_c2c_3d_ddr(N, NULL, out, 0);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // N not a power of 2 is computed on the host
+  fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, 0);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_CPU);
+  EXPECT_FLOAT_EQ(out[0].x, (float)(N * N * N));
+
+  fftfpga_set_fallback(false, 0, 32768);
+
+  fft_time = fftfpgaf_c2c_3d_ddr(N, inp, out, 0);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpga_c2c_3d_ddr() on the host computes the single precision transform of the double precision data
+ */
+TEST(fft3dFPGATest, DoubleOnHost){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<double2> inp(num_pts), out(num_pts);
+  std::vector<float2> inp_f(num_pts), ref(num_pts);
+  for(unsigned i = 0; i < num_pts; i++){
+    inp_f[i].x = (float)(inp[i].x = (double)(i % 11));
+    inp_f[i].y = (float)(inp[i].y = (double)(i % 3));
+  }
+
+  EXPECT_EQ(fftfpga_c2c_3d_ddr(N, NULL, out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpga_c2c_3d_ddr(N - 1, inp.data(), out.data(), false).valid, 0);
+
+  fftfpga_set_fallback(true, 0, 0);
+
+  fpga_t fft_time = fftfpga_c2c_3d_ddr(N, inp.data(), out.data(), true);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_CPU);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr(N, inp_f.data(), ref.data(), true).valid, 1);
+
+  for(unsigned i = 0; i < num_pts; i++){
+    EXPECT_FLOAT_EQ((float)out[i].x, ref[i].x);
+    EXPECT_FLOAT_EQ((float)out[i].y, ref[i].y);
+  }
+
+  fftfpga_set_fallback(false, 0, 32768);
+}
+
+/**
+ * \brief fftfpgaf_conv3d_set_kernel() and fftfpgaf_conv3d()
+ */
+TEST(fft3dFPGATest, InputValidityConv){
+  const unsigned N = 64;
+  const size_t sz = sizeof(float2) * N * N * N;
+
+  float2 *test = (float2*)malloc(sz);
+  fpga_t fft_time = {0.0, 0.0, 0.0, 0};
+
+  // null filter
+  fft_time = fftfpgaf_conv3d_set_kernel(N, NULL);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // if N not a power of 2
+  fft_time = fftfpgaf_conv3d_set_kernel(63, test);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // no filter set
+  fft_time = fftfpgaf_conv3d(N, test, test);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  // null ptr inputs
+  fft_time = fftfpgaf_conv3d(N, NULL, test);
+  EXPECT_EQ(fft_time.valid, 0);
+  fft_time = fftfpgaf_conv3d(N, test, NULL);
+  EXPECT_EQ(fft_time.valid, 0);
+
+  free(test);
+}
+
+/**
+ * \brief fftfpga_buffer_create() and fftfpgaf_c2c_3d_ddr_buffer() without a device
+ */
+TEST(fft3dFPGATest, BuffersOnHost){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+
+  float2 *inp = (float2*)malloc(sizeof(float2) * num_pts);
+  float2 *out = (float2*)malloc(sizeof(float2) * num_pts);
+  for(unsigned i = 0; i < num_pts; i++){
+    inp[i].x = (float)(i % 7);
+    inp[i].y = 1.0f;
+  }
+
+  fftfpga_buffer_t *field = fftfpga_buffer_create(num_pts);
+  ASSERT_TRUE(field != NULL);
+
+  // null handles
+  EXPECT_EQ(fftfpga_buffer_write(NULL, inp).valid, 0);
+  EXPECT_EQ(fftfpga_buffer_read(field, NULL).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, NULL, field, 0).valid, 0);
+
+  EXPECT_EQ(fftfpga_buffer_write(field, inp).valid, 1);
+
+  // without a device, transforms require the fallback
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, field, field, 0).valid, 0);
+
+  fftfpga_set_fallback(true, 0, 0);
+
+  // forward and backward transform in place scale the input by the number of points
+  fpga_t fft_time = fftfpgaf_c2c_3d_ddr_buffer(N, field, field, 0);
+  EXPECT_EQ(fft_time.valid, 1);
+  EXPECT_EQ(fft_time.backend, FFTFPGA_BACKEND_CPU);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_buffer(N, field, field, 1).valid, 1);
+
+  EXPECT_EQ(fftfpga_buffer_read(field, out).valid, 1);
+  for(unsigned i = 0; i < num_pts; i++){
+    EXPECT_NEAR(out[i].x / num_pts, inp[i].x, 1e-3);
+    EXPECT_NEAR(out[i].y / num_pts, inp[i].y, 1e-3);
+  }
+
+  fftfpga_set_fallback(false, 0, 32768);
+
+  fftfpga_buffer_free(field);
+  free(inp);
+  free(out);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_large(), the passes of the 2D engine are modelled in tests/model
+ */
+TEST(fft3dFPGATest, LargeValidity){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(num_pts), out(num_pts);
+
+  // null ptr inputs and N not a power of 2
+  EXPECT_EQ(fftfpgaf_c2c_3d_large(N, NULL, out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_large(N - 1, inp.data(), out.data(), false).valid, 0);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_transposed(), the order of its output is tested on the software model in tests/model
+ */
+TEST(fft3dFPGATest, TransposedValidity){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(num_pts), out(num_pts);
+
+  // null ptr inputs and N not a power of 2
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_transposed(N, NULL, out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_transposed(N - 1, inp.data(), out.data(), false).valid, 0);
+}
+
+/**
+ * \brief fftfpgaf_gradient3d(), the differentiation of the spectrum is tested on the software model in tests/model
+ */
+TEST(fft3dFPGATest, GradientValidity){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float2> inp(num_pts), grad_x(num_pts), grad_y(num_pts), grad_z(num_pts);
+
+  // null ptr inputs and N not a power of 2
+  EXPECT_EQ(fftfpgaf_gradient3d(N, NULL, grad_x.data(), grad_y.data(), grad_z.data(), 1.0f).valid, 0);
+  EXPECT_EQ(fftfpgaf_gradient3d(N, inp.data(), grad_x.data(), NULL, grad_z.data(), 1.0f).valid, 0);
+  EXPECT_EQ(fftfpgaf_gradient3d(N - 1, inp.data(), grad_x.data(), grad_y.data(), grad_z.data(), 1.0f).valid, 0);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_split(), the access of the separate parts is tested on the software model in tests/model
+ */
+TEST(fft3dFPGATest, SplitValidity){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<float> re(num_pts), im(num_pts), out_re(num_pts), out_im(num_pts);
+
+  // null ptr inputs and N not a power of 2
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_split(N, re.data(), im.data(), NULL, out_im.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_split(N - 1, re.data(), im.data(), out_re.data(), out_im.data(), false).valid, 0);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_ddr_pruned(), the padding and cropping of the subcubes is tested on the software model in tests/model
+ */
+TEST(fft3dFPGATest, PrunedValidity){
+  const unsigned N = 16, M = N / 2;
+  const size_t num_sub = M * M * M;
+  std::vector<float2> inp(num_sub), out(num_sub);
+
+  // null ptr inputs, subcubes empty or larger than the cube and N not a power of 2
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, M, M, NULL, out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, 0, M, inp.data(), out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N, N + 1, M, inp.data(), out.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_ddr_pruned(N - 1, M, M, inp.data(), out.data(), false).valid, 0);
+}
+
+/**
+ * \brief fftfpgaf_c2c_3d_sphere_to_grid() and fftfpgaf_c2c_3d_grid_to_sphere(), the addressing of the sphere is tested on the software model in tests/model
+ */
+TEST(fft3dFPGATest, SphereValidity){
+  const unsigned N = 16;
+  const size_t num_pts = N * N * N;
+  std::vector<unsigned> map = {0, 1, N, N * N};
+  std::vector<float2> packed(map.size()), grid(num_pts);
+
+  // the map has to be set first, for the same size
+  EXPECT_EQ(fftfpgaf_c2c_3d_sphere_to_grid(N, packed.data(), grid.data(), true).valid, 0);
+  EXPECT_EQ(fftfpgaf_c2c_3d_grid_to_sphere(N, grid.data(), packed.data(), false).valid, 0);
+  EXPECT_EQ(fftfpgaf_sphere_set_map(N - 1, map.data(), map.size()).valid, 0);
+}
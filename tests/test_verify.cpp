@@ -0,0 +1,78 @@
+//  Author: Arjun Ramaswami
+
+#include <iostream>
+#include <math.h>
+#include <vector>
+#include "gtest/gtest.h" 
+#include <fftw3.h>
+#include "helper.hpp"
+
+/**
+ * \brief  FFTW reference in natural order, 1D outputs bit reversed as by the FPGA unless natural
+ */
+static std::vector<float2> reference(const std::vector<float2> &inp, const unsigned num, const unsigned dim, const unsigned batch, const bool natural = false){
+  std::vector<float2> inp_copy(inp), out(inp.size());
+  int n[3] = {(int)num, (int)num, (int)num};
+  int dist = inp.size() / batch;
+  fftwf_plan plan = fftwf_plan_many_dft(dim, n, batch, (fftwf_complex*)inp_copy.data(), NULL, 1, dist, (fftwf_complex*)out.data(), NULL, 1, dist, FFTW_FORWARD, FFTW_ESTIMATE);
+  fftwf_execute(plan);
+  fftwf_destroy_plan(plan);
+
+  if(dim == 1 && !natural){
+    std::vector<float2> bitrev(out.size());
+    const unsigned bits = log2(num);
+    for(unsigned b = 0; b < batch; b++){
+      for(unsigned i = 0; i < num; i++){
+        unsigned r = 0;
+        for(unsigned k = 0; k < bits; k++)
+          r |= ((i >> k) & 1) << (bits - 1 - k);
+        bitrev[b * num + r] = out[b * num + i];
+      }
+    }
+    return bitrev;
+  }
+  return out;
+}
+
+/**
+ * \brief compare_fftwf() of exact and perturbed outputs
+ */
+TEST(fftVerifyTest, CompareFFTW){
+  const unsigned num = 16, batch = 2;
+
+  for(unsigned dim = 1; dim <= 3; dim++){
+    std::vector<float2> inp(batch * (size_t)pow(num, dim));
+    create_data(inp.data(), inp.size());
+    std::vector<float2> out = reference(inp, num, dim, batch);
+
+    VERIFY_STATS stats = compare_fftwf(inp.data(), out.data(), num, dim, batch, false);
+    EXPECT_GT(stats.snr, 120.0);
+    EXPECT_LT(stats.max_rel_err, 1e-5);
+
+    // perturbing a single point is reported by its absolute error
+    out[3].x += 1.0f;
+    stats = compare_fftwf(inp.data(), out.data(), num, dim, batch, false);
+    EXPECT_LT(stats.snr, 120.0);
+    EXPECT_NEAR(stats.max_abs_err, 1.0, 1e-3);
+
+    // a modified input is detected instead of using the cached reference
+    inp[0].x += 1.0f;
+    out = reference(inp, num, dim, batch);
+    stats = compare_fftwf(inp.data(), out.data(), num, dim, batch, false);
+    EXPECT_GT(stats.snr, 120.0);
+  }
+
+  // 1D outputs in natural order
+  std::vector<float2> inp(batch * num);
+  create_data(inp.data(), inp.size());
+  std::vector<float2> out = reference(inp, num, 1, batch, true);
+  EXPECT_GT(compare_fftwf(inp.data(), out.data(), num, 1, batch, false, true).snr, 120.0);
+  EXPECT_LT(compare_fftwf(inp.data(), out.data(), num, 1, batch, false, false).snr, 120.0);
+
+  // invalid arguments
+  std::vector<float2> data(num);
+  EXPECT_EQ(compare_fftwf(NULL, data.data(), num, 1, 1, false).snr, 0.0);
+  EXPECT_EQ(compare_fftwf(data.data(), data.data(), num, 4, 1, false).snr, 0.0);
+
+  verify_cleanup();
+}